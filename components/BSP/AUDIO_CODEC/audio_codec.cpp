@@ -0,0 +1,389 @@
+/**
+ * @file audio_codec.cpp
+ * @brief 上下行语音编解码：IMA ADPCM（内置）与 Opus（esp_audio_codec，可选）
+ */
+
+#include "audio_codec.h"
+
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#include "sdkconfig.h"
+#endif
+
+#if CONFIG_CLOUD_WS_OPUS
+#include "esp_audio_dec_def.h"
+#include "esp_audio_enc_def.h"
+#include "esp_opus_dec.h"
+#include "esp_opus_enc.h"
+#endif
+
+namespace audio_codec {
+
+namespace {
+
+const int16_t kStepTable[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+const int8_t kIndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8,
+                                -1, -1, -1, -1, 2, 4, 6, 8};
+
+inline int clampIndex(int index) {
+  return index < 0 ? 0 : (index > 88 ? 88 : index);
+}
+
+inline int clamp16(int v) {
+  return v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+}
+
+// 单样本编码，返回 4bit 码字并更新状态
+inline uint8_t encodeSample(int sample, int &pred, int &index) {
+  int step = kStepTable[index];
+  int diff = sample - pred;
+  uint8_t code = 0;
+  if (diff < 0) {
+    code = 8;
+    diff = -diff;
+  }
+  int vpdiff = step >> 3;
+  if (diff >= step) {
+    code |= 4;
+    diff -= step;
+    vpdiff += step;
+  }
+  step >>= 1;
+  if (diff >= step) {
+    code |= 2;
+    diff -= step;
+    vpdiff += step;
+  }
+  step >>= 1;
+  if (diff >= step) {
+    code |= 1;
+    vpdiff += step;
+  }
+  pred = clamp16((code & 8) ? pred - vpdiff : pred + vpdiff);
+  index = clampIndex(index + kIndexTable[code]);
+  return code;
+}
+
+inline int16_t decodeSample(uint8_t code, int &pred, int &index) {
+  const int step = kStepTable[index];
+  int vpdiff = step >> 3;
+  if (code & 4) {
+    vpdiff += step;
+  }
+  if (code & 2) {
+    vpdiff += step >> 1;
+  }
+  if (code & 1) {
+    vpdiff += step >> 2;
+  }
+  pred = clamp16((code & 8) ? pred - vpdiff : pred + vpdiff);
+  index = clampIndex(index + kIndexTable[code]);
+  return (int16_t)pred;
+}
+
+} // namespace
+
+size_t adpcmEncode(const int16_t *in, size_t n, uint8_t *out,
+                   AdpcmState &state) {
+  int pred = state.predictor;
+  int index = clampIndex(state.index);
+  const size_t bytes = n / 2;
+  for (size_t i = 0; i < bytes; ++i) {
+    const uint8_t hi = encodeSample(in[2 * i], pred, index);
+    const uint8_t lo = encodeSample(in[2 * i + 1], pred, index);
+    out[i] = (uint8_t)((hi << 4) | lo);
+  }
+  state.predictor = (int16_t)pred;
+  state.index = (uint8_t)index;
+  return bytes;
+}
+
+void adpcmDecode(const uint8_t *in, size_t len, int16_t *out,
+                 AdpcmState &state) {
+  int pred = state.predictor;
+  int index = clampIndex(state.index);
+  for (size_t i = 0; i < len; ++i) {
+    out[2 * i] = decodeSample((uint8_t)(in[i] >> 4), pred, index);
+    out[2 * i + 1] = decodeSample((uint8_t)(in[i] & 0x0F), pred, index);
+  }
+  state.predictor = (int16_t)pred;
+  state.index = (uint8_t)index;
+}
+
+} // namespace audio_codec
+
+namespace {
+
+constexpr int kFrameMs = 20;
+constexpr int kMaxDownlinkFrameMs = 120; // Opus 单包上限，ADPCM 同样按此限制
+
+/**
+ * @brief ADPCM：包头携带本包起始状态，包体为 frameSamples / 2 字节
+ */
+class AdpcmEncoder : public UplinkEncoder {
+public:
+  explicit AdpcmEncoder(int sampleRate)
+      : m_frameSamples((size_t)sampleRate * kFrameMs / 1000 & ~(size_t)1) {}
+
+  const char *format() const override { return "adpcm"; }
+  size_t frameSamples() const override { return m_frameSamples; }
+  size_t maxPacketBytes() const override {
+    return audio_codec::kAdpcmHeaderBytes + m_frameSamples / 2;
+  }
+
+  int encode(const int16_t *pcm, uint8_t *out) override {
+    const uint16_t pred = (uint16_t)m_state.predictor;
+    out[0] = (uint8_t)(pred & 0xFF);
+    out[1] = (uint8_t)(pred >> 8);
+    out[2] = m_state.index;
+    out[3] = 0;
+    const size_t body = audio_codec::adpcmEncode(
+        pcm, m_frameSamples, out + audio_codec::kAdpcmHeaderBytes, m_state);
+    return (int)(audio_codec::kAdpcmHeaderBytes + body);
+  }
+
+  void reset() override { m_state = audio_codec::AdpcmState{}; }
+
+private:
+  size_t m_frameSamples;
+  audio_codec::AdpcmState m_state;
+};
+
+/**
+ * @brief ADPCM 下行：包格式与上行相同（4 字节状态头 + 包体），包长可变
+ */
+class AdpcmDecoder : public DownlinkDecoder {
+public:
+  explicit AdpcmDecoder(int sampleRate)
+      : m_maxSamples((size_t)sampleRate * kMaxDownlinkFrameMs / 1000 &
+                     ~(size_t)1),
+        m_bytesPerSec((size_t)sampleRate / 2 +
+                      audio_codec::kAdpcmHeaderBytes * 1000 / kFrameMs) {}
+
+  const char *format() const override { return "adpcm"; }
+  size_t maxPacketBytes() const override {
+    return audio_codec::kAdpcmHeaderBytes + m_maxSamples / 2;
+  }
+  size_t maxFrameSamples() const override { return m_maxSamples; }
+  size_t bytesPerSecond() const override { return m_bytesPerSec; }
+
+  int decode(const uint8_t *packet, size_t len, int16_t *out) override {
+    if (len < audio_codec::kAdpcmHeaderBytes || len > maxPacketBytes()) {
+      return -1;
+    }
+    audio_codec::AdpcmState state;
+    state.predictor = (int16_t)(uint16_t)(packet[0] | (packet[1] << 8));
+    state.index = packet[2] > 88 ? 88 : packet[2];
+    const size_t body = len - audio_codec::kAdpcmHeaderBytes;
+    audio_codec::adpcmDecode(packet + audio_codec::kAdpcmHeaderBytes, body, out,
+                             state);
+    return (int)(body * 2);
+  }
+
+  void reset() override {} // 每包自带状态
+
+private:
+  size_t m_maxSamples;
+  size_t m_bytesPerSec;
+};
+
+#if CONFIG_CLOUD_WS_OPUS
+const char *TAG = "AudioCodec";
+
+/**
+ * @brief Opus（VOIP，20ms 帧），每帧一个包
+ */
+class OpusUplinkEncoder : public UplinkEncoder {
+public:
+  ~OpusUplinkEncoder() override { close(); }
+
+  esp_err_t open(int sampleRate) {
+    esp_opus_enc_config_t cfg = ESP_OPUS_ENC_CONFIG_DEFAULT();
+    cfg.sample_rate = sampleRate;
+    cfg.channel = 1;
+    cfg.bits_per_sample = 16;
+    cfg.bitrate = CONFIG_CLOUD_WS_UPLINK_OPUS_BITRATE;
+    cfg.frame_duration = ESP_OPUS_ENC_FRAME_DURATION_20_MS;
+    cfg.application_mode = ESP_OPUS_ENC_APPLICATION_VOIP;
+    cfg.complexity = 0;
+    cfg.enable_vbr = true;
+    m_cfg = cfg;
+    esp_audio_err_t ret = esp_opus_enc_open(&m_cfg, sizeof(m_cfg), &m_handle);
+    if (ret != ESP_AUDIO_ERR_OK || !m_handle) {
+      ESP_LOGE(TAG, "esp_opus_enc_open failed: %d", (int)ret);
+      m_handle = nullptr;
+      return ESP_FAIL;
+    }
+    int inBytes = 0;
+    int outBytes = 0;
+    esp_opus_enc_get_frame_size(m_handle, &inBytes, &outBytes);
+    m_frameSamples = (size_t)inBytes / sizeof(int16_t);
+    m_maxPacket = (size_t)outBytes;
+    return ESP_OK;
+  }
+
+  const char *format() const override { return "opus"; }
+  size_t frameSamples() const override { return m_frameSamples; }
+  size_t maxPacketBytes() const override { return m_maxPacket; }
+
+  int encode(const int16_t *pcm, uint8_t *out) override {
+    esp_audio_enc_in_frame_t in = {};
+    in.buffer = (uint8_t *)pcm;
+    in.len = (uint32_t)(m_frameSamples * sizeof(int16_t));
+    esp_audio_enc_out_frame_t outFrame = {};
+    outFrame.buffer = out;
+    outFrame.len = (uint32_t)m_maxPacket;
+    esp_audio_err_t ret = esp_opus_enc_process(m_handle, &in, &outFrame);
+    if (ret != ESP_AUDIO_ERR_OK) {
+      return -1;
+    }
+    return (int)outFrame.encoded_bytes;
+  }
+
+  void reset() override {
+    // 句间丢弃编码器历史，避免上一轮尾音影响下一轮首包
+    close();
+    open(m_cfg.sample_rate);
+  }
+
+private:
+  void close() {
+    if (m_handle) {
+      esp_opus_enc_close(m_handle);
+      m_handle = nullptr;
+    }
+  }
+
+  esp_opus_enc_config_t m_cfg = {};
+  void *m_handle = nullptr;
+  size_t m_frameSamples = 0;
+  size_t m_maxPacket = 0;
+};
+
+/**
+ * @brief Opus 下行：包长与帧长由服务器决定（最长 120ms）
+ */
+class OpusDownlinkDecoder : public DownlinkDecoder {
+public:
+  ~OpusDownlinkDecoder() override { close(); }
+
+  esp_err_t open(int sampleRate) {
+    esp_opus_dec_cfg_t cfg = ESP_OPUS_DEC_CONFIG_DEFAULT();
+    cfg.sample_rate = sampleRate;
+    cfg.channel = 1;
+    m_sampleRate = sampleRate;
+    esp_audio_err_t ret = esp_opus_dec_open(&cfg, sizeof(cfg), &m_handle);
+    if (ret != ESP_AUDIO_ERR_OK || !m_handle) {
+      ESP_LOGE(TAG, "esp_opus_dec_open failed: %d", (int)ret);
+      m_handle = nullptr;
+      return ESP_FAIL;
+    }
+    return ESP_OK;
+  }
+
+  const char *format() const override { return "opus"; }
+  size_t maxPacketBytes() const override { return 1276; } // RFC 6716 单帧上限
+  size_t maxFrameSamples() const override {
+    return (size_t)m_sampleRate * kMaxDownlinkFrameMs / 1000;
+  }
+  size_t bytesPerSecond() const override { return 24000 / 8; }
+
+  int decode(const uint8_t *packet, size_t len, int16_t *out) override {
+    esp_audio_dec_in_raw_t raw = {};
+    raw.buffer = (uint8_t *)packet;
+    raw.len = (uint32_t)len;
+    esp_audio_dec_out_frame_t frame = {};
+    frame.buffer = (uint8_t *)out;
+    frame.len = (uint32_t)(maxFrameSamples() * sizeof(int16_t));
+    esp_audio_dec_info_t info = {};
+    esp_audio_err_t ret = esp_opus_dec_decode(m_handle, &raw, &frame, &info);
+    if (ret != ESP_AUDIO_ERR_OK) {
+      return -1;
+    }
+    return (int)(frame.decoded_size / sizeof(int16_t));
+  }
+
+  void reset() override {
+    close();
+    open(m_sampleRate);
+  }
+
+private:
+  void close() {
+    if (m_handle) {
+      esp_opus_dec_close(m_handle);
+      m_handle = nullptr;
+    }
+  }
+
+  int m_sampleRate = 16000;
+  void *m_handle = nullptr;
+};
+#endif
+
+} // namespace
+
+std::unique_ptr<UplinkEncoder> UplinkEncoder::create(const char *format,
+                                                     int sampleRate) {
+  if (!format || sampleRate <= 0) {
+    return nullptr;
+  }
+  if (strcmp(format, "adpcm") == 0) {
+    return std::unique_ptr<UplinkEncoder>(new AdpcmEncoder(sampleRate));
+  }
+#if CONFIG_CLOUD_WS_OPUS
+  if (strcmp(format, "opus") == 0) {
+    std::unique_ptr<OpusUplinkEncoder> enc(new OpusUplinkEncoder());
+    if (enc->open(sampleRate) != ESP_OK) {
+      return nullptr;
+    }
+    return enc;
+  }
+#endif
+  return nullptr;
+}
+
+const char *const *UplinkEncoder::supportedFormats() {
+  static const char *const kFormats[] = {
+#if CONFIG_CLOUD_WS_OPUS
+      "opus",
+#endif
+      "adpcm", nullptr};
+  return kFormats;
+}
+
+std::unique_ptr<DownlinkDecoder> DownlinkDecoder::create(const char *format,
+                                                         int sampleRate) {
+  if (!format || sampleRate <= 0) {
+    return nullptr;
+  }
+  if (strcmp(format, "adpcm") == 0) {
+    return std::unique_ptr<DownlinkDecoder>(new AdpcmDecoder(sampleRate));
+  }
+#if CONFIG_CLOUD_WS_OPUS
+  if (strcmp(format, "opus") == 0) {
+    std::unique_ptr<OpusDownlinkDecoder> dec(new OpusDownlinkDecoder());
+    if (dec->open(sampleRate) != ESP_OK) {
+      return nullptr;
+    }
+    return dec;
+  }
+#endif
+  return nullptr;
+}
+
+const char *const *DownlinkDecoder::supportedFormats() {
+  return UplinkEncoder::supportedFormats();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+/**
+ * @brief 语音压缩编解码
+ *
+ * - IMA ADPCM：4:1，纯整数，开销可忽略；码流布局与 Python audioop
+ *   (lin2adpcm / adpcm2lin) 一致：每字节高半字节在前
+ * - Opus：需要 espressif/esp_audio_codec，选择 Opus 上行或下行
+ *   （CONFIG_CLOUD_WS_OPUS）时编译
+ */
+namespace audio_codec {
+
+/**
+ * @brief IMA ADPCM 编解码状态（预测值 + 步长索引 0..88）
+ */
+struct AdpcmState {
+  int16_t predictor = 0;
+  uint8_t index = 0;
+};
+
+/**
+ * @brief ADPCM 编码，n 须为偶数；返回写入 out 的字节数 (n / 2)
+ */
+size_t adpcmEncode(const int16_t *in, size_t n, uint8_t *out,
+                   AdpcmState &state);
+
+/**
+ * @brief ADPCM 解码 len 字节，输出 2 * len 个样本
+ */
+void adpcmDecode(const uint8_t *in, size_t len, int16_t *out,
+                 AdpcmState &state);
+
+/**
+ * @brief ADPCM 包头：int16 预测值 (LE) + uint8 步长索引 + uint8 保留
+ *
+ * 每包自带起始状态，丢包或乱序时其余包仍可独立解码。
+ */
+constexpr size_t kAdpcmHeaderBytes = 4;
+
+} // namespace audio_codec
+
+/**
+ * @brief 上行语音编码器：输入固定长度的 PCM 帧，每帧输出一个包
+ *
+ * 由 WebSocketChat 在发送路径中使用，格式名与 hello 中的
+ * audio_params.format 一致（"adpcm" / "opus"）。
+ */
+class UplinkEncoder {
+public:
+  virtual ~UplinkEncoder() = default;
+
+  /**
+   * @brief 按格式名创建编码器；不支持（或未编译）的格式返回空
+   */
+  static std::unique_ptr<UplinkEncoder> create(const char *format,
+                                               int sampleRate);
+
+  /**
+   * @brief 本次构建支持的压缩格式（不含 "pcm"），按偏好排序，nullptr 结尾
+   */
+  static const char *const *supportedFormats();
+
+  virtual const char *format() const = 0;
+  virtual size_t frameSamples() const = 0;   /*!< 每包 PCM 样本数 */
+  virtual size_t maxPacketBytes() const = 0; /*!< 单包最大字节数 */
+
+  /**
+   * @brief 编码一帧（frameSamples() 个样本）
+   * @return 包字节数；< 0 表示失败
+   */
+  virtual int encode(const int16_t *pcm, uint8_t *out) = 0;
+
+  /**
+   * @brief 新一轮录音开始前复位内部状态
+   */
+  virtual void reset() = 0;
+};
+
+/**
+ * @brief 下行语音解码器：每次输入一个完整的包，输出 16bit 单声道 PCM
+ *
+ * 由 Mp3Player 的 PCM 流播放任务使用：流缓冲中保存压缩包，播放前才解码，
+ * 同样大小的缓冲可以容纳数倍时长的语音。
+ */
+class DownlinkDecoder {
+public:
+  virtual ~DownlinkDecoder() = default;
+
+  /**
+   * @brief 按格式名创建解码器；"pcm"、不支持（或未编译）的格式返回空
+   */
+  static std::unique_ptr<DownlinkDecoder> create(const char *format,
+                                                 int sampleRate);
+
+  /**
+   * @brief 本次构建支持的压缩格式（不含 "pcm"），按偏好排序，nullptr 结尾
+   */
+  static const char *const *supportedFormats();
+
+  virtual const char *format() const = 0;
+  virtual size_t maxPacketBytes() const = 0;  /*!< 可接受的单包最大字节数 */
+  virtual size_t maxFrameSamples() const = 0; /*!< 单包解码后最多样本数 */
+  virtual size_t bytesPerSecond() const = 0;  /*!< 名义码率（用于预缓冲） */
+
+  /**
+   * @brief 解码一个包到 out（容量 maxFrameSamples()）
+   * @return 样本数；< 0 表示失败（调用方丢弃该包）
+   */
+  virtual int decode(const uint8_t *packet, size_t len, int16_t *out) = 0;
+
+  /**
+   * @brief 新一段播报开始前复位内部状态
+   */
+  virtual void reset() = 0;
+};
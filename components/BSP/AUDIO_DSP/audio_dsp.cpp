@@ -0,0 +1,223 @@
+/**
+ * @file audio_dsp.cpp
+ * @brief 16bit PCM 内核：向量 / 标量分发与标量参考实现
+ */
+
+#include "audio_dsp.h"
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && defined(CONFIG_AUDIO_DSP_USE_PIE)
+#define AUDIO_DSP_PIE 1
+#else
+#define AUDIO_DSP_PIE 0
+#endif
+
+#if AUDIO_DSP_PIE
+// audio_dsp_s3.S：指针须 16 字节对齐，blocks 为 8 样本块数
+extern "C" {
+uint32_t audio_dsp_sum_abs16_pie(const int16_t *x, size_t blocks);
+uint32_t audio_dsp_peak_abs16_pie(const int16_t *x, size_t blocks);
+void audio_dsp_dup16_pie(const int16_t *in, int16_t *out, size_t blocks);
+void audio_dsp_gain16_pie(const int16_t *in, int16_t *out, size_t blocks,
+                          int32_t gain_q15);
+void audio_dsp_mix16_pie(const int16_t *a, const int16_t *b, int16_t *out,
+                         size_t blocks);
+}
+#endif
+
+namespace audio_dsp {
+
+namespace {
+
+constexpr size_t kBlock = 8; // 128bit = 8 x int16
+
+// ACCX 低 32 位取和：单次调用最多 65536 个样本，保证 32767 * n 不溢出
+constexpr size_t kMaxSumSamples = 65536;
+
+inline int32_t absSat(int32_t s) {
+  int32_t a = s < 0 ? -s : s;
+  return a > 32767 ? 32767 : a;
+}
+
+inline int16_t sat16(int32_t v) {
+  if (v > 32767) {
+    return 32767;
+  }
+  if (v < -32768) {
+    return -32768;
+  }
+  return (int16_t)v;
+}
+
+#if AUDIO_DSP_PIE
+inline bool aligned16(const void *p) { return ((uintptr_t)p & 15u) == 0; }
+
+// 单输入内核：先用标量处理到 16 字节边界，返回前导样本数
+inline size_t leadToAlign(const int16_t *x, size_t n) {
+  size_t lead = ((16u - ((uintptr_t)x & 15u)) & 15u) / sizeof(int16_t);
+  if (((uintptr_t)x & 1u) != 0) {
+    return n; // 奇地址无法对齐，全部走标量
+  }
+  return lead < n ? lead : n;
+}
+#endif
+
+} // namespace
+
+// ============= 标量参考实现 =============
+
+namespace ref {
+
+uint32_t sumAbs16(const int16_t *x, size_t n) {
+  uint32_t sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    sum += (uint32_t)absSat(x[i]);
+  }
+  return sum;
+}
+
+uint16_t peakAbs16(const int16_t *x, size_t n) {
+  int32_t peak = 0;
+  for (size_t i = 0; i < n; i++) {
+    int32_t a = absSat(x[i]);
+    if (a > peak) {
+      peak = a;
+    }
+  }
+  return (uint16_t)peak;
+}
+
+void monoToStereo16(const int16_t *in, int16_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    int16_t s = in[i];
+    out[i * 2] = s;
+    out[i * 2 + 1] = s;
+  }
+}
+
+void gainQ15(const int16_t *in, int16_t *out, size_t n, int16_t gain_q15) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = sat16(((int32_t)in[i] * (int32_t)gain_q15) >> 15);
+  }
+}
+
+void mixSat16(const int16_t *a, const int16_t *b, int16_t *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = sat16((int32_t)a[i] + (int32_t)b[i]);
+  }
+}
+
+} // namespace ref
+
+// ============= 分发 =============
+
+bool hasSimd() { return AUDIO_DSP_PIE != 0; }
+
+uint32_t meanAbs16(const int16_t *x, size_t n) {
+  if (x == nullptr || n == 0) {
+    return 0;
+  }
+
+  uint64_t sum = 0;
+  size_t done = 0;
+  while (done < n) {
+    size_t len = n - done;
+    if (len > kMaxSumSamples) {
+      len = kMaxSumSamples;
+    }
+    const int16_t *p = x + done;
+#if AUDIO_DSP_PIE
+    size_t lead = leadToAlign(p, len);
+    sum += ref::sumAbs16(p, lead);
+    size_t blocks = (len - lead) / kBlock;
+    if (blocks > 0) {
+      sum += audio_dsp_sum_abs16_pie(p + lead, blocks);
+    }
+    size_t vec = lead + blocks * kBlock;
+    sum += ref::sumAbs16(p + vec, len - vec);
+#else
+    sum += ref::sumAbs16(p, len);
+#endif
+    done += len;
+  }
+  return (uint32_t)(sum / n);
+}
+
+uint16_t peakAbs16(const int16_t *x, size_t n) {
+  if (x == nullptr || n == 0) {
+    return 0;
+  }
+#if AUDIO_DSP_PIE
+  size_t lead = leadToAlign(x, n);
+  uint16_t peak = ref::peakAbs16(x, lead);
+  size_t blocks = (n - lead) / kBlock;
+  if (blocks > 0) {
+    uint16_t v = (uint16_t)audio_dsp_peak_abs16_pie(x + lead, blocks);
+    peak = v > peak ? v : peak;
+  }
+  size_t vec = lead + blocks * kBlock;
+  uint16_t t = ref::peakAbs16(x + vec, n - vec);
+  return t > peak ? t : peak;
+#else
+  return ref::peakAbs16(x, n);
+#endif
+}
+
+void monoToStereo16(const int16_t *in, int16_t *out, size_t n) {
+  if (in == nullptr || out == nullptr || n == 0) {
+    return;
+  }
+#if AUDIO_DSP_PIE
+  if (aligned16(in) && aligned16(out)) {
+    size_t blocks = n / kBlock;
+    if (blocks > 0) {
+      audio_dsp_dup16_pie(in, out, blocks);
+    }
+    size_t vec = blocks * kBlock;
+    ref::monoToStereo16(in + vec, out + vec * 2, n - vec);
+    return;
+  }
+#endif
+  ref::monoToStereo16(in, out, n);
+}
+
+void gainQ15(const int16_t *in, int16_t *out, size_t n, int16_t gain_q15) {
+  if (in == nullptr || out == nullptr || n == 0) {
+    return;
+  }
+#if AUDIO_DSP_PIE
+  if (aligned16(in) && aligned16(out)) {
+    size_t blocks = n / kBlock;
+    if (blocks > 0) {
+      audio_dsp_gain16_pie(in, out, blocks, gain_q15);
+    }
+    size_t vec = blocks * kBlock;
+    ref::gainQ15(in + vec, out + vec, n - vec, gain_q15);
+    return;
+  }
+#endif
+  ref::gainQ15(in, out, n, gain_q15);
+}
+
+void mixSat16(const int16_t *a, const int16_t *b, int16_t *out, size_t n) {
+  if (a == nullptr || b == nullptr || out == nullptr || n == 0) {
+    return;
+  }
+#if AUDIO_DSP_PIE
+  if (aligned16(a) && aligned16(b) && aligned16(out)) {
+    size_t blocks = n / kBlock;
+    if (blocks > 0) {
+      audio_dsp_mix16_pie(a, b, out, blocks);
+    }
+    size_t vec = blocks * kBlock;
+    ref::mixSat16(a + vec, b + vec, out + vec, n - vec);
+    return;
+  }
+#endif
+  ref::mixSat16(a, b, out, n);
+}
+
+} // namespace audio_dsp
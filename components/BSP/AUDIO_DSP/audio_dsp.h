@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 16bit PCM 基础运算内核
+ *
+ * 每帧音频都会经过的逐样本循环集中在这里：
+ * - ESP32-S3 且开启 CONFIG_AUDIO_DSP_USE_PIE 时，16 字节对齐的 8 样本块走
+ *   PIE 128bit 向量指令（audio_dsp_s3.S），剩余部分走标量实现
+ * - 其它目标 / 未对齐输入使用 ref:: 下的可移植实现，结果逐位一致
+ *
+ * 约定：
+ * - 绝对值对 INT16_MIN 饱和为 32767
+ * - 增益为 Q15（32767 ≈ 1.0），乘积算术右移 15 位后饱和
+ * - 混音为饱和加法
+ */
+namespace audio_dsp {
+
+/**
+ * @brief 平均绝对值 mean(|x|)，n == 0 时返回 0
+ */
+uint32_t meanAbs16(const int16_t *x, size_t n);
+
+/**
+ * @brief 峰值绝对值 max(|x|)，n == 0 时返回 0
+ */
+uint16_t peakAbs16(const int16_t *x, size_t n);
+
+/**
+ * @brief 单声道复制为双声道交织：out[2i] = out[2i+1] = in[i]
+ * @param out 至少 2 * n 个样本
+ */
+void monoToStereo16(const int16_t *in, int16_t *out, size_t n);
+
+/**
+ * @brief Q15 增益：out[i] = sat((in[i] * gain) >> 15)，允许 in == out
+ */
+void gainQ15(const int16_t *in, int16_t *out, size_t n, int16_t gain_q15);
+
+/**
+ * @brief 饱和混音：out[i] = sat(a[i] + b[i])，允许 out 与 a 或 b 相同
+ */
+void mixSat16(const int16_t *a, const int16_t *b, int16_t *out, size_t n);
+
+/**
+ * @brief 当前构建是否启用了 PIE 向量实现
+ */
+bool hasSimd();
+
+/**
+ * @brief 分发实现（当前构建的 PIE / 标量路径）与独立整数模型逐位对比
+ *
+ * 覆盖饱和边界（-32768 x Q15 增益、-32768 + -32768 等）、8 种 16 字节
+ * 相位与非 8 整数倍的尾部，以及原地运算。使用约 8 KB 静态缓冲。
+ * @param report 失败明细（最多 8 条）与汇总行的输出，可为 nullptr
+ * @return 不一致的次数，0 表示通过
+ */
+size_t selfTest(void (*report)(const char *msg) = nullptr);
+
+/**
+ * @brief 可移植标量参考实现（向量实现须与之逐位一致）
+ */
+namespace ref {
+uint32_t sumAbs16(const int16_t *x, size_t n);
+uint16_t peakAbs16(const int16_t *x, size_t n);
+void monoToStereo16(const int16_t *in, int16_t *out, size_t n);
+void gainQ15(const int16_t *in, int16_t *out, size_t n, int16_t gain_q15);
+void mixSat16(const int16_t *a, const int16_t *b, int16_t *out, size_t n);
+} // namespace ref
+
+} // namespace audio_dsp
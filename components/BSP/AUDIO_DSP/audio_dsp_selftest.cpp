@@ -0,0 +1,178 @@
+/**
+ * @file audio_dsp_selftest.cpp
+ * @brief 分发实现（PIE / 标量）与独立整数模型的逐位对比
+ *
+ * 纯 C++，不依赖 IDF：主机上由 tools/audio_dsp_test 运行（覆盖标量路径与
+ * 分发逻辑）；固件开启 CONFIG_AUDIO_DSP_SELF_TEST 时启动时运行，覆盖 PIE
+ * 路径的饱和行为。
+ */
+
+#include "audio_dsp.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace audio_dsp {
+
+namespace {
+
+constexpr size_t kMaxLen = 1027;
+constexpr size_t kMaxOffset = 8; // 样本偏移：覆盖对齐 / 未对齐的全部 16 字节相位
+
+// 与 audio_dsp.cpp 无关的参考模型：64 位运算后截断，右移按向下取整
+int16_t modelSat(int64_t v) {
+  return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+int16_t modelGain(int16_t x, int16_t g) {
+  const int64_t p = (int64_t)x * g;
+  const int64_t q = p >= 0 ? p / 32768 : -((-p + 32767) / 32768);
+  return modelSat(q);
+}
+
+struct Checker {
+  void (*report)(const char *msg);
+  size_t failures = 0;
+
+  void fail(const char *what, size_t n, size_t off, size_t i, int got,
+            int want) {
+    if (failures++ < 8 && report) {
+      char line[128];
+      snprintf(line, sizeof(line),
+               "%s mismatch: n=%u off=%u i=%u got=%d want=%d", what,
+               (unsigned)n, (unsigned)off, (unsigned)i, got, want);
+      report(line);
+    }
+  }
+};
+
+// 边界值放在每个 8 样本块的不同位置，也落在尾部
+void fillPattern(int16_t *x, size_t n, uint32_t seed) {
+  static const int16_t kEdges[] = {-32768, 32767, -32767, -1, 0, 1, 16384,
+                                   -16384};
+  uint32_t s = seed;
+  for (size_t i = 0; i < n; i++) {
+    s = s * 1664525u + 1013904223u;
+    x[i] = ((s >> 28) < 6) ? kEdges[(s >> 16) % 8] : (int16_t)(s >> 16);
+  }
+}
+
+// 16 字节对齐的工作区（静态：固件里不占任务栈）
+alignas(16) int16_t s_a[kMaxLen + kMaxOffset];
+alignas(16) int16_t s_b[kMaxLen + kMaxOffset];
+alignas(16) int16_t s_out[kMaxLen + kMaxOffset];
+alignas(16) int16_t s_want[kMaxLen];
+
+const size_t kLengths[] = {1,  2,  3,  7,   8,   9,   15,  16,  17,
+                           31, 33, 63, 64,  65,  255, 256, 257, 1027};
+const int16_t kGains[] = {32767, -32768, -32767, 0, 1, -1, 16384, 32766};
+
+void checkGain(Checker &c) {
+  for (size_t n : kLengths) {
+    for (size_t off = 0; off < kMaxOffset; off++) {
+      for (int16_t g : kGains) {
+        int16_t *in = s_a + off;
+        fillPattern(in, n, (uint32_t)(n * 131 + off * 7 + (uint16_t)g));
+        in[0] = -32768; // -32768 x 单位增益 / 负满量程增益
+        in[n - 1] = -32768;
+        for (size_t i = 0; i < n; i++) {
+          s_want[i] = modelGain(in[i], g);
+        }
+        // 独立输出与原地两种用法（混音器原地加增益）
+        gainQ15(in, s_out + off, n, g);
+        for (size_t i = 0; i < n; i++) {
+          if (s_out[off + i] != s_want[i]) {
+            c.fail("gainQ15", n, off, i, s_out[off + i], s_want[i]);
+          }
+        }
+        gainQ15(in, in, n, g);
+        for (size_t i = 0; i < n; i++) {
+          if (in[i] != s_want[i]) {
+            c.fail("gainQ15(in-place)", n, off, i, in[i], s_want[i]);
+          }
+        }
+      }
+    }
+  }
+}
+
+void checkMix(Checker &c) {
+  for (size_t n : kLengths) {
+    for (size_t off = 0; off < kMaxOffset; off++) {
+      int16_t *a = s_a + off;
+      int16_t *b = s_b + off;
+      fillPattern(a, n, (uint32_t)(n * 17 + off));
+      fillPattern(b, n, (uint32_t)(n * 29 + off + 5));
+      // -32768 + -32768、32767 + 32767、正负满量程相加
+      a[0] = -32768;
+      b[0] = -32768;
+      a[n - 1] = 32767;
+      b[n - 1] = 32767;
+      if (n > 2) {
+        a[n / 2] = 32767;
+        b[n / 2] = -32768;
+      }
+      for (size_t i = 0; i < n; i++) {
+        s_want[i] = modelSat((int64_t)a[i] + b[i]);
+      }
+      mixSat16(a, b, s_out + off, n);
+      for (size_t i = 0; i < n; i++) {
+        if (s_out[off + i] != s_want[i]) {
+          c.fail("mixSat16", n, off, i, s_out[off + i], s_want[i]);
+        }
+      }
+      // 混音器用法：out == a
+      mixSat16(a, b, a, n);
+      for (size_t i = 0; i < n; i++) {
+        if (a[i] != s_want[i]) {
+          c.fail("mixSat16(out=a)", n, off, i, a[i], s_want[i]);
+        }
+      }
+    }
+  }
+}
+
+void checkLevels(Checker &c) {
+  for (size_t n : kLengths) {
+    for (size_t off = 0; off < kMaxOffset; off++) {
+      int16_t *x = s_a + off;
+      fillPattern(x, n, (uint32_t)(n * 7 + off * 3));
+      x[n - 1] = -32768; // |INT16_MIN| 饱和为 32767
+      uint64_t sum = 0;
+      uint16_t peak = 0;
+      for (size_t i = 0; i < n; i++) {
+        const int32_t a = x[i] < 0 ? -(int32_t)x[i] : x[i];
+        const uint16_t s = (uint16_t)(a > 32767 ? 32767 : a);
+        sum += s;
+        peak = s > peak ? s : peak;
+      }
+      const uint32_t mean = (uint32_t)(sum / n);
+      const uint32_t gotMean = meanAbs16(x, n);
+      if (gotMean != mean) {
+        c.fail("meanAbs16", n, off, 0, (int)gotMean, (int)mean);
+      }
+      const uint16_t gotPeak = peakAbs16(x, n);
+      if (gotPeak != peak) {
+        c.fail("peakAbs16", n, off, 0, gotPeak, peak);
+      }
+    }
+  }
+}
+
+} // namespace
+
+size_t selfTest(void (*report)(const char *msg)) {
+  Checker c{report};
+  checkGain(c);
+  checkMix(c);
+  checkLevels(c);
+  if (report) {
+    char line[96];
+    snprintf(line, sizeof(line), "audio_dsp self test (%s): %u failures",
+             hasSimd() ? "PIE" : "scalar", (unsigned)c.failures);
+    report(line);
+  }
+  return c.failures;
+}
+
+} // namespace audio_dsp
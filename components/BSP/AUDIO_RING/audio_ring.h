@@ -0,0 +1,271 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 单生产者 / 单消费者无锁环形缓冲（音频采样专用）
+ *
+ * - 容量向上取整为 2 的幂，读写索引为自由递增计数，用掩码取模
+ * - 生产者通过 writeSpan()/commit() 直接在环内写入（例如 i2s_channel_read
+ *   直接读进环里），消费者通过 readSpans()/consume() 原地读取，避免中间拷贝
+ * - 只允许一个任务写、一个任务读；两端都不加锁
+ * - 溢出 / 欠载计数由调用方按自己的策略记录（noteOverflow / noteUnderrun）
+ *
+ * @example
+ *   AudioRing<int16_t> ring;
+ *   ring.init(4096);                       // PSRAM 优先
+ *   size_t n = 0;
+ *   int16_t *dst = ring.writeSpan(&n);     // 生产者
+ *   ...fill dst[0..n)...
+ *   ring.commit(n);
+ *
+ *   const int16_t *a, *b; size_t na, nb;   // 消费者
+ *   ring.readSpans(&a, &na, &b, &nb);
+ *   ring.consume(na + nb);
+ */
+template <typename T> class AudioRing {
+public:
+  AudioRing() = default;
+  ~AudioRing() { deinit(); }
+
+  AudioRing(const AudioRing &) = delete;
+  AudioRing &operator=(const AudioRing &) = delete;
+
+  /**
+   * @brief 分配缓冲区
+   * @param minCapacity 最少可容纳的元素个数（内部向上取整为 2 的幂）
+   * @param caps        首选内存类型；分配失败时回退到内部 RAM
+   * @return ESP_OK 成功；ESP_ERR_NO_MEM 内存不足
+   */
+  esp_err_t init(size_t minCapacity, uint32_t caps = MALLOC_CAP_SPIRAM) {
+    if (m_buf) {
+      return ESP_ERR_INVALID_STATE;
+    }
+    if (minCapacity == 0) {
+      return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t cap = 1;
+    while (cap < minCapacity) {
+      cap <<= 1;
+    }
+
+    m_buf = (T *)heap_caps_malloc(cap * sizeof(T), caps);
+    if (m_buf == nullptr) {
+      m_buf = (T *)heap_caps_malloc(cap * sizeof(T),
+                                    MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (m_buf == nullptr) {
+      return ESP_ERR_NO_MEM;
+    }
+
+    m_capacity = cap;
+    m_mask = cap - 1;
+    reset();
+    return ESP_OK;
+  }
+
+  /**
+   * @brief 释放缓冲区（调用方保证两端都已停止访问）
+   */
+  void deinit() {
+    if (m_buf) {
+      heap_caps_free(m_buf);
+      m_buf = nullptr;
+    }
+    m_capacity = 0;
+    m_mask = 0;
+  }
+
+  /**
+   * @brief 清空读写位置与统计（调用方保证两端都已停止访问）
+   */
+  void reset() {
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+    m_overflows.store(0, std::memory_order_relaxed);
+    m_underruns.store(0, std::memory_order_relaxed);
+    m_highWater.store(0, std::memory_order_relaxed);
+  }
+
+  bool valid() const { return m_buf != nullptr; }
+  size_t capacity() const { return m_capacity; }
+
+  /**
+   * @brief 当前可读元素个数（任一端均可调用）
+   */
+  size_t available() const {
+    return (size_t)(m_head.load(std::memory_order_acquire) -
+                    m_tail.load(std::memory_order_acquire));
+  }
+
+  /**
+   * @brief 当前可写元素个数（任一端均可调用）
+   */
+  size_t freeSpace() const { return m_capacity - available(); }
+
+  // ---------------- 生产者 ----------------
+
+  /**
+   * @brief 获取一段连续的可写区域
+   * @param[out] contiguous 该区域可写的元素个数（到环尾或到已用区为止）
+   * @return 写指针；无空间时 *contiguous 为 0
+   */
+  T *writeSpan(size_t *contiguous) {
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    uint32_t tail = m_tail.load(std::memory_order_acquire);
+    size_t space = m_capacity - (size_t)(head - tail);
+    size_t idx = head & m_mask;
+    size_t toEnd = m_capacity - idx;
+    *contiguous = space < toEnd ? space : toEnd;
+    return m_buf + idx;
+  }
+
+  /**
+   * @brief 提交 writeSpan() 中已写入的 n 个元素
+   */
+  void commit(size_t n) {
+    uint32_t head = m_head.load(std::memory_order_relaxed) + (uint32_t)n;
+    m_head.store(head, std::memory_order_release);
+
+    size_t fill = (size_t)(head - m_tail.load(std::memory_order_relaxed));
+    if (fill > m_highWater.load(std::memory_order_relaxed)) {
+      m_highWater.store((uint32_t)fill, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief 拷贝写入（自动处理回绕）
+   * @return 实际写入的元素个数；不足的部分由调用方决定是否记为溢出
+   */
+  size_t write(const T *src, size_t n) {
+    size_t written = 0;
+    while (written < n) {
+      size_t span = 0;
+      T *dst = writeSpan(&span);
+      if (span == 0) {
+        break;
+      }
+      size_t chunk = (n - written) < span ? (n - written) : span;
+      for (size_t i = 0; i < chunk; i++) {
+        dst[i] = src[written + i];
+      }
+      commit(chunk);
+      written += chunk;
+    }
+    return written;
+  }
+
+  /**
+   * @brief 覆盖写入：空间不足时丢弃最旧的数据，只保留最近写入的部分
+   *
+   * 会移动读位置，只能在生产者和消费者是同一个任务时使用（例如预录环）。
+   * @return 丢弃的元素个数（包括 src 中放不下的前段）
+   */
+  size_t writeDropOldest(const T *src, size_t n) {
+    size_t dropped = 0;
+    if (n > m_capacity) {
+      dropped = n - m_capacity;
+      src += dropped;
+      n = m_capacity;
+    }
+    size_t room = freeSpace();
+    if (room < n) {
+      consume(n - room);
+      dropped += n - room;
+    }
+    write(src, n);
+    return dropped;
+  }
+
+  // ---------------- 消费者 ----------------
+
+  /**
+   * @brief 获取全部可读数据（回绕时分成两段）
+   * @return 可读元素总数（= *na + *nb）
+   */
+  size_t readSpans(const T **a, size_t *na, const T **b, size_t *nb) const {
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    uint32_t head = m_head.load(std::memory_order_acquire);
+    size_t avail = (size_t)(head - tail);
+    size_t idx = tail & m_mask;
+    size_t toEnd = m_capacity - idx;
+
+    *a = m_buf + idx;
+    *na = avail < toEnd ? avail : toEnd;
+    *b = m_buf;
+    *nb = avail - *na;
+    return avail;
+  }
+
+  /**
+   * @brief 释放已读取的 n 个元素
+   */
+  void consume(size_t n) {
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + (uint32_t)n,
+                 std::memory_order_release);
+  }
+
+  /**
+   * @brief 拷贝读取最多 n 个元素
+   * @return 实际读取的元素个数
+   */
+  size_t read(T *dst, size_t n) {
+    const T *a, *b;
+    size_t na, nb;
+    size_t avail = readSpans(&a, &na, &b, &nb);
+    size_t take = n < avail ? n : avail;
+    size_t fromA = take < na ? take : na;
+    for (size_t i = 0; i < fromA; i++) {
+      dst[i] = a[i];
+    }
+    for (size_t i = fromA; i < take; i++) {
+      dst[i] = b[i - fromA];
+    }
+    consume(take);
+    return take;
+  }
+
+  // ---------------- 统计 ----------------
+
+  void noteOverflow(uint32_t n = 1) {
+    m_overflows.fetch_add(n, std::memory_order_relaxed);
+  }
+  void noteUnderrun(uint32_t n = 1) {
+    m_underruns.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint32_t overflows() const {
+    return m_overflows.load(std::memory_order_relaxed);
+  }
+  uint32_t underruns() const {
+    return m_underruns.load(std::memory_order_relaxed);
+  }
+  /** 历史最高填充量（元素个数） */
+  uint32_t highWater() const {
+    return m_highWater.load(std::memory_order_relaxed);
+  }
+  /** 累计写入 / 读取的元素个数（32 位回绕） */
+  uint32_t totalWritten() const {
+    return m_head.load(std::memory_order_relaxed);
+  }
+  uint32_t totalRead() const {
+    return m_tail.load(std::memory_order_relaxed);
+  }
+
+private:
+  T *m_buf = nullptr;
+  size_t m_capacity = 0;
+  size_t m_mask = 0;
+
+  std::atomic<uint32_t> m_head{0}; /*!< 生产者写入计数 */
+  std::atomic<uint32_t> m_tail{0}; /*!< 消费者读取计数 */
+
+  std::atomic<uint32_t> m_overflows{0};
+  std::atomic<uint32_t> m_underruns{0};
+  std::atomic<uint32_t> m_highWater{0};
+};
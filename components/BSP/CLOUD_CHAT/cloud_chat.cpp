@@ -2,7 +2,9 @@
 
 #include "esp_http_client.h"
 #include "esp_log.h"
+#include "http_conn_pool.h"
 #include "mp3_player.h"
+#include "wav_stream.h"
 
 #include <algorithm>
 #include <cstdlib>
@@ -11,45 +13,62 @@
 static const char *TAG = "CloudChat";
 
 namespace {
-struct HttpBuf {
-  uint8_t *data = nullptr;
-  size_t size = 0;
-  size_t cap = 0;
-};
-
-static void freeBuf(HttpBuf &b) {
-  if (b.data) {
-    free(b.data);
-  }
-  b = {};
-}
-
-static bool ensureCap(HttpBuf &b, size_t need, size_t maxCap) {
-  if (need > maxCap) {
-    return false;
-  }
-  if (b.cap >= need) {
-    return true;
-  }
-
-  size_t newCap = b.cap == 0 ? 16 * 1024 : b.cap;
-  while (newCap < need) {
-    newCap = std::min(newCap * 2, maxCap);
-    if (newCap < need && newCap == maxCap) {
+// esp_http_client_write 可能只写出一部分：循环写完
+static bool writeAll(esp_http_client_handle_t client, const void *data,
+                     size_t len) {
+  const char *p = (const char *)data;
+  while (len > 0) {
+    int w = esp_http_client_write(client, p, (int)len);
+    if (w <= 0) {
       return false;
     }
+    p += w;
+    len -= (size_t)w;
   }
+  return true;
+}
 
-  void *p = realloc(b.data, newCap);
-  if (!p) {
-    return false;
+// HTTP/1.1 分块：<len hex>\r\n<data>\r\n
+static esp_err_t writeChunk(esp_http_client_handle_t client, const void *data,
+                            size_t len) {
+  char head[16];
+  int n = snprintf(head, sizeof(head), "%x\r\n", (unsigned)len);
+  if (!writeAll(client, head, (size_t)n) || !writeAll(client, data, len) ||
+      !writeAll(client, "\r\n", 2)) {
+    ESP_LOGE(TAG, "http chunk write failed (len=%u)", (unsigned)len);
+    return ESP_FAIL;
   }
-  b.data = static_cast<uint8_t *>(p);
-  b.cap = newCap;
-  return true;
+  return ESP_OK;
 }
 } // namespace
 
+void CloudChat::fillWavHeader(uint8_t *h, int sampleRate, uint32_t dataBytes) {
+  auto put16 = [](uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+  };
+  auto put32 = [](uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+  };
+  // 流式上传时还不知道总长度：RIFF/data 长度写 0xFFFFFFFF（服务端按实际长度修正）
+  const uint32_t riffSize = dataBytes == 0xFFFFFFFFu ? dataBytes : 36 + dataBytes;
+  memcpy(h, "RIFF", 4);
+  put32(h + 4, riffSize);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put32(h + 16, 16);
+  put16(h + 20, 1); // PCM
+  put16(h + 22, 1); // mono
+  put32(h + 24, (uint32_t)sampleRate);
+  put32(h + 28, (uint32_t)sampleRate * 2);
+  put16(h + 32, 2);
+  put16(h + 34, 16);
+  memcpy(h + 36, "data", 4);
+  put32(h + 40, dataBytes);
+}
+
 CloudChat &CloudChat::instance() {
   static CloudChat inst;
   return inst;
@@ -61,50 +80,212 @@ esp_err_t CloudChat::init(const CloudChatConfig &cfg) {
   return ESP_OK;
 }
 
-esp_err_t CloudChat::chatWav(const uint8_t *wavData, size_t wavLen,
-                             const std::string &deviceId) {
+esp_http_client_handle_t CloudChat::openRequest(const std::string &deviceId,
+                                                const char *accept,
+                                                int writeLen, bool *reused,
+                                                esp_err_t &err) {
+  auto &pool = HttpConnPool::instance();
+  for (int attempt = 0;; attempt++) {
+    bool wasReused = false;
+    esp_http_client_handle_t client =
+        pool.acquire(m_cfg.url, HTTP_METHOD_POST, m_cfg.timeout_ms, &wasReused);
+    if (!client) {
+      err = ESP_ERR_NO_MEM;
+      return nullptr;
+    }
+
+    pool.setHeader(client, "Content-Type", "audio/wav");
+    pool.setHeader(client, "Accept", accept);
+    if (!deviceId.empty()) {
+      pool.setHeader(client, "X-Device-Id", deviceId.c_str());
+    }
+
+    // writeLen < 0: esp_http_client 自动加 "Transfer-Encoding: chunked"，
+    // 分块格式由调用方自己写（见 writeChunk）
+    err = pool.open(client, writeLen);
+    if (err == ESP_OK) {
+      if (reused) {
+        *reused = wasReused;
+      }
+      return client;
+    }
+    if (wasReused && attempt == 0) {
+      // 还没发出请求体：换新连接重试
+      pool.releaseStale(client);
+      continue;
+    }
+    ESP_LOGE(TAG, "http open failed: %s", esp_err_to_name(err));
+    pool.release(client, false);
+    return nullptr;
+  }
+}
+
+esp_err_t CloudChat::streamBegin(const std::string &deviceId, int sampleRate,
+                                 bool pcmResponse) {
   if (!m_inited) {
     return ESP_ERR_INVALID_STATE;
   }
-  if (m_cfg.url.empty() || wavData == nullptr || wavLen == 0) {
+  if (m_cfg.url.empty() || sampleRate <= 0) {
     return ESP_ERR_INVALID_ARG;
   }
+  streamAbort();
 
-  ESP_LOGI(TAG, "POST %s (wav=%u bytes, deviceId=%s)", m_cfg.url.c_str(),
-           (unsigned)wavLen, deviceId.c_str());
-
-  esp_http_client_config_t cfg = {};
-  cfg.url = m_cfg.url.c_str();
-  cfg.method = HTTP_METHOD_POST;
-  cfg.timeout_ms = m_cfg.timeout_ms;
+  m_cancel.store(false, std::memory_order_relaxed);
+  ESP_LOGI(TAG, "POST %s (chunked, deviceId=%s)%s", m_cfg.url.c_str(),
+           deviceId.c_str(), pcmResponse ? " [pcm stream]" : "");
 
-  esp_http_client_handle_t client = esp_http_client_init(&cfg);
-  if (!client) {
-    return ESP_ERR_NO_MEM;
+  esp_err_t err = ESP_OK;
+  // 分块上传的请求体无法重放：连接建立后的失败不重试，直接报错
+  m_stream = openRequest(deviceId, pcmResponse ? "audio/L16" : "audio/wav", -1,
+                         nullptr, err);
+  if (!m_stream) {
+    return err;
   }
+  m_streamPcm = pcmResponse;
+  m_streamBytes = 0;
 
-  esp_http_client_set_header(client, "Content-Type", "audio/wav");
-  esp_http_client_set_header(client, "Accept", "audio/wav");
-  if (!deviceId.empty()) {
-    esp_http_client_set_header(client, "X-Device-Id", deviceId.c_str());
+  uint8_t header[kWavHeaderBytes];
+  fillWavHeader(header, sampleRate, 0xFFFFFFFFu);
+  err = writeChunk(m_stream, header, sizeof(header));
+  if (err != ESP_OK) {
+    streamAbort();
   }
+  return err;
+}
 
-  esp_err_t err = esp_http_client_open(client, (int)wavLen);
+esp_err_t CloudChat::streamWrite(const int16_t *pcm, size_t samples) {
+  if (!m_stream) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (pcm == nullptr || samples == 0) {
+    return ESP_OK;
+  }
+  esp_err_t err = writeChunk(m_stream, pcm, samples * sizeof(int16_t));
   if (err != ESP_OK) {
-    ESP_LOGE(TAG, "http open failed: %s", esp_err_to_name(err));
-    esp_http_client_cleanup(client);
+    streamAbort();
     return err;
   }
+  m_streamBytes += samples * sizeof(int16_t);
+  return ESP_OK;
+}
+
+esp_err_t CloudChat::streamFinish() {
+  if (!m_stream) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  esp_http_client_handle_t client = m_stream;
+  m_stream = nullptr;
+
+  // 结束分块：长度为 0 的最后一块
+  static const char kLastChunk[] = "0\r\n\r\n";
+  if (!writeAll(client, kLastChunk, sizeof(kLastChunk) - 1)) {
+    ESP_LOGE(TAG, "http write failed (last chunk)");
+    HttpConnPool::instance().release(client, false);
+    return ESP_FAIL;
+  }
+  ESP_LOGI(TAG, "stream upload done: %u bytes", (unsigned)m_streamBytes);
 
-  int w = esp_http_client_write(client, (const char *)wavData, (int)wavLen);
-  if (w < 0 || (size_t)w != wavLen) {
-    ESP_LOGE(TAG, "http write failed: wrote=%d", w);
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
+  const int contentLen = (int)esp_http_client_fetch_headers(client);
+  if (contentLen < 0) {
+    ESP_LOGE(TAG, "http fetch headers failed");
+    HttpConnPool::instance().release(client, false);
     return ESP_FAIL;
   }
+  return m_streamPcm ? receivePcmStream(client)
+                     : receiveWav(client, contentLen);
+}
+
+void CloudChat::streamAbort() {
+  if (!m_stream) {
+    return;
+  }
+  HttpConnPool::instance().release(m_stream, false);
+  m_stream = nullptr;
+}
+
+esp_http_client_handle_t CloudChat::postSpans(const UploadSpan *spans,
+                                              size_t count,
+                                              const std::string &deviceId,
+                                              const char *accept,
+                                              int &contentLen, esp_err_t &err) {
+  if (!m_inited) {
+    err = ESP_ERR_INVALID_STATE;
+    return nullptr;
+  }
+  size_t total = 0;
+  for (size_t i = 0; spans != nullptr && i < count; i++) {
+    if (spans[i].data == nullptr && spans[i].len > 0) {
+      total = 0;
+      break;
+    }
+    total += spans[i].len;
+  }
+  if (m_cfg.url.empty() || total == 0) {
+    err = ESP_ERR_INVALID_ARG;
+    return nullptr;
+  }
+
+  m_cancel.store(false, std::memory_order_relaxed);
+  ESP_LOGI(TAG, "POST %s (wav=%u bytes, deviceId=%s)%s", m_cfg.url.c_str(),
+           (unsigned)total, deviceId.c_str(),
+           strcmp(accept, "audio/L16") == 0 ? " [pcm stream]" : "");
+
+  // 请求体在内存里，可以重放：复用的保活连接已被服务端关闭（收到响应头
+  // 之前失败）时换新连接重试一次
+  auto &pool = HttpConnPool::instance();
+  for (int attempt = 0;; attempt++) {
+    bool reused = false;
+    esp_http_client_handle_t client =
+        openRequest(deviceId, accept, (int)total, &reused, err);
+    if (!client) {
+      return nullptr;
+    }
+
+    err = ESP_OK;
+    for (size_t i = 0; i < count; i++) {
+      if (!writeAll(client, spans[i].data, spans[i].len)) {
+        ESP_LOGW(TAG, "http write failed (span %u/%u)", (unsigned)(i + 1),
+                 (unsigned)count);
+        err = ESP_FAIL;
+        break;
+      }
+    }
+    if (err == ESP_OK) {
+      contentLen = (int)esp_http_client_fetch_headers(client);
+      if (contentLen < 0) {
+        ESP_LOGW(TAG, "http fetch headers failed");
+        err = ESP_FAIL;
+      }
+    }
+    if (err == ESP_OK) {
+      return client;
+    }
+    if (reused && attempt == 0) {
+      pool.releaseStale(client);
+      continue;
+    }
+    ESP_LOGE(TAG, "chat request failed");
+    pool.release(client, false);
+    return nullptr;
+  }
+}
 
-  int contentLen = esp_http_client_fetch_headers(client);
+esp_err_t CloudChat::chatWav(const UploadSpan *spans, size_t count,
+                             const std::string &deviceId) {
+  esp_err_t err = ESP_OK;
+  int contentLen = -1;
+  esp_http_client_handle_t client =
+      postSpans(spans, count, deviceId, "audio/wav", contentLen, err);
+  if (!client) {
+    return err;
+  }
+  return receiveWav(client, contentLen);
+}
+
+esp_err_t CloudChat::receiveWav(esp_http_client_handle_t client,
+                                int contentLen) {
+  auto &pool = HttpConnPool::instance();
+  esp_err_t err = ESP_OK;
   int status = esp_http_client_get_status_code(client);
   if (status != 200) {
     ESP_LOGE(TAG, "chat http status=%d, contentLen=%d", status, contentLen);
@@ -116,156 +297,93 @@ esp_err_t CloudChat::chatWav(const uint8_t *wavData, size_t wavLen,
       ESP_LOGE(TAG, "chat body: %s", errBuf);
     }
 
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
+    pool.release(client);
     return ESP_FAIL;
   }
 
-  HttpBuf buf;
-  size_t maxBytes = (size_t)std::max(0, m_cfg.max_response_bytes);
-  if (maxBytes == 0) {
-    maxBytes = 1024 * 1024;
-  }
-
-  if (contentLen > 0) {
-    if (!ensureCap(buf, (size_t)contentLen, maxBytes)) {
-      ESP_LOGE(TAG, "response too large: %d", contentLen);
-      esp_http_client_close(client);
-      esp_http_client_cleanup(client);
-      return ESP_ERR_NO_MEM;
-    }
-  } else {
-    if (!ensureCap(buf, 16 * 1024, maxBytes)) {
-      esp_http_client_close(client);
-      esp_http_client_cleanup(client);
-      return ESP_ERR_NO_MEM;
-    }
+  auto &player = Mp3Player::instance();
+  if (player.getState() != Mp3PlayerState::Idle) {
+    player.stop();
   }
 
+  // 边下载边播放：解析到 data 块就开始 PCM 流，不缓存整段音频
+  WavStreamPlayer wav;
+  uint8_t buf[2048];
+  size_t total = 0;
+  bool cancelled = false;
   while (true) {
-    if (buf.size == buf.cap) {
-      if (!ensureCap(buf, buf.cap + 1024, maxBytes)) {
-        ESP_LOGE(TAG, "response exceeds max bytes (%u)",
-                 (unsigned)maxBytes);
-        freeBuf(buf);
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        return ESP_ERR_NO_MEM;
-      }
+    if (m_cancel.load(std::memory_order_relaxed)) {
+      ESP_LOGI(TAG, "chat cancelled");
+      cancelled = true;
+      break;
     }
-
-    int r = esp_http_client_read(
-        client, reinterpret_cast<char *>(buf.data + buf.size),
-        (int)std::min((size_t)4096, buf.cap - buf.size));
+    int r = esp_http_client_read(client, reinterpret_cast<char *>(buf),
+                                 sizeof(buf));
     if (r < 0) {
       ESP_LOGE(TAG, "http read failed");
-      freeBuf(buf);
-      esp_http_client_close(client);
-      esp_http_client_cleanup(client);
-      return ESP_FAIL;
+      err = ESP_FAIL;
+      break;
     }
     if (r == 0) {
       break;
     }
-    buf.size += (size_t)r;
-  }
-
-  esp_http_client_close(client);
-  esp_http_client_cleanup(client);
-
-  if (contentLen > 0 && (int)buf.size < contentLen) {
-    ESP_LOGE(TAG, "incomplete download: got=%u expected=%d",
-             (unsigned)buf.size, contentLen);
-    freeBuf(buf);
-    return ESP_FAIL;
-  }
-
-  if (buf.size == 0) {
-    ESP_LOGE(TAG, "empty audio response");
-    freeBuf(buf);
-    return ESP_FAIL;
-  }
-
-  if (buf.size < 4 || memcmp(buf.data, "RIFF", 4) != 0) {
-    ESP_LOGE(TAG, "unexpected audio header (not RIFF), size=%u",
-             (unsigned)buf.size);
-    // Print a small prefix for debug
-    char prefix[2 * 32 + 1] = {0};
-    size_t n = std::min((size_t)32, buf.size);
-    for (size_t i = 0; i < n; i++) {
-      snprintf(prefix + i * 2, sizeof(prefix) - i * 2, "%02X", buf.data[i]);
+    const bool first = (total == 0);
+    total += (size_t)r;
+    err = wav.write(buf, (size_t)r);
+    if (err != ESP_OK && m_cancel.load(std::memory_order_relaxed)) {
+      continue; // 打断与写入竞争：下一轮循环顶部退出
+    }
+    if (err == ESP_ERR_INVALID_RESPONSE && first) {
+      // Print a small prefix for debug
+      char prefix[2 * 32 + 1] = {0};
+      size_t n = std::min((size_t)32, (size_t)r);
+      for (size_t i = 0; i < n; i++) {
+        snprintf(prefix + i * 2, sizeof(prefix) - i * 2, "%02X", buf[i]);
+      }
+      ESP_LOGE(TAG, "prefix(hex): %s", prefix);
+    }
+    if (err != ESP_OK) {
+      break;
     }
-    ESP_LOGE(TAG, "prefix(hex): %s", prefix);
-    freeBuf(buf);
-    return ESP_FAIL;
   }
 
-  ESP_LOGI(TAG, "assistant audio bytes: %u", (unsigned)buf.size);
+  // 打断 / 出错时响应没读完，连接不保留
+  pool.release(client, !cancelled && err == ESP_OK);
 
-  auto &player = Mp3Player::instance();
-  if (player.getState() != Mp3PlayerState::Idle) {
-    player.stop();
+  if (cancelled) {
+    // 打断：播放器已经被 flush，剩余数据直接丢弃
+    wav.abort();
+    return ESP_OK;
   }
-
-  err = player.playOwnedBuffer(buf.data, buf.size, false);
   if (err != ESP_OK) {
-    ESP_LOGE(TAG, "playOwnedBuffer failed: %s", esp_err_to_name(err));
-    freeBuf(buf);
+    wav.abort();
     return err;
   }
-
-  // 播放器接管内存
-  buf.data = nullptr;
-  buf.size = 0;
-  buf.cap = 0;
-  return ESP_OK;
+  if (contentLen > 0 && (int)total < contentLen) {
+    // 已播放的部分保留，只记录截断
+    ESP_LOGW(TAG, "incomplete download: got=%u expected=%d", (unsigned)total,
+             contentLen);
+  }
+  ESP_LOGI(TAG, "assistant audio bytes: %u", (unsigned)total);
+  return wav.finish();
 }
 
-esp_err_t CloudChat::chatWavPcmStream(const uint8_t *wavData, size_t wavLen,
+esp_err_t CloudChat::chatWavPcmStream(const UploadSpan *spans, size_t count,
                                       const std::string &deviceId) {
-  if (!m_inited) {
-    return ESP_ERR_INVALID_STATE;
-  }
-  if (m_cfg.url.empty() || wavData == nullptr || wavLen == 0) {
-    return ESP_ERR_INVALID_ARG;
-  }
-
-  ESP_LOGI(TAG, "POST %s (wav=%u bytes, deviceId=%s) [pcm stream]",
-           m_cfg.url.c_str(), (unsigned)wavLen, deviceId.c_str());
-
-  esp_http_client_config_t cfg = {};
-  cfg.url = m_cfg.url.c_str();
-  cfg.method = HTTP_METHOD_POST;
-  cfg.timeout_ms = m_cfg.timeout_ms;
-
-  esp_http_client_handle_t client = esp_http_client_init(&cfg);
-  if (!client) {
-    return ESP_ERR_NO_MEM;
-  }
-
-  esp_http_client_set_header(client, "Content-Type", "audio/wav");
   // Expect raw PCM stream (audio/L16)
-  esp_http_client_set_header(client, "Accept", "audio/L16");
-  if (!deviceId.empty()) {
-    esp_http_client_set_header(client, "X-Device-Id", deviceId.c_str());
-  }
-
-  esp_err_t err = esp_http_client_open(client, (int)wavLen);
-  if (err != ESP_OK) {
-    ESP_LOGE(TAG, "http open failed: %s", esp_err_to_name(err));
-    esp_http_client_cleanup(client);
+  esp_err_t err = ESP_OK;
+  int contentLen = -1;
+  esp_http_client_handle_t client =
+      postSpans(spans, count, deviceId, "audio/L16", contentLen, err);
+  if (!client) {
     return err;
   }
+  return receivePcmStream(client);
+}
 
-  int w = esp_http_client_write(client, (const char *)wavData, (int)wavLen);
-  if (w < 0 || (size_t)w != wavLen) {
-    ESP_LOGE(TAG, "http write failed: wrote=%d", w);
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
-    return ESP_FAIL;
-  }
-
-  (void)esp_http_client_fetch_headers(client);
+esp_err_t CloudChat::receivePcmStream(esp_http_client_handle_t client) {
+  auto &pool = HttpConnPool::instance();
+  esp_err_t err = ESP_OK;
   int status = esp_http_client_get_status_code(client);
   if (status != 200) {
     ESP_LOGE(TAG, "chat_pcm http status=%d", status);
@@ -277,8 +395,7 @@ esp_err_t CloudChat::chatWavPcmStream(const uint8_t *wavData, size_t wavLen,
       ESP_LOGE(TAG, "chat_pcm body: %s", errBuf);
     }
 
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
+    pool.release(client);
     return ESP_FAIL;
   }
 
@@ -303,15 +420,22 @@ esp_err_t CloudChat::chatWavPcmStream(const uint8_t *wavData, size_t wavLen,
   err = player.pcmStreamBegin((uint32_t)sampleRate, 40);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "pcmStreamBegin failed: %s", esp_err_to_name(err));
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
+    pool.release(client, false);
     return err;
   }
 
   uint8_t buf[2048];
   bool hasTail = false;
   uint8_t tail = 0;
+  bool cancelled = false;
   while (true) {
+    if (m_cancel.load(std::memory_order_relaxed)) {
+      // 打断：播放器已经被 flush，这里只需停止读取
+      ESP_LOGI(TAG, "chat_pcm cancelled");
+      cancelled = true;
+      err = ESP_OK;
+      break;
+    }
     int r = esp_http_client_read(client, (char *)buf, sizeof(buf));
     if (r < 0) {
       ESP_LOGE(TAG, "http read failed");
@@ -342,6 +466,9 @@ esp_err_t CloudChat::chatWavPcmStream(const uint8_t *wavData, size_t wavLen,
     }
 
     esp_err_t we = player.pcmStreamWrite(p, n, 2000);
+    if (we != ESP_OK && m_cancel.load(std::memory_order_relaxed)) {
+      continue; // 打断与写入竞争：下一轮循环顶部退出
+    }
     if (we != ESP_OK) {
       ESP_LOGE(TAG, "pcmStreamWrite failed: %s", esp_err_to_name(we));
       err = we;
@@ -350,7 +477,6 @@ esp_err_t CloudChat::chatWavPcmStream(const uint8_t *wavData, size_t wavLen,
   }
 
   player.pcmStreamEnd();
-  esp_http_client_close(client);
-  esp_http_client_cleanup(client);
+  pool.release(client, !cancelled && err == ESP_OK);
   return err;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "esp_err.h"
+#include "esp_http_client.h"
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <string>
@@ -19,11 +21,27 @@ struct CloudChatConfig {
   std::string url;
 
   int timeout_ms = 60000;
-  int max_response_bytes = 1024 * 1024; // 1 MiB
+};
+
+/**
+ * @brief 上传请求体的一段（按顺序依次写出，不拼成一整块）
+ */
+struct UploadSpan {
+  const void *data = nullptr;
+  size_t len = 0;
 };
 
 class CloudChat {
 public:
+  static constexpr size_t kWavHeaderBytes = 44;
+
+  /**
+   * @brief 填写 16-bit mono PCM 的 WAV 头
+   * @param dataBytes PCM 字节数；0xFFFFFFFF 表示未知（流式上传）
+   */
+  static void fillWavHeader(uint8_t *header, int sampleRate,
+                            uint32_t dataBytes);
+
   static CloudChat &instance();
 
   CloudChat(const CloudChat &) = delete;
@@ -37,11 +55,25 @@ public:
   /**
    * @brief 发送用户语音（WAV）并播放返回语音（audio/wav）
    *
+   * 回复边下载边播放（16bit PCM WAV，见 WavStreamPlayer），不缓存整段音频，
+   * 长度不受限制；阻塞到下载结束或 cancel()。
+   *
    * @param wavData WAV bytes
    * @param wavLen  WAV length
    * @param deviceId 设备标识，用于服务端维持多轮对话上下文
    */
   esp_err_t chatWav(const uint8_t *wavData, size_t wavLen,
+                    const std::string &deviceId) {
+    UploadSpan span{wavData, wavLen};
+    return chatWav(&span, 1, deviceId);
+  }
+
+  /**
+   * @brief 同 chatWav，请求体由多段组成（例如 WAV 头 + 录音缓冲）
+   *
+   * 各段依次 esp_http_client_write，调用方无需为拼接再分配一块内存。
+   */
+  esp_err_t chatWav(const UploadSpan *spans, size_t count,
                     const std::string &deviceId);
 
   /**
@@ -55,8 +87,55 @@ public:
    * @param deviceId 设备标识，用于服务端维持多轮对话上下文
    */
   esp_err_t chatWavPcmStream(const uint8_t *wavData, size_t wavLen,
+                             const std::string &deviceId) {
+    UploadSpan span{wavData, wavLen};
+    return chatWavPcmStream(&span, 1, deviceId);
+  }
+
+  /**
+   * @brief 同 chatWavPcmStream，请求体由多段组成
+   */
+  esp_err_t chatWavPcmStream(const UploadSpan *spans, size_t count,
                              const std::string &deviceId);
 
+  /**
+   * @brief 流式上传：开始一个分块（chunked）POST，先发送 WAV 头
+   *
+   * 录音过程中用 streamWrite 边录边传，说完后 streamFinish 结束请求体并
+   * 接收回复，服务端不必等整句录完再开始接收。WAV 头里的长度字段为
+   * 0xFFFFFFFF（未知），由服务端按实际长度修正。
+   *
+   * 同一时间只能有一个流；只能在同一个任务里调用 streamXxx。
+   * @param pcmResponse true: 回复按 chatWavPcmStream 处理；false: 按 chatWav 处理
+   */
+  esp_err_t streamBegin(const std::string &deviceId, int sampleRate,
+                        bool pcmResponse);
+
+  /**
+   * @brief 写入一段 16-bit mono PCM（作为一个 chunk 发送）；失败时自动 streamAbort
+   */
+  esp_err_t streamWrite(const int16_t *pcm, size_t samples);
+
+  /**
+   * @brief 结束上传并接收/播放回复（行为与 chatWav / chatWavPcmStream 一致）
+   */
+  esp_err_t streamFinish();
+
+  /**
+   * @brief 放弃当前流（不发送结束块，直接断开）
+   */
+  void streamAbort();
+
+  bool streamActive() const { return m_stream != nullptr; }
+
+  /**
+   * @brief 取消正在进行的 chatWav/chatWavPcmStream（用户打断）
+   *
+   * 可在任意任务调用；请求在下一次读取响应前结束并返回 ESP_OK，不再播放。
+   * 每次新的请求开始时自动清除。
+   */
+  void cancel() { m_cancel.store(true, std::memory_order_relaxed); }
+
   void setUrl(const std::string &url) { m_cfg.url = url; }
   std::string getUrl() const { return m_cfg.url; }
 
@@ -64,6 +143,23 @@ private:
   CloudChat() = default;
   ~CloudChat() = default;
 
+  esp_http_client_handle_t openRequest(const std::string &deviceId,
+                                       const char *accept, int writeLen,
+                                       bool *reused, esp_err_t &err);
+  // 发送请求体并读取响应头；contentLen 输出响应长度（分块响应为 0）
+  esp_http_client_handle_t postSpans(const UploadSpan *spans, size_t count,
+                                     const std::string &deviceId,
+                                     const char *accept, int &contentLen,
+                                     esp_err_t &err);
+  esp_err_t receiveWav(esp_http_client_handle_t client, int contentLen);
+  esp_err_t receivePcmStream(esp_http_client_handle_t client);
+
   CloudChatConfig m_cfg;
   bool m_inited = false;
+  std::atomic<bool> m_cancel{false};
+
+  // 流式上传
+  esp_http_client_handle_t m_stream = nullptr;
+  bool m_streamPcm = false;
+  size_t m_streamBytes = 0;
 };
@@ -1,53 +1,64 @@
 #include "cloud_tts.h"
 
+#include "cJSON.h"
+#include "esp_heap_caps.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
+#include "freertos/task.h"
+#include "http_conn_pool.h"
 #include "mp3_player.h"
+#include "wav_stream.h"
+
+#include "sdkconfig.h"
 
 #include <algorithm>
-#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 
 static const char *TAG = "CloudTts";
 
 namespace {
-struct HttpBuf {
-  uint8_t *data = nullptr;
-  size_t size = 0;
-  size_t cap = 0;
-};
+constexpr size_t kGrowBytes = 32 * 1024;
+constexpr int kCacheQueueLen = 4;
+constexpr uint32_t kIdlePollMs = 200;
 
-static void freeBuf(HttpBuf &b) {
-  if (b.data) {
-    free(b.data);
-  }
-  b = {};
-}
+// PSRAM 中按需增长的响应缓冲（已知 Content-Length 时一次分配）
+struct ResponseBuffer {
+  uint8_t *data = nullptr;
+  size_t bytes = 0;
+  size_t capacity = 0;
 
-static bool ensureCap(HttpBuf &b, size_t need, size_t maxCap) {
-  if (need > maxCap) {
-    return false;
-  }
-  if (b.cap >= need) {
+  bool reserve(size_t want) {
+    if (want <= capacity) {
+      return true;
+    }
+    auto *p = (uint8_t *)heap_caps_realloc(data, want, MALLOC_CAP_SPIRAM);
+    if (!p) {
+      return false;
+    }
+    data = p;
+    capacity = want;
     return true;
   }
 
-  size_t newCap = b.cap == 0 ? 16 * 1024 : b.cap;
-  while (newCap < need) {
-    newCap = std::min(newCap * 2, maxCap);
-    if (newCap < need && newCap == maxCap) {
+  bool append(const uint8_t *src, size_t n) {
+    if (bytes + n > capacity &&
+        !reserve(std::max(bytes + n, capacity + kGrowBytes))) {
       return false;
     }
+    memcpy(data + bytes, src, n);
+    bytes += n;
+    return true;
   }
 
-  void *p = realloc(b.data, newCap);
-  if (!p) {
-    return false;
+  void release() {
+    heap_caps_free(data);
+    data = nullptr;
+    bytes = 0;
+    capacity = 0;
   }
-  b.data = static_cast<uint8_t *>(p);
-  b.cap = newCap;
-  return true;
-}
+};
 } // namespace
 
 CloudTts &CloudTts::instance() {
@@ -58,6 +69,26 @@ CloudTts &CloudTts::instance() {
 esp_err_t CloudTts::init(const CloudTtsConfig &cfg) {
   m_cfg = cfg;
   m_inited = true;
+#if CONFIG_CLOUD_TTS_CACHE_ENABLE
+  // 缓存不可用（分区缺失 / 挂载失败）时照常在线合成
+  esp_err_t ret = m_cache.init(CONFIG_CLOUD_TTS_CACHE_PARTITION,
+                               (size_t)CONFIG_CLOUD_TTS_CACHE_BUDGET_KB * 1024);
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "phrase cache disabled: %s", esp_err_to_name(ret));
+  } else if (m_cacheQueue == nullptr) {
+    // 写 flash 会挂起 cache：放到低优先级任务里，等播放结束再写
+    m_cacheQueue = xQueueCreate(kCacheQueueLen, sizeof(CacheJob));
+    if (m_cacheQueue == nullptr ||
+        xTaskCreatePinnedToCore(cacheTask, "tts_cache", 3072, this, 1,
+                                nullptr, 0) != pdPASS) {
+      ESP_LOGW(TAG, "cache writer not started, phrases will not be stored");
+      if (m_cacheQueue) {
+        vQueueDelete(m_cacheQueue);
+        m_cacheQueue = nullptr;
+      }
+    }
+  }
+#endif
   return ESP_OK;
 }
 
@@ -66,45 +97,126 @@ esp_err_t CloudTts::speak(const std::string &text) {
     ESP_LOGE(TAG, "CloudTts not initialized");
     return ESP_ERR_INVALID_STATE;
   }
+  if (text.empty()) {
+    return ESP_OK;
+  }
+
+  // 重复的语句直接从缓存播放：不需要网络，也没有合成延迟
+  const uint64_t key =
+      TtsCache::makeKey(m_cfg.voice, m_cfg.sample_rate, text);
+  size_t cachedBytes = 0;
+  FILE *fp = m_cache.openForRead(key, &cachedBytes);
+  if (fp) {
+    ESP_LOGI(TAG, "cache hit: %u bytes", (unsigned)cachedBytes);
+    esp_err_t err = playCached(fp);
+    fclose(fp);
+    queueCacheJob({key, nullptr, 0}); // 最近使用序号择机写回
+    if (err == ESP_OK) {
+      return ESP_OK;
+    }
+    ESP_LOGW(TAG, "cached audio unusable (%s), fetching again",
+             esp_err_to_name(err));
+  }
+
   if (m_cfg.url.empty()) {
     ESP_LOGE(TAG, "CloudTts url is empty");
     return ESP_ERR_INVALID_ARG;
   }
-  if (text.empty()) {
-    return ESP_OK;
+  return fetch(text, key);
+}
+
+esp_err_t CloudTts::playCached(FILE *fp) {
+  auto &player = Mp3Player::instance();
+  if (player.getState() != Mp3PlayerState::Idle) {
+    player.stop();
   }
 
-  esp_http_client_config_t cfg = {};
-  cfg.url = m_cfg.url.c_str();
-  cfg.method = HTTP_METHOD_POST;
-  cfg.timeout_ms = m_cfg.timeout_ms;
+  WavStreamPlayer wav;
+  uint8_t buf[2048];
+  size_t r;
+  while ((r = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    esp_err_t err = wav.write(buf, r);
+    if (err != ESP_OK) {
+      wav.abort();
+      return err;
+    }
+  }
+  return wav.finish();
+}
+
+std::string CloudTts::requestBody(const std::string &text,
+                                  const char **contentType) const {
+  if (m_cfg.voice.empty() && m_cfg.sample_rate <= 0) {
+    *contentType = "text/plain; charset=utf-8";
+    return text;
+  }
+  // 指定音色 / 采样率时改用 JSON 请求体（proxy 两种都支持）
+  cJSON *root = cJSON_CreateObject();
+  cJSON_AddStringToObject(root, "text", text.c_str());
+  if (!m_cfg.voice.empty()) {
+    cJSON_AddStringToObject(root, "voice", m_cfg.voice.c_str());
+  }
+  if (m_cfg.sample_rate > 0) {
+    cJSON_AddNumberToObject(root, "sample_rate", m_cfg.sample_rate);
+  }
+  char *json = cJSON_PrintUnformatted(root);
+  cJSON_Delete(root);
+  std::string body = json ? json : "";
+  cJSON_free(json);
+  *contentType = "application/json";
+  return body;
+}
 
-  esp_http_client_handle_t client = esp_http_client_init(&cfg);
-  if (!client) {
+esp_err_t CloudTts::fetch(const std::string &text, uint64_t key) {
+  const char *contentType = nullptr;
+  const std::string body = requestBody(text, &contentType);
+  if (body.empty()) {
     return ESP_ERR_NO_MEM;
   }
 
-  esp_http_client_set_header(client, "Content-Type",
-                             "text/plain; charset=utf-8");
-  esp_http_client_set_header(client, "Accept", "audio/wav");
+  auto &pool = HttpConnPool::instance();
+  esp_http_client_handle_t client = nullptr;
+  esp_err_t err = ESP_OK;
+  int contentLen = -1;
+  int status = 0;
+  // 复用的保活连接可能已被服务端关闭：收到响应头之前失败就换新连接重试一次
+  for (int attempt = 0;; attempt++) {
+    bool reused = false;
+    client = pool.acquire(m_cfg.url, HTTP_METHOD_POST, m_cfg.timeout_ms,
+                          &reused);
+    if (!client) {
+      return ESP_ERR_NO_MEM;
+    }
+    pool.setHeader(client, "Content-Type", contentType);
+    pool.setHeader(client, "Accept", "audio/wav");
 
-  esp_err_t err = esp_http_client_open(client, (int)text.size());
-  if (err != ESP_OK) {
-    ESP_LOGE(TAG, "http open failed: %s", esp_err_to_name(err));
-    esp_http_client_cleanup(client);
+    err = pool.open(client, (int)body.size());
+    if (err == ESP_OK) {
+      int w = esp_http_client_write(client, body.data(), (int)body.size());
+      if (w < 0 || (size_t)w != body.size()) {
+        ESP_LOGW(TAG, "http write failed: wrote=%d", w);
+        err = ESP_FAIL;
+      }
+    }
+    if (err == ESP_OK) {
+      contentLen = (int)esp_http_client_fetch_headers(client);
+      status = esp_http_client_get_status_code(client);
+      if (contentLen < 0 || status <= 0) {
+        err = ESP_FAIL;
+      }
+    }
+    if (err == ESP_OK) {
+      break;
+    }
+    if (reused && attempt == 0) {
+      pool.releaseStale(client);
+      continue;
+    }
+    ESP_LOGE(TAG, "http request failed: %s", esp_err_to_name(err));
+    pool.release(client, false);
     return err;
   }
 
-  int w = esp_http_client_write(client, text.data(), (int)text.size());
-  if (w < 0 || (size_t)w != text.size()) {
-    ESP_LOGE(TAG, "http write failed: wrote=%d", w);
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
-    return ESP_FAIL;
-  }
-
-  int contentLen = esp_http_client_fetch_headers(client);
-  int status = esp_http_client_get_status_code(client);
   if (status != 200) {
     ESP_LOGE(TAG, "TTS server http status=%d, contentLen=%d", status,
              contentLen);
@@ -116,101 +228,107 @@ esp_err_t CloudTts::speak(const std::string &text) {
       ESP_LOGE(TAG, "TTS server body: %s", errBuf);
     }
 
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
+    pool.release(client);
     return ESP_FAIL;
   }
 
-  HttpBuf buf;
-  size_t maxBytes = (size_t)std::max(0, m_cfg.max_response_bytes);
-  if (maxBytes == 0) {
-    maxBytes = 256 * 1024;
+  // 边下载边播放：解析到 data 块就开始 PCM 流；要缓存的响应同时攒在
+  // PSRAM，播放结束后再写 flash（过长或内存不足就放弃缓存，不影响播放）
+  auto &player = Mp3Player::instance();
+  if (player.getState() != Mp3PlayerState::Idle) {
+    player.stop();
   }
 
-  if (contentLen > 0) {
-    if (!ensureCap(buf, (size_t)contentLen, maxBytes)) {
-      ESP_LOGE(TAG, "response too large: %d", contentLen);
-      esp_http_client_close(client);
-      esp_http_client_cleanup(client);
-      return ESP_ERR_NO_MEM;
-    }
-  } else {
-    if (!ensureCap(buf, 16 * 1024, maxBytes)) {
-      esp_http_client_close(client);
-      esp_http_client_cleanup(client);
-      return ESP_ERR_NO_MEM;
-    }
+  bool caching = m_cacheQueue != nullptr &&
+                 m_cache.beginWrite(key, contentLen > 0 ? contentLen : 0);
+  ResponseBuffer cacheBuf;
+  if (caching && contentLen > 0 && !cacheBuf.reserve((size_t)contentLen)) {
+    m_cache.abortWrite(key);
+    caching = false;
   }
-
+  WavStreamPlayer wav;
+  uint8_t buf[2048];
+  size_t total = 0;
   while (true) {
-    if (buf.size == buf.cap) {
-      if (!ensureCap(buf, buf.cap + 1024, maxBytes)) {
-        ESP_LOGE(TAG, "response exceeds max bytes (%u)",
-                 (unsigned)maxBytes);
-        freeBuf(buf);
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        return ESP_ERR_NO_MEM;
-      }
-    }
-
-    int r = esp_http_client_read(
-        client, reinterpret_cast<char *>(buf.data + buf.size),
-        (int)std::min((size_t)4096, buf.cap - buf.size));
+    int r = esp_http_client_read(client, reinterpret_cast<char *>(buf),
+                                 sizeof(buf));
     if (r < 0) {
       ESP_LOGE(TAG, "http read failed");
-      freeBuf(buf);
-      esp_http_client_close(client);
-      esp_http_client_cleanup(client);
-      return ESP_FAIL;
+      err = ESP_FAIL;
+      break;
     }
     if (r == 0) {
       break;
     }
-    buf.size += (size_t)r;
+    total += (size_t)r;
+    err = wav.write(buf, (size_t)r);
+    if (err != ESP_OK) {
+      break;
+    }
+    if (caching && (total > m_cache.maxEntryBytes() ||
+                    !cacheBuf.append(buf, (size_t)r))) {
+      m_cache.abortWrite(key);
+      cacheBuf.release();
+      caching = false;
+    }
   }
 
-  esp_http_client_close(client);
-  esp_http_client_cleanup(client);
+  // 响应读完才保留连接（pool 内部检查）
+  pool.release(client, err == ESP_OK);
 
-  if (contentLen > 0 && (int)buf.size < contentLen) {
-    ESP_LOGE(TAG, "incomplete download: got=%u expected=%d",
-             (unsigned)buf.size, contentLen);
-    freeBuf(buf);
-    return ESP_FAIL;
+  const bool truncated = contentLen > 0 && (int)total < contentLen;
+  if (err == ESP_OK && truncated) {
+    // 已播放的部分保留，只记录截断
+    ESP_LOGW(TAG, "incomplete download: got=%u expected=%d", (unsigned)total,
+             contentLen);
   }
-
-  if (buf.size == 0) {
-    ESP_LOGE(TAG, "empty audio response");
-    freeBuf(buf);
-    return ESP_FAIL;
+  if (caching) {
+    // 只缓存完整、能播放的响应
+    if (err == ESP_OK && !truncated && wav.started()) {
+      queueCacheJob({key, cacheBuf.data, cacheBuf.bytes});
+    } else {
+      m_cache.abortWrite(key);
+      cacheBuf.release();
+    }
   }
-
-  if (buf.size < 4 || memcmp(buf.data, "RIFF", 4) != 0) {
-    ESP_LOGE(TAG, "unexpected audio header (not RIFF), size=%u",
-             (unsigned)buf.size);
-    freeBuf(buf);
-    return ESP_FAIL;
+  if (err != ESP_OK) {
+    wav.abort();
+    return err;
   }
 
-  ESP_LOGI(TAG, "TTS audio bytes: %u", (unsigned)buf.size);
+  err = wav.finish();
+  ESP_LOGI(TAG, "TTS audio bytes: %u", (unsigned)total);
+  return err;
+}
 
-  // 播放返回的 audio/wav（Mp3Player 基于 audio_player，支持 WAV/MP3 解码）
-  auto &player = Mp3Player::instance();
-  if (player.getState() != Mp3PlayerState::Idle) {
-    player.stop();
+void CloudTts::queueCacheJob(const CacheJob &job) {
+  if (m_cacheQueue != nullptr &&
+      xQueueSend(m_cacheQueue, &job, 0) == pdTRUE) {
+    return;
   }
-
-  err = player.playOwnedBuffer(buf.data, buf.size, false);
-  if (err != ESP_OK) {
-    ESP_LOGE(TAG, "playOwnedBuffer failed: %s", esp_err_to_name(err));
-    freeBuf(buf);
-    return err;
+  // 积压太多：这一句不缓存（索引写回留给下一次）
+  if (job.data != nullptr) {
+    m_cache.abortWrite(job.key);
+    heap_caps_free(job.data);
   }
+}
 
-  // 播放器接管内存
-  buf.data = nullptr;
-  buf.size = 0;
-  buf.cap = 0;
-  return ESP_OK;
+void CloudTts::cacheTask(void *arg) {
+  auto *self = static_cast<CloudTts *>(arg);
+  CacheJob job;
+  while (true) {
+    if (xQueueReceive(self->m_cacheQueue, &job, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    // 播放中写 flash 会挂起 cache，造成断音：等播放器空闲
+    while (Mp3Player::instance().getState() != Mp3PlayerState::Idle) {
+      vTaskDelay(pdMS_TO_TICKS(kIdlePollMs));
+    }
+    if (job.data != nullptr) {
+      self->m_cache.commitWrite(job.key, job.data, job.bytes);
+      heap_caps_free(job.data);
+    } else {
+      self->m_cache.flushIndex();
+    }
+  }
 }
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "tts_cache.h"
+#include <cstdint>
+#include <cstdio>
 #include <string>
 
 /**
@@ -18,7 +23,13 @@ struct CloudTtsConfig {
   std::string url;
 
   int timeout_ms = 15000;
-  int max_response_bytes = 1024 * 1024; // 1 MiB，按需调整
+
+  /**
+   * @brief 音色 / 采样率（空 / 0 = proxy 默认）；任一设置时以 JSON 请求体
+   *        {"text", "voice", "sample_rate"} 发送，并参与语句缓存的键
+   */
+  std::string voice;
+  int sample_rate = 0;
 };
 
 /**
@@ -36,18 +47,43 @@ public:
   esp_err_t init(const CloudTtsConfig &cfg);
 
   /**
-   * @brief 合成并播放语音（阻塞：下载完成后开始播放）
+   * @brief 合成并播放语音（CONFIG_CLOUD_TTS_CACHE_ENABLE 时先查语句缓存）
+   *
+   * 边下载边播放（16bit PCM WAV）：收到 data 块的第一段就开始出声，
+   * 响应长度不受限制。阻塞到下载结束，此时最后约 1 s 音频仍在播放。
+   * 要缓存的响应先攒在 PSRAM，播放结束后由低优先级任务写入 flash。
    */
   esp_err_t speak(const std::string &text);
 
   void setUrl(const std::string &url) { m_cfg.url = url; }
   std::string getUrl() const { return m_cfg.url; }
 
+  /**
+   * @brief 语句缓存统计（未开启时全为 0）
+   */
+  TtsCacheStats cacheStats() const { return m_cache.stats(); }
+
 private:
   CloudTts() = default;
   ~CloudTts() = default;
 
+  // 延后到播放结束的缓存写入；data 为 nullptr 时只写回索引
+  struct CacheJob {
+    uint64_t key = 0;
+    uint8_t *data = nullptr; // PSRAM，由写入任务释放
+    size_t bytes = 0;
+  };
+
+  esp_err_t playCached(FILE *fp);
+  esp_err_t fetch(const std::string &text, uint64_t key);
+  std::string requestBody(const std::string &text,
+                          const char **contentType) const;
+  void queueCacheJob(const CacheJob &job);
+  static void cacheTask(void *arg);
+
   CloudTtsConfig m_cfg;
   bool m_inited = false;
+  TtsCache m_cache; // 语句缓存（storage 分区）
+  QueueHandle_t m_cacheQueue = nullptr;
 };
 
@@ -0,0 +1,359 @@
+#include "tts_cache.h"
+
+#include "esp_log.h"
+#include "esp_spiffs.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *TAG = "TtsCache";
+
+namespace {
+constexpr const char *kBasePath = "/storage";
+constexpr const char *kIndexPath = "/storage/tts_index.bin";
+constexpr const char *kPrefix = "tts_";
+constexpr uint32_t kIndexMagic = 0x31435454; // "TTC1"
+
+uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+  const auto *p = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// "tts_<16 hex>.<suffix>" -> key；不是缓存文件返回 false
+bool parseName(const char *name, uint64_t *key, const char **suffix) {
+  const size_t prefixLen = strlen(kPrefix);
+  if (strncmp(name, kPrefix, prefixLen) != 0 ||
+      strlen(name) < prefixLen + 16 + 1 || name[prefixLen + 16] != '.') {
+    return false;
+  }
+  uint64_t v = 0;
+  for (size_t i = 0; i < 16; i++) {
+    const char c = name[prefixLen + i];
+    int d;
+    if (c >= '0' && c <= '9') {
+      d = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      d = c - 'a' + 10;
+    } else {
+      return false;
+    }
+    v = (v << 4) | (uint64_t)d;
+  }
+  *key = v;
+  *suffix = name + prefixLen + 17;
+  return true;
+}
+} // namespace
+
+uint64_t TtsCache::makeKey(const std::string &voice, int sampleRate,
+                           const std::string &text) {
+  char rate[16];
+  const int n = snprintf(rate, sizeof(rate), "%d", sampleRate);
+  uint64_t h = 0xcbf29ce484222325ULL;
+  h = fnv1a(h, voice.data(), voice.size() + 1); // 含结尾 '\0' 作分隔
+  h = fnv1a(h, rate, (size_t)n + 1);
+  h = fnv1a(h, text.data(), text.size());
+  return h;
+}
+
+std::string TtsCache::pathFor(uint64_t key, const char *suffix) const {
+  char path[64];
+  snprintf(path, sizeof(path), "%s/%s%016" PRIx64 ".%s", kBasePath, kPrefix,
+           key, suffix);
+  return path;
+}
+
+esp_err_t TtsCache::init(const char *partitionLabel, size_t budgetBytes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_ready) {
+    return ESP_OK;
+  }
+  esp_vfs_spiffs_conf_t conf = {};
+  conf.base_path = kBasePath;
+  conf.partition_label = partitionLabel;
+  conf.max_files = 4;
+  conf.format_if_mount_failed = true;
+  esp_err_t ret = esp_vfs_spiffs_register(&conf);
+  if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+    ESP_LOGE(TAG, "mount %s failed: %s", partitionLabel, esp_err_to_name(ret));
+    return ret;
+  }
+
+  size_t total = 0;
+  size_t used = 0;
+  ret = esp_spiffs_info(partitionLabel, &total, &used);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "spiffs info failed: %s", esp_err_to_name(ret));
+    return ret;
+  }
+  // 预算 + 一条正在写的临时文件（预算的 1/4）不超过分区的 5/6：
+  // SPIFFS 接近写满时垃圾回收会让写入变得很慢
+  m_budget = std::min(budgetBytes, total / 3 * 2);
+
+  loadIndex();
+  reconcile();
+  m_ready = true;
+  ESP_LOGI(TAG, "%u entries, %u / %u bytes (partition %u / %u)",
+           (unsigned)m_entries.size(), (unsigned)m_bytes, (unsigned)m_budget,
+           (unsigned)used, (unsigned)total);
+  return ESP_OK;
+}
+
+void TtsCache::loadIndex() {
+  m_entries.clear();
+  FILE *fp = fopen(kIndexPath, "rb");
+  if (!fp) {
+    return;
+  }
+  uint32_t hdr[2] = {};
+  if (fread(hdr, sizeof(hdr), 1, fp) == 1 && hdr[0] == kIndexMagic &&
+      hdr[1] <= 4096) {
+    m_entries.resize(hdr[1]);
+    if (hdr[1] > 0 &&
+        fread(m_entries.data(), sizeof(Entry), hdr[1], fp) != hdr[1]) {
+      ESP_LOGW(TAG, "index truncated, rebuilding from files");
+      m_entries.clear();
+    }
+  }
+  fclose(fp);
+}
+
+void TtsCache::reconcile() {
+  // 以分区中的实际文件为准：索引里有而文件没有的剔除，没有索引的文件收编为最旧
+  std::vector<bool> seen(m_entries.size(), false);
+  bool changed = false;
+  DIR *dir = opendir(kBasePath);
+  if (dir) {
+    struct dirent *de;
+    while ((de = readdir(dir)) != nullptr) {
+      uint64_t key = 0;
+      const char *suffix = nullptr;
+      if (!parseName(de->d_name, &key, &suffix)) {
+        continue;
+      }
+      const std::string path = std::string(kBasePath) + "/" + de->d_name;
+      if (strcmp(suffix, "wav") != 0) {
+        unlink(path.c_str()); // 断电留下的 .tmp
+        continue;
+      }
+      struct stat st;
+      if (stat(path.c_str(), &st) != 0) {
+        continue;
+      }
+      auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                             [key](const Entry &e) { return e.key == key; });
+      if (it == m_entries.end()) {
+        m_entries.push_back({key, (uint32_t)st.st_size, 0});
+        seen.push_back(true);
+        changed = true;
+      } else {
+        it->bytes = (uint32_t)st.st_size;
+        seen[it - m_entries.begin()] = true;
+      }
+    }
+    closedir(dir);
+  }
+
+  m_bytes = 0;
+  m_seq = 1;
+  size_t out = 0;
+  for (size_t i = 0; i < m_entries.size(); i++) {
+    if (!seen[i]) {
+      changed = true;
+      continue;
+    }
+    m_entries[out++] = m_entries[i];
+    m_bytes += m_entries[i].bytes;
+    m_seq = std::max(m_seq, m_entries[i].seq + 1);
+  }
+  m_entries.resize(out);
+
+  // 预算变小（menuconfig 调整）时立即淘汰
+  if (m_bytes > m_budget) {
+    evictFor(0);
+    changed = true;
+  }
+  if (changed) {
+    saveIndex();
+  }
+}
+
+void TtsCache::saveIndex() {
+  m_indexDirty = false;
+  FILE *fp = fopen(kIndexPath, "wb");
+  if (!fp) {
+    ESP_LOGW(TAG, "index write failed");
+    return;
+  }
+  const uint32_t hdr[2] = {kIndexMagic, (uint32_t)m_entries.size()};
+  bool ok = fwrite(hdr, sizeof(hdr), 1, fp) == 1;
+  if (ok && !m_entries.empty()) {
+    ok = fwrite(m_entries.data(), sizeof(Entry), m_entries.size(), fp) ==
+         m_entries.size();
+  }
+  fclose(fp);
+  if (!ok) {
+    ESP_LOGW(TAG, "index write incomplete");
+  }
+}
+
+TtsCache::Entry *TtsCache::find(uint64_t key) {
+  for (auto &e : m_entries) {
+    if (e.key == key) {
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+void TtsCache::removeEntry(size_t idx) {
+  unlink(pathFor(m_entries[idx].key, "wav").c_str());
+  m_bytes -= std::min(m_bytes, (size_t)m_entries[idx].bytes);
+  m_entries.erase(m_entries.begin() + idx);
+}
+
+void TtsCache::evictFor(size_t incoming) {
+  while (!m_entries.empty() && m_bytes + incoming > m_budget) {
+    size_t oldest = 0;
+    for (size_t i = 1; i < m_entries.size(); i++) {
+      if (m_entries[i].seq < m_entries[oldest].seq) {
+        oldest = i;
+      }
+    }
+    ESP_LOGI(TAG, "evict %016" PRIx64 " (%u bytes)", m_entries[oldest].key,
+             (unsigned)m_entries[oldest].bytes);
+    removeEntry(oldest);
+    m_stats.evictions++;
+  }
+}
+
+FILE *TtsCache::openForRead(uint64_t key, size_t *bytes) {
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_ready) {
+      return nullptr;
+    }
+    Entry *e = find(key);
+    if (!e) {
+      m_stats.misses++;
+      return nullptr;
+    }
+    e->seq = m_seq++;
+    m_indexDirty = true;
+    m_stats.hits++;
+    if (bytes) {
+      *bytes = e->bytes;
+    }
+    path = pathFor(key, "wav");
+  }
+  FILE *fp = fopen(path.c_str(), "rb");
+  if (!fp) {
+    // 文件被外部删除：从索引中剔除
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_entries.size(); i++) {
+      if (m_entries[i].key == key) {
+        removeEntry(i);
+        m_indexDirty = true;
+        break;
+      }
+    }
+  }
+  return fp;
+}
+
+bool TtsCache::ready() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_ready;
+}
+
+bool TtsCache::beginWrite(uint64_t key, size_t expectedBytes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_ready || expectedBytes > maxEntryBytes() || find(key) != nullptr ||
+      std::find(m_writing.begin(), m_writing.end(), key) != m_writing.end()) {
+    return false;
+  }
+  m_writing.push_back(key);
+  return true;
+}
+
+void TtsCache::endWriteLocked(uint64_t key) {
+  auto it = std::find(m_writing.begin(), m_writing.end(), key);
+  if (it != m_writing.end()) {
+    m_writing.erase(it);
+  }
+}
+
+void TtsCache::abortWrite(uint64_t key) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  endWriteLocked(key);
+}
+
+esp_err_t TtsCache::commitWrite(uint64_t key, const uint8_t *data,
+                                size_t bytes) {
+  if (data == nullptr || bytes == 0 || bytes > maxEntryBytes()) {
+    abortWrite(key);
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  // 键由 beginWrite 独占，.tmp 只有这一个写者
+  const std::string tmp = pathFor(key, "tmp");
+  FILE *fp = fopen(tmp.c_str(), "wb");
+  bool ok = fp != nullptr && fwrite(data, 1, bytes, fp) == bytes;
+  if (fp && fclose(fp) != 0) {
+    ok = false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  endWriteLocked(key);
+  if (!ok) {
+    ESP_LOGW(TAG, "write %016" PRIx64 " failed", key);
+    unlink(tmp.c_str());
+    return ESP_FAIL;
+  }
+  evictFor(bytes);
+  const std::string path = pathFor(key, "wav");
+  if (rename(tmp.c_str(), path.c_str()) != 0) {
+    unlink(tmp.c_str());
+    saveIndex();
+    return ESP_FAIL;
+  }
+  m_entries.push_back({key, (uint32_t)bytes, m_seq++});
+  m_bytes += bytes;
+  saveIndex();
+  ESP_LOGI(TAG, "cached %016" PRIx64 " (%u bytes, total %u / %u)", key,
+           (unsigned)bytes, (unsigned)m_bytes, (unsigned)m_budget);
+  return ESP_OK;
+}
+
+void TtsCache::flushIndex() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_ready && m_indexDirty) {
+    saveIndex();
+  }
+}
+
+TtsCacheStats TtsCache::stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  TtsCacheStats s = m_stats;
+  s.entries = (uint32_t)m_entries.size();
+  s.bytes = m_bytes;
+  s.budget = m_budget;
+  return s;
+}
+
+void TtsCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  while (!m_entries.empty()) {
+    removeEntry(m_entries.size() - 1);
+  }
+  saveIndex();
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "esp_err.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief TTS 缓存统计
+ */
+struct TtsCacheStats {
+  uint32_t entries = 0;
+  size_t bytes = 0;     /*!< 缓存文件总字节 */
+  size_t budget = 0;    /*!< 容量上限 */
+  uint32_t hits = 0;
+  uint32_t misses = 0;
+  uint32_t evictions = 0;
+};
+
+/**
+ * @brief TTS 语句缓存：按内容寻址的 WAV 文件 + 内存索引 + LRU 淘汰
+ *
+ * - 键为 (voice, sample_rate, text) 的 64 位 FNV-1a 哈希，文件名
+ *   tts_<16 位十六进制>.wav，内容为服务端返回的原始 WAV
+ * - 索引（键、大小、最近使用序号）常驻内存，增删时写回 index.bin；命中只
+ *   更新内存中的序号，由 flushIndex() 择机批量写回。开机时读取索引并与分区
+ *   中的实际文件核对（缺失的剔除，孤儿文件收编）
+ * - 写入分两步：下载期间 beginWrite 占住键（同一句并发合成时只有一个写者），
+ *   完整响应由调用方攒在内存里，commitWrite 一次写入 .tmp 再 rename 成正式
+ *   文件，断电不会留下半截缓存
+ * - 总大小超出预算时按最近使用顺序淘汰
+ *
+ * 线程安全（内部加锁；文件读写本身不持锁）。写 flash 期间 cache 会被挂起，
+ * commitWrite / flushIndex 应在播放结束后、从低优先级任务调用。
+ */
+class TtsCache {
+public:
+  /**
+   * @brief 挂载 SPIFFS 分区并加载索引
+   * @param partitionLabel 分区名（partitions-16MB.csv 中的 storage）
+   * @param budgetBytes    缓存容量上限（会限制在分区容量的 2/3 以内）
+   */
+  esp_err_t init(const char *partitionLabel, size_t budgetBytes);
+
+  bool ready() const;
+
+  static uint64_t makeKey(const std::string &voice, int sampleRate,
+                          const std::string &text);
+
+  /**
+   * @brief 查找并打开缓存文件（命中时更新最近使用）
+   * @return 文件句柄（调用方 fclose）；未命中返回 nullptr
+   */
+  FILE *openForRead(uint64_t key, size_t *bytes);
+
+  /**
+   * @brief 占住一个新条目的写入
+   * @param expectedBytes 已知的响应长度（未知为 0），超出单条上限时直接放弃
+   * @return false 不缓存（未就绪 / 已缓存 / 同一键正在写入 / 过大）；
+   *         true 时必须以 commitWrite 或 abortWrite 结束
+   */
+  bool beginWrite(uint64_t key, size_t expectedBytes);
+
+  /**
+   * @brief 写入完整内容：必要时淘汰旧条目，临时文件改名为正式条目
+   */
+  esp_err_t commitWrite(uint64_t key, const uint8_t *data, size_t bytes);
+
+  /**
+   * @brief 放弃写入（释放 beginWrite 占住的键）
+   */
+  void abortWrite(uint64_t key);
+
+  /**
+   * @brief 命中更新过最近使用序号时写回索引（没有变化不写）
+   */
+  void flushIndex();
+
+  /** 单条上限（预算的 1/4，16 kHz 单声道约 20 s），超过的响应不缓存 */
+  size_t maxEntryBytes() const { return m_budget / 4; }
+
+  TtsCacheStats stats() const;
+
+  /**
+   * @brief 删除所有缓存条目
+   */
+  void clear();
+
+private:
+  struct Entry {
+    uint64_t key = 0;
+    uint32_t bytes = 0;
+    uint32_t seq = 0; // 最近使用序号，越大越新
+  };
+
+  std::string pathFor(uint64_t key, const char *suffix) const;
+  Entry *find(uint64_t key);
+  void loadIndex();
+  void reconcile();
+  void saveIndex();
+  void evictFor(size_t incoming);
+  void removeEntry(size_t idx);
+  void endWriteLocked(uint64_t key);
+
+  mutable std::mutex m_mutex;
+  bool m_ready = false;
+  std::vector<Entry> m_entries;
+  size_t m_bytes = 0;
+  size_t m_budget = 0;
+  uint32_t m_seq = 1; // 命中只更新内存中的序号，flushIndex / 增删时写回
+  bool m_indexDirty = false;
+  std::vector<uint64_t> m_writing; // beginWrite 占住、尚未结束的键
+  TtsCacheStats m_stats;
+};
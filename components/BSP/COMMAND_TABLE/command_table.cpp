@@ -0,0 +1,376 @@
+#include "command_table.h"
+
+#include "cJSON.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+
+static const char *TAG = "CommandTable";
+
+namespace {
+
+constexpr const char *kNvsNamespace = "cmdtab";
+constexpr const char *kNvsKeyTable = "table";
+
+struct ActionInfo {
+  VoiceCommand action;
+  const char *name;
+};
+
+constexpr ActionInfo kActions[] = {
+    {VoiceCommand::LightOn, "light_on"},
+    {VoiceCommand::LightOff, "light_off"},
+    {VoiceCommand::Forward, "forward"},
+    {VoiceCommand::Backward, "backward"},
+    {VoiceCommand::DragonTail, "dragon_tail"},
+};
+
+// MultiNet 拼音：小写字母 + 单个空格分隔；返回规范化后的结果，非法时返回空串
+std::string normalizePhrase(const char *s) {
+  std::string out;
+  bool pendingSpace = false;
+  for (; *s != '\0'; s++) {
+    char c = (char)tolower((unsigned char)*s);
+    if (c == ' ' || c == '\t') {
+      pendingSpace = !out.empty();
+      continue;
+    }
+    if (c < 'a' || c > 'z') {
+      return std::string();
+    }
+    if (pendingSpace) {
+      out += ' ';
+      pendingSpace = false;
+    }
+    out += c;
+  }
+  return out;
+}
+
+} // namespace
+
+CommandTable &CommandTable::instance() {
+  static CommandTable instance;
+  return instance;
+}
+
+const char *CommandTable::actionName(VoiceCommand action) {
+  for (const auto &a : kActions) {
+    if (a.action == action) {
+      return a.name;
+    }
+  }
+  return "unknown";
+}
+
+VoiceCommand CommandTable::actionFromName(const char *name) {
+  if (name == nullptr) {
+    return VoiceCommand::Unknown;
+  }
+  for (const auto &a : kActions) {
+    if (strcmp(a.name, name) == 0) {
+      return a.action;
+    }
+  }
+  return VoiceCommand::Unknown;
+}
+
+std::vector<CommandEntry> CommandTable::defaultEntries() {
+  return {
+      {0, "kai deng", "开灯", VoiceCommand::LightOn},
+      {1, "guan deng", "关灯", VoiceCommand::LightOff},
+      {2, "qian jin", "前进", VoiceCommand::Forward},
+      {3, "hou tui", "后退", VoiceCommand::Backward},
+      {4, "shen long bai wei", "神龙摆尾", VoiceCommand::DragonTail},
+  };
+}
+
+bool CommandTable::parseJson(const char *json, size_t len,
+                             std::vector<CommandEntry> &out,
+                             std::string &error) {
+  cJSON *root = cJSON_ParseWithLength(json, len);
+  if (root == nullptr) {
+    error = "invalid json";
+    return false;
+  }
+
+  const cJSON *list = cJSON_GetObjectItem(root, "commands");
+  if (!cJSON_IsArray(list)) {
+    cJSON_Delete(root);
+    error = "missing \"commands\" array";
+    return false;
+  }
+
+  std::vector<CommandEntry> entries;
+  std::set<int> ids;
+  std::set<std::string> phrases;
+  const cJSON *item = nullptr;
+  cJSON_ArrayForEach(item, list) {
+    char where[24];
+    snprintf(where, sizeof(where), "commands[%u]: ", (unsigned)entries.size());
+
+    const cJSON *id = cJSON_GetObjectItem(item, "id");
+    const cJSON *phrase = cJSON_GetObjectItem(item, "phrase");
+    const cJSON *name = cJSON_GetObjectItem(item, "name");
+    const cJSON *action = cJSON_GetObjectItem(item, "action");
+    if (!cJSON_IsNumber(id) || !cJSON_IsString(phrase) ||
+        !cJSON_IsString(action)) {
+      error = std::string(where) + "need id/phrase/action";
+      break;
+    }
+
+    CommandEntry e;
+    e.id = id->valueint;
+    if (e.id < 0 || e.id > kMaxCommandId || !ids.insert(e.id).second) {
+      error = std::string(where) + "id must be unique in 0.." +
+              std::to_string(kMaxCommandId);
+      break;
+    }
+    e.phrase = normalizePhrase(phrase->valuestring);
+    if (e.phrase.empty() || e.phrase.size() > kMaxPhraseLen) {
+      error = std::string(where) + "phrase must be pinyin (a-z and spaces)";
+      break;
+    }
+    if (!phrases.insert(e.phrase).second) {
+      error = std::string(where) + "duplicate phrase \"" + e.phrase + "\"";
+      break;
+    }
+    e.name = cJSON_IsString(name) ? name->valuestring : e.phrase;
+    if (e.name.empty() || e.name.size() > kMaxNameLen) {
+      error = std::string(where) + "name too long";
+      break;
+    }
+    e.action = actionFromName(action->valuestring);
+    if (e.action == VoiceCommand::Unknown) {
+      error = std::string(where) + "unknown action \"" +
+              action->valuestring + "\"";
+      break;
+    }
+    entries.push_back(std::move(e));
+    if (entries.size() > kMaxCommands) {
+      error = "too many commands (max " + std::to_string(kMaxCommands) + ")";
+      break;
+    }
+  }
+  cJSON_Delete(root);
+
+  if (!error.empty()) {
+    return false;
+  }
+  if (entries.empty()) {
+    error = "command table is empty";
+    return false;
+  }
+  out = std::move(entries);
+  return true;
+}
+
+std::string CommandTable::serialize(const std::vector<CommandEntry> &entries) {
+  cJSON *root = cJSON_CreateObject();
+  cJSON *list = cJSON_AddArrayToObject(root, "commands");
+  for (const auto &e : entries) {
+    cJSON *item = cJSON_CreateObject();
+    cJSON_AddNumberToObject(item, "id", e.id);
+    cJSON_AddStringToObject(item, "phrase", e.phrase.c_str());
+    cJSON_AddStringToObject(item, "name", e.name.c_str());
+    cJSON_AddStringToObject(item, "action", actionName(e.action));
+    cJSON_AddItemToArray(list, item);
+  }
+  char *str = cJSON_PrintUnformatted(root);
+  std::string out = str ? str : "";
+  free(str);
+  cJSON_Delete(root);
+  return out;
+}
+
+esp_err_t CommandTable::load() {
+  // 命令表在 WakeWord 初始化前加载，早于 WifiManager 的 NVS 初始化
+  esp_err_t ret = nvs_flash_init();
+  if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
+      ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    ret = nvs_flash_init();
+  }
+
+  std::vector<CommandEntry> entries;
+  nvs_handle_t h;
+  if (ret == ESP_OK && nvs_open(kNvsNamespace, NVS_READONLY, &h) == ESP_OK) {
+    size_t len = 0;
+    if (nvs_get_blob(h, kNvsKeyTable, nullptr, &len) == ESP_OK && len > 0) {
+      std::string json(len, '\0');
+      if (nvs_get_blob(h, kNvsKeyTable, &json[0], &len) == ESP_OK) {
+        std::string error;
+        if (!parseJson(json.data(), len, entries, error)) {
+          ESP_LOGW(TAG, "保存的命令表无效 (%s)，使用默认表", error.c_str());
+          entries.clear();
+        }
+      }
+    }
+    nvs_close(h);
+  }
+
+  bool fromNvs = !entries.empty();
+  if (!fromNvs) {
+    entries = defaultEntries();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries = std::move(entries);
+  ESP_LOGI(TAG, "命令表: %u 条 (%s)", (unsigned)m_entries.size(),
+           fromNvs ? "NVS" : "默认");
+  return ESP_OK;
+}
+
+void CommandTable::setReloadHook(ReloadHook hook) {
+  std::lock_guard<std::mutex> lock(m_updateMutex);
+  m_reloadHook = std::move(hook);
+}
+
+esp_err_t CommandTable::apply(std::vector<CommandEntry> entries,
+                              std::string &error) {
+  std::vector<CommandEntry> previous;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    previous = std::move(m_entries);
+    m_entries = std::move(entries);
+  }
+
+  if (!m_reloadHook) {
+    return ESP_OK; // MultiNet 尚未初始化，init 时会直接读取新表
+  }
+
+  esp_err_t ret = m_reloadHook(error);
+  if (ret == ESP_OK) {
+    return ESP_OK;
+  }
+
+  ESP_LOGW(TAG, "热加载失败 (%s)，回滚", error.c_str());
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries = std::move(previous);
+  }
+  std::string rollbackError;
+  if (m_reloadHook(rollbackError) != ESP_OK) {
+    ESP_LOGE(TAG, "回滚旧命令表失败: %s", rollbackError.c_str());
+  }
+  return ret;
+}
+
+esp_err_t CommandTable::updateFromJson(const char *json, size_t len,
+                                       std::string &error) {
+  std::vector<CommandEntry> entries;
+  if (!parseJson(json, len, entries, error)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  std::lock_guard<std::mutex> lock(m_updateMutex);
+  std::vector<CommandEntry> copy = entries;
+  esp_err_t ret = apply(std::move(entries), error);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  ret = save(copy);
+  if (ret != ESP_OK) {
+    error = "saved to MultiNet but NVS write failed";
+  }
+  ESP_LOGI(TAG, "命令表已更新: %u 条", (unsigned)copy.size());
+  return ret;
+}
+
+esp_err_t CommandTable::resetToDefaults(std::string &error) {
+  std::lock_guard<std::mutex> lock(m_updateMutex);
+  esp_err_t ret = apply(defaultEntries(), error);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  ret = eraseSaved();
+  if (ret != ESP_OK) {
+    error = "NVS erase failed";
+  }
+  return ret;
+}
+
+esp_err_t CommandTable::save(const std::vector<CommandEntry> &entries) {
+  std::string json = serialize(entries);
+  nvs_handle_t h;
+  esp_err_t ret = nvs_open(kNvsNamespace, NVS_READWRITE, &h);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "nvs_open 失败: %s", esp_err_to_name(ret));
+    return ret;
+  }
+  ret = nvs_set_blob(h, kNvsKeyTable, json.data(), json.size());
+  if (ret == ESP_OK) {
+    ret = nvs_commit(h);
+  }
+  nvs_close(h);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "保存命令表失败: %s", esp_err_to_name(ret));
+  }
+  return ret;
+}
+
+esp_err_t CommandTable::eraseSaved() {
+  nvs_handle_t h;
+  esp_err_t ret = nvs_open(kNvsNamespace, NVS_READWRITE, &h);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  ret = nvs_erase_key(h, kNvsKeyTable);
+  if (ret == ESP_ERR_NVS_NOT_FOUND) {
+    ret = ESP_OK;
+  }
+  if (ret == ESP_OK) {
+    ret = nvs_commit(h);
+  }
+  nvs_close(h);
+  return ret;
+}
+
+std::vector<CommandEntry> CommandTable::entries() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries;
+}
+
+bool CommandTable::lookup(int id, CommandEntry &out) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto &e : m_entries) {
+    if (e.id == id) {
+      out = e;
+      return true;
+    }
+  }
+  return false;
+}
+
+VoiceCommand CommandTable::actionOf(int id) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto &e : m_entries) {
+    if (e.id == id) {
+      return e.action;
+    }
+  }
+  return VoiceCommand::Unknown;
+}
+
+std::string CommandTable::toJson() const {
+  std::string json = serialize(entries());
+  // 附带可用动作列表，方便网页生成下拉框
+  std::string actions = ",\"actions\":[";
+  for (size_t i = 0; i < sizeof(kActions) / sizeof(kActions[0]); i++) {
+    actions += i ? ",\"" : "\"";
+    actions += kActions[i].name;
+    actions += "\"";
+  }
+  actions += "]}";
+  if (!json.empty() && json.back() == '}') {
+    json.pop_back();
+    json += actions;
+  }
+  return json;
+}
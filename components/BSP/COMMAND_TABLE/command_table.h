@@ -0,0 +1,107 @@
+#pragma once
+
+#include "esp_err.h"
+#include "voice_control.h"
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 一条离线命令词及其动作绑定
+ */
+struct CommandEntry {
+  int id = -1;        /*!< MultiNet command_id（也用于网页 /api/cmd?id=） */
+  std::string phrase; /*!< MultiNet 拼音，如 "kai deng" */
+  std::string name;   /*!< 显示名，如 "开灯" */
+  VoiceCommand action = VoiceCommand::Unknown; /*!< 识别后执行的动作 */
+};
+
+/**
+ * @brief 运行时可配置的离线命令表（NVS 持久化）
+ *
+ * - 默认表与固件内置的 5 条命令一致；NVS 中有保存的表时优先使用
+ * - 同一动作可以绑定多条命令词（同义词），每条命令词有独立的 id
+ * - 通过网页 /api/commands 修改后立即热加载到 MultiNet，无需重启/OTA
+ *
+ * 表在 NVS 中以 JSON 保存：
+ *   {"commands":[{"id":0,"phrase":"kai deng","name":"开灯","action":"light_on"}]}
+ *
+ * @example
+ *   auto& table = CommandTable::instance();
+ *   table.load();
+ *   VoiceCommand cmd = table.actionOf(commandId);
+ */
+class CommandTable {
+public:
+  static CommandTable &instance();
+
+  CommandTable(const CommandTable &) = delete;
+  CommandTable &operator=(const CommandTable &) = delete;
+
+  /** MultiNet 热加载函数；error 用于返回被拒绝的命令词 */
+  using ReloadHook = std::function<esp_err_t(std::string &error)>;
+
+  static constexpr size_t kMaxCommands = 64;
+  static constexpr int kMaxCommandId = 199;
+  static constexpr size_t kMaxPhraseLen = 63;
+  static constexpr size_t kMaxNameLen = 31;
+
+  /**
+   * @brief 从 NVS 加载命令表；没有或损坏时使用默认表
+   */
+  esp_err_t load();
+
+  /**
+   * @brief 设置热加载函数（由 WakeWord 在初始化时注册）
+   */
+  void setReloadHook(ReloadHook hook);
+
+  /**
+   * @brief 用 JSON 替换整张表：校验 -> 热加载 -> 持久化
+   *
+   * MultiNet 拒绝任意一条命令词时回滚到旧表，NVS 不变。
+   * @param error 失败原因（给网页显示）
+   */
+  esp_err_t updateFromJson(const char *json, size_t len, std::string &error);
+
+  /**
+   * @brief 恢复默认表（清除 NVS 中保存的表并热加载）
+   */
+  esp_err_t resetToDefaults(std::string &error);
+
+  /** 当前表的拷贝 */
+  std::vector<CommandEntry> entries() const;
+
+  /** 按 id 查找 */
+  bool lookup(int id, CommandEntry &out) const;
+
+  /** 按 id 查动作；未知 id 返回 VoiceCommand::Unknown */
+  VoiceCommand actionOf(int id) const;
+
+  /** 当前表（含可用动作列表）的 JSON */
+  std::string toJson() const;
+
+  static const char *actionName(VoiceCommand action);
+  static VoiceCommand actionFromName(const char *name);
+
+private:
+  CommandTable() = default;
+  ~CommandTable() = default;
+
+  static std::vector<CommandEntry> defaultEntries();
+  static bool parseJson(const char *json, size_t len,
+                        std::vector<CommandEntry> &out, std::string &error);
+  static std::string serialize(const std::vector<CommandEntry> &entries);
+
+  esp_err_t apply(std::vector<CommandEntry> entries, std::string &error);
+  esp_err_t save(const std::vector<CommandEntry> &entries);
+  esp_err_t eraseSaved();
+
+  mutable std::mutex m_mutex;   // 保护 m_entries
+  std::mutex m_updateMutex;     // 串行化更新（热加载 + 回滚）
+  std::vector<CommandEntry> m_entries;
+  ReloadHook m_reloadHook;
+};
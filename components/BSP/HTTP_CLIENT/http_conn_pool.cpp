@@ -0,0 +1,215 @@
+#include "http_conn_pool.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include <algorithm>
+#include <cstdio>
+
+static const char *TAG = "HttpPool";
+
+namespace {
+#if CONFIG_CLOUD_HTTP_KEEPALIVE
+constexpr int64_t kMaxIdleUs = (int64_t)CONFIG_CLOUD_HTTP_KEEPALIVE_IDLE_MS * 1000;
+#else
+constexpr int64_t kMaxIdleUs = 0; // 关闭保活：每个请求结束都断开
+#endif
+
+esp_http_client_handle_t createClient(const std::string &url,
+                                      esp_http_client_method_t method,
+                                      int timeoutMs) {
+  esp_http_client_config_t cfg = {};
+  cfg.url = url.c_str();
+  cfg.method = method;
+  cfg.timeout_ms = timeoutMs;
+  // TCP keepalive 探测：对端掉线时尽早发现，而不是等到下一次请求
+  cfg.keep_alive_enable = true;
+  return esp_http_client_init(&cfg);
+}
+} // namespace
+
+HttpConnPool &HttpConnPool::instance() {
+  static HttpConnPool inst;
+  return inst;
+}
+
+std::string HttpConnPool::originOf(const std::string &url) {
+  const size_t scheme = url.find("://");
+  const size_t hostStart = (scheme == std::string::npos) ? 0 : scheme + 3;
+  const size_t pathStart = url.find('/', hostStart);
+  return url.substr(0, pathStart);
+}
+
+HttpConnPool::Slot *HttpConnPool::slotFor(esp_http_client_handle_t client) {
+  for (auto &slot : m_slots) {
+    if (slot.client == client && client != nullptr) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+void HttpConnPool::resetRequest(Slot &slot) {
+  for (const auto &key : slot.headers) {
+    esp_http_client_delete_header(slot.client, key.c_str());
+  }
+  slot.headers.clear();
+  // 上一次 open 自动加的长度 / 分块头，不删会和本次的冲突
+  esp_http_client_delete_header(slot.client, "Content-Length");
+  esp_http_client_delete_header(slot.client, "Transfer-Encoding");
+}
+
+esp_http_client_handle_t HttpConnPool::acquire(const std::string &url,
+                                               esp_http_client_method_t method,
+                                               int timeoutMs, bool *reused) {
+  if (reused) {
+    *reused = false;
+  }
+  const std::string origin = originOf(url);
+  const int64_t now = esp_timer_get_time();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Slot *slot = nullptr;
+  for (auto &s : m_slots) {
+    if (s.client && s.origin == origin) {
+      slot = &s;
+      break;
+    }
+  }
+  if (slot && slot->busy) {
+    // 同一 origin 并发请求：临时连接，用完即关
+    return createClient(url, method, timeoutMs);
+  }
+  if (!slot) {
+    // 空槽位，没有就挤掉空闲最久的 origin
+    for (auto &s : m_slots) {
+      if (!s.client) {
+        slot = &s;
+        break;
+      }
+      if (!s.busy && (!slot || s.idleSinceUs < slot->idleSinceUs)) {
+        slot = &s;
+      }
+    }
+    if (!slot) {
+      return createClient(url, method, timeoutMs);
+    }
+    if (slot->client) {
+      esp_http_client_cleanup(slot->client);
+    }
+    *slot = Slot{};
+    slot->client = createClient(url, method, timeoutMs);
+    if (!slot->client) {
+      return nullptr;
+    }
+    slot->origin = origin;
+  } else {
+    if (slot->connected && now - slot->idleSinceUs > kMaxIdleUs) {
+      // 服务端大概率已经关闭了空闲连接：主动断开，重新握手
+      esp_http_client_close(slot->client);
+      slot->connected = false;
+    }
+    esp_http_client_set_url(slot->client, url.c_str());
+    esp_http_client_set_method(slot->client, method);
+    esp_http_client_set_timeout_ms(slot->client, timeoutMs);
+    resetRequest(*slot);
+  }
+
+  slot->busy = true;
+  slot->reusing = slot->connected;
+  if (reused) {
+    *reused = slot->reusing;
+  }
+  return slot->client;
+}
+
+esp_err_t HttpConnPool::setHeader(esp_http_client_handle_t client,
+                                  const char *key, const char *value) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Slot *slot = slotFor(client);
+    if (slot) {
+      slot->headers.emplace_back(key);
+    }
+  }
+  return esp_http_client_set_header(client, key, value);
+}
+
+esp_err_t HttpConnPool::open(esp_http_client_handle_t client, int writeLen) {
+  const int64_t t0 = esp_timer_get_time();
+  esp_err_t err = esp_http_client_open(client, writeLen);
+  const uint32_t ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+  if (err != ESP_OK) {
+    return err;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Slot *slot = slotFor(client);
+  if (slot && slot->reusing) {
+    m_stats.reuses++;
+    if (m_stats.connect_ms_avg > ms) {
+      m_stats.saved_ms += m_stats.connect_ms_avg - ms;
+    }
+    ESP_LOGD(TAG, "reuse %s (open %lu ms)", slot->origin.c_str(),
+             (unsigned long)ms);
+  } else {
+    // 新建连接的耗时（DNS + TCP + TLS + 请求头）：指数平均，权重 1/4
+    m_stats.connects++;
+    m_stats.connect_ms_avg = (m_stats.connects == 1)
+                                 ? ms
+                                 : (m_stats.connect_ms_avg * 3 + ms) / 4;
+    ESP_LOGI(TAG, "connect %s: %lu ms", slot ? slot->origin.c_str() : "(temp)",
+             (unsigned long)ms);
+  }
+  return ESP_OK;
+}
+
+void HttpConnPool::release(esp_http_client_handle_t client, bool keep) {
+  if (!client) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Slot *slot = slotFor(client);
+  if (!slot) {
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    return;
+  }
+  // 响应没读完（取消 / 出错）时连接上还有残留数据，不能复用
+  keep = keep && kMaxIdleUs > 0 &&
+         esp_http_client_is_complete_data_received(client);
+  if (!keep) {
+    esp_http_client_close(client);
+  }
+  resetRequest(*slot);
+  slot->connected = keep;
+  slot->busy = false;
+  slot->reusing = false;
+  slot->idleSinceUs = esp_timer_get_time();
+}
+
+void HttpConnPool::releaseStale(esp_http_client_handle_t client) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.stale++;
+  }
+  ESP_LOGW(TAG, "kept-alive connection was closed by peer, reconnecting");
+  release(client, false);
+}
+
+HttpPoolStats HttpConnPool::stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+std::string HttpConnPool::statusJson() const {
+  HttpPoolStats st = stats();
+  char buf[128];
+  snprintf(buf, sizeof(buf),
+           "{\"connects\":%u,\"reuses\":%u,\"stale\":%u,"
+           "\"connect_ms_avg\":%u,\"saved_ms\":%u}",
+           (unsigned)st.connects, (unsigned)st.reuses, (unsigned)st.stale,
+           (unsigned)st.connect_ms_avg, (unsigned)st.saved_ms);
+  return std::string(buf);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 保活连接统计
+ */
+struct HttpPoolStats {
+  uint32_t connects = 0;       /*!< 新建连接（TCP / TLS 握手）次数 */
+  uint32_t reuses = 0;         /*!< 复用保活连接的请求数 */
+  uint32_t stale = 0;          /*!< 复用时发现连接已被对端关闭的次数 */
+  uint32_t connect_ms_avg = 0; /*!< 新建连接时 open 的平均耗时 */
+  uint32_t saved_ms = 0;       /*!< 复用累计省下的握手时间（估计） */
+};
+
+/**
+ * @brief HTTP 保活连接池（单例模式）
+ *
+ * 每个 origin（scheme://host:port）保留一个 esp_http_client 句柄，请求结束
+ * 且响应已读完时不关闭连接，下一轮对话 / TTS 直接在同一条 TCP（TLS）连接
+ * 上发请求，省掉每轮的握手。连接按需建立：空闲超过
+ * CONFIG_CLOUD_HTTP_KEEPALIVE_IDLE_MS（应小于服务端 keep-alive 超时）或
+ * 上次请求未读完时，下次 acquire 重新连接。
+ *
+ * 用法：acquire -> setHeader -> open -> 读写 -> release。
+ * 复用的连接可能已被服务端关闭（写入成功但读不到响应头）：请求体可重放的
+ * 调用方在收到响应头之前失败时，用 releaseStale() 丢弃并重试一次。
+ *
+ * 同一 origin 的连接正被占用时，再次 acquire 得到一个临时句柄，release 时关闭。
+ */
+class HttpConnPool {
+public:
+  static constexpr int kMaxOrigins = 4;
+
+  static HttpConnPool &instance();
+
+  HttpConnPool(const HttpConnPool &) = delete;
+  HttpConnPool &operator=(const HttpConnPool &) = delete;
+
+  /**
+   * @brief 取得访问 url 的客户端（已设置 url / method / timeout）
+   * @param reused 输出：true 表示复用了已建立的连接
+   * @return nullptr 内存不足
+   */
+  esp_http_client_handle_t acquire(const std::string &url,
+                                   esp_http_client_method_t method,
+                                   int timeoutMs, bool *reused = nullptr);
+
+  /**
+   * @brief 设置请求头（release 时自动删除，避免带到下一个使用者的请求里）
+   */
+  esp_err_t setHeader(esp_http_client_handle_t client, const char *key,
+                      const char *value);
+
+  /**
+   * @brief esp_http_client_open，并统计新建 / 复用连接的耗时
+   */
+  esp_err_t open(esp_http_client_handle_t client, int writeLen);
+
+  /**
+   * @brief 请求结束
+   * @param keep 调用方认为请求正常结束；响应也已读完时才保留连接
+   */
+  void release(esp_http_client_handle_t client, bool keep = true);
+
+  /**
+   * @brief 复用的连接在收到响应头之前失败：关闭并计入 stale
+   */
+  void releaseStale(esp_http_client_handle_t client);
+
+  HttpPoolStats stats() const;
+
+  /**
+   * @brief 连接复用统计（JSON 对象字符串，供网页 /api/status）
+   */
+  std::string statusJson() const;
+
+private:
+  HttpConnPool() = default;
+  ~HttpConnPool() = default;
+
+  struct Slot {
+    std::string origin;
+    esp_http_client_handle_t client = nullptr;
+    bool busy = false;
+    bool connected = false;  // 连接保持中（上次响应已读完）
+    bool reusing = false;    // 本次请求复用了连接
+    int64_t idleSinceUs = 0;
+    std::vector<std::string> headers; // 本次请求设置过的头
+  };
+
+  static std::string originOf(const std::string &url);
+  Slot *slotFor(esp_http_client_handle_t client);
+  void resetRequest(Slot &slot);
+
+  mutable std::mutex m_mutex;
+  Slot m_slots[kMaxOrigins];
+  HttpPoolStats m_stats;
+};
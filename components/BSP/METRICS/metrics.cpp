@@ -0,0 +1,182 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+// 攒够 1 KB 再交给 write（每次 httpd_resp_send_chunk 都是一次 TCP 发送）
+class ChunkWriter {
+public:
+  explicit ChunkWriter(
+      const std::function<esp_err_t(const char *, size_t)> &write)
+      : m_write(write) {}
+
+  void appendf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (m_err != ESP_OK) {
+      return;
+    }
+    char line[192];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n <= 0) {
+      return;
+    }
+    size_t len = std::min((size_t)n, sizeof(line) - 1);
+    if (m_len + len > sizeof(m_buf)) {
+      flush();
+    }
+    memcpy(m_buf + m_len, line, len);
+    m_len += len;
+  }
+
+  esp_err_t flush() {
+    if (m_err == ESP_OK && m_len > 0) {
+      m_err = m_write(m_buf, m_len);
+    }
+    m_len = 0;
+    return m_err;
+  }
+
+private:
+  const std::function<esp_err_t(const char *, size_t)> &m_write;
+  char m_buf[1024];
+  size_t m_len = 0;
+  esp_err_t m_err = ESP_OK;
+};
+
+const char *typeName(MetricType type) {
+  switch (type) {
+  case MetricType::Counter:
+    return "counter";
+  case MetricType::Gauge:
+    return "gauge";
+  case MetricType::Histogram:
+    return "histogram";
+  }
+  return "untyped";
+}
+
+// 整数值按整数输出（计数器 / 字节数不要变成科学计数法）
+void formatValue(char *out, size_t n, double v) {
+  if (std::isnan(v)) {
+    snprintf(out, n, "NaN");
+  } else if (v == std::floor(v) && std::fabs(v) < 1e15) {
+    snprintf(out, n, "%" PRId64, (int64_t)v);
+  } else {
+    snprintf(out, n, "%.6g", v);
+  }
+}
+
+// {labels} 或 {labels,extra}，都为空时不输出花括号
+void formatLabels(char *out, size_t n, const char *labels, const char *extra) {
+  const bool hasLabels = labels && labels[0];
+  const bool hasExtra = extra && extra[0];
+  if (!hasLabels && !hasExtra) {
+    out[0] = '\0';
+  } else if (hasLabels && hasExtra) {
+    snprintf(out, n, "{%s,%s}", labels, extra);
+  } else {
+    snprintf(out, n, "{%s}", hasLabels ? labels : extra);
+  }
+}
+} // namespace
+
+double MetricCounter::value() const {
+  return m_read ? (double)m_read()
+                : (double)m_value.load(std::memory_order_relaxed);
+}
+
+double MetricGauge::value() const {
+  return m_read ? m_read() : (double)m_value.load(std::memory_order_relaxed);
+}
+
+MetricHistogram::MetricHistogram(const char *name, const char *help,
+                                 const uint32_t *bounds, size_t count,
+                                 const char *labels)
+    : Metric(name, help, MetricType::Histogram, labels), m_bounds(bounds),
+      m_bucketCount(std::min(count, kMaxBuckets)) {}
+
+void MetricHistogram::observe(uint32_t v) {
+  size_t i = 0;
+  while (i < m_bucketCount && v > m_bounds[i]) {
+    i++;
+  }
+  m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(v, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+Metrics &Metrics::instance() {
+  static Metrics inst;
+  return inst;
+}
+
+esp_err_t Metrics::add(std::initializer_list<Metric *> metrics) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t n = m_count.load(std::memory_order_relaxed);
+  for (Metric *metric : metrics) {
+    if (metric == nullptr ||
+        std::find(m_items, m_items + n, metric) != m_items + n) {
+      continue;
+    }
+    if (n >= kMaxMetrics) {
+      m_count.store(n, std::memory_order_release);
+      return ESP_ERR_NO_MEM;
+    }
+    m_items[n++] = metric;
+  }
+  // 先写槽位再发布数量：导出方只读 [0, count)，不需要加锁
+  m_count.store(n, std::memory_order_release);
+  return ESP_OK;
+}
+
+esp_err_t Metrics::exportPrometheus(
+    const std::function<esp_err_t(const char *, size_t)> &write) const {
+  if (!write) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  ChunkWriter out(write);
+  char labels[128];
+  char value[32];
+  const size_t n = count();
+  for (size_t i = 0; i < n; i++) {
+    const Metric *m = m_items[i];
+    if (i == 0 || strcmp(m_items[i - 1]->name(), m->name()) != 0) {
+      out.appendf("# HELP %s %s\n# TYPE %s %s\n", m->name(), m->help(),
+                  m->name(), typeName(m->type()));
+    }
+
+    if (m->type() != MetricType::Histogram) {
+      formatLabels(labels, sizeof(labels), m->labels(), nullptr);
+      formatValue(value, sizeof(value), m->value());
+      out.appendf("%s%s %s\n", m->name(), labels, value);
+      continue;
+    }
+
+    // 直方图：桶按 Prometheus 约定输出累计值，最后是 +Inf / _sum / _count
+    const auto *h = static_cast<const MetricHistogram *>(m);
+    uint64_t cumulative = 0;
+    char le[24];
+    for (size_t b = 0; b <= h->bucketCount(); b++) {
+      cumulative += h->bucket(b);
+      if (b < h->bucketCount()) {
+        snprintf(le, sizeof(le), "le=\"%" PRIu32 "\"", h->bound(b));
+      } else {
+        snprintf(le, sizeof(le), "le=\"+Inf\"");
+      }
+      formatLabels(labels, sizeof(labels), h->labels(), le);
+      out.appendf("%s_bucket%s %" PRIu64 "\n", h->name(), labels, cumulative);
+    }
+    formatLabels(labels, sizeof(labels), h->labels(), nullptr);
+    out.appendf("%s_sum%s %" PRIu32 "\n%s_count%s %" PRIu64 "\n", h->name(),
+                labels, h->sum(), h->name(), labels, cumulative);
+  }
+  return out.flush();
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "esp_err.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+
+/**
+ * @brief 指标类型（对应 Prometheus 的 TYPE）
+ */
+enum class MetricType : uint8_t { Counter, Gauge, Histogram };
+
+/**
+ * @brief 指标基类：名称、说明与可选的固定标签
+ *
+ * name / help / labels 必须是静态字符串（注册后只保存指针）。
+ * labels 形如 region="internal"，同名指标用不同标签区分。
+ */
+class Metric {
+public:
+  Metric(const char *name, const char *help, MetricType type,
+         const char *labels = nullptr)
+      : m_name(name), m_help(help), m_labels(labels), m_type(type) {}
+  virtual ~Metric() = default;
+
+  Metric(const Metric &) = delete;
+  Metric &operator=(const Metric &) = delete;
+
+  const char *name() const { return m_name; }
+  const char *help() const { return m_help; }
+  const char *labels() const { return m_labels; }
+  MetricType type() const { return m_type; }
+
+  /** 当前值（直方图为观测次数） */
+  virtual double value() const = 0;
+
+private:
+  const char *m_name;
+  const char *m_help;
+  const char *m_labels;
+  MetricType m_type;
+};
+
+/**
+ * @brief 单调递增计数器
+ *
+ * inc() 只是一次 relaxed fetch_add，可在任意任务 / 回调中调用。32 位计数
+ * 回绕时 Prometheus 按计数器重置处理（rate() 不受影响）。
+ * 也可以在采集时读取模块已有的累计值（read 回调），不必在热路径上再计一次。
+ */
+class MetricCounter : public Metric {
+public:
+  MetricCounter(const char *name, const char *help, const char *labels = nullptr)
+      : Metric(name, help, MetricType::Counter, labels) {}
+  MetricCounter(const char *name, const char *help,
+                std::function<uint32_t()> read, const char *labels = nullptr)
+      : Metric(name, help, MetricType::Counter, labels), m_read(std::move(read)) {}
+
+  void inc(uint32_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+  double value() const override;
+
+private:
+  std::atomic<uint32_t> m_value{0};
+  std::function<uint32_t()> m_read;
+};
+
+/**
+ * @brief 瞬时值（可增可减）
+ *
+ * set() / add() 为 relaxed 原子操作；带 read 回调时在采集时读取
+ * （堆余量、缓冲水位等已有状态）。
+ */
+class MetricGauge : public Metric {
+public:
+  MetricGauge(const char *name, const char *help, const char *labels = nullptr)
+      : Metric(name, help, MetricType::Gauge, labels) {}
+  MetricGauge(const char *name, const char *help, std::function<double()> read,
+              const char *labels = nullptr)
+      : Metric(name, help, MetricType::Gauge, labels), m_read(std::move(read)) {}
+
+  void set(int32_t v) { m_value.store(v, std::memory_order_relaxed); }
+  void add(int32_t d) { m_value.fetch_add(d, std::memory_order_relaxed); }
+  double value() const override;
+
+private:
+  std::atomic<int32_t> m_value{0};
+  std::function<double()> m_read;
+};
+
+/**
+ * @brief 固定分桶的直方图（整数观测值，通常为毫秒）
+ *
+ * observe() 找到桶后做三次 relaxed fetch_add（桶、总和、次数），无锁；
+ * 采集与写入并发时各字段可能相差一次观测，对监控无影响。
+ */
+class MetricHistogram : public Metric {
+public:
+  static constexpr size_t kMaxBuckets = 12;
+
+  /**
+   * @param bounds 各桶上界（升序，静态数组），最多 kMaxBuckets 个；另有 +Inf 桶
+   */
+  MetricHistogram(const char *name, const char *help, const uint32_t *bounds,
+                  size_t count, const char *labels = nullptr);
+
+  void observe(uint32_t v);
+  double value() const override {
+    return (double)m_count.load(std::memory_order_relaxed);
+  }
+
+  size_t bucketCount() const { return m_bucketCount; }
+  uint32_t bound(size_t i) const { return m_bounds[i]; }
+  /** 第 i 个桶（非累计）；i == bucketCount() 为 +Inf 桶 */
+  uint32_t bucket(size_t i) const {
+    return m_buckets[i].load(std::memory_order_relaxed);
+  }
+  uint32_t sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+private:
+  const uint32_t *m_bounds;
+  size_t m_bucketCount;
+  std::atomic<uint32_t> m_buckets[kMaxBuckets + 1] = {};
+  std::atomic<uint32_t> m_sum{0};
+  std::atomic<uint32_t> m_count{0};
+};
+
+/**
+ * @brief 指标注册表（单例模式）
+ *
+ * 各模块在 init 时注册自己持有的指标对象（对象生命周期需覆盖整个运行期，
+ * 一般是单例的成员）；/api/metrics 按 Prometheus 文本格式导出。
+ * 注册只在启动时发生（加锁）；更新与导出都不加锁。
+ *
+ * @example
+ *   static MetricCounter wakes("dino_wake_total", "Wake words detected");
+ *   Metrics::instance().add({&wakes});
+ *   wakes.inc();
+ */
+class Metrics {
+public:
+  static constexpr size_t kMaxMetrics = 96;
+
+  static Metrics &instance();
+
+  Metrics(const Metrics &) = delete;
+  Metrics &operator=(const Metrics &) = delete;
+
+  /**
+   * @brief 注册指标（同一对象重复注册会被忽略）
+   * @return ESP_ERR_NO_MEM 超过 kMaxMetrics
+   */
+  esp_err_t add(std::initializer_list<Metric *> metrics);
+
+  size_t count() const { return m_count.load(std::memory_order_acquire); }
+
+  /**
+   * @brief 导出 Prometheus 文本格式（text/plain; version=0.0.4）
+   *
+   * 同名指标需连续注册，HELP / TYPE 只输出一次。
+   * @param write 分块输出回调（例如 httpd_resp_send_chunk）
+   */
+  esp_err_t exportPrometheus(
+      const std::function<esp_err_t(const char *, size_t)> &write) const;
+
+private:
+  Metrics() = default;
+
+  std::mutex m_mutex; // 只保护注册
+  Metric *m_items[kMaxMetrics] = {};
+  std::atomic<size_t> m_count{0};
+};
+
+/**
+ * @brief 注册系统指标：堆（内部 RAM / PSRAM 余量、最低余量、最大连续块）、
+ *        运行时长与固件版本（dino_build_info）
+ */
+esp_err_t registerSystemMetrics();
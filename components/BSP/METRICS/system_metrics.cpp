@@ -0,0 +1,56 @@
+#include "metrics.h"
+
+#include "esp_app_desc.h"
+#include "esp_heap_caps.h"
+#include "esp_idf_version.h"
+#include "esp_timer.h"
+
+#include <cstdio>
+
+namespace {
+constexpr uint32_t kInternal = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+constexpr uint32_t kPsram = MALLOC_CAP_SPIRAM;
+
+char s_buildLabels[96];
+
+MetricGauge s_heapFreeInternal(
+    "dino_heap_free_bytes", "Free heap bytes by region",
+    [] { return (double)heap_caps_get_free_size(kInternal); },
+    "region=\"internal\"");
+MetricGauge s_heapFreePsram(
+    "dino_heap_free_bytes", "Free heap bytes by region",
+    [] { return (double)heap_caps_get_free_size(kPsram); }, "region=\"psram\"");
+MetricGauge s_heapMinInternal(
+    "dino_heap_min_free_bytes", "Lowest free heap bytes since boot",
+    [] { return (double)heap_caps_get_minimum_free_size(kInternal); },
+    "region=\"internal\"");
+MetricGauge s_heapMinPsram(
+    "dino_heap_min_free_bytes", "Lowest free heap bytes since boot",
+    [] { return (double)heap_caps_get_minimum_free_size(kPsram); },
+    "region=\"psram\"");
+// 内部 RAM 碎片化时 DMA / 任务栈分配会先失败，单看余量看不出来
+MetricGauge s_heapLargestInternal(
+    "dino_heap_largest_free_block_bytes", "Largest allocatable block by region",
+    [] { return (double)heap_caps_get_largest_free_block(kInternal); },
+    "region=\"internal\"");
+MetricGauge s_heapLargestPsram(
+    "dino_heap_largest_free_block_bytes", "Largest allocatable block by region",
+    [] { return (double)heap_caps_get_largest_free_block(kPsram); },
+    "region=\"psram\"");
+MetricGauge s_uptime("dino_uptime_seconds", "Seconds since boot",
+                     [] { return (double)(esp_timer_get_time() / 1000000); });
+MetricGauge s_buildInfo("dino_build_info", "Firmware version (value is 1)",
+                        s_buildLabels);
+} // namespace
+
+esp_err_t registerSystemMetrics() {
+  const esp_app_desc_t *app = esp_app_get_description();
+  snprintf(s_buildLabels, sizeof(s_buildLabels),
+           "version=\"%s\",idf=\"%s\"", app->version, esp_get_idf_version());
+  s_buildInfo.set(1);
+
+  return Metrics::instance().add({&s_heapFreeInternal, &s_heapFreePsram,
+                                  &s_heapMinInternal, &s_heapMinPsram,
+                                  &s_heapLargestInternal, &s_heapLargestPsram,
+                                  &s_uptime, &s_buildInfo});
+}
@@ -0,0 +1,436 @@
+#include "audio_mixer.h"
+
+#include "audio_dsp.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <algorithm>
+#include <cstring>
+
+static const char *TAG = "AudioMixer";
+
+// 双声道 16bit 一帧的字节数
+static constexpr size_t kFrameBytes = 2 * sizeof(int16_t);
+// 没有任何数据时的等待上限（写入会立即唤醒）
+static constexpr uint32_t kIdleWaitMs = 20;
+
+esp_err_t AudioMixer::init(i2s_chan_handle_t tx, uint32_t sampleRate,
+                           TapFn tap) {
+  if (m_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!tx || sampleRate == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  m_tx = tx;
+  m_sampleRate = sampleRate;
+  m_tap = std::move(tap);
+
+  // 16 字节对齐，便于 audio_dsp 走向量路径；m_tmp 多留一帧放残余字节
+  m_mix = (int16_t *)heap_caps_aligned_alloc(
+      16, kBlockFrames * kFrameBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  m_tmp = (int16_t *)heap_caps_aligned_alloc(
+      16, (kBlockFrames + 1) * kFrameBytes,
+      MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!m_mix || !m_tmp) {
+    deinit();
+    return ESP_ERR_NO_MEM;
+  }
+
+  m_stop.store(false);
+  // 优先级高于解码 / PCM 流任务，保证 I2S 不断流
+  TaskHandle_t task = nullptr;
+  if (xTaskCreatePinnedToCore(taskEntry, "audio_mixer", 4096, this, 6, &task,
+                              1) != pdPASS) {
+    deinit();
+    return ESP_FAIL;
+  }
+  m_task.store(task, std::memory_order_release);
+  ESP_LOGI(TAG, "mixer started: %lu Hz, %d voices, block=%u frames",
+           (unsigned long)sampleRate, kMaxVoices, (unsigned)kBlockFrames);
+  return ESP_OK;
+}
+
+void AudioMixer::deinit() {
+  TaskHandle_t task = m_task.load(std::memory_order_acquire);
+  if (task) {
+    m_stop.store(true);
+    xTaskNotifyGive(task);
+    for (int i = 0; i < 100 && m_task.load(std::memory_order_acquire); i++) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &v : m_voices) {
+      if (v.kind != Kind::Free) {
+        release(v);
+      }
+    }
+  }
+  heap_caps_free(m_mix);
+  heap_caps_free(m_tmp);
+  m_mix = nullptr;
+  m_tmp = nullptr;
+}
+
+// ============= voice 管理 =============
+
+AudioMixer::Voice *AudioMixer::lookup(MixerVoice voice) {
+  const uint32_t slot = (voice & 0xFF) - 1;
+  if (voice == kNoVoice || slot >= (uint32_t)kMaxVoices) {
+    return nullptr;
+  }
+  Voice &v = m_voices[slot];
+  return (v.kind != Kind::Free && v.gen == (voice >> 8)) ? &v : nullptr;
+}
+
+const AudioMixer::Voice *AudioMixer::lookup(MixerVoice voice) const {
+  return const_cast<AudioMixer *>(this)->lookup(voice);
+}
+
+MixerVoice AudioMixer::claim(Kind kind, int16_t gainQ15) {
+  for (int i = 0; i < kMaxVoices; i++) {
+    Voice &v = m_voices[i];
+    if (v.kind != Kind::Free) {
+      continue;
+    }
+    v.kind = kind;
+    v.gen = (v.gen + 1) & 0xFFFFFF;
+    v.gain = gainQ15;
+    v.closed = false;
+    v.stopped = false;
+    v.discardBytes = 0;
+    v.carryBytes = 0;
+    return (v.gen << 8) | (uint32_t)(i + 1);
+  }
+  return kNoVoice;
+}
+
+void AudioMixer::release(Voice &v) {
+  if (v.sb) {
+    vStreamBufferDelete(v.sb);
+    v.sb = nullptr;
+  }
+  if (v.sbMem) {
+    heap_caps_free(v.sbMem);
+    v.sbMem = nullptr;
+  }
+  v.clip = nullptr;
+  v.clipFrames = 0;
+  v.clipPos = 0;
+  v.kind = Kind::Free;
+}
+
+MixerVoice AudioMixer::openStream(uint32_t bufferMs, int16_t gainQ15) {
+  if (!m_task) {
+    return kNoVoice;
+  }
+  // 至少两块，保证生产者能领先混音任务
+  size_t bytes = (size_t)m_sampleRate * bufferMs / 1000 * kFrameBytes;
+  bytes = std::max(bytes, 2 * kBlockFrames * kFrameBytes);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  MixerVoice h = claim(Kind::Stream, gainQ15);
+  Voice *v = lookup(h);
+  if (!v) {
+    ESP_LOGW(TAG, "no free voice");
+    return kNoVoice;
+  }
+  // PSRAM 优先，失败回退内部 RAM
+  v->sbMem = (uint8_t *)heap_caps_malloc(bytes + 1, MALLOC_CAP_SPIRAM);
+  if (!v->sbMem) {
+    v->sbMem = (uint8_t *)heap_caps_malloc(
+        bytes + 1, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  if (v->sbMem) {
+    v->sb = xStreamBufferCreateStatic(bytes, 1, v->sbMem, &v->sbStorage);
+  }
+  if (!v->sb) {
+    ESP_LOGE(TAG, "voice buffer alloc failed (%u bytes)", (unsigned)bytes);
+    release(*v);
+    return kNoVoice;
+  }
+  return h;
+}
+
+MixerVoice AudioMixer::playClip(const int16_t *pcm, size_t frames,
+                                int channels, int16_t gainQ15) {
+  if (!m_task || !pcm || frames == 0 || channels < 1 || channels > 2) {
+    return kNoVoice;
+  }
+  MixerVoice h;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    h = claim(Kind::Clip, gainQ15);
+    Voice *v = lookup(h);
+    if (!v) {
+      ESP_LOGW(TAG, "no free voice");
+      return kNoVoice;
+    }
+    v->clip = pcm;
+    v->clipFrames = frames;
+    v->clipPos = 0;
+    v->clipChannels = channels;
+  }
+  xTaskNotifyGive(m_task);
+  return h;
+}
+
+esp_err_t AudioMixer::write(MixerVoice voice, const int16_t *stereo,
+                            size_t frames, TickType_t timeout) {
+  StreamBufferHandle_t sb;
+  Voice *v;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    v = lookup(voice);
+    if (!v || v->kind != Kind::Stream || v->closed) {
+      return ESP_ERR_INVALID_ARG;
+    }
+    if (v->stopped) {
+      return ESP_ERR_INVALID_STATE;
+    }
+    // 只有混音任务会释放 sb，且要等打开者（即本调用方）close 之后
+    sb = v->sb;
+  }
+
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(stereo);
+  size_t left = frames * kFrameBytes;
+  while (left > 0) {
+    if (v->stopped) {
+      return ESP_ERR_INVALID_STATE;
+    }
+    size_t sent = xStreamBufferSend(sb, p, left, timeout);
+    if (sent == 0) {
+      return ESP_ERR_TIMEOUT;
+    }
+    xTaskNotifyGive(m_task);
+    p += sent;
+    left -= sent;
+  }
+  return ESP_OK;
+}
+
+void AudioMixer::close(MixerVoice voice, bool discard) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Voice *v = lookup(voice);
+    if (!v || v->kind != Kind::Stream) {
+      return;
+    }
+    v->closed = true;
+    v->stopped = v->stopped || discard;
+  }
+  if (m_task) {
+    xTaskNotifyGive(m_task);
+  }
+}
+
+esp_err_t AudioMixer::flush(MixerVoice voice) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Voice *v = lookup(voice);
+  if (!v) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (v->kind == Kind::Stream) {
+    v->discardBytes = xStreamBufferBytesAvailable(v->sb);
+  } else {
+    v->stopped = true; // 片段没有“之后写入的数据”，等同于停止
+  }
+  return ESP_OK;
+}
+
+esp_err_t AudioMixer::stop(MixerVoice voice) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Voice *v = lookup(voice);
+    if (!v) {
+      return ESP_ERR_NOT_FOUND;
+    }
+    v->stopped = true;
+  }
+  xTaskNotifyGive(m_task);
+  return ESP_OK;
+}
+
+void AudioMixer::stopClips() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto &v : m_voices) {
+    if (v.kind == Kind::Clip) {
+      v.stopped = true;
+    }
+  }
+}
+
+esp_err_t AudioMixer::setGain(MixerVoice voice, int16_t gainQ15) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Voice *v = lookup(voice);
+  if (!v) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  v->gain = gainQ15;
+  return ESP_OK;
+}
+
+bool AudioMixer::active(MixerVoice voice) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return lookup(voice) != nullptr;
+}
+
+size_t AudioMixer::queuedFrames(MixerVoice voice) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const Voice *v = lookup(voice);
+  if (!v || v->kind != Kind::Stream) {
+    return 0;
+  }
+  return xStreamBufferBytesAvailable(v->sb) / kFrameBytes;
+}
+
+int AudioMixer::clipCount() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  int n = 0;
+  for (const auto &v : m_voices) {
+    n += (v.kind == Kind::Clip) ? 1 : 0;
+  }
+  return n;
+}
+
+// ============= 混音任务 =============
+
+void AudioMixer::taskEntry(void *arg) {
+  static_cast<AudioMixer *>(arg)->run();
+  vTaskDelete(nullptr);
+}
+
+size_t AudioMixer::readStream(Voice &v, int16_t *dst, size_t frames) {
+  uint8_t *p = reinterpret_cast<uint8_t *>(dst);
+  memcpy(p, v.carry, v.carryBytes);
+  const size_t got = xStreamBufferReceive(
+      v.sb, p + v.carryBytes, frames * kFrameBytes - v.carryBytes, 0);
+  const size_t total = got + v.carryBytes;
+  const size_t n = total / kFrameBytes;
+  // 生产者超时时可能只写进半帧，留到下一块拼完整
+  v.carryBytes = total - n * kFrameBytes;
+  memcpy(v.carry, p + n * kFrameBytes, v.carryBytes);
+  return n;
+}
+
+void AudioMixer::run() {
+  struct Job {
+    int slot;
+    Kind kind;
+    int16_t gain;
+    bool stopped;
+    size_t discardBytes;
+  };
+  const size_t blockBytes = kBlockFrames * kFrameBytes;
+
+  while (!m_stop) {
+    // 1) 在锁内处理结束 / 停止的 voice，并取出本块要混的 voice
+    Job jobs[kMaxVoices];
+    int nJobs = 0;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (int i = 0; i < kMaxVoices; i++) {
+        Voice &v = m_voices[i];
+        if (v.kind == Kind::Free) {
+          continue;
+        }
+        if (v.kind == Kind::Clip) {
+          if (v.stopped || v.clipPos >= v.clipFrames) {
+            release(v);
+            continue;
+          }
+        } else if (v.closed &&
+                   (v.stopped ||
+                    xStreamBufferBytesAvailable(v.sb) + v.carryBytes <
+                        kFrameBytes)) {
+          release(v);
+          continue;
+        }
+        jobs[nJobs++] = {i, v.kind, v.gain, v.stopped, v.discardBytes};
+        v.discardBytes = 0;
+      }
+    }
+
+    // 2) 先处理丢弃，定块长：有数据的流式 voice 中取最少的可用帧数。
+    //    块长取最大值时，数据较少的流会在块中间被补零、下一块再接着播，
+    //    与音效重叠时 TTS 出现可闻的断口；不足的部分留在缓冲里等下一块。
+    //    没有数据的流本身就是欠载，不为它拖住其它 voice。
+    size_t block = kBlockFrames;
+    bool any = false;
+    for (int j = 0; j < nJobs; j++) {
+      Voice &v = m_voices[jobs[j].slot];
+      if (jobs[j].kind == Kind::Clip) {
+        block = std::min(block, v.clipFrames - v.clipPos);
+        any = true;
+        continue;
+      }
+      size_t drop = jobs[j].stopped ? SIZE_MAX : jobs[j].discardBytes;
+      while (drop > 0) {
+        const size_t got = xStreamBufferReceive(
+            v.sb, m_tmp, std::min(drop, blockBytes), 0);
+        if (got == 0) {
+          break;
+        }
+        drop -= got;
+        v.carryBytes = 0;
+      }
+      const size_t avail =
+          (xStreamBufferBytesAvailable(v.sb) + v.carryBytes) / kFrameBytes;
+      if (!jobs[j].stopped && avail > 0) {
+        block = std::min(block, avail);
+        any = true;
+      }
+    }
+    if (!any) {
+      block = 0; // 都没有数据：不写 I2S，等待写入
+    }
+
+    // 3) 逐个 voice 取 block 帧、加增益、饱和叠加（voice 只由本任务释放，锁外访问安全）
+    memset(m_mix, 0, blockBytes);
+    for (int j = 0; j < nJobs && block > 0; j++) {
+      Voice &v = m_voices[jobs[j].slot];
+      if (jobs[j].stopped) {
+        continue;
+      }
+      size_t n = 0;
+      if (jobs[j].kind == Kind::Stream) {
+        n = readStream(v, m_tmp, block);
+      } else {
+        n = std::min(block, v.clipFrames - v.clipPos);
+        const int16_t *src = v.clip + v.clipPos * v.clipChannels;
+        if (v.clipChannels == 1) {
+          audio_dsp::monoToStereo16(src, m_tmp, n);
+        } else {
+          memcpy(m_tmp, src, n * kFrameBytes);
+        }
+        v.clipPos += n;
+      }
+      if (n == 0) {
+        continue;
+      }
+      if (jobs[j].gain != kUnityGain) {
+        audio_dsp::gainQ15(m_tmp, m_tmp, 2 * n, jobs[j].gain);
+      }
+      audio_dsp::mixSat16(m_mix, m_tmp, m_mix, 2 * n);
+    }
+
+    // 4) 写 I2S（DMA 满时阻塞，决定整个播放链的节奏）；没有数据就等写入
+    if (block == 0) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(kIdleWaitMs));
+      continue;
+    }
+    size_t written = 0;
+    esp_err_t err = i2s_channel_write(m_tx, m_mix, block * kFrameBytes,
+                                      &written, pdMS_TO_TICKS(1000));
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "i2s write failed: %s", esp_err_to_name(err));
+      vTaskDelay(pdMS_TO_TICKS(10));
+      continue;
+    }
+    if (m_tap) {
+      m_tap(m_mix, written / kFrameBytes);
+    }
+  }
+  m_task.store(nullptr, std::memory_order_release);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "driver/i2s_std.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+/**
+ * @brief 混音 voice 句柄：低 8 位为槽位 + 1，高位为槽位复用代数，
+ *        已结束 voice 的旧句柄不会误操作新 voice；0 表示无效
+ */
+using MixerVoice = uint32_t;
+constexpr MixerVoice kNoVoice = 0;
+
+/**
+ * @brief 多路混音器：独占 I2S TX 通道，把 N 路 voice 按各自增益叠加
+ *        （Q15 增益 + 饱和加法，见 audio_dsp）后写入 I2S
+ *
+ * 所有 voice 都是输出采样率、16bit 双声道：
+ * - 流式 voice：生产者任务 write()，数据进该 voice 的 stream buffer，
+ *   缓冲满时生产者阻塞——播放节奏仍由 I2S DMA 决定
+ * - 片段 voice：直接从调用方内存读取（单声道或双声道），播完自动释放，
+ *   启动只需登记一个槽位
+ *
+ * 混音任务每块最多取 kBlockFrames 帧，块长取有数据的 voice 中可用帧数的
+ * 最小值（流不会在块中间被补零）；完全没有数据的流按欠载处理、不拖住其它
+ * voice；没有任何数据时不写 I2S（DMA 自动补零）。
+ * voice 的资源只由混音任务释放：流式 voice 要等生产者 close() 之后。
+ */
+class AudioMixer {
+public:
+  static constexpr int kMaxVoices = 8;
+  static constexpr size_t kBlockFrames = 256; /*!< 每次写 I2S 的帧数 */
+  static constexpr int16_t kUnityGain = 32767;
+
+  /** 混音结果回调（回声参考），在混音任务中调用 */
+  using TapFn = std::function<void(const int16_t *stereo, size_t frames)>;
+
+  AudioMixer() = default;
+  ~AudioMixer() { deinit(); }
+  AudioMixer(const AudioMixer &) = delete;
+  AudioMixer &operator=(const AudioMixer &) = delete;
+
+  /**
+   * @brief 启动混音任务
+   * @param tx 已启用的 I2S TX 通道（16bit 双声道）
+   */
+  esp_err_t init(i2s_chan_handle_t tx, uint32_t sampleRate, TapFn tap);
+
+  /**
+   * @brief 停止混音任务并释放所有 voice（调用方保证生产者都已停止）
+   */
+  void deinit();
+
+  /**
+   * @brief 打开流式 voice
+   * @param bufferMs 该 voice 的缓冲时长（生产者领先 I2S 的最大量）
+   * @return 句柄；槽位或内存不足时返回 kNoVoice
+   */
+  MixerVoice openStream(uint32_t bufferMs, int16_t gainQ15 = kUnityGain);
+
+  /**
+   * @brief 写入双声道帧（只允许打开者一个任务调用）
+   * @return ESP_ERR_TIMEOUT 超时仍未写完；ESP_ERR_INVALID_STATE voice 已被停止
+   */
+  esp_err_t write(MixerVoice voice, const int16_t *stereo, size_t frames,
+                  TickType_t timeout);
+
+  /**
+   * @brief 生产者结束：剩余数据播完后释放（discard 为 true 时直接丢弃）
+   */
+  void close(MixerVoice voice, bool discard = false);
+
+  /**
+   * @brief 播放一段内存中的 PCM（输出采样率），pcm 须在播放期间保持有效
+   * @param channels 1 = 单声道（复制到两个声道），2 = 交织双声道
+   */
+  MixerVoice playClip(const int16_t *pcm, size_t frames, int channels,
+                      int16_t gainQ15 = kUnityGain);
+
+  /**
+   * @brief 丢弃 voice 当前已排队的数据（之后写入的数据照常播放）
+   */
+  esp_err_t flush(MixerVoice voice);
+
+  /**
+   * @brief 立即停止：片段 voice 直接释放；流式 voice 丢弃所有数据，
+   *        之后的 write() 返回 ESP_ERR_INVALID_STATE，close() 后释放
+   */
+  esp_err_t stop(MixerVoice voice);
+
+  /** 停止所有片段 voice */
+  void stopClips();
+
+  esp_err_t setGain(MixerVoice voice, int16_t gainQ15);
+
+  /** voice 仍在播放（流式 voice：未 close 或仍有数据） */
+  bool active(MixerVoice voice) const;
+
+  /** 流式 voice 已排队、尚未送进 I2S 的帧数 */
+  size_t queuedFrames(MixerVoice voice) const;
+
+  /** 正在播放的片段 voice 数 */
+  int clipCount() const;
+
+  uint32_t sampleRate() const { return m_sampleRate; }
+
+private:
+  enum class Kind : uint8_t { Free = 0, Stream, Clip };
+
+  struct Voice {
+    Kind kind = Kind::Free;
+    uint32_t gen = 0;
+    int16_t gain = kUnityGain;
+    bool closed = false;  // 流式：生产者不再写
+    volatile bool stopped = false; // 停止：丢弃数据（write() 在锁外轮询）
+    size_t discardBytes = 0; // flush() 时已排队、待丢弃的字节
+
+    // 流式
+    StreamBufferHandle_t sb = nullptr;
+    uint8_t *sbMem = nullptr;
+    StaticStreamBuffer_t sbStorage;
+    uint8_t carry[4] = {}; // 不足一帧的残余字节
+    size_t carryBytes = 0;
+
+    // 片段
+    const int16_t *clip = nullptr;
+    size_t clipFrames = 0;
+    size_t clipPos = 0;
+    int clipChannels = 1;
+  };
+
+  static void taskEntry(void *arg);
+  void run();
+  Voice *lookup(MixerVoice voice);
+  const Voice *lookup(MixerVoice voice) const;
+  MixerVoice claim(Kind kind, int16_t gainQ15);
+  void release(Voice &v);
+  size_t readStream(Voice &v, int16_t *dst, size_t frames);
+
+  i2s_chan_handle_t m_tx = nullptr;
+  uint32_t m_sampleRate = 0;
+  TapFn m_tap;
+  // 混音任务退出前清零（deinit 轮询它，之后才释放缓冲）
+  std::atomic<TaskHandle_t> m_task{nullptr};
+  std::atomic<bool> m_stop{false};
+
+  mutable std::mutex m_mutex; // 保护 m_voices 的元数据（数据面由混音任务独占读取）
+  Voice m_voices[kMaxVoices];
+
+  int16_t *m_mix = nullptr; // kBlockFrames 双声道
+  int16_t *m_tmp = nullptr; // 单个 voice 的块（+ 残余字节）
+};
@@ -0,0 +1,105 @@
+#include "jitter_buffer.h"
+
+#include <algorithm>
+
+void JitterBuffer::configure(const JitterBufferConfig &cfg) {
+  m_cfg = cfg;
+  m_cfg.min_target_ms = std::max(0, m_cfg.min_target_ms);
+  m_cfg.max_target_ms = std::max(m_cfg.min_target_ms, m_cfg.max_target_ms);
+  m_cfg.margin_ms = std::max(0, m_cfg.margin_ms);
+  m_cfg.decay_ms_per_s = std::max(0, m_cfg.decay_ms_per_s);
+}
+
+void JitterBuffer::begin(uint32_t bytesPerSec, uint32_t seedMs,
+                         uint32_t nowMs) {
+  m_bytesPerSec = bytesPerSec > 0 ? bytesPerSec : 32000;
+  if (!m_hasHistory) {
+    // 第一条流：按调用方给的预缓冲起步（已有网络抖动提示时取较大者）
+    m_needMs = std::max(m_needMs,
+                        (float)std::max(0, (int)seedMs - m_cfg.margin_ms));
+    m_holdUntilMs = nowMs + (uint32_t)m_cfg.hold_ms;
+    m_hasHistory = true;
+  }
+  m_lastDecayMs = nowMs;
+  m_haveArrival = false;
+  m_virtualMs = 0.0f;
+  m_stats.streams++;
+}
+
+void JitterBuffer::raise(float ms, uint32_t nowMs) {
+  const float cap = (float)m_cfg.max_target_ms;
+  m_needMs = std::min(cap, std::max(m_needMs, ms));
+  m_holdUntilMs = nowMs + (uint32_t)m_cfg.hold_ms;
+}
+
+void JitterBuffer::onNetworkJitter(float jitterMs, uint32_t nowMs) {
+  if (jitterMs > 0.0f) {
+    raise(jitterMs * 3.0f, nowMs);
+  }
+}
+
+void JitterBuffer::decay(uint32_t nowMs) {
+  const uint32_t elapsed = nowMs - m_lastDecayMs;
+  m_lastDecayMs = nowMs;
+  if ((int32_t)(nowMs - m_holdUntilMs) < 0 || m_needMs <= 0.0f) {
+    return;
+  }
+  m_needMs -= (float)m_cfg.decay_ms_per_s * (float)elapsed / 1000.0f;
+  if (m_needMs < 0.0f) {
+    m_needMs = 0.0f;
+  }
+}
+
+void JitterBuffer::onArrival(size_t bytes, uint32_t nowMs) {
+  const float mediaMs = (float)bytes * 1000.0f / (float)m_bytesPerSec;
+  if (m_haveArrival) {
+    m_virtualMs -= (float)(nowMs - m_lastArrivalMs);
+    if (m_virtualMs < 0.0f) {
+      // 零预缓冲的播放会在这次到达前饿 -m_virtualMs 毫秒
+      raise(-m_virtualMs, nowMs);
+      m_virtualMs = 0.0f;
+    }
+  }
+  m_haveArrival = true;
+  m_lastArrivalMs = nowMs;
+  m_virtualMs += mediaMs;
+}
+
+void JitterBuffer::onPlayout(size_t depthBytes, uint32_t nowMs) {
+  decay(nowMs);
+  const uint32_t depthMs =
+      (uint32_t)((uint64_t)depthBytes * 1000 / m_bytesPerSec);
+  m_stats.depth_ms = depthMs;
+  int bin = 0;
+  while (bin < JitterStats::kDepthBins - 1 &&
+         depthMs >= JitterStats::kDepthBinEdgesMs[bin]) {
+    bin++;
+  }
+  m_stats.depth_hist[bin]++;
+}
+
+void JitterBuffer::onUnderrun(uint32_t nowMs) {
+  m_stats.underruns++;
+  raise((float)targetMs() + (float)m_cfg.underrun_step_ms -
+            (float)m_cfg.margin_ms,
+        nowMs);
+}
+
+uint32_t JitterBuffer::targetMs() const {
+  const int target = (int)(m_needMs + 0.5f) + m_cfg.margin_ms;
+  return (uint32_t)std::min(m_cfg.max_target_ms,
+                            std::max(m_cfg.min_target_ms, target));
+}
+
+size_t JitterBuffer::msToBytes(uint32_t ms) const {
+  return (size_t)((uint64_t)m_bytesPerSec * ms / 1000);
+}
+
+size_t JitterBuffer::targetBytes() const { return msToBytes(targetMs()); }
+
+JitterStats JitterBuffer::stats() const {
+  JitterStats s = m_stats;
+  s.target_ms = targetMs();
+  s.late_ms = (uint32_t)(m_needMs + 0.5f);
+  return s;
+}
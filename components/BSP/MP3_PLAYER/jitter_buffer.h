@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 抖动缓冲参数（时间单位毫秒）
+ */
+struct JitterBufferConfig {
+  int min_target_ms = 20;    /*!< 目标水位下限 */
+  int max_target_ms = 500;   /*!< 目标水位上限 */
+  int margin_ms = 20;        /*!< 在迟到估计之上额外保留的余量 */
+  int underrun_step_ms = 40; /*!< 每次欠载在当前目标上追加的量 */
+  int hold_ms = 3000;        /*!< 估计上调后至少保持多久才开始回落 */
+  int decay_ms_per_s = 10;   /*!< 稳定后每秒回落的量 */
+};
+
+/**
+ * @brief 抖动缓冲统计
+ */
+struct JitterStats {
+  static constexpr int kDepthBins = 8;
+  /** 水位直方图各桶上界（ms），最后一桶无上界 */
+  static constexpr uint16_t kDepthBinEdgesMs[kDepthBins - 1] = {
+      10, 20, 40, 80, 160, 320, 640};
+
+  uint32_t streams = 0;      /*!< 已开始的流数 */
+  uint32_t underruns = 0;    /*!< 播放中途读空（之后又有数据）的次数 */
+  uint32_t concealed_ms = 0; /*!< 欠载期间补的静音总时长 */
+  uint32_t target_ms = 0;    /*!< 当前目标水位 */
+  uint32_t late_ms = 0;      /*!< 当前需求估计（迟到峰值 / 欠载抬高，随时间回落） */
+  uint32_t depth_ms = 0;     /*!< 最近一次采样的缓冲水位 */
+  uint32_t depth_hist[kDepthBins] = {}; /*!< 每次输出时的水位分布 */
+};
+
+/**
+ * @brief PCM 流播放的自适应抖动缓冲策略（纯 C++，不依赖 FreeRTOS / IDF）
+ *
+ * 数据本身仍在 Mp3Player 的流缓冲里，这里只决定“缓冲到多少再播”：
+ *
+ * - 到达抖动：按“零预缓冲播放会饿多久”估计迟到量——虚拟缓冲按到达的
+ *   媒体时长增加、按真实时间消耗，读空的量即本次迟到；取峰值并缓慢回落
+ * - 欠载：在当前目标上追加 underrun_step_ms
+ * - 目标 = clamp(迟到估计 + margin, min, max)，并在流之间保留，
+ *   网络好时首包延迟自动降到最低，网络差时才付出更大的预缓冲
+ *
+ * 非线程安全，由调用方加锁。
+ */
+class JitterBuffer {
+public:
+  void configure(const JitterBufferConfig &cfg);
+  const JitterBufferConfig &config() const { return m_cfg; }
+
+  /**
+   * @brief 新的流开始
+   * @param bytesPerSec 缓冲中数据的字节率（PCM 或压缩码率）
+   * @param seedMs 尚无历史时的初始目标
+   */
+  void begin(uint32_t bytesPerSec, uint32_t seedMs, uint32_t nowMs);
+
+  /** 写入一段数据（生产者） */
+  void onArrival(size_t bytes, uint32_t nowMs);
+
+  /** 输出一块前采样当前水位（消费者） */
+  void onPlayout(size_t depthBytes, uint32_t nowMs);
+
+  /** 读空后又收到数据：确认一次欠载 */
+  void onUnderrun(uint32_t nowMs);
+
+  /**
+   * @brief 传输层实测的网络抖动（RFC 3550 平均偏差），在流开始之前给出
+   *
+   * 迟到估计至少取 3 倍抖动：虚拟播放只能在欠载之后才学到，这里让新流
+   * 一开始就按网络状况预缓冲。
+   */
+  void onNetworkJitter(float jitterMs, uint32_t nowMs);
+
+  /** 欠载期间补了 ms 毫秒静音 */
+  void onConcealed(uint32_t ms) { m_stats.concealed_ms += ms; }
+
+  uint32_t targetMs() const;
+  size_t targetBytes() const;
+  size_t msToBytes(uint32_t ms) const;
+  JitterStats stats() const;
+
+private:
+  void decay(uint32_t nowMs);
+  void raise(float ms, uint32_t nowMs);
+
+  JitterBufferConfig m_cfg;
+  uint32_t m_bytesPerSec = 32000;
+  bool m_hasHistory = false;
+
+  float m_needMs = 0.0f;     // 迟到估计 / 欠载抬高后的需求
+  uint32_t m_holdUntilMs = 0;
+  uint32_t m_lastDecayMs = 0;
+
+  // 虚拟播放：本流内按到达时长累加、按真实时间消耗
+  bool m_haveArrival = false;
+  uint32_t m_lastArrivalMs = 0;
+  float m_virtualMs = 0.0f;
+
+  JitterStats m_stats;
+};
@@ -8,15 +8,21 @@
 
 #include "mp3_player.h"
 
+#include "audio_dsp.h"
 #include "audio_player.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
+#include "latency_trace.h"
+#include "sdkconfig.h"
+#include "freertos/message_buffer.h"
 #include "freertos/stream_buffer.h"
 #include "freertos/task.h"
 #include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 
 // 嵌入的 MP3 文件
 extern const uint8_t mp3_start[] asm("_binary_dinosaur_roar_mp3_start");
@@ -24,8 +30,91 @@ extern const uint8_t mp3_end[] asm("_binary_dinosaur_roar_mp3_end");
 
 static const char *TAG = "Mp3Player";
 
-// 静态成员用于 I2S 写入回调
-static i2s_chan_handle_t s_txHandle = nullptr;
+// I2S 输出固定为 kOutRate / 16bit / 双声道，只在 initI2s 配置一次；
+// 所有音源在写 I2S 前重采样到该采样率
+static constexpr uint32_t kOutRate = CONFIG_AUDIO_OUTPUT_SAMPLE_RATE;
+
+// audio_player 当前音源格式（clkSetFn 更新），i2sWrite 按它转换
+static uint32_t s_srcBits = 16;
+static int s_srcChannels = 2;
+
+// 每路流式 voice 在混音器里的缓冲（生产者最多领先 I2S 这么多）
+static constexpr uint32_t kVoiceBufferMs = 40;
+
+// PCM 流播放任务每次写 I2S 的单声道字节数（输出为双声道，加倍）
+static constexpr size_t kPcmInChunkBytes = 1024;
+static constexpr size_t kPcmOutChunkBytes = kPcmInChunkBytes * 2;
+// 每次写 I2S 的帧数（i2sWrite 与 PCM 流共用）
+static constexpr size_t kChunkFrames = kPcmInChunkBytes / sizeof(int16_t);
+// 读空判定的等待时间 / 欠载时每次补的静音时长
+static constexpr uint32_t kDryPollMs = 10;
+static constexpr uint32_t kConcealMs = 10;
+
+static uint32_t nowMs() { return (uint32_t)(esp_timer_get_time() / 1000); }
+
+/**
+ * @brief 播放尾部保留 kRamp 个样本：读空时把它们淡出后再补静音，恢复时
+ * 对第一块淡入，欠载不再表现为“咔哒”声。稳态下只多出 kRamp 个样本的延迟。
+ */
+class PlayoutRamp {
+public:
+  static constexpr size_t kRamp = 64;
+
+  template <typename Out> void push(int16_t *pcm, size_t n, Out &out) {
+    if (m_fadeIn) {
+      m_fadeIn = false;
+      const size_t r = std::min(n, kRamp);
+      for (size_t i = 0; i < r; i++) {
+        pcm[i] = (int16_t)((int32_t)pcm[i] * (int32_t)i / (int32_t)kRamp);
+      }
+    }
+    if (m_held + n <= kRamp) {
+      memcpy(m_hold + m_held, pcm, n * sizeof(int16_t));
+      m_held += n;
+      return;
+    }
+    // 先输出 [hold, pcm] 的前 m_held + n - kRamp 个样本，保留最后 kRamp 个
+    const size_t emit = m_held + n - kRamp;
+    const size_t fromHold = std::min(m_held, emit);
+    if (fromHold > 0) {
+      out(m_hold, fromHold);
+    }
+    const size_t fromPcm = emit - fromHold;
+    if (fromPcm > 0) {
+      out(pcm, fromPcm);
+    }
+    const size_t keepHold = m_held - fromHold;
+    memmove(m_hold, m_hold + fromHold, keepHold * sizeof(int16_t));
+    memcpy(m_hold + keepHold, pcm + fromPcm, (n - fromPcm) * sizeof(int16_t));
+    m_held = keepHold + (n - fromPcm);
+  }
+
+  template <typename Out> void fadeOutAndFlush(Out &out) {
+    for (size_t i = 0; i < m_held; i++) {
+      m_hold[i] = (int16_t)((int32_t)m_hold[i] * (int32_t)(m_held - i) /
+                            (int32_t)(m_held + 1));
+    }
+    flush(out);
+  }
+
+  template <typename Out> void flush(Out &out) {
+    if (m_held > 0) {
+      out(m_hold, m_held);
+    }
+    m_held = 0;
+  }
+
+  void armFadeIn() { m_fadeIn = true; }
+  void clear() {
+    m_held = 0;
+    m_fadeIn = false;
+  }
+
+private:
+  int16_t m_hold[kRamp];
+  size_t m_held = 0;
+  bool m_fadeIn = false;
+};
 
 // MAX98357 等 I2S 功放通常没有硬件静音脚；提供一个空实现避免 audio_player 解引用空函数指针
 static esp_err_t muteNoopFn(AUDIO_PLAYER_MUTE_SETTING /*setting*/) {
@@ -45,16 +134,11 @@ void Mp3Player::audioCallback(void *ctx) {
   auto *cbCtx = static_cast<audio_player_cb_ctx_t *>(ctx);
   auto &self = Mp3Player::instance();
 
-  // While PCM streaming, ignore audio_player events to avoid state corruption
-  // (audio_player_stop may still emit IDLE later).
-  if (self.m_pcmTask != nullptr) {
-    return;
-  }
-
+  // 只更新 audio_player 这一路的状态；PCM 流 / 片段由混音器并行播放
   switch (cbCtx->audio_event) {
   case AUDIO_PLAYER_CALLBACK_EVENT_IDLE:
     ESP_LOGI(TAG, "播放完成");
-    self.m_state = Mp3PlayerState::Idle;
+    self.m_playerState = Mp3PlayerState::Idle;
 
     // 如果开启循环播放，重新开始
     if (self.m_loopEnabled) {
@@ -69,56 +153,95 @@ void Mp3Player::audioCallback(void *ctx) {
   case AUDIO_PLAYER_CALLBACK_EVENT_PLAYING:
   case AUDIO_PLAYER_CALLBACK_EVENT_COMPLETED_PLAYING_NEXT:
     ESP_LOGI(TAG, "正在播放");
-    self.m_state = Mp3PlayerState::Playing;
+    self.m_playerState = Mp3PlayerState::Playing;
     break;
 
   case AUDIO_PLAYER_CALLBACK_EVENT_PAUSE:
     ESP_LOGI(TAG, "已暂停");
-    self.m_state = Mp3PlayerState::Paused;
+    self.m_playerState = Mp3PlayerState::Paused;
     break;
 
   default:
     break;
   }
 
-  // 调用用户回调
-  if (self.m_callback) {
-    self.m_callback(self.m_state);
-  }
+  self.notifyState();
 }
 
 esp_err_t Mp3Player::i2sWrite(void *audio_buffer, size_t len,
                               size_t *bytes_written, uint32_t timeout_ms) {
-  if (s_txHandle == nullptr) {
+  auto &self = Mp3Player::instance();
+  if (self.m_playerVoice == kNoVoice) {
     return ESP_ERR_INVALID_STATE;
   }
-  return i2s_channel_write(s_txHandle, audio_buffer, len, bytes_written,
-                           pdMS_TO_TICKS(timeout_ms));
-}
-
-esp_err_t Mp3Player::clkSetFn(uint32_t rate, uint32_t bits_cfg,
-                              i2s_slot_mode_t ch) {
-  if (s_txHandle == nullptr) {
-    return ESP_ERR_INVALID_STATE;
+  if (s_srcBits != 16 || !self.m_playerOutBuf) {
+    // 不支持的位深（clkSetFn 已报错）：丢弃，避免把数据当 16bit 播成噪声
+    if (bytes_written != nullptr) {
+      *bytes_written = len;
+    }
+    return ESP_OK;
   }
 
-  // 需要先禁用通道才能重新配置
-  ESP_ERROR_CHECK(i2s_channel_disable(s_txHandle));
+  const int ch = s_srcChannels;
+  const int16_t *in = static_cast<const int16_t *>(audio_buffer);
+  size_t frames = len / (sizeof(int16_t) * ch);
+  const TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+  PolyphaseResampler &rs = self.m_playerResampler;
+  esp_err_t ret = ESP_OK;
+
+  if (ch == 2 && rs.passthrough()) {
+    // 音源已是输出格式：直接送混音器
+    ret = self.m_mixer.write(self.m_playerVoice, in, frames, timeout);
+    if (bytes_written != nullptr) {
+      *bytes_written = (ret == ESP_OK) ? len : 0;
+    }
+    return ret;
+  }
 
-  // 更新时钟配置
-  i2s_std_clk_config_t clkCfg = I2S_STD_CLK_DEFAULT_CONFIG(rate);
-  ESP_ERROR_CHECK(i2s_channel_reconfig_std_clock(s_txHandle, &clkCfg));
+  while (frames > 0) {
+    // 单声道先重采样到 m_playerMonoBuf 再复制成双声道
+    int16_t *dst = (ch == 2) ? self.m_playerOutBuf : self.m_playerMonoBuf;
+    size_t used = 0;
+    const size_t n = rs.process(in, frames, &used, dst, kChunkFrames);
+    in += used * ch;
+    frames -= used;
+    if (n == 0) {
+      continue;
+    }
+    if (ch == 1) {
+      audio_dsp::monoToStereo16(dst, self.m_playerOutBuf, n);
+    }
+    ret = self.m_mixer.write(self.m_playerVoice, self.m_playerOutBuf, n,
+                             timeout);
+    if (ret != ESP_OK) {
+      break;
+    }
+  }
+  if (bytes_written != nullptr) {
+    *bytes_written = len - frames * sizeof(int16_t) * ch;
+  }
+  return ret;
+}
 
-  // 更新槽位配置
-  i2s_std_slot_config_t slotCfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(
-      static_cast<i2s_data_bit_width_t>(bits_cfg), ch);
-  ESP_ERROR_CHECK(i2s_channel_reconfig_std_slot(s_txHandle, &slotCfg));
+esp_err_t Mp3Player::clkSetFn(uint32_t rate, uint32_t bits_cfg,
+                              i2s_slot_mode_t ch) {
 
-  // 重新启用通道
-  ESP_ERROR_CHECK(i2s_channel_enable(s_txHandle));
+  // I2S 时钟在 initI2s 固定，不再停通道重配（避免切换音源时的爆音和
+  // 几毫秒的空档）；这里只记录音源格式并切换重采样器
+  s_srcBits = bits_cfg;
+  s_srcChannels = (ch == I2S_SLOT_MODE_MONO) ? 1 : 2;
+  if (bits_cfg != 16) {
+    ESP_LOGE(TAG, "不支持的音源位深: %lu bit", bits_cfg);
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  if (!Mp3Player::instance().m_playerResampler.configure(rate, kOutRate,
+                                                         s_srcChannels)) {
+    ESP_LOGE(TAG, "不支持的音源采样率: %lu", rate);
+    return ESP_ERR_INVALID_ARG;
+  }
 
-  ESP_LOGI(TAG, "I2S 时钟配置更新: rate=%lu, bits=%lu, ch=%d", rate, bits_cfg,
-           ch);
+  ESP_LOGI(TAG, "音源格式: rate=%lu, bits=%lu, ch=%d -> I2S %lu Hz", rate,
+           bits_cfg, ch, (unsigned long)kOutRate);
   return ESP_OK;
 }
 
@@ -134,7 +257,7 @@ esp_err_t Mp3Player::initI2s(const Mp3I2sConfig &config) {
 
   // I2S 标准模式配置
   i2s_std_config_t stdCfg = {
-      .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(44100),
+      .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(kOutRate),
       .slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT,
                                                   I2S_SLOT_MODE_STEREO),
       .gpio_cfg =
@@ -156,15 +279,22 @@ esp_err_t Mp3Player::initI2s(const Mp3I2sConfig &config) {
   ESP_ERROR_CHECK(i2s_channel_init_std_mode(m_txHandle, &stdCfg));
   ESP_ERROR_CHECK(i2s_channel_enable(m_txHandle));
 
-  // 保存到静态变量供回调使用
-  s_txHandle = m_txHandle;
-
-  ESP_LOGI(TAG, "I2S 初始化完成 (BCK:%d, WS:%d, DOUT:%d)", config.bck_io,
-           config.ws_io, config.dout_io);
+  ESP_LOGI(TAG, "I2S 初始化完成 (BCK:%d, WS:%d, DOUT:%d, %lu Hz)",
+           config.bck_io, config.ws_io, config.dout_io,
+           (unsigned long)kOutRate);
 
   return ESP_OK;
 }
 
+void Mp3Player::registerMetrics() {
+  esp_err_t ret = Metrics::instance().add(
+      {&m_metricStreams, &m_metricUnderruns, &m_metricConcealedMs,
+       &m_metricDepthMs, &m_metricTargetMs});
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "指标注册失败: %s", esp_err_to_name(ret));
+  }
+}
+
 // ============= 公共 API =============
 
 esp_err_t Mp3Player::init(const Mp3I2sConfig &config) {
@@ -182,6 +312,31 @@ esp_err_t Mp3Player::init(const Mp3I2sConfig &config) {
     return ret;
   }
 
+  // audio_player 写 I2S 前的重采样缓冲（16 字节对齐，便于 audio_dsp 走向量路径）
+  m_playerOutBuf = (int16_t *)heap_caps_aligned_alloc(
+      16, kPcmOutChunkBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  m_playerMonoBuf = (int16_t *)heap_caps_aligned_alloc(
+      16, kPcmInChunkBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!m_playerOutBuf || !m_playerMonoBuf) {
+    ESP_LOGE(TAG, "重采样缓冲分配失败");
+    return ESP_ERR_NO_MEM;
+  }
+
+  // 混音器独占 I2S；混音结果作为回声参考
+  ret = m_mixer.init(m_txHandle, kOutRate,
+                     [this](const int16_t *stereo, size_t frames) {
+                       tapReference(stereo, frames, 2);
+                     });
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "混音器初始化失败");
+    return ret;
+  }
+  // audio_player（MP3/WAV 解码）固定占用一路 voice
+  m_playerVoice = m_mixer.openStream(kVoiceBufferMs);
+  if (m_playerVoice == kNoVoice) {
+    return ESP_ERR_NO_MEM;
+  }
+
   // 配置 audio_player
   audio_player_config_t playerCfg = {
       .mute_fn = muteNoopFn,
@@ -205,6 +360,7 @@ esp_err_t Mp3Player::init(const Mp3I2sConfig &config) {
     return ret;
   }
 
+  registerMetrics();
   m_initialized = true;
   ESP_LOGI(TAG, "MP3 播放器初始化完成");
   return ESP_OK;
@@ -223,12 +379,23 @@ void Mp3Player::freeActiveBuffer() {
 }
 
 void Mp3Player::waitForIdle(uint32_t timeout_ms) {
-  if (m_state == Mp3PlayerState::Idle) {
+  if (getState() == Mp3PlayerState::Idle) {
     return;
   }
   TickType_t start = xTaskGetTickCount();
   TickType_t timeoutTicks = pdMS_TO_TICKS(timeout_ms);
-  while (m_state != Mp3PlayerState::Idle) {
+  while (getState() != Mp3PlayerState::Idle) {
+    vTaskDelay(pdMS_TO_TICKS(20));
+    if ((xTaskGetTickCount() - start) > timeoutTicks) {
+      break;
+    }
+  }
+}
+
+void Mp3Player::waitForPlayerIdle(uint32_t timeout_ms) {
+  TickType_t start = xTaskGetTickCount();
+  TickType_t timeoutTicks = pdMS_TO_TICKS(timeout_ms);
+  while (m_playerState != Mp3PlayerState::Idle) {
     vTaskDelay(pdMS_TO_TICKS(20));
     if ((xTaskGetTickCount() - start) > timeoutTicks) {
       break;
@@ -277,14 +444,12 @@ esp_err_t Mp3Player::playEmbedded(bool loop) {
     return ESP_ERR_INVALID_STATE;
   }
 
-  // Stop PCM stream if active (and wait it to end).
-  stopPcmStreamInternal(true);
-
-  // 确保先停止当前播放，等待进入 IDLE（避免上一次 IDLE 回调释放到新的 buffer）
-  if (m_state != Mp3PlayerState::Idle) {
-    stop();
-    waitForIdle(3000);
-    if (m_state != Mp3PlayerState::Idle) {
+  // PCM 流 / 片段照常播放（混音叠加）；audio_player 只有一个解码器，
+  // 若正在播放则先停掉它，等待进入 IDLE（避免上一次 IDLE 回调释放到新的 buffer）
+  if (m_playerState != Mp3PlayerState::Idle) {
+    stopPlayerInternal();
+    waitForPlayerIdle(3000);
+    if (m_playerState != Mp3PlayerState::Idle) {
       ESP_LOGW(TAG, "stop timeout, skip playEmbedded");
       return ESP_ERR_TIMEOUT;
     }
@@ -315,14 +480,11 @@ esp_err_t Mp3Player::playOwnedBuffer(uint8_t *data, size_t len, bool loop) {
     return ESP_ERR_INVALID_ARG;
   }
 
-  // Stop PCM stream if active (and wait it to end).
-  stopPcmStreamInternal(true);
-
-  // 停止当前播放，等待进入 IDLE（确保上一次 IDLE 回调已完成）
-  if (m_state != Mp3PlayerState::Idle) {
-    stop();
-    waitForIdle(3000);
-    if (m_state != Mp3PlayerState::Idle) {
+  // 停止 audio_player 当前播放，等待进入 IDLE（确保上一次 IDLE 回调已完成）
+  if (m_playerState != Mp3PlayerState::Idle) {
+    stopPlayerInternal();
+    waitForPlayerIdle(3000);
+    if (m_playerState != Mp3PlayerState::Idle) {
       ESP_LOGW(TAG, "stop timeout, drop new audio buffer");
       free(data);
       return ESP_ERR_TIMEOUT;
@@ -350,11 +512,11 @@ void Mp3Player::pcmStreamTask(void *arg) {
     return;
   }
 
-  // Small prebuffer to reduce underflow/clicking on LAN jitter.
+  // 自适应预缓冲：目标水位由抖动缓冲给出（跨流学习），最长等待 2s
   TickType_t start = xTaskGetTickCount();
   while (!self->m_pcmStop && self->m_pcmStream &&
          xStreamBufferBytesAvailable(self->m_pcmStream) <
-             self->m_pcmPrebufferBytes) {
+             self->jitterTargetBytes()) {
     vTaskDelay(pdMS_TO_TICKS(10));
     // Don't wait forever; start anyway after ~2s
     if ((xTaskGetTickCount() - start) > pdMS_TO_TICKS(2000)) {
@@ -362,18 +524,51 @@ void Mp3Player::pcmStreamTask(void *arg) {
     }
   }
 
-  static constexpr size_t kInChunkBytes = 1024; // mono bytes
-  static constexpr size_t kOutChunkBytes = kInChunkBytes * 2; // stereo bytes
-  uint8_t *inBuf = (uint8_t *)malloc(kInChunkBytes + 1); // +1 for tail byte
-  uint8_t *outBuf = (uint8_t *)malloc(kOutChunkBytes);
-  if (!inBuf || !outBuf) {
+  // 16 字节对齐，便于 audio_dsp 走向量路径
+  uint8_t *inBuf = (uint8_t *)heap_caps_aligned_alloc(
+      16, kPcmInChunkBytes + 16, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  uint8_t *outBuf = (uint8_t *)heap_caps_aligned_alloc(
+      16, kPcmOutChunkBytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  int16_t *rsBuf = (int16_t *)heap_caps_aligned_alloc(
+      16, kChunkFrames * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!inBuf || !outBuf || !rsBuf) {
     ESP_LOGE(TAG, "pcm stream malloc failed");
   }
+
+  // 压缩流：一次取一个包，解码后再按块写 I2S
+  DownlinkDecoder *dec = self->m_pcmDecoder.get();
+  uint8_t *pktBuf = nullptr;
+  int16_t *decBuf = nullptr;
+  if (dec) {
+    pktBuf = (uint8_t *)heap_caps_malloc(dec->maxPacketBytes(),
+                                         MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    decBuf = (int16_t *)heap_caps_aligned_alloc(
+        16, dec->maxFrameSamples() * sizeof(int16_t),
+        MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!pktBuf || !decBuf) {
+      ESP_LOGE(TAG, "pcm stream decoder malloc failed");
+      heap_caps_free(inBuf);
+      inBuf = nullptr;
+    }
+  }
   bool hasTail = false;
   uint8_t tail = 0;
+  size_t flushed = 0;
+  uint32_t badPackets = 0;
+
+  // 欠载处理：读空后先把保留的尾巴淡出，再补静音直到水位回到目标，
+  // 恢复时淡入；流正常结束时的读空不算欠载
+  PlayoutRamp ramp;
+  auto output = [self, outBuf, rsBuf](const int16_t *pcm, size_t n) {
+    self->pcmStreamOutput(pcm, n, rsBuf, outBuf);
+  };
+  const size_t concealFrames = kOutRate * kConcealMs / 1000;
+  bool dry = false;
+  bool refilling = false;    // 读空后已经又收到数据（确认欠载）
+  uint32_t refillStartMs = 0;
 
   while (true) {
-    if (!inBuf || !outBuf) {
+    if (!inBuf || !outBuf || !rsBuf) {
       break;
     }
     if (!self->m_pcmStream) {
@@ -384,14 +579,81 @@ void Mp3Player::pcmStreamTask(void *arg) {
       break;
     }
 
+    // 打断：把缓冲读空但不写 I2S（读空后写者不会再阻塞在满缓冲上）
+    if (self->m_pcmFlush) {
+      flushed += dec ? xMessageBufferReceive(self->m_pcmStream, pktBuf,
+                                             dec->maxPacketBytes(), 0)
+                     : xStreamBufferReceive(self->m_pcmStream, inBuf,
+                                            kPcmInChunkBytes, 0);
+      ramp.clear();
+      continue;
+    }
+
+    if (dry) {
+      const uint32_t now = nowMs();
+      if (avail > 0 && !refilling) {
+        refilling = true;
+        refillStartMs = now;
+        uint32_t target;
+        {
+          std::lock_guard<std::mutex> lock(self->m_jitterMutex);
+          self->m_jitter.onUnderrun(now);
+          target = self->m_jitter.targetMs();
+        }
+        LTRACE(TraceEvent::PcmUnderrun, target);
+      }
+      // 水位回到目标、流已结束或等够目标时长后恢复播放
+      const bool resume =
+          avail >= self->jitterTargetBytes() || self->m_pcmStop ||
+          (refilling && now - refillStartMs >= self->jitterTargetMs());
+      if (!resume) {
+        self->pcmStreamSilence(concealFrames, outBuf);
+        std::lock_guard<std::mutex> lock(self->m_jitterMutex);
+        self->m_jitter.onConcealed(kConcealMs);
+        continue;
+      }
+      dry = false;
+      refilling = false;
+      ramp.armFadeIn();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(self->m_jitterMutex);
+      self->m_jitter.onPlayout(avail, nowMs());
+    }
+
+    if (dec) {
+      size_t got = xMessageBufferReceive(self->m_pcmStream, pktBuf,
+                                         dec->maxPacketBytes(),
+                                         pdMS_TO_TICKS(kDryPollMs));
+      if (got == 0) {
+        if (!self->m_pcmStop) {
+          ramp.fadeOutAndFlush(output);
+          dry = true;
+        }
+        continue;
+      }
+      int samples = dec->decode(pktBuf, got, decBuf);
+      if (samples <= 0) {
+        ++badPackets;
+        continue;
+      }
+      ramp.push(decBuf, (size_t)samples, output);
+      continue;
+    }
+
     size_t recvOffset = hasTail ? 1 : 0;
     if (hasTail) {
       inBuf[0] = tail;
     }
     size_t got = xStreamBufferReceive(self->m_pcmStream, inBuf + recvOffset,
-                                      kInChunkBytes - recvOffset,
-                                      pdMS_TO_TICKS(100));
+                                      kPcmInChunkBytes - recvOffset,
+                                      pdMS_TO_TICKS(kDryPollMs));
     if (got == 0) {
+      if (!self->m_pcmStop) {
+        ramp.fadeOutAndFlush(output);
+        dry = true;
+      }
       continue;
     }
     size_t total = got + recvOffset;
@@ -406,25 +668,23 @@ void Mp3Player::pcmStreamTask(void *arg) {
       continue;
     }
 
-    // mono S16LE -> stereo S16LE (duplicate samples)
-    int samples = (int)(total / 2);
-    auto *in = reinterpret_cast<const int16_t *>(inBuf);
-    auto *out = reinterpret_cast<int16_t *>(outBuf);
-    for (int i = 0; i < samples; i++) {
-      int16_t s = in[i];
-      out[i * 2] = s;
-      out[i * 2 + 1] = s;
-    }
-
-    size_t outBytes = (size_t)samples * 2 * sizeof(int16_t);
-    size_t written = 0;
-    esp_err_t err = i2s_channel_write(s_txHandle, outBuf, outBytes, &written,
-                                      pdMS_TO_TICKS(2000));
-    if (err != ESP_OK) {
-      ESP_LOGW(TAG, "pcm i2s write failed: %s", esp_err_to_name(err));
-      // Keep draining so we can exit cleanly.
-      vTaskDelay(pdMS_TO_TICKS(10));
-    }
+    ramp.push(reinterpret_cast<int16_t *>(inBuf), total / 2, output);
+  }
+  if (!self->m_pcmFlush && inBuf && outBuf && rsBuf) {
+    ramp.flush(output);
+    // 再送入群延迟长度的静音，把重采样滤波器里的最后几个样本推出来
+    memset(inBuf, 0, kPcmInChunkBytes);
+    output(reinterpret_cast<const int16_t *>(inBuf),
+           std::min(self->m_streamResampler.delayFrames(), kChunkFrames));
+  }
+
+  if (self->m_pcmFlush) {
+    LTRACE(TraceEvent::PcmFlushed, flushed);
+    ESP_LOGI(TAG, "PCM stream flushed (%u bytes dropped)", (unsigned)flushed);
+  }
+  if (badPackets > 0) {
+    ESP_LOGW(TAG, "PCM stream: %u %s packets failed to decode",
+             (unsigned)badPackets, dec->format());
   }
 
   // Cleanup stream resources
@@ -437,24 +697,120 @@ void Mp3Player::pcmStreamTask(void *arg) {
     heap_caps_free(self->m_pcmStreamBuf);
     self->m_pcmStreamBuf = nullptr;
   }
-  self->m_pcmStop = false;
+  self->m_pcmPacketMode = false;
+  self->m_pcmDecoder.reset();
 
-  self->m_state = Mp3PlayerState::Idle;
-  if (self->m_callback) {
-    self->m_callback(self->m_state);
-  }
+  // 剩余数据由混音器播完后释放 voice；打断时直接丢弃
+  self->m_mixer.close(self->m_streamVoice, self->m_pcmFlush);
+  self->m_streamVoice = kNoVoice;
+  self->m_pcmStop = false;
+  self->m_pcmFlush = false;
 
   self->m_pcmTask = nullptr;
+  self->notifyState();
   if (inBuf) {
-    free(inBuf);
+    heap_caps_free(inBuf);
   }
   if (outBuf) {
-    free(outBuf);
+    heap_caps_free(outBuf);
+  }
+  if (rsBuf) {
+    heap_caps_free(rsBuf);
+  }
+  if (pktBuf) {
+    heap_caps_free(pktBuf);
+  }
+  if (decBuf) {
+    heap_caps_free(decBuf);
   }
   ESP_LOGI(TAG, "PCM stream finished");
   vTaskDelete(nullptr);
 }
 
+void Mp3Player::pcmStreamSilence(size_t frames, uint8_t *outBuf) {
+  memset(outBuf, 0, kPcmOutChunkBytes);
+  while (frames > 0) {
+    const size_t n = std::min(frames, kChunkFrames);
+    if (m_mixer.write(m_streamVoice, reinterpret_cast<const int16_t *>(outBuf),
+                      n, pdMS_TO_TICKS(2000)) != ESP_OK) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    frames -= n;
+  }
+}
+
+size_t Mp3Player::jitterTargetBytes() {
+  std::lock_guard<std::mutex> lock(m_jitterMutex);
+  return std::min(m_jitter.targetBytes(), m_pcmBufferBytes / 2);
+}
+
+uint32_t Mp3Player::jitterTargetMs() {
+  std::lock_guard<std::mutex> lock(m_jitterMutex);
+  return m_jitter.targetMs();
+}
+
+void Mp3Player::noteNetworkJitter(uint32_t jitter_ms) {
+  std::lock_guard<std::mutex> lock(m_jitterMutex);
+  m_jitter.onNetworkJitter((float)jitter_ms, nowMs());
+}
+
+JitterStats Mp3Player::getJitterStats() const {
+  std::lock_guard<std::mutex> lock(m_jitterMutex);
+  return m_jitter.stats();
+}
+
+std::string Mp3Player::statusJson() const {
+  JitterStats jb = getJitterStats();
+  char buf[160];
+  snprintf(buf, sizeof(buf),
+           "{\"underruns\":%u,\"concealed_ms\":%u,\"target_ms\":%u,"
+           "\"late_ms\":%u,\"depth_ms\":%u,\"depth_hist\":[",
+           (unsigned)jb.underruns, (unsigned)jb.concealed_ms,
+           (unsigned)jb.target_ms, (unsigned)jb.late_ms, (unsigned)jb.depth_ms);
+  std::string json(buf);
+  for (int i = 0; i < JitterStats::kDepthBins; i++) {
+    snprintf(buf, sizeof(buf), "%s%u", i ? "," : "",
+             (unsigned)jb.depth_hist[i]);
+    json += buf;
+  }
+  json += "]}";
+  return json;
+}
+
+void Mp3Player::pcmStreamOutput(const int16_t *mono, size_t samples,
+                                int16_t *rsBuf, uint8_t *outBuf) {
+  PolyphaseResampler &rs = m_streamResampler;
+  while (samples > 0) {
+    // 重采样到 I2S 采样率（同采样率时直接用输入）
+    const int16_t *pcm = mono;
+    size_t n = std::min(samples, kChunkFrames);
+    size_t used = n;
+    if (!rs.passthrough()) {
+      n = rs.process(mono, samples, &used, rsBuf, kChunkFrames);
+      pcm = rsBuf;
+    }
+    mono += used;
+    samples -= used;
+    if (n == 0) {
+      continue;
+    }
+
+    // mono S16LE -> stereo S16LE (duplicate samples)
+    audio_dsp::monoToStereo16(pcm, reinterpret_cast<int16_t *>(outBuf), n);
+
+    esp_err_t err =
+        m_mixer.write(m_streamVoice, reinterpret_cast<const int16_t *>(outBuf),
+                      n, pdMS_TO_TICKS(2000));
+    if (err == ESP_OK) {
+      LTRACE_FIRST(TraceEvent::I2sFirstWrite, n * 2 * sizeof(int16_t));
+    } else if (err != ESP_ERR_INVALID_STATE) {
+      ESP_LOGW(TAG, "pcm mixer write failed: %s", esp_err_to_name(err));
+      // Keep draining so we can exit cleanly.
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+  }
+}
+
 void Mp3Player::stopPcmStreamInternal(bool waitIdle) {
   if (!m_pcmTask) {
     if (m_pcmStream) {
@@ -467,17 +823,24 @@ void Mp3Player::stopPcmStreamInternal(bool waitIdle) {
       m_pcmStreamBuf = nullptr;
     }
     m_pcmStop = false;
+    m_pcmFlush = false;
+    m_pcmPacketMode = false;
+    m_pcmDecoder.reset();
     return;
   }
 
   m_pcmStop = true;
   if (waitIdle) {
-    waitForIdle(3000);
+    TickType_t start = xTaskGetTickCount();
+    while (m_pcmTask != nullptr &&
+           (xTaskGetTickCount() - start) <= pdMS_TO_TICKS(3000)) {
+      vTaskDelay(pdMS_TO_TICKS(20));
+    }
   }
 }
 
 esp_err_t Mp3Player::pcmStreamBegin(uint32_t sample_rate_hz,
-                                   uint32_t prebuffer_ms) {
+                                   uint32_t prebuffer_ms, const char *format) {
   if (!m_initialized) {
     return ESP_ERR_INVALID_STATE;
   }
@@ -488,23 +851,25 @@ esp_err_t Mp3Player::pcmStreamBegin(uint32_t sample_rate_hz,
   // Stop any existing stream first
   stopPcmStreamInternal(true);
 
-  // Stop current audio_player playback
-  if (m_state != Mp3PlayerState::Idle) {
-    stop();
-    waitForIdle(3000);
-    if (m_state != Mp3PlayerState::Idle) {
-      ESP_LOGW(TAG, "stop timeout, skip pcmStreamBegin");
-      return ESP_ERR_TIMEOUT;
+  std::unique_ptr<DownlinkDecoder> decoder;
+  if (format && strcmp(format, "pcm") != 0) {
+    decoder = DownlinkDecoder::create(format, (int)sample_rate_hz);
+    if (!decoder) {
+      ESP_LOGE(TAG, "unsupported pcm stream format: %s", format);
+      return ESP_ERR_NOT_SUPPORTED;
     }
   }
 
-  // Release owned buffer (if any) now; streaming doesn't need it.
-  m_loopEnabled = false;
-  freeActiveBuffer();
+  if (m_pcmTask != nullptr) {
+    ESP_LOGW(TAG, "stop timeout, skip pcmStreamBegin");
+    return ESP_ERR_TIMEOUT;
+  }
 
-  // Reconfigure I2S clock to match PCM stream
-  (void)clkSetFn(sample_rate_hz, (uint32_t)I2S_DATA_BIT_WIDTH_16BIT,
-                 I2S_SLOT_MODE_STEREO);
+  // audio_player 的播放不再打断：两路由混音器叠加（需要替换时调用方先 stop()）
+  // I2S 时钟保持不变，流数据在播放任务里重采样到 kOutRate
+  if (!m_streamResampler.configure(sample_rate_hz, kOutRate, 1)) {
+    return ESP_ERR_INVALID_ARG;
+  }
 
   // Create stream buffer (~1s for 16k mono; scale with sample rate)
   // Prefer PSRAM for large buffer to avoid internal RAM exhaustion
@@ -513,14 +878,19 @@ esp_err_t Mp3Player::pcmStreamBegin(uint32_t sample_rate_hz,
   bufBytes = std::min(bufBytes, (size_t)48 * 1024);
 
   // Try PSRAM first, fallback to internal RAM
+  // 压缩流用 message buffer：整包入队/出队，解码器总能拿到完整的包
   uint8_t *bufMem = (uint8_t *)heap_caps_malloc(bufBytes + 1, MALLOC_CAP_SPIRAM);
   if (bufMem) {
-    m_pcmStream = xStreamBufferCreateStatic(bufBytes, 1, bufMem, &m_pcmStreamStorage);
+    m_pcmStream = decoder ? xMessageBufferCreateStatic(bufBytes, bufMem,
+                                                       &m_pcmStreamStorage)
+                          : xStreamBufferCreateStatic(bufBytes, 1, bufMem,
+                                                      &m_pcmStreamStorage);
     m_pcmStreamBuf = bufMem;
     ESP_LOGI(TAG, "PCM buffer allocated from PSRAM: %u bytes", (unsigned)bufBytes);
   } else {
     // Fallback to internal RAM
-    m_pcmStream = xStreamBufferCreate(bufBytes, 1);
+    m_pcmStream = decoder ? xMessageBufferCreate(bufBytes)
+                          : xStreamBufferCreate(bufBytes, 1);
     m_pcmStreamBuf = nullptr;
     ESP_LOGW(TAG, "PSRAM alloc failed, using internal RAM for PCM buffer");
   }
@@ -534,46 +904,78 @@ esp_err_t Mp3Player::pcmStreamBegin(uint32_t sample_rate_hz,
   }
 
   m_pcmSampleRate = sample_rate_hz;
-  m_pcmPrebufferBytes =
-      (size_t)((uint64_t)sample_rate_hz * 2 * (uint64_t)prebuffer_ms / 1000);
-  if (m_pcmPrebufferBytes > bufBytes) {
-    m_pcmPrebufferBytes = bufBytes / 2;
+  m_pcmBufferBytes = bufBytes;
+  {
+    // prebuffer_ms 只作为第一条流的起点，之后由抖动缓冲按网络情况调整
+    std::lock_guard<std::mutex> lock(m_jitterMutex);
+    m_jitter.begin(decoder ? (uint32_t)decoder->bytesPerSecond()
+                           : sample_rate_hz * 2,
+                   prebuffer_ms, nowMs());
   }
   m_pcmStop = false;
-
-  // Mark as playing so other modules can mute/ignore mic during streaming
-  m_state = Mp3PlayerState::Playing;
-  if (m_callback) {
-    m_callback(m_state);
-  }
-
-  BaseType_t ok = xTaskCreatePinnedToCore(pcmStreamTask, "pcm_stream", 6144,
-                                         this, 5, &m_pcmTask, 1);
+  m_pcmFlush = false;
+  m_pcmPacketMode = (decoder != nullptr);
+  m_pcmMaxPacket = decoder ? decoder->maxPacketBytes() : 0;
+  m_pcmDecoder = std::move(decoder);
+
+  m_streamVoice = m_mixer.openStream(kVoiceBufferMs);
+  BaseType_t ok = (m_streamVoice != kNoVoice)
+                      ? xTaskCreatePinnedToCore(pcmStreamTask, "pcm_stream",
+                                                6144, this, 5, &m_pcmTask, 1)
+                      : pdFAIL;
   if (ok != pdPASS) {
+    m_mixer.close(m_streamVoice, true);
+    m_streamVoice = kNoVoice;
+    m_pcmTask = nullptr;
     vStreamBufferDelete(m_pcmStream);
     m_pcmStream = nullptr;
-    m_state = Mp3PlayerState::Idle;
+    if (m_pcmStreamBuf) {
+      heap_caps_free(m_pcmStreamBuf);
+      m_pcmStreamBuf = nullptr;
+    }
+    m_pcmPacketMode = false;
+    m_pcmDecoder.reset();
     return ESP_FAIL;
   }
 
-  ESP_LOGI(TAG, "PCM stream begin: rate=%lu, prebuffer=%lu ms, buf=%u",
+  // Mark as playing so other modules can mute/ignore mic during streaming
+  notifyState();
+
+  ESP_LOGI(TAG, "PCM stream begin: rate=%lu, prebuffer=%lu ms, buf=%u, format=%s",
            (unsigned long)sample_rate_hz, (unsigned long)prebuffer_ms,
-           (unsigned)bufBytes);
+           (unsigned)bufBytes, m_pcmDecoder ? m_pcmDecoder->format() : "pcm");
   return ESP_OK;
 }
 
 esp_err_t Mp3Player::pcmStreamWrite(const uint8_t *data, size_t len,
                                    uint32_t timeout_ms) {
-  if (!m_initialized || !m_pcmStream || !m_pcmTask) {
+  if (!m_initialized || !m_pcmStream || !m_pcmTask || m_pcmFlush) {
     return ESP_ERR_INVALID_STATE;
   }
   if (!data || len == 0) {
     return ESP_ERR_INVALID_ARG;
   }
+  LTRACE_FIRST(TraceEvent::PcmFirstWrite, len);
+  const uint32_t arrivedMs = nowMs(); // 缓冲满时的等待不算网络抖动
 
   TickType_t timeoutTicks = pdMS_TO_TICKS(timeout_ms);
+  if (m_pcmPacketMode) {
+    if (len > m_pcmMaxPacket) {
+      return ESP_ERR_INVALID_SIZE;
+    }
+    // 整包入队：空间不足时等待，超时则丢弃该包
+    if (xMessageBufferSend(m_pcmStream, data, len, timeoutTicks) == 0) {
+      return ESP_ERR_TIMEOUT;
+    }
+    std::lock_guard<std::mutex> lock(m_jitterMutex);
+    m_jitter.onArrival(len, arrivedMs);
+    return ESP_OK;
+  }
   size_t sentTotal = 0;
   while (sentTotal < len) {
+    if (m_pcmFlush) {
+      return ESP_ERR_INVALID_STATE;
+    }
     size_t sent =
         xStreamBufferSend(m_pcmStream, data + sentTotal, len - sentTotal,
                           timeoutTicks);
@@ -582,6 +984,8 @@ esp_err_t Mp3Player::pcmStreamWrite(const uint8_t *data, size_t len,
     }
     sentTotal += sent;
   }
+  std::lock_guard<std::mutex> lock(m_jitterMutex);
+  m_jitter.onArrival(len, arrivedMs);
   return ESP_OK;
 }
 
@@ -596,6 +1000,85 @@ esp_err_t Mp3Player::pcmStreamEnd() {
   return ESP_OK;
 }
 
+esp_err_t Mp3Player::pcmStreamFlush() {
+  if (!m_initialized) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!m_pcmTask) {
+    return ESP_OK;
+  }
+  m_pcmFlush = true;
+  m_pcmStop = true;
+  // 混音器里已排队的几十毫秒也立即丢弃
+  m_mixer.stop(m_streamVoice);
+  return ESP_OK;
+}
+
+// ============= 回声参考 =============
+
+esp_err_t Mp3Player::enableReference(uint32_t sample_rate_hz,
+                                     uint32_t capacity_ms) {
+  if (m_refEnabled.load(std::memory_order_acquire)) {
+    return ESP_OK;
+  }
+  if (sample_rate_hz == 0 || capacity_ms == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  esp_err_t ret =
+      m_refRing.init((size_t)sample_rate_hz * capacity_ms / 1000);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "参考环分配失败");
+    return ret;
+  }
+  m_refRate = sample_rate_hz;
+  resetReferenceResampler(kOutRate);
+  m_refEnabled.store(true, std::memory_order_release);
+  ESP_LOGI(TAG, "AEC reference enabled: %lu Hz, ring=%u samples",
+           (unsigned long)sample_rate_hz, (unsigned)m_refRing.capacity());
+  return ESP_OK;
+}
+
+void Mp3Player::resetReferenceResampler(uint32_t output_rate_hz) {
+  m_refStepQ16 =
+      (uint32_t)(((uint64_t)output_rate_hz << 16) / (m_refRate ? m_refRate : 1));
+  m_refPosQ16 = 0;
+  m_refPrev = 0;
+}
+
+void Mp3Player::tapReference(const int16_t *pcm, size_t frames, int channels) {
+  if (!m_refEnabled.load(std::memory_order_acquire) || pcm == nullptr ||
+      frames == 0) {
+    return;
+  }
+
+  // 线性插值重采样到参考采样率（参考信号只给 AEC 用，不需要高质量滤波）
+  int16_t out[128];
+  size_t n = 0;
+  size_t dropped = 0;
+  for (size_t i = 0; i < frames; i++) {
+    int32_t x = (channels == 2) ? ((int32_t)pcm[2 * i] + pcm[2 * i + 1]) >> 1
+                                : pcm[i];
+    while (m_refPosQ16 < 65536) {
+      int64_t y = m_refPrev +
+                  (((int64_t)(x - m_refPrev) * m_refPosQ16) >> 16);
+      out[n++] = (int16_t)y;
+      m_refPosQ16 += m_refStepQ16;
+      if (n == sizeof(out) / sizeof(out[0])) {
+        dropped += n - m_refRing.write(out, n);
+        n = 0;
+      }
+    }
+    m_refPosQ16 -= 65536;
+    m_refPrev = (int16_t)x;
+  }
+  if (n > 0) {
+    dropped += n - m_refRing.write(out, n);
+  }
+  if (dropped > 0) {
+    m_refRing.noteOverflow();
+  }
+}
+
 esp_err_t Mp3Player::pause() {
   if (!m_initialized) {
     return ESP_ERR_INVALID_STATE;
@@ -614,13 +1097,83 @@ esp_err_t Mp3Player::stop() {
   if (!m_initialized) {
     return ESP_ERR_INVALID_STATE;
   }
-  m_loopEnabled = false;
-  // Also stop any active PCM stream. Keep it non-blocking to match existing
-  // stop() behavior; callers that require synchronization can waitForIdle().
+  // Also stop any active PCM stream and sound effects. Keep it non-blocking
+  // to match existing stop() behavior; callers that require synchronization
+  // can waitForIdle().
   stopPcmStreamInternal(false);
-  return audio_player_stop();
+  m_mixer.stopClips();
+  return stopPlayerInternal();
+}
+
+esp_err_t Mp3Player::stopPlayerInternal() {
+  m_loopEnabled = false;
+  esp_err_t ret = audio_player_stop();
+  // 解码器停下前已送进混音器的部分不再播放
+  m_mixer.flush(m_playerVoice);
+  return ret;
+}
+
+Mp3PlayerState Mp3Player::getState() const {
+  if (m_pcmTask != nullptr || m_mixer.clipCount() > 0) {
+    return Mp3PlayerState::Playing;
+  }
+  return m_playerState;
+}
+
+void Mp3Player::notifyState() {
+  if (m_callback) {
+    m_callback(getState());
+  }
+}
+
+// ============= 混音 voice =============
+
+static int16_t gainToQ15(float gain) {
+  gain = std::min(1.0f, std::max(0.0f, gain));
+  return (int16_t)(gain * (float)AudioMixer::kUnityGain + 0.5f);
+}
+
+MixerVoice Mp3Player::playClip(const int16_t *pcm, size_t frames, int channels,
+                               float gain) {
+  if (!m_initialized) {
+    return kNoVoice;
+  }
+  return m_mixer.playClip(pcm, frames, channels, gainToQ15(gain));
+}
+
+esp_err_t Mp3Player::stopVoice(MixerVoice voice) {
+  if (!m_initialized) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (voice == kNoVoice) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  // 两路常驻来源要连同生产者一起停
+  if (voice == m_playerVoice) {
+    return stopPlayerInternal();
+  }
+  if (voice == m_streamVoice) {
+    return pcmStreamFlush();
+  }
+  return m_mixer.stop(voice);
+}
+
+esp_err_t Mp3Player::setVoiceGain(MixerVoice voice, float gain) {
+  if (!m_initialized) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  return m_mixer.setGain(voice, gainToQ15(gain));
 }
 
+bool Mp3Player::isVoiceActive(MixerVoice voice) const {
+  if (voice == m_playerVoice) {
+    return m_playerState != Mp3PlayerState::Idle;
+  }
+  return m_initialized && m_mixer.active(voice);
+}
+
+uint32_t Mp3Player::outputSampleRate() { return kOutRate; }
+
 void Mp3Player::deinit() {
   if (!m_initialized) {
     return;
@@ -631,13 +1184,18 @@ void Mp3Player::deinit() {
   waitForIdle(3000);
   freeActiveBuffer();
   audio_player_delete();
+  m_mixer.deinit();
+  m_playerVoice = kNoVoice;
 
   if (m_txHandle) {
     i2s_channel_disable(m_txHandle);
     i2s_del_channel(m_txHandle);
     m_txHandle = nullptr;
-    s_txHandle = nullptr;
   }
+  heap_caps_free(m_playerOutBuf);
+  heap_caps_free(m_playerMonoBuf);
+  m_playerOutBuf = nullptr;
+  m_playerMonoBuf = nullptr;
 
   m_initialized = false;
   ESP_LOGI(TAG, "MP3 播放器已释放");
@@ -1,13 +1,23 @@
 #pragma once
 
+#include "audio_codec.h"
+#include "audio_mixer.h"
+#include "audio_ring.h"
+#include "jitter_buffer.h"
+#include "metrics.h"
+#include "resampler.h"
 #include "driver/gpio.h"
 #include "driver/i2s_std.h"
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/stream_buffer.h"
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
 
 /**
  * @brief MP3 播放器状态枚举
@@ -37,6 +47,14 @@ struct Mp3I2sConfig {
  *
  * 基于 esp-audio-player 组件封装的 C++ 接口
  *
+ * I2S 只在 init 时按 CONFIG_AUDIO_OUTPUT_SAMPLE_RATE（16bit 双声道）配置一次，
+ * MP3/WAV 与 PCM 流都经多相重采样器转换到该采样率后写入，切换音源不再
+ * 停启 I2S 通道。
+ *
+ * I2S 由混音器（AudioMixer）独占：MP3/WAV 解码、PCM 流和 playClip() 的
+ * 音效片段各占一个 voice，可以同时发声（如播报中插入提示音）。
+ * getState() 为所有来源的合并状态，任一来源在播放即为 Playing。
+ *
  * @example
  *   auto& player = Mp3Player::instance();
  *   player.init({.bck_io = GPIO_NUM_15, .ws_io = GPIO_NUM_16, .dout_io =
@@ -61,6 +79,9 @@ public:
 
   /**
    * @brief 播放嵌入的 MP3 文件
+   *
+   * 只替换解码器中正在播放的 MP3/WAV，PCM 流与音效片段不受影响。
+   *
    * @param loop 是否循环播放
    * @return ESP_OK 成功
    */
@@ -76,14 +97,25 @@ public:
   /**
    * @brief 开始播放 PCM 流（16-bit little-endian mono），用于低延迟语音对话
    *
-   * @note 会停止当前播放（MP3/WAV），并切换 I2S 时钟到指定采样率。
+   * format 为压缩格式（"adpcm" / "opus"）时流缓冲中保存压缩包，由播放任务
+   * 逐包解码后写入 I2S；同样大小的缓冲可容纳数倍时长的语音。
+   *
+   * 预缓冲由自适应抖动缓冲决定：prebuffer_ms 只是第一条流的起点，之后按
+   * 实测到达抖动与欠载次数在流之间调整（见 getJitterStats()）。
+   *
+   * @note 不再停止 MP3/WAV 播放，二者经混音器叠加；需要独占时先
+   *       stopVoice(playerVoice())。数据由播放任务重采样到 I2S 采样率。
+   * @return ESP_ERR_NOT_SUPPORTED 不支持（或未编译）该格式
    */
-  esp_err_t pcmStreamBegin(uint32_t sample_rate_hz, uint32_t prebuffer_ms = 80);
+  esp_err_t pcmStreamBegin(uint32_t sample_rate_hz, uint32_t prebuffer_ms = 80,
+                           const char *format = "pcm");
 
   /**
    * @brief 写入 PCM 数据（16-bit little-endian mono）
    *
-   * @return ESP_OK 成功；超时/失败会返回错误码
+   * 压缩格式下每次调用写入一个完整的包（整包入队，不会拆分）。
+   *
+   * @return ESP_OK 成功；超时/失败会返回错误码；包超长返回 ESP_ERR_INVALID_SIZE
    */
   esp_err_t pcmStreamWrite(const uint8_t *data, size_t len,
                            uint32_t timeout_ms = 1000);
@@ -93,6 +125,31 @@ public:
    */
   esp_err_t pcmStreamEnd();
 
+  /**
+   * @brief 立即结束 PCM 流并丢弃尚未播放的数据（用于打断播报）
+   *
+   * 播放任务最多再写完当前一块（约 32 ms @16 kHz）就停止；之后的
+   * pcmStreamWrite 直接返回 ESP_ERR_INVALID_STATE。
+   */
+  esp_err_t pcmStreamFlush();
+
+  /**
+   * @brief 传输层测得的网络到达抖动（ms），在 pcmStreamBegin 之前调用
+   *
+   * 只会抬高抖动缓冲的目标水位（之后照常随时间回落）。
+   */
+  void noteNetworkJitter(uint32_t jitter_ms);
+
+  /**
+   * @brief PCM 流抖动缓冲统计：欠载次数、水位直方图、当前目标水位
+   */
+  JitterStats getJitterStats() const;
+
+  /**
+   * @brief 抖动缓冲统计（JSON 对象字符串，供网页 /api/status）
+   */
+  std::string statusJson() const;
+
   /**
    * @brief 暂停播放
    * @return ESP_OK 成功
@@ -106,22 +163,54 @@ public:
   esp_err_t resume();
 
   /**
-   * @brief 停止播放
+   * @brief 停止播放（MP3/WAV、PCM 流与所有音效片段）
    * @return ESP_OK 成功
    */
   esp_err_t stop();
 
   /**
-   * @brief 获取当前状态
+   * @brief 获取当前状态（所有来源合并）
    * @return 当前播放状态
    */
-  Mp3PlayerState getState() const { return m_state; }
+  Mp3PlayerState getState() const;
 
   /**
    * @brief 检查是否正在播放
    * @return true 正在播放
    */
-  bool isPlaying() const { return m_state == Mp3PlayerState::Playing; }
+  bool isPlaying() const { return getState() == Mp3PlayerState::Playing; }
+
+  /**
+   * @brief 在 MP3/WAV、PCM 流之上叠加播放一段 PCM 片段（不打断其他来源）
+   * @param pcm      输出采样率（outputSampleRate()）的 16bit PCM，播放期间须保持有效
+   * @param channels 1 = 单声道，2 = 交织双声道
+   * @param gain     0.0 ~ 1.0
+   * @return voice 句柄；voice 已满时返回 kNoVoice
+   */
+  MixerVoice playClip(const int16_t *pcm, size_t frames, int channels = 1,
+                      float gain = 1.0f);
+
+  /**
+   * @brief 停止单个 voice；playerVoice() / streamVoice() 分别等同于停止
+   *        MP3/WAV 解码与 pcmStreamFlush()
+   */
+  esp_err_t stopVoice(MixerVoice voice);
+
+  /**
+   * @brief 设置 voice 增益（0.0 ~ 1.0），可用于播报时压低背景音乐
+   */
+  esp_err_t setVoiceGain(MixerVoice voice, float gain);
+
+  bool isVoiceActive(MixerVoice voice) const;
+
+  /** MP3/WAV 解码器的常驻 voice */
+  MixerVoice playerVoice() const { return m_playerVoice; }
+
+  /** 当前 PCM 流的 voice（没有流时为 kNoVoice） */
+  MixerVoice streamVoice() const { return m_streamVoice; }
+
+  /** I2S 输出采样率（playClip 的数据须为该采样率） */
+  static uint32_t outputSampleRate();
 
   /**
    * @brief 设置状态回调
@@ -129,6 +218,21 @@ public:
    */
   void setCallback(Mp3PlayerCallback callback) { m_callback = callback; }
 
+  /**
+   * @brief 开启回声消除参考信号：把最终写入 I2S 的音频转成单声道并重采样到
+   *        sample_rate_hz 后写入参考环（由 WakeWord 的 AFE feed 任务消费）
+   * @param sample_rate_hz 参考信号采样率（与麦克风一致）
+   * @param capacity_ms    参考环长度
+   */
+  esp_err_t enableReference(uint32_t sample_rate_hz, uint32_t capacity_ms = 500);
+
+  /**
+   * @brief 参考环（未开启时返回 nullptr）；只允许一个消费者
+   */
+  AudioRing<int16_t> *referenceRing() {
+    return m_refEnabled.load(std::memory_order_acquire) ? &m_refRing : nullptr;
+  }
+
   /**
    * @brief 释放资源
    */
@@ -140,11 +244,15 @@ private:
 
   // I2S 初始化
   esp_err_t initI2s(const Mp3I2sConfig &config);
+  void registerMetrics();
 
   // 启动播放
   esp_err_t startPlayback();
 
   void waitForIdle(uint32_t timeout_ms);
+  void waitForPlayerIdle(uint32_t timeout_ms);
+  esp_err_t stopPlayerInternal();
+  void notifyState();
   void freeActiveBuffer();
 
   // 静态回调函数（用于 audio_player）
@@ -154,34 +262,89 @@ private:
   static esp_err_t i2sWrite(void *audio_buffer, size_t len,
                             size_t *bytes_written, uint32_t timeout_ms);
 
-  // I2S 时钟设置函数
+  // 音源格式变化（只更新重采样器，不动 I2S 时钟）
   static esp_err_t clkSetFn(uint32_t rate, uint32_t bits_cfg,
                             i2s_slot_mode_t ch);
 
+  // 回声参考：把已写入 I2S 的数据转成参考采样率的单声道写入参考环
+  void tapReference(const int16_t *pcm, size_t frames, int channels);
+  void resetReferenceResampler(uint32_t output_rate_hz);
+
   // PCM stream task
   static void pcmStreamTask(void *arg);
   void stopPcmStreamInternal(bool waitIdle);
+  void pcmStreamOutput(const int16_t *mono, size_t samples, int16_t *rsBuf,
+                       uint8_t *outBuf);
+  void pcmStreamSilence(size_t frames, uint8_t *outBuf);
+  size_t jitterTargetBytes();
+  uint32_t jitterTargetMs();
 
   // 成员变量
   bool m_initialized = false;
-  volatile Mp3PlayerState m_state = Mp3PlayerState::Idle;
+  volatile Mp3PlayerState m_playerState = Mp3PlayerState::Idle; // 仅 audio_player
   Mp3PlayerCallback m_callback = nullptr;
   i2s_chan_handle_t m_txHandle = nullptr;
   bool m_loopEnabled = false;
 
+  // 混音器独占 I2S；解码器 voice 常驻，PCM 流每条流一个 voice
+  AudioMixer m_mixer;
+  MixerVoice m_playerVoice = kNoVoice;
+  volatile MixerVoice m_streamVoice = kNoVoice;
+
   enum class Source : uint8_t { EmbeddedMp3 = 0, OwnedBuffer = 1 };
   Source m_source = Source::EmbeddedMp3;
   uint8_t *m_activeBuf = nullptr;
   size_t m_activeBufLen = 0;
 
+  // 音源 -> I2S 采样率（audio_player 任务 / pcm_stream 任务各用一个）
+  PolyphaseResampler m_playerResampler;
+  PolyphaseResampler m_streamResampler;
+  int16_t *m_playerOutBuf = nullptr;  // i2sWrite 双声道输出块
+  int16_t *m_playerMonoBuf = nullptr; // i2sWrite 单声道重采样块
+
   // PCM streaming (input is mono S16LE)
   StreamBufferHandle_t m_pcmStream = nullptr;
   TaskHandle_t m_pcmTask = nullptr;
   volatile bool m_pcmStop = false;
-  size_t m_pcmPrebufferBytes = 0;
+  volatile bool m_pcmFlush = false; // 与 m_pcmStop 一起置位：丢弃剩余数据
+  size_t m_pcmBufferBytes = 0;
   uint32_t m_pcmSampleRate = 16000;
+
+  // 自适应抖动缓冲（写入者记录到达，播放任务决定水位；跨流保留）
+  JitterBuffer m_jitter;
+  mutable std::mutex m_jitterMutex;
+
+  // 压缩下行：m_pcmStream 为 message buffer，每条消息一个包
+  std::unique_ptr<DownlinkDecoder> m_pcmDecoder; // 仅播放任务使用
+  bool m_pcmPacketMode = false;
+  size_t m_pcmMaxPacket = 0;
   
   // PSRAM buffer for static stream buffer (nullptr if using internal RAM)
   uint8_t *m_pcmStreamBuf = nullptr;
   StaticStreamBuffer_t m_pcmStreamStorage;
+
+  // AEC reference（生产者：audio_player 任务或 pcm_stream 任务，二者不会同时写）
+  AudioRing<int16_t> m_refRing;
+  std::atomic<bool> m_refEnabled{false};
+  uint32_t m_refRate = 16000;    // 参考环采样率
+  uint32_t m_refStepQ16 = 65536; // 输出采样率 / 参考采样率（Q16）
+  uint32_t m_refPosQ16 = 65536;  // 线性插值相位
+  int16_t m_refPrev = 0;
+
+  // /api/metrics（采集时读 getJitterStats()，播放路径上不额外计数）
+  MetricCounter m_metricStreams{"dino_player_streams_total",
+                                "PCM streams started",
+                                [this] { return getJitterStats().streams; }};
+  MetricCounter m_metricUnderruns{
+      "dino_player_underruns_total", "PCM stream underruns mid-playback",
+      [this] { return getJitterStats().underruns; }};
+  MetricCounter m_metricConcealedMs{
+      "dino_player_concealed_ms_total", "Silence inserted during underruns",
+      [this] { return getJitterStats().concealed_ms; }};
+  MetricGauge m_metricDepthMs{
+      "dino_player_stream_depth_ms", "Jitter buffer depth at last output",
+      [this] { return (double)getJitterStats().depth_ms; }};
+  MetricGauge m_metricTargetMs{
+      "dino_player_stream_target_ms", "Jitter buffer target depth",
+      [this] { return (double)getJitterStats().target_ms; }};
 };
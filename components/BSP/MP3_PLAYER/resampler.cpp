@@ -0,0 +1,167 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+// 截止频率相对 min(输入, 输出) Nyquist 的比例；Kaiser beta ≈ 70 dB 阻带
+constexpr float kCutoff = 0.92f;
+constexpr float kKaiserBeta = 7.0f;
+constexpr float kPi = 3.14159265358979f;
+
+// 第一类零阶修正 Bessel 函数（级数展开）。系数表在切换采样率时生成，
+// 用 float（S3 有单精度 FPU，double 为软件实现），精度远高于 Q15
+float besselI0(float x) {
+  float sum = 1.0f;
+  float term = 1.0f;
+  const float q = x * x / 4.0f;
+  for (int k = 1; k < 40; k++) {
+    term *= q / ((float)k * (float)k);
+    sum += term;
+    if (term < sum * 1e-8f) {
+      break;
+    }
+  }
+  return sum;
+}
+
+} // namespace
+
+bool PolyphaseResampler::configure(uint32_t inRate, uint32_t outRate,
+                                   int channels) {
+  if (inRate == 0 || outRate == 0 || channels < 1 || channels > kMaxChannels) {
+    return false;
+  }
+  const bool sameShape = m_inRate == inRate && m_outRate == outRate;
+  m_inRate = inRate;
+  m_outRate = outRate;
+  m_channels = channels;
+
+  const uint32_t g = std::gcd(inRate, outRate);
+  m_l = outRate / g;
+  m_m = inRate / g;
+  m_phases = std::min(m_l, kMaxPhases);
+
+  // 降采样时截止频率降低，抽头按比值加长（取偶数）
+  int taps = kTapsPerPhase;
+  if (inRate > outRate) {
+    taps = (int)(((uint64_t)kTapsPerPhase * inRate + outRate - 1) / outRate);
+    taps = std::min(kMaxTaps, (taps + 1) & ~1);
+  }
+  m_taps = taps;
+
+  if (passthrough()) {
+    m_coef.clear();
+    m_coef.shrink_to_fit();
+  } else if (!sameShape || m_coef.empty()) {
+    buildTable();
+  }
+  m_hist.assign((size_t)m_channels * 2 * m_taps, 0);
+  reset();
+  return true;
+}
+
+void PolyphaseResampler::buildTable() {
+  const int taps = m_taps;
+  const float ratio = std::min(1.0f, (float)m_outRate / (float)m_inRate);
+  const float fc = 0.5f * ratio * kCutoff; // 周期 / 输入样本
+  const float half = (float)taps / 2.0f;
+  const float i0Beta = besselI0(kKaiserBeta);
+
+  m_coef.assign((size_t)m_phases * taps, 0);
+  std::vector<float> h(taps);
+  for (uint32_t p = 0; p < m_phases; p++) {
+    // 输出时刻位于窗口内 (taps/2 - 1) + f，tap j 的输入样本距它 x 个采样
+    const float f = (float)p / (float)m_phases;
+    float sum = 0.0f;
+    for (int j = 0; j < taps; j++) {
+      const float x = (half - 1.0f + f) - (float)j;
+      const float t = 2.0f * fc * x;
+      const float sinc =
+          (std::fabs(t) < 1e-6f) ? 1.0f : std::sin(kPi * t) / (kPi * t);
+      const float u = x / half;
+      const float w =
+          (std::fabs(u) >= 1.0f)
+              ? 0.0f
+              : besselI0(kKaiserBeta * std::sqrt(1.0f - u * u)) / i0Beta;
+      h[j] = sinc * w;
+      sum += h[j];
+    }
+    // 每个相位直流增益归一化为 1，避免相位间增益起伏
+    int16_t *row = &m_coef[(size_t)p * taps];
+    for (int j = 0; j < taps; j++) {
+      const long q = std::lround(h[j] / sum * 32768.0f);
+      row[j] = (int16_t)std::max(-32768L, std::min(32767L, q));
+    }
+  }
+}
+
+void PolyphaseResampler::reset() {
+  std::fill(m_hist.begin(), m_hist.end(), 0);
+  m_histPos = 0;
+  m_frac = m_l; // 先取一个输入样本再输出
+}
+
+void PolyphaseResampler::push(const int16_t *frame) {
+  m_histPos = (m_histPos + 1 == m_taps) ? 0 : m_histPos + 1;
+  for (int ch = 0; ch < m_channels; ch++) {
+    int16_t *h = &m_hist[(size_t)ch * 2 * m_taps];
+    h[m_histPos] = frame[ch];
+    h[m_histPos + m_taps] = frame[ch];
+  }
+}
+
+int16_t PolyphaseResampler::dot(const int16_t *coef, int ch) const {
+  // 最近 taps 个样本（旧 -> 新）连续存放在 [pos + 1, pos + taps]
+  const int16_t *x = &m_hist[(size_t)ch * 2 * m_taps + m_histPos + 1];
+  // 各相位 sum|coef| 约 1.1~1.3（Q15），int32 累加不会溢出
+  int32_t acc = 1 << 14;
+  for (int j = 0; j < m_taps; j++) {
+    acc += (int32_t)coef[j] * x[j];
+  }
+  acc >>= 15;
+  return (int16_t)std::max<int32_t>(-32768, std::min<int32_t>(32767, acc));
+}
+
+size_t PolyphaseResampler::process(const int16_t *in, size_t inFrames,
+                                   size_t *consumed, int16_t *out,
+                                   size_t outFrames) {
+  if (passthrough()) {
+    const size_t n = std::min(inFrames, outFrames);
+    memcpy(out, in, n * m_channels * sizeof(int16_t));
+    if (consumed) {
+      *consumed = n;
+    }
+    return n;
+  }
+
+  size_t ip = 0;
+  size_t op = 0;
+  while (op < outFrames) {
+    // 输出位置越过当前样本：先取入足够的输入
+    while (m_frac >= m_l && ip < inFrames) {
+      push(in + ip * m_channels);
+      ip++;
+      m_frac -= m_l;
+    }
+    if (m_frac >= m_l) {
+      break; // 输入用完
+    }
+    const uint32_t phase =
+        (m_phases == m_l) ? m_frac
+                          : (uint32_t)((uint64_t)m_frac * m_phases / m_l);
+    const int16_t *coef = &m_coef[(size_t)phase * m_taps];
+    for (int ch = 0; ch < m_channels; ch++) {
+      out[op * m_channels + ch] = dot(coef, ch);
+    }
+    op++;
+    m_frac += m_m;
+  }
+  if (consumed) {
+    *consumed = ip;
+  }
+  return op;
+}
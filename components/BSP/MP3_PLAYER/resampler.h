@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 定点多相重采样器（纯 C++，不依赖 FreeRTOS / IDF）
+ *
+ * 把任意输入采样率转换到固定输出采样率，使 I2S 只需在初始化时配置一次时钟：
+ *
+ * - 比值化为最简分数 L / M（L = out / g, M = in / g），每个输出样本只计算
+ *   一个相位的 FIR：L <= kMaxPhases 时相位精确，否则取最近相位
+ * - 原型滤波器为 Kaiser 窗 sinc，截止频率取输入 / 输出 Nyquist 中较小者；
+ *   降采样时按比值加长抽头，保证过渡带相对输出 Nyquist 不变
+ * - 系数 Q15（各相位直流增益归一化为 1），int32 累加后四舍五入、饱和
+ * - 输入输出均为 16bit 交织 PCM，最多 2 声道；输入输出同采样率时直通
+ *
+ * 非线程安全，每个生产者各用一个实例。
+ */
+class PolyphaseResampler {
+public:
+  static constexpr int kMaxChannels = 2;
+  static constexpr int kTapsPerPhase = 32; /*!< 不降采样时每相位抽头数 */
+  static constexpr int kMaxTaps = 128;     /*!< 降采样加长后的上限 */
+  static constexpr uint32_t kMaxPhases = 640; /*!< 11.025 kHz -> 48 kHz */
+
+  /**
+   * @brief 配置采样率和声道数，并清空历史
+   * @return false 参数不支持（采样率为 0 / 声道数不为 1、2）
+   */
+  bool configure(uint32_t inRate, uint32_t outRate, int channels);
+
+  /**
+   * @brief 清空滤波历史与相位（同一配置下开始新的一段音频）
+   */
+  void reset();
+
+  uint32_t inRate() const { return m_inRate; }
+  uint32_t outRate() const { return m_outRate; }
+  int channels() const { return m_channels; }
+  bool passthrough() const { return m_inRate == m_outRate; }
+
+  /**
+   * @brief 滤波器群延迟（输入帧）；流结束时再送入这么多帧静音即可输出完整尾部
+   */
+  size_t delayFrames() const { return passthrough() ? 0 : m_taps / 2; }
+
+  /**
+   * @brief 处理 inFrames 帧输入，最多输出 outFrames 帧
+   * @param consumed 实际消耗的输入帧数（输出满时可能小于 inFrames）
+   * @return 输出帧数
+   */
+  size_t process(const int16_t *in, size_t inFrames, size_t *consumed,
+                 int16_t *out, size_t outFrames);
+
+private:
+  void buildTable();
+  void push(const int16_t *frame);
+  int16_t dot(const int16_t *coef, int ch) const;
+
+  uint32_t m_inRate = 0;
+  uint32_t m_outRate = 0;
+  int m_channels = 1;
+
+  uint32_t m_l = 1; // out / g：一个输入样本间隔内的输出相位数
+  uint32_t m_m = 1; // in / g
+  uint32_t m_phases = 1; // 系数表相位数（min(L, kMaxPhases)）
+  int m_taps = kTapsPerPhase;
+  std::vector<int16_t> m_coef; // [phase][tap]，tap 0 对应最旧的历史样本
+
+  // 历史：每声道 2 * taps 的镜像环，最近 taps 个样本总是连续的
+  std::vector<int16_t> m_hist;
+  int m_histPos = 0;
+  uint32_t m_frac = 0; // 当前输出位置的小数部分（分母 L）
+};
@@ -0,0 +1,379 @@
+#include "sfx_cache.h"
+#include "mp3_player.h"
+#include "resampler.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mp3dec.h"
+#include "sdkconfig.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static const char *TAG = "SfxCache";
+
+// 嵌入的 MP3 文件（与 Mp3Player::playEmbedded 共用）
+extern const uint8_t roar_start[] asm("_binary_dinosaur_roar_mp3_start");
+extern const uint8_t roar_end[] asm("_binary_dinosaur_roar_mp3_end");
+
+namespace {
+
+// libhelix 单帧最大输出（交织样本）
+constexpr size_t kMp3MaxSamples = MAX_NCHAN * MAX_NGRAN * MAX_NSAMP;
+// 每次重采样的输出帧数
+constexpr size_t kOutChunkFrames = 512;
+// PSRAM 缓冲按此粒度增长（再在解码结束时收缩到实际大小）
+constexpr size_t kGrowBytes = 64 * 1024;
+
+// 跳过 ID3v2 标签：标签内容可能恰好含有帧同步字
+size_t id3v2Size(const uint8_t *data, size_t len) {
+  if (len < 10 || memcmp(data, "ID3", 3) != 0) {
+    return 0;
+  }
+  // 标签长度为 4 字节 syncsafe 整数（每字节 7 位），不含 10 字节头
+  const size_t size = ((size_t)(data[6] & 0x7F) << 21) |
+                      ((size_t)(data[7] & 0x7F) << 14) |
+                      ((size_t)(data[8] & 0x7F) << 7) | (data[9] & 0x7F);
+  const size_t footer = (data[5] & 0x10) ? 10 : 0;
+  return std::min(len, 10 + size + footer);
+}
+
+// PSRAM 中按需增长的 PCM 缓冲
+struct PcmBuilder {
+  int16_t *data = nullptr;
+  size_t samples = 0;
+  size_t capacity = 0; // 样本数
+
+  bool append(const int16_t *src, size_t n) {
+    if (samples + n > capacity) {
+      const size_t want = std::max(samples + n,
+                                   capacity + kGrowBytes / sizeof(int16_t));
+      auto *p = (int16_t *)heap_caps_realloc(data, want * sizeof(int16_t),
+                                             MALLOC_CAP_SPIRAM);
+      if (!p) {
+        return false;
+      }
+      data = p;
+      capacity = want;
+    }
+    memcpy(data + samples, src, n * sizeof(int16_t));
+    samples += n;
+    return true;
+  }
+
+  void shrink() {
+    if (data && samples < capacity) {
+      auto *p = (int16_t *)heap_caps_realloc(data, samples * sizeof(int16_t),
+                                             MALLOC_CAP_SPIRAM);
+      if (p) {
+        data = p;
+        capacity = samples;
+      }
+    }
+  }
+
+  void release() {
+    heap_caps_free(data);
+    data = nullptr;
+    samples = capacity = 0;
+  }
+};
+
+} // namespace
+
+SfxCache &SfxCache::instance() {
+  static SfxCache instance;
+  return instance;
+}
+
+esp_err_t SfxCache::init() {
+  if (m_initialized) {
+    return ESP_OK;
+  }
+  esp_err_t ret =
+      add(kSfxRoar, roar_start, (size_t)(roar_end - roar_start), true);
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  m_initialized = true;
+
+#if CONFIG_SFX_PRELOAD_AT_BOOT
+  // 解码放到 core 0 的低优先级任务，不拖慢开机，也不和 wake_detect 抢 core 1
+  if (xTaskCreatePinnedToCore(preloadTask, "sfx_preload", 4096, this, 2,
+                              nullptr, 0) != pdPASS) {
+    ESP_LOGW(TAG, "preload task create failed, clips load on first use");
+  }
+#endif
+  return ESP_OK;
+}
+
+void SfxCache::preloadTask(void *arg) {
+  auto *self = static_cast<SfxCache *>(arg);
+  self->loadAll();
+  self->logUsage();
+  vTaskDelete(nullptr);
+}
+
+esp_err_t SfxCache::add(const char *name, const uint8_t *mp3, size_t len,
+                        bool mono) {
+  if (name == nullptr || name[0] == '\0' || mp3 == nullptr || len == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (find(name) != nullptr) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (m_count >= kMaxClips) {
+    ESP_LOGE(TAG, "clip table full, drop %s", name);
+    return ESP_ERR_NO_MEM;
+  }
+  Clip &clip = m_clips[m_count++];
+  clip = Clip{};
+  strncpy(clip.info.name, name, sizeof(clip.info.name) - 1);
+  clip.src = mp3;
+  clip.srcLen = len;
+  clip.mono = mono;
+  return ESP_OK;
+}
+
+SfxCache::Clip *SfxCache::find(const char *name) {
+  for (int i = 0; i < m_count; i++) {
+    if (strncmp(m_clips[i].info.name, name, sizeof(m_clips[i].info.name) - 1) ==
+        0) {
+      return &m_clips[i];
+    }
+  }
+  return nullptr;
+}
+
+const SfxCache::Clip *SfxCache::find(const char *name) const {
+  return const_cast<SfxCache *>(this)->find(name);
+}
+
+esp_err_t SfxCache::load(const char *name) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Clip *clip = find(name);
+  if (clip == nullptr) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  return decode(*clip);
+}
+
+esp_err_t SfxCache::loadAll() {
+  esp_err_t result = ESP_OK;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (int i = 0; i < m_count; i++) {
+    esp_err_t ret = decode(m_clips[i]);
+    if (ret != ESP_OK) {
+      result = ret;
+    }
+  }
+  return result;
+}
+
+esp_err_t SfxCache::decode(Clip &clip) {
+  if (clip.info.loaded) {
+    return ESP_OK;
+  }
+  if (clip.failed) {
+    return ESP_FAIL;
+  }
+  const uint32_t outRate = Mp3Player::outputSampleRate();
+  const int64_t t0 = esp_timer_get_time();
+
+  HMP3Decoder dec = MP3InitDecoder();
+  // 解码输出 + 重采样输出块
+  auto *work = (int16_t *)malloc((kMp3MaxSamples + kOutChunkFrames * 2) *
+                                 sizeof(int16_t));
+  if (dec == nullptr || work == nullptr) {
+    if (dec) {
+      MP3FreeDecoder(dec);
+    }
+    free(work);
+    ESP_LOGE(TAG, "%s: decoder alloc failed", clip.info.name);
+    return ESP_ERR_NO_MEM;
+  }
+  int16_t *frame = work;
+  int16_t *rsOut = work + kMp3MaxSamples;
+
+  PolyphaseResampler rs;
+  PcmBuilder pcm;
+  int channels = 0; // 缓存的声道数，第一帧确定
+  int srcRate = 0;
+  int badFrames = 0;
+  esp_err_t ret = ESP_OK;
+
+  // 重采样一段（帧数为输入采样率下的帧），结果追加到 PSRAM 缓冲
+  auto emit = [&](const int16_t *in, size_t frames) {
+    while (frames > 0 || in == nullptr) {
+      size_t used = 0;
+      const size_t n = rs.process(in, frames, &used, rsOut, kOutChunkFrames);
+      if (n > 0 && !pcm.append(rsOut, n * channels)) {
+        return false;
+      }
+      if (in == nullptr) {
+        return true;
+      }
+      in += used * channels;
+      frames -= used;
+    }
+    return true;
+  };
+
+  const size_t skip = id3v2Size(clip.src, clip.srcLen);
+  // libhelix 只读输入，接口没有 const
+  auto *ptr = const_cast<unsigned char *>(clip.src + skip);
+  int left = (int)(clip.srcLen - skip);
+  while (left > 0) {
+    const int sync = MP3FindSyncWord(ptr, left);
+    if (sync < 0) {
+      break;
+    }
+    ptr += sync;
+    left -= sync;
+    const int err = MP3Decode(dec, &ptr, &left, frame, 0);
+    if (err == ERR_MP3_INDATA_UNDERFLOW) {
+      break;
+    }
+    if (err == ERR_MP3_MAINDATA_UNDERFLOW) {
+      continue; // 比特池数据还不够（开头几帧），继续下一帧
+    }
+    if (err != ERR_MP3_NONE) {
+      // 坏帧：跳过同步字重新找帧
+      badFrames++;
+      ptr++;
+      left--;
+      continue;
+    }
+
+    MP3FrameInfo info;
+    MP3GetLastFrameInfo(dec, &info);
+    if (info.nChans < 1 || info.nChans > 2 || info.outputSamps <= 0) {
+      badFrames++;
+      continue;
+    }
+    if (channels == 0) {
+      srcRate = info.samprate;
+      channels = clip.mono ? 1 : info.nChans;
+      if (!rs.configure((uint32_t)srcRate, outRate, channels)) {
+        ret = ESP_ERR_NOT_SUPPORTED;
+        break;
+      }
+    } else if (info.samprate != srcRate) {
+      ESP_LOGE(TAG, "%s: sample rate changed mid-stream (%d -> %d)",
+               clip.info.name, srcRate, info.samprate);
+      ret = ESP_ERR_NOT_SUPPORTED;
+      break;
+    }
+
+    size_t frames = (size_t)info.outputSamps / info.nChans;
+    if (info.nChans != channels) {
+      if (channels == 1) {
+        // 下混：(L + R) / 2，原地写回
+        for (size_t i = 0; i < frames; i++) {
+          frame[i] = (int16_t)(((int32_t)frame[2 * i] + frame[2 * i + 1]) >> 1);
+        }
+      } else {
+        // 单声道帧出现在双声道流里：复制到两个声道（从尾部往前展开）
+        for (size_t i = frames; i-- > 0;) {
+          frame[2 * i] = frame[2 * i + 1] = frame[i];
+        }
+      }
+    }
+    if (!emit(frame, frames)) {
+      ret = ESP_ERR_NO_MEM;
+      break;
+    }
+  }
+
+  if (ret == ESP_OK && channels == 0) {
+    ESP_LOGE(TAG, "%s: no decodable MP3 frames", clip.info.name);
+    ret = ESP_ERR_INVALID_RESPONSE;
+  }
+  if (ret == ESP_OK) {
+    // 送入群延迟长度的静音，输出滤波器尾部；再取完剩余输出
+    memset(frame, 0, rs.delayFrames() * channels * sizeof(int16_t));
+    if (!emit(frame, rs.delayFrames()) || !emit(nullptr, 0)) {
+      ret = ESP_ERR_NO_MEM;
+    }
+  }
+  MP3FreeDecoder(dec);
+  free(work);
+
+  if (ret != ESP_OK) {
+    pcm.release();
+    clip.failed = true;
+    ESP_LOGE(TAG, "%s: decode failed: %s", clip.info.name,
+             esp_err_to_name(ret));
+    return ret;
+  }
+
+  pcm.shrink();
+  clip.pcm = pcm.data;
+  clip.info.channels = (uint8_t)channels;
+  clip.info.frames = (uint32_t)(pcm.samples / channels);
+  clip.info.bytes = pcm.samples * sizeof(int16_t);
+  clip.info.decode_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+  clip.info.loaded = true;
+  ESP_LOGI(TAG, "%s: %d Hz -> %lu Hz, %d ch, %lu ms, %u bytes, decoded in %lu ms%s",
+           clip.info.name, srcRate, (unsigned long)outRate, channels,
+           (unsigned long)((uint64_t)clip.info.frames * 1000 / outRate),
+           (unsigned)clip.info.bytes, (unsigned long)clip.info.decode_ms,
+           badFrames ? " (some frames skipped)" : "");
+  return ESP_OK;
+}
+
+MixerVoice SfxCache::play(const char *name, float gain) {
+  const int16_t *pcm = nullptr;
+  size_t frames = 0;
+  int channels = 1;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Clip *clip = find(name);
+    if (clip == nullptr) {
+      ESP_LOGW(TAG, "unknown clip: %s", name);
+      return kNoVoice;
+    }
+    if (decode(*clip) != ESP_OK) {
+      return kNoVoice;
+    }
+    pcm = clip->pcm;
+    frames = clip->info.frames;
+    channels = clip->info.channels;
+  }
+  return Mp3Player::instance().playClip(pcm, frames, channels, gain);
+}
+
+size_t SfxCache::memoryUsed() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t total = 0;
+  for (int i = 0; i < m_count; i++) {
+    total += m_clips[i].info.bytes;
+  }
+  return total;
+}
+
+int SfxCache::clipInfo(SfxClipInfo *out, int maxClips) const {
+  if (out == nullptr) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const int n = std::min(m_count, maxClips);
+  for (int i = 0; i < n; i++) {
+    out[i] = m_clips[i].info;
+  }
+  return n;
+}
+
+void SfxCache::logUsage() const {
+  SfxClipInfo infos[kMaxClips];
+  const int n = clipInfo(infos, kMaxClips);
+  size_t total = 0;
+  for (int i = 0; i < n; i++) {
+    ESP_LOGI(TAG, "  %-15s %s %u bytes (%lu frames, %u ch)", infos[i].name,
+             infos[i].loaded ? "loaded " : "pending", (unsigned)infos[i].bytes,
+             (unsigned long)infos[i].frames, (unsigned)infos[i].channels);
+    total += infos[i].bytes;
+  }
+  ESP_LOGI(TAG, "%d clips, %u bytes PSRAM", n, (unsigned)total);
+}
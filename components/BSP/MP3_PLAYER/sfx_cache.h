@@ -0,0 +1,114 @@
+#pragma once
+
+#include "audio_mixer.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/** 内置音效：嵌入固件的 dinosaur-roar.mp3 */
+constexpr const char *kSfxRoar = "roar";
+
+/**
+ * @brief 单个音效的缓存信息
+ */
+struct SfxClipInfo {
+  char name[16] = {};
+  bool loaded = false;   /*!< 已解码进 PSRAM */
+  uint8_t channels = 0;  /*!< 缓存的声道数 */
+  uint32_t frames = 0;   /*!< 输出采样率下的帧数 */
+  size_t bytes = 0;      /*!< 占用的 PSRAM 字节 */
+  uint32_t decode_ms = 0; /*!< 解码 + 重采样耗时 */
+};
+
+/**
+ * @brief 预解码音效缓存（单例模式）
+ *
+ * 注册的 MP3 只解码一次（开机预加载或首次播放时），经重采样转换到
+ * I2S 输出采样率后以 PCM 存在 PSRAM；播放时直接交给混音器的片段 voice，
+ * 不再经过 audio_player 的 fmemopen + 解码，启动延迟只剩一个 DMA 块，
+ * 也不占 core 1（wake_detect 所在核）的解码 CPU。
+ *
+ * 缓存的 PCM 在注册期间一直有效（不提供卸载），片段 voice 可以直接引用。
+ */
+class SfxCache {
+public:
+  static constexpr int kMaxClips = 8;
+
+  static SfxCache &instance();
+
+  SfxCache(const SfxCache &) = delete;
+  SfxCache &operator=(const SfxCache &) = delete;
+
+  /**
+   * @brief 注册内置音效；开启 CONFIG_SFX_PRELOAD_AT_BOOT 时在后台任务中解码
+   * @note 须在 Mp3Player::init() 之后调用（输出采样率由播放器决定）
+   */
+  esp_err_t init();
+
+  /**
+   * @brief 注册一个 MP3 音效（只登记，不解码）
+   * @param mp3  须在整个运行期间有效（如 EMBED_FILES）
+   * @param mono 下混为单声道缓存（内存减半，扬声器为单声道时无损失）
+   * @return ESP_ERR_NO_MEM 表已满；ESP_ERR_INVALID_STATE 同名已注册
+   */
+  esp_err_t add(const char *name, const uint8_t *mp3, size_t len,
+                bool mono = true);
+
+  /**
+   * @brief 解码指定音效（已加载时直接返回 ESP_OK）
+   */
+  esp_err_t load(const char *name);
+
+  /**
+   * @brief 解码所有尚未加载的音效
+   */
+  esp_err_t loadAll();
+
+  /**
+   * @brief 播放音效（未加载时先同步解码）
+   * @return voice 句柄，可用 Mp3Player::stopVoice() 停止；失败返回 kNoVoice
+   */
+  MixerVoice play(const char *name, float gain = 1.0f);
+
+  /**
+   * @brief 已加载音效占用的 PSRAM 总字节
+   */
+  size_t memoryUsed() const;
+
+  /**
+   * @brief 各音效的缓存信息
+   * @return 写入 out 的条数
+   */
+  int clipInfo(SfxClipInfo *out, int maxClips) const;
+
+  /**
+   * @brief 打印每个音效的内存占用
+   */
+  void logUsage() const;
+
+private:
+  SfxCache() = default;
+  ~SfxCache() = default;
+
+  struct Clip {
+    SfxClipInfo info;
+    const uint8_t *src = nullptr;
+    size_t srcLen = 0;
+    bool mono = true;
+    bool failed = false; // 解码失败后不再重试
+    int16_t *pcm = nullptr;
+  };
+
+  static void preloadTask(void *arg);
+  Clip *find(const char *name);
+  const Clip *find(const char *name) const;
+  esp_err_t decode(Clip &clip);
+
+  mutable std::mutex m_mutex; // 保护 m_clips（解码期间持有）
+  Clip m_clips[kMaxClips];
+  int m_count = 0;
+  bool m_initialized = false;
+};
@@ -0,0 +1,292 @@
+#include "wav_stream.h"
+#include "esp_log.h"
+#include "mp3_player.h"
+#include <algorithm>
+#include <cstring>
+
+static const char *TAG = "WavStream";
+
+namespace {
+
+uint16_t le16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+uint32_t le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+constexpr uint16_t kWavePcm = 1;
+constexpr uint16_t kWaveExtensible = 0xFFFE;
+
+} // namespace
+
+// ============= WavStreamParser =============
+
+void WavStreamParser::reset() { *this = WavStreamParser(); }
+
+void WavStreamParser::fail(const char *why) {
+  m_state = State::Error;
+  m_error = why;
+}
+
+bool WavStreamParser::gather(const uint8_t *in, size_t len, size_t need,
+                             size_t *used) {
+  const size_t n = std::min(len, need - m_hdrLen);
+  memcpy(m_hdr + m_hdrLen, in, n);
+  m_hdrLen += n;
+  *used += n;
+  return m_hdrLen == need;
+}
+
+void WavStreamParser::parseFmt() {
+  m_format.format_tag = le16(m_hdr);
+  m_format.channels = le16(m_hdr + 2);
+  m_format.sample_rate = le32(m_hdr + 4);
+  m_format.block_align = le16(m_hdr + 12);
+  m_format.bits_per_sample = le16(m_hdr + 14);
+  // WAVE_FORMAT_EXTENSIBLE：真实格式在子格式 GUID 的前两个字节
+  if (m_format.format_tag == kWaveExtensible && m_hdrLen >= 26) {
+    m_format.format_tag = le16(m_hdr + 24);
+  }
+  m_haveFmt = true;
+}
+
+size_t WavStreamParser::feed(const uint8_t *in, size_t len,
+                             const uint8_t **pcm, size_t *pcmLen) {
+  *pcm = nullptr;
+  *pcmLen = 0;
+  size_t used = 0;
+  while (used < len) {
+    switch (m_state) {
+    case State::Riff:
+      if (!gather(in + used, len - used, 12, &used)) {
+        break;
+      }
+      if (memcmp(m_hdr, "RIFF", 4) != 0 || memcmp(m_hdr + 8, "WAVE", 4) != 0) {
+        fail("not a RIFF/WAVE stream");
+        return len;
+      }
+      m_hdrLen = 0;
+      m_state = State::ChunkHeader;
+      break;
+
+    case State::ChunkHeader: {
+      if (!gather(in + used, len - used, 8, &used)) {
+        break;
+      }
+      const uint32_t size = le32(m_hdr + 4);
+      m_hdrLen = 0;
+      if (memcmp(m_hdr, "fmt ", 4) == 0) {
+        if (size < 16) {
+          fail("fmt chunk too short");
+          return len;
+        }
+        m_chunkLeft = size;
+        m_pad = (size & 1) != 0;
+        m_state = State::Fmt;
+      } else if (memcmp(m_hdr, "data", 4) == 0) {
+        if (!m_haveFmt) {
+          fail("data chunk before fmt");
+          return len;
+        }
+        m_unbounded = (size == 0 || size == 0xFFFFFFFFu);
+        m_chunkLeft = size;
+        m_state = State::Data;
+      } else {
+        // LIST / fact 等：跳过（含奇数长度的填充字节）
+        m_chunkLeft = size + (size & 1);
+        m_state = m_chunkLeft ? State::Skip : State::ChunkHeader;
+      }
+      break;
+    }
+
+    case State::Fmt: {
+      const size_t n = std::min((size_t)m_chunkLeft, len - used);
+      const size_t keep = std::min(n, sizeof(m_hdr) - m_hdrLen);
+      memcpy(m_hdr + m_hdrLen, in + used, keep);
+      m_hdrLen += keep;
+      used += n;
+      m_chunkLeft -= (uint32_t)n;
+      if (m_chunkLeft == 0) {
+        parseFmt();
+        m_hdrLen = 0;
+        m_chunkLeft = m_pad ? 1 : 0;
+        m_state = m_pad ? State::Skip : State::ChunkHeader;
+      }
+      break;
+    }
+
+    case State::Skip: {
+      const size_t n = std::min((size_t)m_chunkLeft, len - used);
+      used += n;
+      m_chunkLeft -= (uint32_t)n;
+      if (m_chunkLeft == 0) {
+        m_state = State::ChunkHeader;
+      }
+      break;
+    }
+
+    case State::Data: {
+      size_t n = len - used;
+      if (!m_unbounded) {
+        n = std::min(n, (size_t)m_chunkLeft);
+        m_chunkLeft -= (uint32_t)n;
+        if (m_chunkLeft == 0) {
+          m_state = State::Done;
+        }
+      }
+      *pcm = in + used;
+      *pcmLen = n;
+      return used + n;
+    }
+
+    case State::Done:
+    case State::Error:
+      return len;
+    }
+  }
+  return used;
+}
+
+// ============= WavStreamPlayer =============
+
+WavStreamPlayer::~WavStreamPlayer() {
+  if (m_started && !m_closed) {
+    Mp3Player::instance().pcmStreamEnd();
+  }
+}
+
+esp_err_t WavStreamPlayer::begin() {
+  const WavFormat &fmt = m_parser.format();
+  if (fmt.format_tag != kWavePcm || fmt.bits_per_sample != 16 ||
+      fmt.channels < 1 || fmt.channels > 2 || fmt.sample_rate < 8000 ||
+      fmt.sample_rate > 48000) {
+    ESP_LOGE(TAG, "unsupported wav: tag=%u ch=%u rate=%lu bits=%u",
+             (unsigned)fmt.format_tag, (unsigned)fmt.channels,
+             (unsigned long)fmt.sample_rate, (unsigned)fmt.bits_per_sample);
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  esp_err_t err =
+      Mp3Player::instance().pcmStreamBegin(fmt.sample_rate, m_prebufferMs);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "pcmStreamBegin failed: %s", esp_err_to_name(err));
+    return err;
+  }
+  ESP_LOGI(TAG, "streaming wav: %lu Hz, %u ch", (unsigned long)fmt.sample_rate,
+           (unsigned)fmt.channels);
+  m_started = true;
+  return ESP_OK;
+}
+
+esp_err_t WavStreamPlayer::write(const uint8_t *data, size_t len,
+                                 uint32_t timeoutMs) {
+  if (m_closed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  while (len > 0) {
+    const uint8_t *pcm = nullptr;
+    size_t pcmLen = 0;
+    const size_t used = m_parser.feed(data, len, &pcm, &pcmLen);
+    data += used;
+    len -= used;
+    if (m_parser.failed()) {
+      ESP_LOGE(TAG, "bad wav stream: %s", m_parser.error());
+      return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (pcmLen == 0) {
+      continue;
+    }
+    if (!m_started) {
+      esp_err_t err = begin();
+      if (err != ESP_OK) {
+        m_closed = true;
+        return err;
+      }
+    }
+    esp_err_t err = writePcm(pcm, pcmLen, timeoutMs);
+    if (err != ESP_OK) {
+      return err;
+    }
+  }
+  return ESP_OK;
+}
+
+esp_err_t WavStreamPlayer::writePcm(const uint8_t *p, size_t n,
+                                    uint32_t timeoutMs) {
+  const size_t frameBytes = (size_t)m_parser.format().channels * 2;
+  m_pcmBytes += n;
+
+  // 先补齐上一片剩下的半帧
+  if (m_carryLen > 0) {
+    const size_t take = std::min(n, frameBytes - m_carryLen);
+    memcpy(m_carry + m_carryLen, p, take);
+    m_carryLen += take;
+    p += take;
+    n -= take;
+    if (m_carryLen < frameBytes) {
+      return ESP_OK;
+    }
+    m_carryLen = 0;
+    esp_err_t err = writeFrames(m_carry, 1, timeoutMs);
+    if (err != ESP_OK) {
+      return err;
+    }
+  }
+
+  const size_t frames = n / frameBytes;
+  esp_err_t err = writeFrames(p, frames, timeoutMs);
+  const size_t rest = n - frames * frameBytes;
+  memcpy(m_carry, p + frames * frameBytes, rest);
+  m_carryLen = rest;
+  return err;
+}
+
+esp_err_t WavStreamPlayer::writeFrames(const uint8_t *p, size_t frames,
+                                       uint32_t timeoutMs) {
+  if (frames == 0) {
+    return ESP_OK;
+  }
+  auto &player = Mp3Player::instance();
+  if (m_parser.format().channels == 1) {
+    return player.pcmStreamWrite(p, frames * 2, timeoutMs);
+  }
+  // 双声道：(L + R) / 2 下混（输入可能不对齐，按字节取样本）
+  while (frames > 0) {
+    const size_t n = std::min(frames, kMonoChunk);
+    for (size_t i = 0; i < n; i++) {
+      const int32_t l = (int16_t)le16(p + 4 * i);
+      const int32_t r = (int16_t)le16(p + 4 * i + 2);
+      m_mono[i] = (int16_t)((l + r) >> 1);
+    }
+    esp_err_t err = player.pcmStreamWrite(
+        reinterpret_cast<const uint8_t *>(m_mono), n * sizeof(int16_t),
+        timeoutMs);
+    if (err != ESP_OK) {
+      return err;
+    }
+    p += n * 4;
+    frames -= n;
+  }
+  return ESP_OK;
+}
+
+esp_err_t WavStreamPlayer::finish() {
+  if (m_closed) {
+    return m_started ? ESP_OK : ESP_ERR_INVALID_STATE;
+  }
+  m_closed = true;
+  if (!m_started) {
+    // 整个响应里都没等到 data 块
+    ESP_LOGE(TAG, "no audio in response (%s)",
+             m_parser.failed() ? m_parser.error() : "truncated wav header");
+    return ESP_ERR_INVALID_RESPONSE;
+  }
+  return Mp3Player::instance().pcmStreamEnd();
+}
+
+void WavStreamPlayer::abort() {
+  if (m_started && !m_closed) {
+    Mp3Player::instance().pcmStreamFlush();
+  }
+  m_closed = true;
+}
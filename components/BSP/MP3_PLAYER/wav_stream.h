@@ -0,0 +1,132 @@
+#pragma once
+
+#include "esp_err.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief WAV fmt 块中播放需要的字段
+ */
+struct WavFormat {
+  uint16_t format_tag = 0;      /*!< 1 = PCM（WAVE_FORMAT_EXTENSIBLE 已按子格式换算） */
+  uint16_t channels = 0;
+  uint32_t sample_rate = 0;
+  uint16_t bits_per_sample = 0;
+  uint16_t block_align = 0;     /*!< 每帧字节数 */
+};
+
+/**
+ * @brief 增量 RIFF/WAVE 解析器（纯 C++，不依赖 FreeRTOS / IDF）
+ *
+ * 按任意大小的分片喂入 HTTP 响应体：头部（RIFF、fmt、LIST 等块）在内部
+ * 累积解析，到达 data 块后 feed() 直接返回指向输入缓冲的 PCM 片段，
+ * 不复制、不缓存整段音频。
+ *
+ * data 块长度为 0 或 0xFFFFFFFF（流式合成时服务端还不知道总长）时，
+ * 视为一直延续到响应结束。
+ */
+class WavStreamParser {
+public:
+  enum class State : uint8_t {
+    Riff = 0,    /*!< 等待 12 字节 RIFF 头 */
+    ChunkHeader, /*!< 等待 8 字节块头 */
+    Fmt,         /*!< 读取 fmt 块 */
+    Skip,        /*!< 跳过无关块 */
+    Data,        /*!< PCM 数据 */
+    Done,        /*!< data 块结束，其后的字节忽略 */
+    Error
+  };
+
+  /**
+   * @brief 消费输入
+   * @param pcm    输出：本次返回的 PCM 片段（指向 in 内部），没有时为 nullptr
+   * @param pcmLen 输出：PCM 片段字节数
+   * @return 消费的字节数；每次最多返回一个 PCM 片段，调用方循环直到消费完
+   */
+  size_t feed(const uint8_t *in, size_t len, const uint8_t **pcm,
+              size_t *pcmLen);
+
+  void reset();
+
+  State state() const { return m_state; }
+  bool inData() const { return m_state == State::Data; }
+  bool failed() const { return m_state == State::Error; }
+  /** 已解析出格式（进入 data 块） */
+  bool ready() const { return m_state == State::Data || m_state == State::Done; }
+  const WavFormat &format() const { return m_format; }
+  /** 失败原因（failed() 时有效） */
+  const char *error() const { return m_error; }
+
+private:
+  bool gather(const uint8_t *in, size_t len, size_t need, size_t *used);
+  void fail(const char *why);
+  void parseFmt();
+
+  State m_state = State::Riff;
+  uint8_t m_hdr[40] = {};  // RIFF 头 / 块头 / fmt 块前 40 字节
+  size_t m_hdrLen = 0;
+  uint32_t m_chunkLeft = 0; // 当前块剩余字节（Fmt / Skip / Data）
+  bool m_pad = false;       // 奇数长度块后的填充字节
+  bool m_unbounded = false; // data 块延续到响应结束
+  bool m_haveFmt = false;
+  WavFormat m_format;
+  const char *m_error = nullptr;
+};
+
+/**
+ * @brief 把 HTTP 返回的 WAV 边下载边送进 Mp3Player 的 PCM 流
+ *
+ * 解析到 data 块即 pcmStreamBegin()，之后每个分片立即 pcmStreamWrite()，
+ * 首包延迟只剩合成首段 + 抖动缓冲，不再等整段下载。支持 16bit PCM
+ * 单声道 / 双声道（双声道下混为单声道），采样率由播放器重采样。
+ *
+ * 只允许一个任务使用；对象可放在调用方栈上（约 0.6 KB）。
+ */
+class WavStreamPlayer {
+public:
+  explicit WavStreamPlayer(uint32_t prebufferMs = 80)
+      : m_prebufferMs(prebufferMs) {}
+  ~WavStreamPlayer();
+
+  WavStreamPlayer(const WavStreamPlayer &) = delete;
+  WavStreamPlayer &operator=(const WavStreamPlayer &) = delete;
+
+  /**
+   * @brief 写入一段响应体
+   * @return ESP_ERR_INVALID_RESPONSE 不是 WAV；ESP_ERR_NOT_SUPPORTED
+   *         编码不是 16bit PCM；其他为 pcmStreamBegin / pcmStreamWrite 的错误
+   */
+  esp_err_t write(const uint8_t *data, size_t len, uint32_t timeoutMs = 2000);
+
+  /**
+   * @brief 响应结束：已开始播放则 pcmStreamEnd()（缓冲播完后回到 Idle）
+   * @return ESP_ERR_INVALID_RESPONSE 响应里没有完整的 WAV 头
+   */
+  esp_err_t finish();
+
+  /**
+   * @brief 放弃：丢弃尚未播放的数据
+   */
+  void abort();
+
+  bool started() const { return m_started; }
+  /** 已送进播放器的 PCM 字节（下混前） */
+  size_t pcmBytes() const { return m_pcmBytes; }
+  const WavFormat &format() const { return m_parser.format(); }
+
+private:
+  esp_err_t begin();
+  esp_err_t writePcm(const uint8_t *p, size_t n, uint32_t timeoutMs);
+  esp_err_t writeFrames(const uint8_t *p, size_t frames, uint32_t timeoutMs);
+
+  static constexpr size_t kMonoChunk = 256;
+
+  WavStreamParser m_parser;
+  uint32_t m_prebufferMs;
+  bool m_started = false;
+  bool m_closed = false;
+  size_t m_pcmBytes = 0;
+  uint8_t m_carry[4] = {}; // 跨分片的不完整帧
+  size_t m_carryLen = 0;
+  int16_t m_mono[kMonoChunk]; // 双声道下混缓冲
+};
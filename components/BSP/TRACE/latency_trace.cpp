@@ -0,0 +1,300 @@
+#include "latency_trace.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+static const char *TAG = "LatencyTrace";
+
+namespace {
+
+struct EventInfo {
+  const char *name;
+  int tid; // Chrome trace 中的一条轨道
+};
+
+constexpr int kTidCapture = 1;
+constexpr int kTidAfe = 2;
+constexpr int kTidNet = 3;
+constexpr int kTidPlayer = 4;
+constexpr int kTidTurn = 5;
+
+constexpr EventInfo kEventInfo[] = {
+    {"i2s_read", kTidCapture},      {"afe_fetch", kTidAfe},
+    {"frame_cb", kTidAfe},          {"ws_send_audio", kTidNet},
+    {"ws_listen_stop", kTidNet},    {"tts_start", kTidNet},
+    {"tts_first_binary", kTidNet},  {"pcm_first_write", kTidPlayer},
+    {"i2s_first_write", kTidPlayer}, {"http_upload", kTidNet},
+    {"barge_in", kTidAfe},          {"pcm_flushed", kTidPlayer},
+    {"pcm_underrun", kTidPlayer},
+};
+static_assert(sizeof(kEventInfo) / sizeof(kEventInfo[0]) ==
+                  (size_t)TraceEvent::Count,
+              "kEventInfo must match TraceEvent");
+
+// 每个轮次的关键节点（按链路顺序）
+constexpr TraceEvent kMilestones[] = {
+    TraceEvent::WsListenStop,   TraceEvent::HttpUpload,
+    TraceEvent::TtsStart,       TraceEvent::TtsFirstBinary,
+    TraceEvent::PcmFirstWrite,  TraceEvent::I2sFirstWrite,
+};
+constexpr size_t kMilestoneCount = sizeof(kMilestones) / sizeof(kMilestones[0]);
+
+struct TurnMarks {
+  uint16_t turn = 0;
+  int64_t ts[kMilestoneCount] = {};
+};
+
+struct Record {
+  uint8_t event;
+  uint16_t turn;
+  uint32_t arg;
+  int64_t ts_us;
+};
+
+// 攒够一块再交给回调，避免每个事件一次 httpd chunk
+class ChunkWriter {
+public:
+  explicit ChunkWriter(
+      const std::function<esp_err_t(const char *, size_t)> &write)
+      : m_write(write) {}
+
+  void append(const char *s, size_t n) {
+    if (m_err != ESP_OK) {
+      return;
+    }
+    if (m_len + n > sizeof(m_buf)) {
+      flush();
+    }
+    if (n > sizeof(m_buf)) {
+      m_err = m_write(s, n);
+      return;
+    }
+    memcpy(m_buf + m_len, s, n);
+    m_len += n;
+  }
+
+  void appendf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char line[192];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+      append(line, std::min((size_t)n, sizeof(line) - 1));
+    }
+  }
+
+  esp_err_t flush() {
+    if (m_err == ESP_OK && m_len > 0) {
+      m_err = m_write(m_buf, m_len);
+    }
+    m_len = 0;
+    return m_err;
+  }
+
+private:
+  const std::function<esp_err_t(const char *, size_t)> &m_write;
+  char m_buf[1024];
+  size_t m_len = 0;
+  esp_err_t m_err = ESP_OK;
+};
+
+} // namespace
+
+LatencyTrace &LatencyTrace::instance() {
+  static LatencyTrace instance;
+  return instance;
+}
+
+const char *LatencyTrace::eventName(TraceEvent ev) {
+  size_t i = (size_t)ev;
+  return i < (size_t)TraceEvent::Count ? kEventInfo[i].name : "unknown";
+}
+
+esp_err_t LatencyTrace::init(size_t capacity) {
+  if (m_slots != nullptr) {
+    return ESP_OK;
+  }
+  size_t cap = 64;
+  while (cap < capacity) {
+    cap <<= 1;
+  }
+
+  void *mem = heap_caps_calloc(cap, sizeof(Slot), MALLOC_CAP_SPIRAM);
+  if (mem == nullptr) {
+    mem = heap_caps_calloc(cap, sizeof(Slot),
+                           MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  if (mem == nullptr) {
+    ESP_LOGE(TAG, "无法分配 trace 缓冲 (%u 条)", (unsigned)cap);
+    return ESP_ERR_NO_MEM;
+  }
+
+  Slot *slots = static_cast<Slot *>(mem);
+  for (size_t i = 0; i < cap; i++) {
+    new (&slots[i].seq) std::atomic<uint32_t>(0);
+  }
+  m_mask = (uint32_t)(cap - 1);
+  m_writeIdx.store(0, std::memory_order_relaxed);
+  m_slots = slots;
+  ESP_LOGI(TAG, "Latency trace ready: %u events (%u bytes)", (unsigned)cap,
+           (unsigned)(cap * sizeof(Slot)));
+  return ESP_OK;
+}
+
+void LatencyTrace::store(TraceEvent ev, uint32_t arg, uint16_t turn) {
+  uint32_t idx = m_writeIdx.fetch_add(1, std::memory_order_relaxed);
+  Slot &s = m_slots[idx & m_mask];
+  // seqlock：先作废，再写字段，最后发布序号
+  s.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  s.event = (uint8_t)ev;
+  s.turn = turn;
+  s.arg = arg;
+  s.ts_us = esp_timer_get_time();
+  s.seq.store(idx + 1, std::memory_order_release);
+}
+
+void LatencyTrace::record(TraceEvent ev, uint32_t arg) {
+  if (m_slots == nullptr) {
+    return;
+  }
+  store(ev, arg, m_turn.load(std::memory_order_relaxed));
+}
+
+void LatencyTrace::recordFirst(TraceEvent ev, uint32_t arg) {
+  if (m_slots == nullptr) {
+    return;
+  }
+  uint32_t bit = 1u << (uint32_t)ev;
+  if (m_firstMask.fetch_or(bit, std::memory_order_relaxed) & bit) {
+    return;
+  }
+  store(ev, arg, m_turn.load(std::memory_order_relaxed));
+}
+
+void LatencyTrace::beginTurn() {
+  m_turn.fetch_add(1, std::memory_order_relaxed);
+  m_firstMask.store(0, std::memory_order_relaxed);
+}
+
+void LatencyTrace::clear() {
+  if (m_slots == nullptr) {
+    return;
+  }
+  for (uint32_t i = 0; i <= m_mask; i++) {
+    m_slots[i].seq.store(0, std::memory_order_relaxed);
+  }
+}
+
+esp_err_t LatencyTrace::exportChromeTrace(
+    const std::function<esp_err_t(const char *, size_t)> &write) {
+  if (!write) {
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  // 先把当前窗口拷出来（不阻塞生产者；被并发覆盖的槽位直接跳过）
+  Record *records = nullptr;
+  size_t numRecords = 0;
+  if (m_slots != nullptr) {
+    uint32_t end = m_writeIdx.load(std::memory_order_acquire);
+    uint32_t cap = m_mask + 1;
+    uint32_t begin = (end > cap) ? end - cap : 0;
+    size_t bytes = (size_t)(end - begin) * sizeof(Record);
+    records = (Record *)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (records == nullptr) {
+      records = (Record *)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL |
+                                                      MALLOC_CAP_8BIT);
+    }
+    if (records == nullptr && end != begin) {
+      return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = begin; i != end; i++) {
+      const Slot &s = m_slots[i & m_mask];
+      uint32_t seq = s.seq.load(std::memory_order_acquire);
+      if (seq != i + 1) {
+        continue;
+      }
+      Record r = {s.event, s.turn, s.arg, s.ts_us};
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (s.seq.load(std::memory_order_relaxed) != seq ||
+          r.event >= (uint8_t)TraceEvent::Count) {
+        continue;
+      }
+      records[numRecords++] = r;
+    }
+  }
+
+  ChunkWriter out(write);
+  out.appendf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  const char *tracks[] = {"", "capture", "afe", "net", "player", "turn"};
+  for (int tid = kTidCapture; tid <= kTidTurn; tid++) {
+    out.appendf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                tid == kTidCapture ? "" : ",", tid, tracks[tid]);
+  }
+
+  std::vector<TurnMarks> turns;
+  for (size_t i = 0; i < numRecords; i++) {
+    const Record &r = records[i];
+    const EventInfo &info = kEventInfo[r.event];
+    out.appendf(",{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+                "\"tid\":%d,\"ts\":%" PRId64
+                ",\"args\":{\"arg\":%" PRIu32 ",\"turn\":%u}}",
+                info.name, info.tid, r.ts_us, r.arg, (unsigned)r.turn);
+
+    for (size_t m = 0; m < kMilestoneCount; m++) {
+      if ((TraceEvent)r.event != kMilestones[m]) {
+        continue;
+      }
+      TurnMarks *t = nullptr;
+      for (auto &it : turns) {
+        if (it.turn == r.turn) {
+          t = &it;
+          break;
+        }
+      }
+      if (t == nullptr) {
+        turns.push_back(TurnMarks{});
+        t = &turns.back();
+        t->turn = r.turn;
+      }
+      if (t->ts[m] == 0) {
+        t->ts[m] = r.ts_us;
+      }
+    }
+  }
+
+  // 每个轮次：相邻关键节点之间画一段耗时，直接看出时间花在设备/网络/代理哪一段
+  for (const auto &t : turns) {
+    int prev = -1;
+    for (size_t m = 0; m < kMilestoneCount; m++) {
+      if (t.ts[m] == 0) {
+        continue;
+      }
+      if (prev >= 0 && t.ts[m] >= t.ts[prev]) {
+        out.appendf(",{\"name\":\"%s->%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%" PRId64 ",\"dur\":%" PRId64
+                    ",\"args\":{\"turn\":%u}}",
+                    eventName(kMilestones[prev]), eventName(kMilestones[m]),
+                    kTidTurn, t.ts[prev], t.ts[m] - t.ts[prev],
+                    (unsigned)t.turn);
+      }
+      prev = (int)m;
+    }
+  }
+
+  heap_caps_free(records);
+
+  out.appendf("]}");
+  return out.flush();
+}
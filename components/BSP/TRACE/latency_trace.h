@@ -0,0 +1,119 @@
+#pragma once
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ * @brief 链路打点事件（I2S 采集 -> 上云 -> 播报）
+ *
+ * 标注 "first" 的事件每个对话轮次只记录第一次（见 LatencyTrace::beginTurn）。
+ */
+enum class TraceEvent : uint8_t {
+  I2sReadDone = 0, /*!< 采集任务 i2s_channel_read 返回，arg=样本数 */
+  AfeFetch,        /*!< AFE fetch 返回，arg=vad_state */
+  FrameCallback,   /*!< 对话帧回调开始，arg=样本数 */
+  WsSendAudio,     /*!< WebSocketChat::sendAudio，arg=字节数 */
+  WsListenStop,    /*!< 发送 listen stop（开启新轮次） */
+  TtsStart,        /*!< first: 收到 tts start JSON */
+  TtsFirstBinary,  /*!< first: 收到第一帧二进制 TTS 音频，arg=字节数 */
+  PcmFirstWrite,   /*!< first: 第一次 pcmStreamWrite，arg=字节数 */
+  I2sFirstWrite,   /*!< first: 播放任务第一次写 I2S，arg=字节数 */
+  HttpUpload,      /*!< HTTP 模式提交整句上传（开启新轮次），arg=样本数 */
+  BargeIn,         /*!< 用户打断播报，arg=0 语音 / 1 唤醒词 */
+  PcmFlushed,      /*!< 打断后 PCM 播放任务退出，arg=丢弃字节数 */
+  PcmUnderrun,     /*!< PCM 流播放中途读空，arg=调整后的目标水位 (ms) */
+  Count
+};
+
+/**
+ * @brief 固定大小、无锁（多生产者）的时间戳事件环形缓冲
+ *
+ * - record() 只做一次 fetch_add + 写一个槽位，可在任意任务中调用
+ * - 满了之后覆盖最旧的记录
+ * - exportChromeTrace() 输出 Chrome trace JSON（chrome://tracing / Perfetto）
+ *
+ * @example
+ *   LatencyTrace::instance().init(2048);
+ *   LTRACE(TraceEvent::AfeFetch, vad);
+ *   LTRACE_FIRST(TraceEvent::TtsStart, 0);
+ */
+class LatencyTrace {
+public:
+  static LatencyTrace &instance();
+
+  LatencyTrace(const LatencyTrace &) = delete;
+  LatencyTrace &operator=(const LatencyTrace &) = delete;
+
+  /**
+   * @brief 分配缓冲（优先 PSRAM）
+   * @param capacity 事件条数，向上取整到 2 的幂
+   */
+  esp_err_t init(size_t capacity);
+
+  bool enabled() const { return m_slots != nullptr; }
+
+  /**
+   * @brief 记录一个事件
+   */
+  void record(TraceEvent ev, uint32_t arg = 0);
+
+  /**
+   * @brief 记录本轮次的第一次事件（之后同类事件忽略，直到 beginTurn）
+   */
+  void recordFirst(TraceEvent ev, uint32_t arg = 0);
+
+  /**
+   * @brief 开启新的对话轮次：重置 "first" 事件
+   */
+  void beginTurn();
+
+  /**
+   * @brief 清空已记录的事件
+   */
+  void clear();
+
+  /**
+   * @brief 输出 Chrome trace JSON
+   * @param write 分块写出回调，返回非 ESP_OK 时中止
+   */
+  esp_err_t
+  exportChromeTrace(const std::function<esp_err_t(const char *, size_t)> &write);
+
+  static const char *eventName(TraceEvent ev);
+
+private:
+  LatencyTrace() = default;
+  ~LatencyTrace() = default;
+
+  struct Slot {
+    std::atomic<uint32_t> seq; /*!< 写入序号 + 1；0 表示空 */
+    uint8_t event;
+    uint16_t turn;
+    uint32_t arg;
+    int64_t ts_us;
+  };
+
+  void store(TraceEvent ev, uint32_t arg, uint16_t turn);
+
+  Slot *m_slots = nullptr;
+  uint32_t m_mask = 0;
+  std::atomic<uint32_t> m_writeIdx{0};
+  std::atomic<uint32_t> m_firstMask{0};
+  std::atomic<uint16_t> m_turn{0};
+};
+
+#if CONFIG_LATENCY_TRACE_ENABLE
+#define LTRACE(ev, arg) LatencyTrace::instance().record((ev), (uint32_t)(arg))
+#define LTRACE_FIRST(ev, arg)                                                  \
+  LatencyTrace::instance().recordFirst((ev), (uint32_t)(arg))
+#define LTRACE_TURN() LatencyTrace::instance().beginTurn()
+#else
+#define LTRACE(ev, arg) ((void)0)
+#define LTRACE_FIRST(ev, arg) ((void)0)
+#define LTRACE_TURN() ((void)0)
+#endif
@@ -1,8 +1,10 @@
 #include "voice_control.h"
+#include "command_table.h"
 #include "esp_log.h"
 #include "led.h"
 #include "mp3_player.h"
 #include "servo.h"
+#include "sfx_cache.h"
 #include "wake_word.h"
 #include <algorithm>
 #include <cstring>
@@ -15,6 +17,7 @@ enum class VoiceControlEventType : uint8_t { WakeDetected = 0, Command = 1 };
 struct VoiceControlEvent {
   VoiceControlEventType type = VoiceControlEventType::WakeDetected;
   int commandId = -1;
+  VoiceCommand command = VoiceCommand::Unknown;
   uint32_t token = 0;
 };
 } // namespace
@@ -52,6 +55,9 @@ esp_err_t VoiceControl::init(const VoiceControlConfig &config) {
     });
     if (mp3Ret != ESP_OK) {
       ESP_LOGW(TAG, "MP3 Player init failed: %s", esp_err_to_name(mp3Ret));
+    } else {
+      // 音效预解码到 PSRAM（后台任务），播放时不再经过 MP3 解码器
+      SfxCache::instance().init();
     }
   } else {
     ESP_LOGW(TAG, "MP3 Player pins not set, skip init");
@@ -213,12 +219,15 @@ void VoiceControl::dragonTailSwing(uint32_t token) {
   // 保存LED原始状态
   bool originalLedState = m_ledOn;
 
-  // 播放“神龙摆尾”音效（嵌入的 dinosaur-roar.mp3）
+  // 播放“神龙摆尾”音效（嵌入的 dinosaur-roar.mp3，已预解码在 PSRAM）
+  // 与正在进行的语音播报混音叠加，不打断 PCM 流
   auto &mp3Player = Mp3Player::instance();
-  if (mp3Player.getState() != Mp3PlayerState::Idle) {
-    mp3Player.stop();
+  MixerVoice roar = SfxCache::instance().play(kSfxRoar);
+  if (roar == kNoVoice) {
+    // 缓存不可用（PSRAM 不足 / voice 已满）：退回解码器播放
+    mp3Player.playEmbedded(false);
+    roar = mp3Player.playerVoice();
   }
-  mp3Player.playEmbedded(false);
 
   // 舵机左右摆动和LED闪烁同时进行
   // 舵机摆动3次，LED闪烁5次
@@ -278,7 +287,7 @@ void VoiceControl::dragonTailSwing(uint32_t token) {
 
   // 被打断时停止音效，避免“换命令后还在吼”
   if (shouldAbort(token)) {
-    mp3Player.stop();
+    mp3Player.stopVoice(roar);
   }
 
   // 恢复舵机到中间位置
@@ -293,31 +302,15 @@ void VoiceControl::dragonTailSwing(uint32_t token) {
 }
 
 void VoiceControl::executeCommandById(int commandId) {
-  // 命令ID映射：
-  // 0 = 开灯
-  // 1 = 关灯
-  // 2 = 前进
-  // 3 = 后退
-  // 4 = 神龙摆尾
-
-  if (commandId < 0 || commandId >= 5) {
+  // 命令ID -> 动作 的映射由 CommandTable 提供（同一动作可有多个 ID）
+  if (CommandTable::instance().actionOf(commandId) == VoiceCommand::Unknown) {
     ESP_LOGW(TAG, "Invalid command ID: %d", commandId);
     return;
   }
 
-  // 有后台队列时：统一走队列执行，避免并发触碰硬件（web/识别/其它线程）
-  if (m_eventQueue != nullptr) {
-    postCommandEvent(commandId);
-    return;
-  }
-
-  // 兜底：同步执行（无后台任务/队列时）
-  VoiceCommand commands[] = {VoiceCommand::LightOn, VoiceCommand::LightOff,
-                             VoiceCommand::Forward, VoiceCommand::Backward,
-                             VoiceCommand::DragonTail};
-
-  uint32_t token = m_actionToken.fetch_add(1, std::memory_order_relaxed) + 1;
-  executeCommandInternal(commands[commandId], token);
+  // 有后台队列时：统一走队列执行，避免并发触碰硬件（web/识别/其它线程）；
+  // 没有队列时 postCommandEvent 内部同步执行
+  postCommandEvent(commandId);
 }
 
 void VoiceControl::bindToWakeWord() {
@@ -388,6 +381,7 @@ void VoiceControl::postWakeEvent() {
   VoiceControlEvent ev = {
       .type = VoiceControlEventType::WakeDetected,
       .commandId = -1,
+      .command = VoiceCommand::Unknown,
       .token = m_actionToken.load(std::memory_order_relaxed),
   };
   if (xQueueSend(m_eventQueue, &ev, 0) != pdTRUE) {
@@ -396,25 +390,26 @@ void VoiceControl::postWakeEvent() {
 }
 
 void VoiceControl::postCommandEvent(int commandId) {
+  // 投递时就解析动作：之后命令表被修改也不影响已排队的命令
+  VoiceCommand command = CommandTable::instance().actionOf(commandId);
+  if (command == VoiceCommand::Unknown) {
+    ESP_LOGW(TAG, "Invalid command ID: %d", commandId);
+    return;
+  }
+
   // 新命令到来：提升 token -> 打断正在执行的动作
   uint32_t token = m_actionToken.fetch_add(1, std::memory_order_relaxed) + 1;
 
   if (m_eventQueue == nullptr) {
     // 兜底：没有队列时仍执行，但会阻塞调用方（不推荐）
-    VoiceCommand commands[] = {VoiceCommand::LightOn, VoiceCommand::LightOff,
-                               VoiceCommand::Forward, VoiceCommand::Backward,
-                               VoiceCommand::DragonTail};
-    if (commandId >= 0 && commandId < 5) {
-      executeCommandInternal(commands[commandId], token);
-    } else {
-      ESP_LOGW(TAG, "Invalid command ID: %d", commandId);
-    }
+    executeCommandInternal(command, token);
     return;
   }
 
   VoiceControlEvent ev = {
       .type = VoiceControlEventType::Command,
       .commandId = commandId,
+      .command = command,
       .token = token,
   };
   if (xQueueSend(m_eventQueue, &ev, 0) != pdTRUE) {
@@ -451,17 +446,9 @@ void VoiceControl::workerTask(void *arg) {
       self->blinkLed(2, self->m_config.flash_delay_ms, ev.token);
       break;
 
-    case VoiceControlEventType::Command: {
-      VoiceCommand commands[] = {VoiceCommand::LightOn, VoiceCommand::LightOff,
-                                 VoiceCommand::Forward, VoiceCommand::Backward,
-                                 VoiceCommand::DragonTail};
-      if (ev.commandId >= 0 && ev.commandId < 5) {
-        self->executeCommandInternal(commands[ev.commandId], ev.token);
-      } else {
-        ESP_LOGW(TAG, "Invalid command ID: %d", ev.commandId);
-      }
+    case VoiceControlEventType::Command:
+      self->executeCommandInternal(ev.command, ev.token);
       break;
     }
-    }
   }
 }
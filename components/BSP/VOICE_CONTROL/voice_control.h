@@ -141,7 +141,7 @@ public:
 
   /**
    * @brief 根据命令ID执行对应操作
-   * @param commandId 命令ID (0-4)
+   * @param commandId 命令ID（由 CommandTable 映射到动作，默认 0-4）
    */
   void executeCommandById(int commandId);
 
@@ -0,0 +1,71 @@
+#include "noise_floor_gate.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// 一阶平滑系数：每帧向目标靠近的比例
+float smoothingAlpha(int frameMs, int tauMs) {
+  if (tauMs <= 0) {
+    return 1.0f;
+  }
+  return 1.0f - std::exp(-(float)frameMs / (float)tauMs);
+}
+} // namespace
+
+void NoiseFloorGate::configure(const NoiseFloorGateConfig &cfg) {
+  m_cfg = cfg;
+  m_cfg.min_mean_abs = std::max(0, m_cfg.min_mean_abs);
+  m_cfg.max_mean_abs = std::max(m_cfg.min_mean_abs, m_cfg.max_mean_abs);
+  m_snrRatio = std::pow(10.0f, (float)m_cfg.snr_db / 20.0f);
+  m_closeRatio = std::pow(10.0f, -(float)std::max(0, m_cfg.hysteresis_db) / 20.0f);
+  m_coefFrameMs = 0;
+  reset();
+}
+
+void NoiseFloorGate::reset() {
+  m_primed = false;
+  m_open = false;
+  m_floor = 0.0f;
+  m_threshold = m_cfg.adaptive ? (uint32_t)m_cfg.min_mean_abs
+                               : (uint32_t)std::max(0, m_cfg.fixed_mean_abs);
+}
+
+void NoiseFloorGate::updateCoefficients(int frameMs) {
+  m_coefFrameMs = frameMs;
+  m_attackAlpha = smoothingAlpha(frameMs, m_cfg.attack_ms);
+  m_openAttackAlpha = smoothingAlpha(frameMs, m_cfg.open_attack_ms);
+  m_releaseAlpha = smoothingAlpha(frameMs, m_cfg.release_ms);
+}
+
+bool NoiseFloorGate::process(uint32_t meanAbs, int frameMs, bool vadSpeech) {
+  if (!m_cfg.adaptive) {
+    m_open = (m_cfg.fixed_mean_abs <= 0) ||
+             meanAbs >= (uint32_t)m_cfg.fixed_mean_abs;
+    return m_open;
+  }
+
+  if (frameMs != m_coefFrameMs) {
+    updateCoefficients(frameMs > 0 ? frameMs : 1);
+  }
+
+  float level = (float)meanAbs;
+  if (!m_primed) {
+    m_floor = level;
+    m_primed = true;
+  } else if (level < m_floor) {
+    m_floor += m_releaseAlpha * (level - m_floor);
+  } else {
+    float alpha = (m_open && vadSpeech) ? m_openAttackAlpha : m_attackAlpha;
+    m_floor += alpha * (level - m_floor);
+  }
+
+  float gate = m_floor * m_snrRatio;
+  gate = std::min(std::max(gate, (float)m_cfg.min_mean_abs),
+                  (float)m_cfg.max_mean_abs);
+  m_threshold = (uint32_t)(gate + 0.5f);
+
+  float need = m_open ? gate * m_closeRatio : gate;
+  m_open = level >= need;
+  return m_open;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief 能量门限参数（幅度均为 mean(|pcm|)，时间单位毫秒）
+ */
+struct NoiseFloorGateConfig {
+  bool adaptive = false;     /*!< false: 固定门限 fixed_mean_abs（旧行为） */
+  int fixed_mean_abs = 0;    /*!< 固定门限；<=0 表示不启用能量门限 */
+
+  int snr_db = 8;            /*!< 自适应：门限 = 噪声底 * 10^(snr_db/20) */
+  int min_mean_abs = 40;     /*!< 自适应门限下限（安静环境下的最低门限） */
+  int max_mean_abs = 3000;   /*!< 自适应门限上限（避免噪声很大时永远打不开） */
+  int attack_ms = 1500;      /*!< 噪声底上升时间常数（门限关闭时） */
+  int open_attack_ms = 10000; /*!< 噪声底上升时间常数（VAD 判为语音且门限打开时） */
+  int release_ms = 150;      /*!< 噪声底下降时间常数 */
+  int hysteresis_db = 3;     /*!< 门限打开后，低于门限该值才关闭 */
+};
+
+/**
+ * @brief 跟踪背景噪声底的能量门限（纯 C++，不依赖 FreeRTOS / IDF）
+ *
+ * 噪声底按帧做非对称一阶平滑：电平低于噪声底时快速跟随（release），
+ * 高于噪声底时缓慢上升（attack）。VAD 判为语音时上升更慢，避免说话本身
+ * 把门限抬高；但持续的电视/风扇声最终会被计入噪声底，门限随之关闭，
+ * 不会一直“卡在说话中”直到 max_utterance_ms。
+ *
+ * 门限 = clamp(噪声底 * SNR, min_mean_abs, max_mean_abs)，并带迟滞。
+ * 噪声底属于环境状态，句子结束时不清零。
+ */
+class NoiseFloorGate {
+public:
+  void configure(const NoiseFloorGateConfig &cfg);
+  const NoiseFloorGateConfig &config() const { return m_cfg; }
+
+  /**
+   * @brief 忘记已学习的噪声底（下一帧重新初始化）
+   */
+  void reset();
+
+  /**
+   * @brief 处理一帧电平
+   * @param meanAbs 当前帧 mean(|pcm|)
+   * @param frameMs 帧长
+   * @param vadSpeech AFE VAD 是否判为语音（只影响噪声底上升速度）
+   * @return 能量是否通过门限
+   */
+  bool process(uint32_t meanAbs, int frameMs, bool vadSpeech);
+
+  bool isOpen() const { return m_open; }
+  /** 当前噪声底估计（固定门限模式下为 0） */
+  uint32_t noiseFloor() const { return (uint32_t)(m_floor + 0.5f); }
+  /** 当前打开门限 */
+  uint32_t threshold() const { return m_threshold; }
+
+private:
+  void updateCoefficients(int frameMs);
+
+  NoiseFloorGateConfig m_cfg;
+  float m_snrRatio = 1.0f;
+  float m_closeRatio = 1.0f;
+
+  int m_coefFrameMs = 0;
+  float m_attackAlpha = 0.0f;
+  float m_openAttackAlpha = 0.0f;
+  float m_releaseAlpha = 0.0f;
+
+  bool m_primed = false;
+  bool m_open = false;
+  float m_floor = 0.0f;
+  uint32_t m_threshold = 0;
+};
@@ -0,0 +1,72 @@
+#include "speech_endpointer.h"
+
+#include "audio_dsp.h"
+
+void SpeechEndpointer::configure(const SpeechEndpointerConfig &cfg,
+                                 int sample_rate_hz) {
+  m_cfg = cfg;
+  m_sampleRate = sample_rate_hz > 0 ? sample_rate_hz : 16000;
+  m_frameMs = 0;
+  m_gate.configure(cfg.gate);
+  reset();
+}
+
+void SpeechEndpointer::reset() {
+  m_inSpeech = false;
+  m_speechMs = 0;
+  m_silenceMs = 0;
+  m_totalMs = 0;
+  m_lastMeanAbs = 0;
+  m_lastFrameSpeech = false;
+}
+
+EndpointEvent SpeechEndpointer::process(const int16_t *samples, int numSamples,
+                                        bool vadSpeech) {
+  if (samples == nullptr || numSamples <= 0) {
+    return m_inSpeech ? EndpointEvent::Continue : EndpointEvent::None;
+  }
+
+  if (m_frameMs <= 0) {
+    m_frameMs = (numSamples * 1000) / m_sampleRate;
+    if (m_frameMs < 1) {
+      m_frameMs = 1;
+    }
+  }
+
+  m_lastMeanAbs = audio_dsp::meanAbs16(samples, (size_t)numSamples);
+  bool energyOk = m_gate.process(m_lastMeanAbs, m_frameMs, vadSpeech);
+  bool speechFrame = vadSpeech && energyOk;
+  m_lastFrameSpeech = speechFrame;
+
+  if (!m_inSpeech) {
+    if (!speechFrame) {
+      return EndpointEvent::None;
+    }
+    m_inSpeech = true;
+    m_speechMs = m_frameMs;
+    m_silenceMs = 0;
+    m_totalMs = m_frameMs;
+    return EndpointEvent::SpeechStart;
+  }
+
+  m_totalMs += m_frameMs;
+  if (speechFrame) {
+    m_speechMs += m_frameMs;
+    m_silenceMs = 0;
+  } else {
+    m_silenceMs += m_frameMs;
+  }
+
+  if (m_speechMs >= m_cfg.min_speech_ms &&
+      m_silenceMs >= m_cfg.end_silence_ms) {
+    m_inSpeech = false;
+    return EndpointEvent::End;
+  }
+
+  if ((m_cfg.max_utterance_ms > 0 && m_totalMs >= m_cfg.max_utterance_ms) ||
+      (m_cfg.max_speech_ms > 0 && m_speechMs >= m_cfg.max_speech_ms)) {
+    m_inSpeech = false;
+    return EndpointEvent::ForcedEnd;
+  }
+  return EndpointEvent::Continue;
+}
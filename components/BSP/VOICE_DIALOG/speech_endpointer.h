@@ -0,0 +1,84 @@
+#pragma once
+
+#include "noise_floor_gate.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 端点检测参数（单位均为毫秒）
+ */
+struct SpeechEndpointerConfig {
+  int min_speech_ms = 300;    /*!< 至少这么长的语音才允许按静音结束 */
+  int end_silence_ms = 450;   /*!< 语音后连续静音达到该值即结束 */
+  int max_utterance_ms = 8000; /*!< 单句总时长上限（语音+静音），超出强制结束；0 不限 */
+  int max_speech_ms = 0;       /*!< 单句语音累计上限（不含静音），超出强制结束；0 不限 */
+  NoiseFloorGateConfig gate;   /*!< 能量门限：未通过的帧即使 VAD 判为语音也视为静音 */
+};
+
+/**
+ * @brief 每帧处理结果
+ */
+enum class EndpointEvent {
+  None = 0,    /*!< 未在说话，当前帧不属于任何句子 */
+  SpeechStart, /*!< 新句子开始，当前帧是句子的第一帧 */
+  Continue,    /*!< 句子进行中，当前帧属于该句子 */
+  End,         /*!< 静音结束，当前帧是句子的最后一帧 */
+  ForcedEnd,   /*!< 达到时长上限强制结束，当前帧是句子的最后一帧 */
+};
+
+/**
+ * @brief 对话语音端点检测（纯 C++，不依赖 FreeRTOS / IDF）
+ *
+ * HTTP 与 WebSocket 两条对话链路共用同一套判定：
+ * - VAD 判为语音且通过能量门限（固定或跟踪噪声底，见 NoiseFloorGate）-> 语音帧
+ * - 语音帧开启句子；句内语音帧清零静音计数，静音帧累加“尾部连续静音”
+ * - 语音累计 >= min_speech_ms 且尾部静音 >= end_silence_ms -> End
+ * - 句子总时长 >= max_utterance_ms，或语音累计 >= max_speech_ms -> ForcedEnd
+ *
+ * 结束后 speechMs()/silenceMs() 保留最后一句的值，直到下一句开始。
+ * 同一逻辑也被 tools/dialog_replay 在主机上复用，用于离线调参。
+ */
+class SpeechEndpointer {
+public:
+  void configure(const SpeechEndpointerConfig &cfg, int sample_rate_hz);
+  const SpeechEndpointerConfig &config() const { return m_cfg; }
+
+  /**
+   * @brief 回到空闲（丢弃当前句子；保留已学习的噪声底）
+   */
+  void reset();
+
+  /**
+   * @brief 处理一帧
+   * @param vadSpeech AFE VAD 是否判为语音
+   */
+  EndpointEvent process(const int16_t *samples, int numSamples,
+                        bool vadSpeech);
+
+  bool inSpeech() const { return m_inSpeech; }
+  int speechMs() const { return m_speechMs; }
+  int silenceMs() const { return m_silenceMs; }
+  /** 当前（或最后一句）句子总时长，含句内停顿 */
+  int utteranceMs() const { return m_totalMs; }
+  int frameMs() const { return m_frameMs; }
+  int sampleRate() const { return m_sampleRate; }
+
+  /** 最近一帧的 mean(|pcm|) 与判定结果 */
+  uint32_t lastMeanAbs() const { return m_lastMeanAbs; }
+  bool lastFrameSpeech() const { return m_lastFrameSpeech; }
+  const NoiseFloorGate &gate() const { return m_gate; }
+
+private:
+  SpeechEndpointerConfig m_cfg;
+  int m_sampleRate = 16000;
+  NoiseFloorGate m_gate;
+
+  bool m_inSpeech = false;
+  int m_speechMs = 0;
+  int m_silenceMs = 0; /*!< 尾部连续静音 */
+  int m_totalMs = 0;
+  int m_frameMs = 0;
+  uint32_t m_lastMeanAbs = 0;
+  bool m_lastFrameSpeech = false;
+};
@@ -1,8 +1,10 @@
 #include "voice_dialog.h"
 
+#include "audio_dsp.h"
 #include "cloud_chat.h"
 #include "esp_log.h"
 #include "esp_mac.h"
+#include "latency_trace.h"
 #include "mp3_player.h"
 #include "wake_word.h"
 #include "websocket_chat.h"
@@ -11,10 +13,20 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <new>
 
 static const char *TAG = "VoiceDialog";
 
 namespace {
+// Streaming upload: the worker polls for new frames every kStreamPollMs (one
+// AFE frame is 32 ms).
+constexpr int kStreamPollMs = 20;
+constexpr int kStreamGraceMs = 3000; // no StreamEnd after max utterance -> abort
+
+static size_t msToSamples(int ms, int sampleRate) {
+  return (size_t)((int64_t)std::max(0, ms) * sampleRate / 1000);
+}
+
 static std::string getDeviceIdFromMac() {
   uint8_t mac[6] = {};
   esp_err_t err = esp_read_mac(mac, ESP_MAC_WIFI_STA);
@@ -29,80 +41,6 @@ static std::string getDeviceIdFromMac() {
            mac[2], mac[3], mac[4], mac[5]);
   return std::string(buf);
 }
-
-static uint32_t meanAbs16(const int16_t *samples, int numSamples) {
-  if (samples == nullptr || numSamples <= 0) {
-    return 0;
-  }
-  uint32_t sum = 0;
-  for (int i = 0; i < numSamples; i++) {
-    int32_t s = samples[i];
-    int32_t a = s < 0 ? -s : s;
-    if (a > 32767) {
-      a = 32767; // handle INT16_MIN
-    }
-    sum += (uint32_t)a;
-  }
-  return sum / (uint32_t)numSamples;
-}
-
-static uint8_t *buildWav16Mono(const int16_t *pcm, size_t samples,
-                               int sampleRate, size_t &outLen) {
-  outLen = 0;
-  if (pcm == nullptr || samples == 0 || sampleRate <= 0) {
-    return nullptr;
-  }
-
-  const uint16_t numChannels = 1;
-  const uint16_t bitsPerSample = 16;
-  const uint32_t byteRate =
-      (uint32_t)sampleRate * numChannels * (bitsPerSample / 8);
-  const uint16_t blockAlign = numChannels * (bitsPerSample / 8);
-
-  const uint32_t dataBytes = (uint32_t)(samples * sizeof(int16_t));
-  const uint32_t riffSize = 36 + dataBytes;
-
-  struct WavHeader {
-    char riff[4];
-    uint32_t riffSize;
-    char wave[4];
-    char fmt[4];
-    uint32_t fmtSize;
-    uint16_t audioFormat;
-    uint16_t numChannels;
-    uint32_t sampleRate;
-    uint32_t byteRate;
-    uint16_t blockAlign;
-    uint16_t bitsPerSample;
-    char data[4];
-    uint32_t dataSize;
-  } __attribute__((packed));
-
-  WavHeader h{};
-  memcpy(h.riff, "RIFF", 4);
-  h.riffSize = riffSize;
-  memcpy(h.wave, "WAVE", 4);
-  memcpy(h.fmt, "fmt ", 4);
-  h.fmtSize = 16;
-  h.audioFormat = 1; // PCM
-  h.numChannels = numChannels;
-  h.sampleRate = (uint32_t)sampleRate;
-  h.byteRate = byteRate;
-  h.blockAlign = blockAlign;
-  h.bitsPerSample = bitsPerSample;
-  memcpy(h.data, "data", 4);
-  h.dataSize = dataBytes;
-
-  size_t total = sizeof(WavHeader) + dataBytes;
-  uint8_t *buf = (uint8_t *)malloc(total);
-  if (!buf) {
-    return nullptr;
-  }
-  memcpy(buf, &h, sizeof(WavHeader));
-  memcpy(buf + sizeof(WavHeader), pcm, dataBytes);
-  outLen = total;
-  return buf;
-}
 } // namespace
 
 esp_err_t VoiceDialog::init(const VoiceDialogConfig &cfg) {
@@ -111,26 +49,76 @@ esp_err_t VoiceDialog::init(const VoiceDialogConfig &cfg) {
   }
   m_cfg = cfg;
   m_deviceId = getDeviceIdFromMac();
+
+  SpeechEndpointerConfig epCfg;
+  epCfg.min_speech_ms = m_cfg.min_speech_ms;
+  epCfg.end_silence_ms = m_cfg.end_silence_ms;
+  if (m_cfg.use_websocket) {
+    // WS 上行边说边发，没有缓冲上限：只限制语音累计时长（句内停顿不计）
+    epCfg.max_utterance_ms = 0;
+    epCfg.max_speech_ms = m_cfg.max_utterance_ms;
+  } else {
+    // HTTP 整句缓冲在 m_pcm（按 max_pcm_ms 预留），按总时长限制
+    epCfg.max_utterance_ms = std::min(m_cfg.max_utterance_ms, m_cfg.max_pcm_ms);
+  }
+  epCfg.gate.adaptive = m_cfg.adaptive_energy_gate;
+  epCfg.gate.fixed_mean_abs = m_cfg.energy_gate_mean_abs;
+  epCfg.gate.snr_db = m_cfg.gate_snr_db;
+  epCfg.gate.min_mean_abs = m_cfg.gate_min_mean_abs;
+  epCfg.gate.max_mean_abs = m_cfg.gate_max_mean_abs;
+  epCfg.gate.attack_ms = m_cfg.noise_floor_attack_ms;
+  epCfg.gate.release_ms = m_cfg.noise_floor_release_ms;
+  m_endpointer.configure(epCfg, m_cfg.sample_rate_hz);
+  m_statGate.store(m_endpointer.gate().threshold(), std::memory_order_relaxed);
   ESP_LOGI(TAG, "Init: deviceId=%s use_websocket=%d", m_deviceId.c_str(),
            m_cfg.use_websocket ? 1 : 0);
+  if (m_cfg.adaptive_energy_gate) {
+    ESP_LOGI(TAG, "Energy gate: adaptive snr=%ddB min=%d max=%d", m_cfg.gate_snr_db,
+             m_cfg.gate_min_mean_abs, m_cfg.gate_max_mean_abs);
+  } else {
+    ESP_LOGI(TAG, "Energy gate: fixed %d", m_cfg.energy_gate_mean_abs);
+  }
 
-  // Pre-reserve capture buffer
+  // Pre-reserve capture buffer. HTTP streaming upload sends frames through a
+  // ring of the same size instead (a stalled connection then loses nothing
+  // until the utterance hits its hard cap anyway).
   int capMs = std::max(1000, m_cfg.max_pcm_ms);
   size_t capSamples = (size_t)((int64_t)capMs * m_cfg.sample_rate_hz / 1000);
-  m_pcm.reserve(capSamples);
   if (m_cfg.use_websocket) {
-    constexpr int kPreRollMs = 200;
-    size_t preRollSamples =
-        (size_t)((int64_t)kPreRollMs * m_cfg.sample_rate_hz / 1000);
-    m_wsPreRoll.reserve(preRollSamples);
+    m_cfg.stream_upload = false;
   }
+  if (m_cfg.stream_upload && m_streamRing.init(capSamples) != ESP_OK) {
+    ESP_LOGW(TAG, "No mem for stream ring, upload after end of speech");
+    m_cfg.stream_upload = false;
+  }
+  // 录音缓冲在句末整块交给 worker，下一句开始时再按此容量重新分配
+  m_pcmReserve = m_cfg.stream_upload ? 0 : capSamples;
+  m_pcm.reserve(m_pcmReserve);
+  if (m_cfg.use_websocket) {
+    // 打断时预录还要容纳“确认打断”之前已经说出的部分
+    m_cfg.preroll_ms = std::max(0, m_cfg.preroll_ms);
+    int preRollMs =
+        m_cfg.preroll_ms + (m_cfg.barge_in ? m_cfg.barge_in_min_speech_ms : 0);
+    if (preRollMs > 0 &&
+        m_wsPreRoll.init(msToSamples(preRollMs, m_cfg.sample_rate_hz)) !=
+            ESP_OK) {
+      ESP_LOGW(TAG, "No mem for pre-roll");
+    }
+  }
+  if (m_cfg.barge_in) {
+    ESP_LOGI(TAG, "Barge-in: enabled (min speech %d ms, needs AEC=%d)",
+             m_cfg.barge_in_min_speech_ms,
+             WakeWord::instance().aecEnabled() ? 1 : 0);
+  }
+
+  registerMetrics();
 
   // WebSocket mode: init WebSocket client
   if (m_cfg.use_websocket) {
     initWebSocket();
   }
 
-  m_queue = xQueueCreate(4, sizeof(UtteranceEvent));
+  m_queue = xQueueCreate(8, sizeof(UtteranceEvent));
   if (!m_queue) {
     ESP_LOGE(TAG, "Failed to create queue");
     return ESP_ERR_NO_MEM;
@@ -151,6 +139,17 @@ esp_err_t VoiceDialog::init(const VoiceDialogConfig &cfg) {
   return ESP_OK;
 }
 
+void VoiceDialog::registerMetrics() {
+  esp_err_t err = Metrics::instance().add(
+      {&m_metricTurnsOk, &m_metricTurnsFailed, &m_metricDropQueue,
+       &m_metricDropNoMem, &m_metricDropRing, &m_metricUtterances,
+       &m_metricForcedEnds, &m_metricBargeIns, &m_metricNoiseFloor,
+       &m_metricReplyMs});
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Metrics register failed: %s", esp_err_to_name(err));
+  }
+}
+
 void VoiceDialog::onWakeDetected() {
   if (!m_inited) {
     return;
@@ -159,21 +158,14 @@ void VoiceDialog::onWakeDetected() {
   m_turnBusy.store(false, std::memory_order_relaxed);
   m_ignoreUntilTick = 0;
   resetCapture();
-  m_wsPreRoll.clear();
-  m_wsLastConnectAttemptTick = 0;
+  m_wsPreRoll.reset();
   m_wsTurnBusySinceTick = 0;
   m_wsStopListenTick = 0;
-
-  if (m_queue) {
-    UtteranceEvent ev{};
-    while (xQueueReceive(m_queue, &ev, 0) == pdTRUE) {
-      if (ev.pcm) {
-        free(ev.pcm);
-      }
-    }
-  }
+  m_wsSpeechEndTick.store(0, std::memory_order_relaxed);
+  m_bargeInHold = false;
+  drainQueue();
   
-  // WebSocket mode: connect and start listening
+  // WebSocket mode: 连接常驻（见 initWebSocket），正在退避等待时立即重连
   if (m_cfg.use_websocket) {
     auto& ws = WebSocketChat::instance();
     if (!ws.isReady()) {
@@ -190,7 +182,7 @@ void VoiceDialog::onLocalCommandDetected() {
   // 本地命令被识别：丢弃当前录音，避免同时走云端对话
   m_turnBusy.store(false, std::memory_order_relaxed);
   resetCapture();
-  m_wsPreRoll.clear();
+  m_wsPreRoll.reset();
   int ignoreMs = std::max(0, m_cfg.local_command_ignore_ms);
   if (ignoreMs > 0) {
     m_ignoreUntilTick =
@@ -200,14 +192,7 @@ void VoiceDialog::onLocalCommandDetected() {
   }
 
   // 尽量清掉队列里尚未处理的语音，避免“命令也执行了、云端也回了一句”
-  if (m_queue) {
-    UtteranceEvent ev{};
-    while (xQueueReceive(m_queue, &ev, 0) == pdTRUE) {
-      if (ev.pcm) {
-        free(ev.pcm);
-      }
-    }
-  }
+  drainQueue();
 
   // WebSocket mode: abort current interaction as early as possible.
   if (m_cfg.use_websocket) {
@@ -223,24 +208,218 @@ void VoiceDialog::onLocalCommandDetected() {
   ESP_LOGI(TAG, "Local command detected, cancel current utterance");
 }
 
+void VoiceDialog::onWakeDuringReply() {
+  if (!m_inited || !m_sessionActive || !replyActive()) {
+    return;
+  }
+  bargeIn(true);
+  // 唤醒词本身不上传：丢掉当前录音，下一句话照常开启新一轮
+  resetCapture();
+}
+
+void VoiceDialog::drainQueue() {
+  if (!m_queue) {
+    return;
+  }
+  // 丢掉了 StreamStart/StreamEnd 时，worker 可能正在（或将要）上传：补发取消
+  bool streamPending = m_streamOpen;
+  UtteranceEvent ev{};
+  while (xQueueReceive(m_queue, &ev, 0) == pdTRUE) {
+    delete ev.pcm;
+    if (ev.kind == UtteranceEvent::Kind::StreamStart ||
+        ev.kind == UtteranceEvent::Kind::StreamEnd) {
+      streamPending = true;
+    }
+  }
+  if (streamPending) {
+    m_streamOpen = true;
+    cancelStream();
+  }
+}
+
 void VoiceDialog::resetCapture() {
-  m_inSpeech = false;
-  m_dropCurrentUtterance = false;
-  m_speechMs = 0;
-  m_silenceMs = 0;
-  m_frameMs = 0;
+  cancelStream();
+  m_endpointer.reset();
+  m_statInSpeech.store(false, std::memory_order_relaxed);
   m_pcm.clear();
-  m_wsPreRoll.clear();
+  m_wsPreRoll.reset();
+  m_bargeSpeechMs = 0;
+}
+
+bool VoiceDialog::beginStream(const int16_t *samples, size_t numSamples) {
+  if (!m_cfg.stream_upload || m_streamOpen) {
+    return false;
+  }
+  UtteranceEvent ev{};
+  ev.kind = UtteranceEvent::Kind::StreamStart;
+  ev.index = m_streamRing.totalWritten();
+  ev.sample_rate_hz = m_cfg.sample_rate_hz;
+  if (xQueueSend(m_queue, &ev, 0) != pdTRUE) {
+    ESP_LOGW(TAG, "Queue full, upload after end of speech");
+    return false;
+  }
+  m_streamOpen = true;
+  m_streamStart = ev.index;
+  if (samples && numSamples > 0) {
+    streamFrame(samples, numSamples);
+  }
+  return true;
+}
+
+void VoiceDialog::streamFrame(const int16_t *samples, size_t numSamples) {
+  size_t written = m_streamRing.write(samples, numSamples);
+  if (written < numSamples) {
+    // worker 跟不上（网络卡住）：丢帧比阻塞检测任务好
+    m_streamRing.noteOverflow();
+    m_metricDropRing.inc();
+    ESP_LOGW(TAG, "Stream ring full, dropped %u samples",
+             (unsigned)(numSamples - written));
+  }
+}
+
+void VoiceDialog::cancelStream() {
+  if (!m_streamOpen) {
+    return;
+  }
+  m_streamOpen = false;
+  UtteranceEvent ev{};
+  ev.kind = UtteranceEvent::Kind::StreamCancel;
+  if (xQueueSend(m_queue, &ev, pdMS_TO_TICKS(100)) != pdTRUE) {
+    ESP_LOGW(TAG, "Queue full, stream cancel lost");
+    m_metricDropQueue.inc();
+  }
+}
+
+void VoiceDialog::appendCapture(const int16_t *samples, size_t numSamples) {
+  if (m_pcm.capacity() == 0) {
+    // 上一句的缓冲已交给 worker：到这时才重新分配，避免两块大缓冲同时存在
+    m_pcm.reserve(m_pcmReserve);
+  }
+  size_t oldSize = m_pcm.size();
+  m_pcm.resize(oldSize + numSamples);
+  memcpy(m_pcm.data() + oldSize, samples, numSamples * sizeof(int16_t));
+}
+
+void VoiceDialog::appendPreRoll(const int16_t *samples, int numSamples,
+                                size_t maxSamples) {
+  if (maxSamples == 0 || !m_wsPreRoll.valid()) {
+    return;
+  }
+  // 环容量是 2 的幂，可能比 maxSamples 大：写入后再丢到 maxSamples
+  (void)m_wsPreRoll.writeDropOldest(samples, (size_t)numSamples);
+  size_t avail = m_wsPreRoll.available();
+  if (avail > maxSamples) {
+    m_wsPreRoll.consume(avail - maxSamples);
+  }
+}
+
+bool VoiceDialog::replyActive() {
+  if (!m_cfg.barge_in || !WakeWord::instance().aecEnabled()) {
+    return false;
+  }
+  bool speaking = Mp3Player::instance().getState() != Mp3PlayerState::Idle;
+  if (m_cfg.use_websocket) {
+    speaking = speaking ||
+               WebSocketChat::instance().getState() == WsDialogState::Speaking;
+  }
+  if (m_bargeInHold) {
+    if (speaking) {
+      return false; // 已打断，等播放任务真正停下（最多一块）
+    }
+    m_bargeInHold = false;
+  }
+  return speaking;
 }
 
-bool VoiceDialog::shouldFinalizeOnSilence() const {
-  if (!m_inSpeech) {
+bool VoiceDialog::detectBargeIn(const int16_t *samples, int numSamples,
+                                vad_state_t vad) {
+  WakeWord::instance().touchDialog(); // keep alive during long response
+  if (samples == nullptr || numSamples <= 0) {
     return false;
   }
-  if (m_speechMs < m_cfg.min_speech_ms) {
+
+  // 帧已经过 AEC：残余回声由端点检测的能量门限（跟踪噪声底）过滤
+  EndpointEvent evt = processFrame(samples, numSamples, vad);
+  if (m_cfg.use_websocket) {
+    appendPreRoll(samples, numSamples,
+                  msToSamples(m_cfg.preroll_ms + m_cfg.barge_in_min_speech_ms,
+                              m_cfg.sample_rate_hz));
+  } else if (evt != EndpointEvent::None) {
+    if (evt == EndpointEvent::SpeechStart) {
+      m_pcm.clear();
+    }
+    appendCapture(samples, (size_t)numSamples);
+  }
+
+  if (evt == EndpointEvent::None || evt == EndpointEvent::End ||
+      evt == EndpointEvent::ForcedEnd) {
+    // 没说话，或只是一小段噪声/残余回声：不打断
+    m_bargeSpeechMs = 0;
+    if (evt != EndpointEvent::None) {
+      m_pcm.clear();
+    }
     return false;
   }
-  return m_silenceMs >= m_cfg.end_silence_ms;
+
+  // 语音帧累加、静音帧衰减：允许字间短暂停顿
+  int frameMs = (int)((int64_t)numSamples * 1000 / m_cfg.sample_rate_hz);
+  if (m_endpointer.lastFrameSpeech()) {
+    m_bargeSpeechMs += frameMs;
+  } else {
+    m_bargeSpeechMs = std::max(0, m_bargeSpeechMs - frameMs);
+  }
+  return m_bargeSpeechMs >= std::max(frameMs, m_cfg.barge_in_min_speech_ms);
+}
+
+void VoiceDialog::bargeIn(bool byWakeWord) {
+  ESP_LOGI(TAG, "Barge-in (%s): abort assistant reply",
+           byWakeWord ? "wake word" : "speech");
+  LTRACE(TraceEvent::BargeIn, byWakeWord ? 1 : 0);
+  m_statBargeIns.fetch_add(1, std::memory_order_relaxed);
+
+  // 先让上游停止送数据，再丢弃本地播放缓冲
+  if (m_cfg.use_websocket) {
+    auto &ws = WebSocketChat::instance();
+    if (ws.isReady()) {
+      (void)ws.sendAbort();
+    }
+  } else {
+    CloudChat::instance().cancel();
+  }
+  auto &player = Mp3Player::instance();
+  if (m_cfg.use_websocket || m_cfg.use_pcm_stream) {
+    player.pcmStreamFlush();
+  } else {
+    player.stop();
+  }
+
+  m_turnBusy.store(false, std::memory_order_relaxed);
+  m_wsTurnBusySinceTick = 0;
+  m_wsStopListenTick = 0;
+  m_wsSpeechEndTick.store(0, std::memory_order_relaxed);
+  m_wsListening = false;
+  m_bargeSpeechMs = 0;
+  m_bargeInHold = true;
+  WakeWord::instance().touchDialog();
+}
+
+EndpointEvent VoiceDialog::processFrame(const int16_t *samples, int numSamples,
+                                        vad_state_t vad) {
+  EndpointEvent evt =
+      m_endpointer.process(samples, numSamples, vad == VAD_SPEECH);
+
+  const NoiseFloorGate &gate = m_endpointer.gate();
+  m_statMeanAbs.store(m_endpointer.lastMeanAbs(), std::memory_order_relaxed);
+  m_statNoiseFloor.store(gate.noiseFloor(), std::memory_order_relaxed);
+  m_statGate.store(gate.threshold(), std::memory_order_relaxed);
+  m_statInSpeech.store(m_endpointer.inSpeech(), std::memory_order_relaxed);
+  if (evt == EndpointEvent::End || evt == EndpointEvent::ForcedEnd) {
+    m_statUtterances.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (evt == EndpointEvent::ForcedEnd) {
+    m_statForcedEnds.fetch_add(1, std::memory_order_relaxed);
+  }
+  return evt;
 }
 
 void VoiceDialog::onAudioFrame(const int16_t *samples, int numSamples,
@@ -266,14 +445,29 @@ void VoiceDialog::onAudioFrame(const int16_t *samples, int numSamples,
     m_ignoreUntilTick = 0;
   }
 
+  // Barge-in (AEC only): endpoint the echo-cancelled frames while the reply
+  // plays. The detected speech is already in m_pcm, so after barging in the
+  // following frames continue the same utterance through the normal path.
+  if (replyActive()) {
+    if (detectBargeIn(samples, numSamples, vad)) {
+      bargeIn(false);
+      if (beginStream(m_pcm.data(), m_pcm.size())) {
+        m_pcm.clear();
+      }
+    }
+    return;
+  }
+
   // Single-turn policy: while waiting assistant reply, ignore new speech
   if (m_turnBusy.load(std::memory_order_relaxed)) {
     WakeWord::instance().touchDialog();
     return;
   }
 
-  // 播放器正在播报时：不采集，避免回声把自己“听进去”
-  if (Mp3Player::instance().getState() != Mp3PlayerState::Idle) {
+  // 播放器正在播报时：没有 AEC 则不采集，避免回声把自己“听进去”；
+  // 有 AEC 时帧已去除回声，照常处理（播报尾部也能开始说话）
+  if (!WakeWord::instance().aecEnabled() &&
+      Mp3Player::instance().getState() != Mp3PlayerState::Idle) {
     WakeWord::instance().touchDialog(); // keep alive during long response
     return;
   }
@@ -282,77 +476,85 @@ void VoiceDialog::onAudioFrame(const int16_t *samples, int numSamples,
     return;
   }
 
-  if (m_frameMs <= 0) {
-    m_frameMs = std::max(1, (numSamples * 1000) / m_cfg.sample_rate_hz);
+  EndpointEvent evt = processFrame(samples, numSamples, vad);
+  if (evt == EndpointEvent::None) {
+    return;
   }
 
-  uint32_t meanAbs = meanAbs16(samples, numSamples);
-  bool speechFrame = (vad == VAD_SPEECH);
-  if (m_cfg.energy_gate_mean_abs > 0 &&
-      meanAbs < (uint32_t)m_cfg.energy_gate_mean_abs) {
-    speechFrame = false;
+  if (evt == EndpointEvent::SpeechStart) {
+    m_pcm.clear();
+    ESP_LOGI(TAG, "Speech start (vad=%d meanAbs=%u gate=%u floor=%u)", (int)vad,
+             (unsigned)m_endpointer.lastMeanAbs(),
+             (unsigned)m_endpointer.gate().threshold(),
+             (unsigned)m_endpointer.gate().noiseFloor());
+    (void)beginStream(nullptr, 0);
   }
-
-  if (speechFrame) {
-    if (!m_inSpeech) {
-      m_inSpeech = true;
-      m_dropCurrentUtterance = false;
-      m_speechMs = 0;
-      m_silenceMs = 0;
-      m_pcm.clear();
-      ESP_LOGI(TAG, "Speech start (vad=%d meanAbs=%u gate=%d)", (int)vad,
-               (unsigned)meanAbs, m_cfg.energy_gate_mean_abs);
-    }
-    m_speechMs += m_frameMs;
+  if (m_endpointer.lastFrameSpeech()) {
     WakeWord::instance().touchDialog();
-  } else {
-    if (m_inSpeech) {
-      m_silenceMs += m_frameMs;
-    }
-  }
-
-  if (!m_inSpeech) {
-    return;
   }
 
   // Append frame (include trailing silence for STT robustness)
-  size_t oldSize = m_pcm.size();
-  m_pcm.resize(oldSize + (size_t)numSamples);
-  memcpy(m_pcm.data() + oldSize, samples, (size_t)numSamples * sizeof(int16_t));
-
-  // Hard cap
-  bool forcedFinalize = false;
-  int totalMs = m_speechMs + m_silenceMs;
-  if (totalMs > m_cfg.max_utterance_ms || totalMs > m_cfg.max_pcm_ms) {
-    m_silenceMs = m_cfg.end_silence_ms;
-    forcedFinalize = true;
+  if (m_streamOpen) {
+    streamFrame(samples, (size_t)numSamples);
+  } else {
+    appendCapture(samples, (size_t)numSamples);
   }
 
-  if (!shouldFinalizeOnSilence()) {
+  if (evt != EndpointEvent::End && evt != EndpointEvent::ForcedEnd) {
     return;
   }
 
   // finalize utterance
-  if (m_dropCurrentUtterance) {
-    resetCapture();
-    return;
-  }
+  bool forcedFinalize = (evt == EndpointEvent::ForcedEnd);
+  int speechMs = m_endpointer.speechMs();
+  int silenceMs = m_endpointer.silenceMs();
 
   // Trim excessive tail silence to reduce upload size/latency.
   // Only do this when we truly ended on silence (not forced by hard cap),
   // otherwise we may accidentally cut off real speech.
+  size_t captured = m_streamOpen ? (size_t)(m_streamRing.totalWritten() -
+                                            m_streamStart)
+                                 : m_pcm.size();
+  size_t trimSamples = 0;
   if (!forcedFinalize) {
     constexpr int kKeepTailSilenceMs = 200;
-    if (m_silenceMs > kKeepTailSilenceMs) {
-      int trimMs = m_silenceMs - kKeepTailSilenceMs;
-      size_t trimSamples =
-          (size_t)((int64_t)trimMs * m_cfg.sample_rate_hz / 1000);
-      if (trimSamples > 0 && trimSamples < m_pcm.size()) {
-        m_pcm.resize(m_pcm.size() - trimSamples);
+    if (silenceMs > kKeepTailSilenceMs) {
+      trimSamples =
+          msToSamples(silenceMs - kKeepTailSilenceMs, m_cfg.sample_rate_hz);
+      if (trimSamples >= captured) {
+        trimSamples = 0;
       }
     }
   }
 
+  if (m_streamOpen) {
+    // Most of the audio is already on the wire; the worker sends the rest up
+    // to the trimmed end and then waits for the reply.
+    m_streamOpen = false;
+    UtteranceEvent ev{};
+    ev.kind = UtteranceEvent::Kind::StreamEnd;
+    ev.index = m_streamRing.totalWritten() - (uint32_t)trimSamples;
+    ESP_LOGI(TAG,
+             "Utterance finalize: speech=%dms silence=%dms samples=%u "
+             "forced=%d (streamed)",
+             speechMs, silenceMs, (unsigned)(captured - trimSamples),
+             forcedFinalize ? 1 : 0);
+    m_turnBusy.store(true, std::memory_order_relaxed);
+    LTRACE_TURN();
+    LTRACE(TraceEvent::HttpUpload, captured - trimSamples);
+    if (xQueueSend(m_queue, &ev, pdMS_TO_TICKS(100)) != pdTRUE) {
+      ESP_LOGW(TAG, "Queue full, stream end lost");
+      m_metricDropQueue.inc();
+      m_turnBusy.store(false, std::memory_order_relaxed);
+    }
+    resetCapture();
+    return;
+  }
+
+  if (trimSamples > 0) {
+    m_pcm.resize(m_pcm.size() - trimSamples);
+  }
+
   size_t totalSamples = m_pcm.size();
   if (totalSamples == 0) {
     resetCapture();
@@ -361,29 +563,34 @@ void VoiceDialog::onAudioFrame(const int16_t *samples, int numSamples,
 
   ESP_LOGI(
       TAG, "Utterance finalize: speech=%dms silence=%dms samples=%u forced=%d",
-      m_speechMs, m_silenceMs, (unsigned)totalSamples, forcedFinalize ? 1 : 0);
-
-  int16_t *pcmCopy =
-      (int16_t *)malloc(totalSamples * sizeof(int16_t));
-  if (!pcmCopy) {
-    ESP_LOGW(TAG, "No mem for pcm copy");
+      speechMs, silenceMs, (unsigned)totalSamples, forcedFinalize ? 1 : 0);
+
+  // Hand the capture buffer itself to the worker (no copy); m_pcm is left
+  // empty and re-reserved when the next utterance starts.
+  auto *pcm = new (std::nothrow) std::vector<int16_t>();
+  if (!pcm) {
+    ESP_LOGW(TAG, "No mem for utterance");
+    m_metricDropNoMem.inc();
     resetCapture();
     return;
   }
-  memcpy(pcmCopy, m_pcm.data(), totalSamples * sizeof(int16_t));
-
-  UtteranceEvent ev = {
-      .pcm = pcmCopy,
-      .samples = totalSamples,
-      .sample_rate_hz = m_cfg.sample_rate_hz,
-  };
+  pcm->swap(m_pcm);
 
+  UtteranceEvent ev{};
+  ev.pcm = pcm;
+  ev.sample_rate_hz = m_cfg.sample_rate_hz;
+
+  // Now waiting assistant reply; pause listening until it finishes. Set busy
+  // before sending so a fast worker cannot clear it first.
+  m_turnBusy.store(true, std::memory_order_relaxed);
+  LTRACE_TURN();
+  LTRACE(TraceEvent::HttpUpload, totalSamples);
   if (xQueueSend(m_queue, &ev, 0) != pdTRUE) {
     ESP_LOGW(TAG, "Queue full, drop utterance");
-    free(pcmCopy);
-  } else {
-    // Now waiting assistant reply; pause listening until it finishes
-    m_turnBusy.store(true, std::memory_order_relaxed);
+    m_metricDropQueue.inc();
+    m_pcm.swap(*pcm); // keep the reserved buffer for the next utterance
+    delete pcm;
+    m_turnBusy.store(false, std::memory_order_relaxed);
   }
 
   resetCapture();
@@ -394,24 +601,10 @@ void VoiceDialog::tick() {
     return;
   }
 
-  // WebSocket mode: best-effort reconnect + watchdog to avoid being stuck after
-  // a missing "tts stop" / disconnect.
+  // WebSocket mode: watchdog to avoid being stuck after a missing "tts stop" /
+  // disconnect (reconnecting is up to WebSocketChat's ws_conn task).
   if (m_cfg.use_websocket) {
     auto &ws = WebSocketChat::instance();
-    if (!ws.isReady()) {
-      uint32_t now = (uint32_t)xTaskGetTickCount();
-      constexpr uint32_t kReconnectIntervalMs = 3000;
-      if (m_wsLastConnectAttemptTick == 0 ||
-          (uint32_t)((now - m_wsLastConnectAttemptTick) * portTICK_PERIOD_MS) >=
-              kReconnectIntervalMs) {
-        m_wsLastConnectAttemptTick = now;
-        ESP_LOGI(TAG, "WS not ready, reconnecting...");
-        (void)ws.connect();
-      }
-    } else {
-      m_wsLastConnectAttemptTick = 0;
-    }
-
     if (m_turnBusy.load(std::memory_order_relaxed)) {
       if (m_wsTurnBusySinceTick == 0) {
         m_wsTurnBusySinceTick = (uint32_t)xTaskGetTickCount();
@@ -426,9 +619,11 @@ void VoiceDialog::tick() {
         if (ws.getState() == WsDialogState::WaitingForResponse && elapsedMs > kSttTimeoutMs) {
           ESP_LOGW(TAG, "WS STT timeout (%u ms), reset to allow new listening",
                    (unsigned)elapsedMs);
+          m_metricTurnsFailed.inc();
           m_turnBusy.store(false, std::memory_order_relaxed);
           m_wsTurnBusySinceTick = 0;
           m_wsStopListenTick = 0;
+          m_wsSpeechEndTick.store(0, std::memory_order_relaxed);
           m_wsListening = false;
           resetCapture();
         }
@@ -437,12 +632,14 @@ void VoiceDialog::tick() {
         if (elapsedMs > kBusyTimeoutMs) {
           ESP_LOGW(TAG, "WS busy timeout (%u ms), reset dialog turn",
                    (unsigned)elapsedMs);
+          m_metricTurnsFailed.inc();
           if (ws.isReady()) {
             (void)ws.sendAbort();
           }
           m_turnBusy.store(false, std::memory_order_relaxed);
           m_wsTurnBusySinceTick = 0;
           m_wsStopListenTick = 0;
+          m_wsSpeechEndTick.store(0, std::memory_order_relaxed);
           m_wsListening = false;
           resetCapture();
         }
@@ -462,6 +659,27 @@ void VoiceDialog::tick() {
   }
 }
 
+std::string VoiceDialog::statusJson() const {
+  char buf[320];
+  snprintf(buf, sizeof(buf),
+           "{\"session\":%s,\"turn_busy\":%s,\"in_speech\":%s,"
+           "\"gate\":{\"adaptive\":%s,\"mean_abs\":%u,\"noise_floor\":%u,"
+           "\"threshold\":%u},\"utterances\":%u,\"forced_ends\":%u,"
+           "\"barge_in\":%s,\"barge_ins\":%u}",
+           m_sessionActive ? "true" : "false",
+           m_turnBusy.load(std::memory_order_relaxed) ? "true" : "false",
+           m_statInSpeech.load(std::memory_order_relaxed) ? "true" : "false",
+           m_cfg.adaptive_energy_gate ? "true" : "false",
+           (unsigned)m_statMeanAbs.load(std::memory_order_relaxed),
+           (unsigned)m_statNoiseFloor.load(std::memory_order_relaxed),
+           (unsigned)m_statGate.load(std::memory_order_relaxed),
+           (unsigned)m_statUtterances.load(std::memory_order_relaxed),
+           (unsigned)m_statForcedEnds.load(std::memory_order_relaxed),
+           m_cfg.barge_in ? "true" : "false",
+           (unsigned)m_statBargeIns.load(std::memory_order_relaxed));
+  return std::string(buf);
+}
+
 void VoiceDialog::workerTask(void *arg) {
   auto *self = static_cast<VoiceDialog *>(arg);
   if (!self || !self->m_queue) {
@@ -474,53 +692,165 @@ void VoiceDialog::workerTask(void *arg) {
     if (xQueueReceive(self->m_queue, &ev, portMAX_DELAY) != pdTRUE) {
       continue;
     }
-    self->handleUtterance(ev);
-    if (ev.pcm) {
-      free(ev.pcm);
+    switch (ev.kind) {
+    case UtteranceEvent::Kind::Buffered:
+      self->handleUtterance(ev);
+      break;
+    case UtteranceEvent::Kind::StreamStart:
+      self->handleStreamUtterance(ev);
+      break;
+    default:
+      break; // stale StreamEnd/StreamCancel of an already finished stream
     }
+    delete ev.pcm;
   }
 }
 
-void VoiceDialog::handleUtterance(const UtteranceEvent &ev) {
-  if (m_cfg.chat_url.empty()) {
-    ESP_LOGW(TAG, "chat_url empty, skip");
+void VoiceDialog::handleUtterance(UtteranceEvent &ev) {
+  if (m_cfg.chat_url.empty() || !ev.pcm || ev.pcm->empty()) {
+    ESP_LOGW(TAG, "chat_url empty or no audio, skip");
     m_turnBusy.store(false, std::memory_order_relaxed);
     return;
   }
 
-  size_t wavLen = 0;
-  uint8_t *wav = buildWav16Mono(ev.pcm, ev.samples, ev.sample_rate_hz, wavLen);
-  if (!wav || wavLen == 0) {
-    ESP_LOGW(TAG, "build wav failed");
-    if (wav) {
-      free(wav);
-    }
-    m_turnBusy.store(false, std::memory_order_relaxed);
-    return;
-  }
+  // WAV 头 + 录音缓冲分两段写出，不再拼成一整块
+  const size_t pcmBytes = ev.pcm->size() * sizeof(int16_t);
+  uint8_t header[CloudChat::kWavHeaderBytes];
+  CloudChat::fillWavHeader(header, ev.sample_rate_hz, (uint32_t)pcmBytes);
+  const UploadSpan spans[] = {
+      {header, sizeof(header)},
+      {ev.pcm->data(), pcmBytes},
+  };
+  ESP_LOGI(TAG, "Upload wav: bytes=%u", (unsigned)(sizeof(header) + pcmBytes));
 
-  ESP_LOGI(TAG, "Upload wav: bytes=%u", (unsigned)wavLen);
+  auto &chat = prepareChat();
+  WakeWord::instance().touchDialog();
+  esp_err_t err = ESP_OK;
+  if (m_cfg.use_pcm_stream) {
+    err = chat.chatWavPcmStream(spans, 2, m_deviceId);
+  } else {
+    err = chat.chatWav(spans, 2, m_deviceId);
+  }
+  // 播报期间不再需要录音
+  delete ev.pcm;
+  ev.pcm = nullptr;
+  finishTurn(err);
+}
 
+CloudChat &VoiceDialog::prepareChat() {
   auto &chat = CloudChat::instance();
   if (!chat.isInitialized()) {
     chat.init({
         .url = m_cfg.chat_url,
         .timeout_ms = 60000,
-        .max_response_bytes = 2 * 1024 * 1024,
     });
   } else {
     chat.setUrl(m_cfg.chat_url);
   }
+  return chat;
+}
 
+void VoiceDialog::handleStreamUtterance(const UtteranceEvent &start) {
+  // 上一句被取消时留在环里的数据
+  skipStream(start.index);
+
+  auto &chat = prepareChat();
   WakeWord::instance().touchDialog();
-  esp_err_t err = ESP_OK;
-  if (m_cfg.use_pcm_stream) {
-    err = chat.chatWavPcmStream(wav, wavLen, m_deviceId);
-  } else {
-    err = chat.chatWav(wav, wavLen, m_deviceId);
+  esp_err_t err = ESP_ERR_INVALID_STATE;
+  if (!m_cfg.chat_url.empty()) {
+    err = chat.streamBegin(m_deviceId, start.sample_rate_hz,
+                           m_cfg.use_pcm_stream);
+  }
+  if (err != ESP_OK) {
+    // 仍然要消费到 StreamEnd，保持环与检测任务同步
+    ESP_LOGW(TAG, "stream begin failed: %s, drop utterance",
+             esp_err_to_name(err));
+  }
+
+  const TickType_t startTick = xTaskGetTickCount();
+  const TickType_t maxTicks =
+      pdMS_TO_TICKS(m_cfg.max_utterance_ms + kStreamGraceMs);
+  bool ended = false;
+  bool cancelled = false;
+  uint32_t endIndex = 0;
+  while (!ended && !cancelled) {
+    UtteranceEvent ev{};
+    if (xQueueReceive(m_queue, &ev, pdMS_TO_TICKS(kStreamPollMs)) == pdTRUE) {
+      delete ev.pcm;
+      switch (ev.kind) {
+      case UtteranceEvent::Kind::StreamEnd:
+        ended = true;
+        endIndex = ev.index;
+        break;
+      case UtteranceEvent::Kind::StreamCancel:
+        cancelled = true;
+        break;
+      case UtteranceEvent::Kind::StreamStart:
+        // StreamEnd 丢失（队列满）：放弃当前这句，改传新的一句
+        ESP_LOGW(TAG, "Stream restarted before end, drop previous");
+        chat.streamAbort();
+        handleStreamUtterance(ev);
+        return;
+      default:
+        ESP_LOGW(TAG, "Buffered utterance during stream, dropped");
+        break;
+      }
+    }
+    uploadStream(chat, ended ? endIndex - m_streamRing.totalRead()
+                             : UINT32_MAX);
+    if (!ended && !cancelled && xTaskGetTickCount() - startTick > maxTicks) {
+      ESP_LOGW(TAG, "Stream end timeout, abort upload");
+      cancelled = true;
+    }
+  }
+
+  if (cancelled || !chat.streamActive()) {
+    if (cancelled) {
+      ESP_LOGI(TAG, "Stream upload cancelled");
+    } else {
+      ESP_LOGW(TAG, "stream upload failed, drop utterance");
+      m_metricTurnsFailed.inc();
+    }
+    chat.streamAbort();
+    if (uxQueueMessagesWaiting(m_queue) == 0) {
+      m_turnBusy.store(false, std::memory_order_relaxed);
+    }
+    return;
+  }
+  finishTurn(chat.streamFinish());
+}
+
+void VoiceDialog::skipStream(uint32_t index) {
+  uint32_t stale = index - m_streamRing.totalRead();
+  size_t n = std::min(m_streamRing.available(), (size_t)stale);
+  if (n > 0) {
+    m_streamRing.consume(n);
+  }
+}
+
+void VoiceDialog::uploadStream(CloudChat &chat, uint32_t limit) {
+  const int16_t *a = nullptr;
+  const int16_t *b = nullptr;
+  size_t na = 0;
+  size_t nb = 0;
+  size_t avail = m_streamRing.readSpans(&a, &na, &b, &nb);
+  size_t take = std::min(avail, (size_t)limit);
+  if (take == 0) {
+    return;
+  }
+  // 直接从环里发，不再拷贝；上传失败时 CloudChat 已中止请求，这里照常消费
+  size_t fromA = std::min(take, na);
+  if (chat.streamActive() && fromA > 0) {
+    (void)chat.streamWrite(a, fromA);
   }
-  free(wav);
+  if (chat.streamActive() && take > fromA) {
+    (void)chat.streamWrite(b, take - fromA);
+  }
+  m_streamRing.consume(take);
+}
 
+void VoiceDialog::finishTurn(esp_err_t err) {
+  (err == ESP_OK ? m_metricTurnsOk : m_metricTurnsFailed).inc();
   // keep dialog alive while assistant is speaking
   if (err == ESP_OK) {
     while (Mp3Player::instance().getState() != Mp3PlayerState::Idle) {
@@ -531,7 +861,10 @@ void VoiceDialog::handleUtterance(const UtteranceEvent &ev) {
     ESP_LOGW(TAG, "chat failed: %s", esp_err_to_name(err));
   }
 
-  m_turnBusy.store(false, std::memory_order_relaxed);
+  // 被打断时新一句可能已经入队（并置了 busy），不能把它清掉
+  if (uxQueueMessagesWaiting(m_queue) == 0) {
+    m_turnBusy.store(false, std::memory_order_relaxed);
+  }
 }
 
 void VoiceDialog::initWebSocket() {
@@ -545,6 +878,8 @@ void VoiceDialog::initWebSocket() {
   ws_cfg.url = m_cfg.ws_url;
   ws_cfg.device_id = m_deviceId;
   ws_cfg.sample_rate = m_cfg.sample_rate_hz;
+  ws_cfg.uplink_format = m_cfg.ws_uplink_format;
+  ws_cfg.downlink_format = m_cfg.ws_downlink_format;
   
   esp_err_t err = ws.init(ws_cfg);
   if (err != ESP_OK) {
@@ -569,12 +904,18 @@ void VoiceDialog::initWebSocket() {
         m_wsTurnBusySinceTick = (uint32_t)xTaskGetTickCount();
       }
 
-      // 开始 PCM 流播放（S16LE mono）
+      // 开始 PCM 流播放（S16LE mono，或 hello 协商的压缩格式，播放前解码）
       int sr = ws.serverSampleRate();
       if (sr < 8000 || sr > 48000) {
         sr = m_cfg.sample_rate_hz;
       }
-      esp_err_t err = player.pcmStreamBegin((uint32_t)sr, 100);  // 100ms prebuffer
+      // v2 帧头测得的上一轮下行抖动：开播前抬高抖动缓冲目标
+      const WsNetStats net = ws.netStats();
+      if (net.framed) {
+        player.noteNetworkJitter(net.dl_jitter_ms);
+      }
+      esp_err_t err = player.pcmStreamBegin((uint32_t)sr, 100,  // 100ms prebuffer
+                                            ws.downlinkFormat());
       if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start PCM stream: %s", esp_err_to_name(err));
         // Avoid being stuck in busy state if we cannot play audio.
@@ -583,6 +924,7 @@ void VoiceDialog::initWebSocket() {
       }
     } else {
       ESP_LOGI(TAG, "WS TTS stopped");
+      m_metricTurnsOk.inc();
       // 结束 PCM 流
       player.pcmStreamEnd();
       // Full state reset to prepare for next turn
@@ -595,10 +937,16 @@ void VoiceDialog::initWebSocket() {
     }
   });
   
-  // TTS 音频回调：播放收到的 PCM
+  // TTS 音频回调：播放收到的 PCM（压缩格式时每次一个完整的包）
   ws.setOnTtsAudio([this](const uint8_t* data, size_t len) {
     auto& player = Mp3Player::instance();
-    // 写入 PCM 数据到播放流
+    const uint32_t endTick = m_wsSpeechEndTick.exchange(0, std::memory_order_relaxed);
+    if (endTick != 0) {
+      m_metricReplyMs.observe(((uint32_t)xTaskGetTickCount() - endTick) *
+                              portTICK_PERIOD_MS);
+    }
+    // 写入 PCM 数据到播放流（在 ws_rx 任务中调用：缓冲满时在这里等待，
+    // 不会拖住 WebSocket 事件任务与控制消息）
     esp_err_t err = player.pcmStreamWrite(data, len, 500);
     if (err != ESP_OK) {
       ESP_LOGW(TAG, "PCM write failed: %s (len=%u)", esp_err_to_name(err), (unsigned)len);
@@ -626,6 +974,10 @@ void VoiceDialog::initWebSocket() {
   
   m_wsInited = true;
   ESP_LOGI(TAG, "WebSocket initialized: %s", ws_cfg.url.c_str());
+
+  // 开机即建立常驻连接（网络可用后由 ws_conn 任务连上并保持），唤醒后的
+  // 第一句话不用等 TCP / TLS / hello 握手
+  (void)ws.connect();
 }
 
 void VoiceDialog::handleWsAudioFrame(const int16_t *samples, int numSamples,
@@ -647,14 +999,26 @@ void VoiceDialog::handleWsAudioFrame(const int16_t *samples, int numSamples,
     m_ignoreUntilTick = 0;
   }
 
+  // Barge-in (AEC only): abort the reply and open a new turn whose audio
+  // starts with the pre-roll (which already contains this frame).
+  if (replyActive()) {
+    if (detectBargeIn(samples, numSamples, vad)) {
+      bargeIn(false);
+      (void)wsOpenTurn(nullptr, 0);
+    }
+    return;
+  }
+
   // One turn at a time: while waiting assistant reply, ignore new speech.
   if (m_turnBusy.load(std::memory_order_relaxed)) {
     WakeWord::instance().touchDialog();
     return;
   }
 
-  // 播放器正在播报时：不采集，避免回声把自己“听进去”
-  if (Mp3Player::instance().getState() != Mp3PlayerState::Idle) {
+  // 播放器正在播报时：没有 AEC 则不采集，避免回声把自己“听进去”；
+  // 有 AEC 时帧已去除回声，照常处理（播报尾部也能开始说话）
+  if (!WakeWord::instance().aecEnabled() &&
+      Mp3Player::instance().getState() != Mp3PlayerState::Idle) {
     WakeWord::instance().touchDialog();
     return;
   }
@@ -675,79 +1039,25 @@ void VoiceDialog::handleWsAudioFrame(const int16_t *samples, int numSamples,
     return;
   }
 
-  // 计算帧时长
-  if (m_frameMs <= 0) {
-    m_frameMs = std::max(1, (numSamples * 1000) / m_cfg.sample_rate_hz);
-  }
-
   // 本地 VAD + 能量门限：避免噪声导致误触发
-  uint32_t meanAbs = meanAbs16(samples, numSamples);
-  bool speechFrame = (vad == VAD_SPEECH);
-  if (m_cfg.energy_gate_mean_abs > 0 &&
-      meanAbs < (uint32_t)m_cfg.energy_gate_mean_abs) {
-    speechFrame = false;
-  }
-
-  // Pre-roll (avoid cutting the first syllable when we start listening)
-  constexpr int kPreRollMs = 200;
-  size_t preRollSamples =
-      (size_t)((int64_t)kPreRollMs * m_cfg.sample_rate_hz / 1000);
+  EndpointEvent evt = processFrame(samples, numSamples, vad);
 
   // Start a new utterance only when speech is detected (avoid uploading long
   // silence which can confuse the server and waste bandwidth).
-  if (!m_inSpeech) {
-    if (!speechFrame) {
-      if (preRollSamples > 0) {
-        size_t old = m_wsPreRoll.size();
-        m_wsPreRoll.resize(old + (size_t)numSamples);
-        memcpy(m_wsPreRoll.data() + old, samples,
-               (size_t)numSamples * sizeof(int16_t));
-        if (m_wsPreRoll.size() > preRollSamples) {
-          size_t drop = m_wsPreRoll.size() - preRollSamples;
-          m_wsPreRoll.erase(m_wsPreRoll.begin(), m_wsPreRoll.begin() + drop);
-        }
-      }
-      return;
-    }
-
-    if (ws.getState() == WsDialogState::Connected) {
-      esp_err_t err = ws.startListening();
-      if (err != ESP_OK) {
-        ESP_LOGW(TAG, "WS startListening failed: %s", esp_err_to_name(err));
-        return;
-      }
-    } else if (ws.getState() != WsDialogState::Listening) {
-      // Handshake not complete or in an unexpected state.
-      return;
-    }
-
-    m_wsListening = true;
-    m_inSpeech = true;
-    m_speechMs = m_frameMs;
-    m_silenceMs = 0;
-
-    ESP_LOGI(TAG, "WS speech start (meanAbs=%u)", (unsigned)meanAbs);
-
-    // Flush pre-roll first (if any)
-    if (!m_wsPreRoll.empty()) {
-      (void)ws.sendAudio((const uint8_t *)m_wsPreRoll.data(),
-                         m_wsPreRoll.size() * sizeof(int16_t));
-      m_wsPreRoll.clear();
-    }
+  if (evt == EndpointEvent::None) {
+    appendPreRoll(samples, numSamples,
+                  msToSamples(m_cfg.preroll_ms, m_cfg.sample_rate_hz));
+    return;
+  }
 
-    (void)ws.sendAudio((const uint8_t *)samples,
-                       (size_t)numSamples * sizeof(int16_t));
-    WakeWord::instance().touchDialog();
+  if (evt == EndpointEvent::SpeechStart) {
+    (void)wsOpenTurn(samples, numSamples);
     return;
   }
 
   // In speech: stream frames (including short trailing silence for STT).
-  if (speechFrame) {
-    m_speechMs += m_frameMs;
-    m_silenceMs = 0;
+  if (m_endpointer.lastFrameSpeech()) {
     WakeWord::instance().touchDialog();
-  } else {
-    m_silenceMs += m_frameMs;
   }
 
   if (m_wsListening) {
@@ -755,29 +1065,68 @@ void VoiceDialog::handleWsAudioFrame(const int16_t *samples, int numSamples,
                        (size_t)numSamples * sizeof(int16_t));
   }
 
-  bool shouldStop = false;
-  if (m_speechMs >= m_cfg.min_speech_ms &&
-      m_silenceMs >= m_cfg.end_silence_ms) {
-    shouldStop = true;
-  }
-  if (m_speechMs >= m_cfg.max_utterance_ms) {
-    shouldStop = true;
-  }
-
-  if (shouldStop) {
-    ESP_LOGI(TAG, "WS speech end: speech=%dms silence=%dms", m_speechMs,
-             m_silenceMs);
+  if (evt == EndpointEvent::End || evt == EndpointEvent::ForcedEnd) {
+    ESP_LOGI(TAG, "WS speech end: speech=%dms silence=%dms forced=%d",
+             m_endpointer.speechMs(), m_endpointer.silenceMs(),
+             evt == EndpointEvent::ForcedEnd ? 1 : 0);
     (void)ws.stopListening();
     m_wsListening = false;
-    m_wsPreRoll.clear();
-    m_inSpeech = false;
-    m_speechMs = 0;
-    m_silenceMs = 0;
+    m_wsPreRoll.reset();
 
     // Wait for assistant reply (tts start/stop). Prevent overlapping turns.
     uint32_t now = (uint32_t)xTaskGetTickCount();
     m_wsTurnBusySinceTick = now;
     m_wsStopListenTick = now;  // Track when we stopped for STT timeout
+    // 回复延迟从最后一个语音帧算起（含端点检测等待的尾部静音）
+    const uint32_t endTick =
+        now - (uint32_t)pdMS_TO_TICKS(m_endpointer.silenceMs());
+    m_wsSpeechEndTick.store(endTick != 0 ? endTick : 1,
+                            std::memory_order_relaxed);
     m_turnBusy.store(true, std::memory_order_relaxed);
   }
 }
+
+bool VoiceDialog::wsOpenTurn(const int16_t *samples, int numSamples) {
+  auto &ws = WebSocketChat::instance();
+  if (ws.getState() == WsDialogState::Connected) {
+    esp_err_t err = ws.startListening();
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "WS startListening failed: %s", esp_err_to_name(err));
+      m_endpointer.reset();
+      return false;
+    }
+  } else if (ws.getState() != WsDialogState::Listening) {
+    // Handshake not complete or in an unexpected state.
+    m_endpointer.reset();
+    return false;
+  }
+
+  m_wsListening = true;
+
+  ESP_LOGI(TAG, "WS speech start (meanAbs=%u gate=%u floor=%u)",
+           (unsigned)m_endpointer.lastMeanAbs(),
+           (unsigned)m_endpointer.gate().threshold(),
+           (unsigned)m_endpointer.gate().noiseFloor());
+
+  // Flush pre-roll first (if any): both ring spans go out as they are
+  const int16_t *a = nullptr;
+  const int16_t *b = nullptr;
+  size_t na = 0;
+  size_t nb = 0;
+  if (m_wsPreRoll.readSpans(&a, &na, &b, &nb) > 0) {
+    if (na > 0) {
+      (void)ws.sendAudio((const uint8_t *)a, na * sizeof(int16_t));
+    }
+    if (nb > 0) {
+      (void)ws.sendAudio((const uint8_t *)b, nb * sizeof(int16_t));
+    }
+    m_wsPreRoll.consume(na + nb);
+  }
+
+  if (samples != nullptr && numSamples > 0) {
+    (void)ws.sendAudio((const uint8_t *)samples,
+                       (size_t)numSamples * sizeof(int16_t));
+  }
+  WakeWord::instance().touchDialog();
+  return true;
+}
@@ -1,37 +1,73 @@
 #pragma once
 
+#include "audio_ring.h"
 #include "esp_err.h"
 #include "esp_vad.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/task.h"
+#include "metrics.h"
+#include "speech_endpointer.h"
 
 #include <atomic>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+class CloudChat;
+
 struct VoiceDialogConfig {
   std::string chat_url; // e.g. http://192.168.1.10:8000/chat
   std::string ws_url;   // e.g. ws://192.168.1.10:8000/ws (for WebSocket mode)
   bool use_websocket = false; // true: use WebSocket streaming, false: use HTTP
+  // WebSocket uplink format offered in hello ("pcm" / "adpcm" / "opus").
+  std::string ws_uplink_format = "pcm";
+  // WebSocket TTS format requested in hello; decoded just before playback.
+  std::string ws_downlink_format = "pcm";
   int sample_rate_hz = 16000;
   bool use_pcm_stream = false; // server returns streaming PCM instead of WAV
+  // HTTP mode: open a chunked POST at speech start and upload frames while the
+  // user is still speaking, instead of buffering the whole utterance.
+  bool stream_upload = false;
 
   int min_speech_ms = 300;
   int end_silence_ms = 450;
+  // Forced end of an utterance. HTTP: total length incl. pauses (the PCM
+  // buffer is sized by max_pcm_ms). WebSocket: speech time only, pauses
+  // inside the utterance do not count.
   int max_utterance_ms = 8000;
   int max_pcm_ms = 10000; // hard cap to avoid OOM
   // Mean-absolute-amplitude gate for speech detection.
   // If > 0, frames with mean(|pcm|) below this value will be treated as
   // non-speech even if VAD says speech. Helps reduce false triggers and
   // avoids being "stuck" in speech due to noise.
+  // Only used when adaptive_energy_gate is false.
   int energy_gate_mean_abs = 0;
 
+  // Adaptive gate: track the background noise floor and require speech to be
+  // gate_snr_db above it (clamped to [gate_min_mean_abs, gate_max_mean_abs]).
+  bool adaptive_energy_gate = false;
+  int gate_snr_db = 8;
+  int gate_min_mean_abs = 40;
+  int gate_max_mean_abs = 3000;
+  int noise_floor_attack_ms = 1500;  // floor rising towards louder noise
+  int noise_floor_release_ms = 150;  // floor falling when it gets quieter
+
   // After a local command is detected, ignore dialog audio frames for a short
   // period to avoid accidentally uploading the command utterance to cloud chat.
   int local_command_ignore_ms = 800;
 
+  // WebSocket mode: audio kept from before speech start and sent ahead of the
+  // first speech frame, so soft onsets are not clipped.
+  int preroll_ms = 200;
+
+  // Barge-in (requires AEC): while the assistant is speaking, keep running the
+  // endpointer on echo-cancelled frames; once the user has talked for
+  // barge_in_min_speech_ms, abort the reply, flush playback and open a new
+  // turn that starts with the buffered pre-roll.
+  bool barge_in = false;
+  int barge_in_min_speech_ms = 200;
+
   int worker_stack = 8192;
   int worker_prio = 4;
   int worker_core = 0;
@@ -44,6 +80,12 @@ public:
   void onWakeDetected();
   void onLocalCommandDetected();
 
+  /**
+   * @brief 播报期间检测到唤醒词（WakeWord::setBargeInCallback）：打断播报，
+   *        下一句话照常开启新一轮
+   */
+  void onWakeDuringReply();
+
   /**
    * @brief 对话模式音频帧输入（从 WakeWord::setAudioFrameCallback 喂入）
    */
@@ -54,21 +96,55 @@ public:
    */
   void tick();
 
+  /**
+   * @brief 端点检测/能量门限状态（JSON 对象字符串，供网页 /api/status）
+   */
+  std::string statusJson() const;
+
 private:
   struct UtteranceEvent {
-    int16_t *pcm = nullptr; // malloc owned; worker will free
-    size_t samples = 0;
+    std::vector<int16_t> *pcm = nullptr; // owned (capture buffer handed over)
     int sample_rate_hz = 16000;
+
+    // stream_upload: audio goes through m_streamRing; index is the absolute
+    // ring sample position where the utterance starts (StreamStart) or ends
+    // (StreamEnd).
+    enum class Kind : uint8_t { Buffered, StreamStart, StreamEnd, StreamCancel };
+    Kind kind = Kind::Buffered;
+    uint32_t index = 0;
   };
 
   static void workerTask(void *arg);
-  void handleUtterance(const UtteranceEvent &ev);
+  void handleUtterance(UtteranceEvent &ev);
+  void handleStreamUtterance(const UtteranceEvent &start);
+  CloudChat &prepareChat();
+  void finishTurn(esp_err_t err);
+  void drainQueue();
+
+  // Streaming upload helpers (detect task)
+  bool beginStream(const int16_t *samples, size_t numSamples);
+  void streamFrame(const int16_t *samples, size_t numSamples);
+  void cancelStream();
+  // Streaming upload helpers (worker task)
+  void skipStream(uint32_t index);
+  void uploadStream(CloudChat &chat, uint32_t limit);
   void resetCapture();
-  bool shouldFinalizeOnSilence() const;
+  void appendCapture(const int16_t *samples, size_t numSamples);
+  EndpointEvent processFrame(const int16_t *samples, int numSamples,
+                             vad_state_t vad);
+
+  // Barge-in helpers
+  bool replyActive();
+  bool detectBargeIn(const int16_t *samples, int numSamples, vad_state_t vad);
+  void bargeIn(bool byWakeWord);
+  void appendPreRoll(const int16_t *samples, int numSamples, size_t maxSamples);
+
+  void registerMetrics();
   
   // WebSocket mode helpers
   void initWebSocket();
   void handleWsAudioFrame(const int16_t *samples, int numSamples, vad_state_t vad);
+  bool wsOpenTurn(const int16_t *samples, int numSamples);
 
   VoiceDialogConfig m_cfg;
   bool m_inited = false;
@@ -76,13 +152,29 @@ private:
   // capture state (called from WakeWord detect task)
   bool m_sessionActive = false;
   std::atomic<bool> m_turnBusy{false}; // one user turn at a time
-  bool m_inSpeech = false;
-  bool m_dropCurrentUtterance = false;
-  int m_speechMs = 0;
-  int m_silenceMs = 0;
-  int m_frameMs = 0;
+  SpeechEndpointer m_endpointer;
   uint32_t m_ignoreUntilTick = 0;
   std::vector<int16_t> m_pcm;
+  size_t m_pcmReserve = 0; // capacity re-reserved after a hand-over
+
+  // status snapshot (written by the detect task, read by the web server)
+  std::atomic<uint32_t> m_statMeanAbs{0};
+  std::atomic<uint32_t> m_statNoiseFloor{0};
+  std::atomic<uint32_t> m_statGate{0};
+  std::atomic<bool> m_statInSpeech{false};
+  std::atomic<uint32_t> m_statUtterances{0};
+  std::atomic<uint32_t> m_statForcedEnds{0};
+  std::atomic<uint32_t> m_statBargeIns{0};
+
+  // barge-in state (detect task)
+  int m_bargeSpeechMs = 0;    // consecutive speech while the reply plays
+  bool m_bargeInHold = false; // barged in; wait for playback to go idle
+
+  // streaming upload: detect task writes, worker reads
+  AudioRing<int16_t> m_streamRing;
+  // (positions are the ring's totalWritten()/totalRead() sample counters)
+  bool m_streamOpen = false;    // detect task: current utterance is streaming
+  uint32_t m_streamStart = 0;   // detect task: ring position at speech start
 
   // worker
   QueueHandle_t m_queue = nullptr;
@@ -93,8 +185,45 @@ private:
   // WebSocket mode state
   bool m_wsInited = false;
   bool m_wsListening = false;
-  uint32_t m_wsLastConnectAttemptTick = 0;
   uint32_t m_wsTurnBusySinceTick = 0;
   uint32_t m_wsStopListenTick = 0;  // Tick when stopListening was sent (for STT timeout)
-  std::vector<int16_t> m_wsPreRoll;
+  // 本轮最后一个语音帧的 tick（0 = 无待测回复）；检测任务写，ws_rx 任务在
+  // 首个下行音频包时取走
+  std::atomic<uint32_t> m_wsSpeechEndTick{0};
+  AudioRing<int16_t> m_wsPreRoll; // pre-roll, only touched by the detect task
+
+  // /api/metrics
+  static constexpr uint32_t kReplyBoundsMs[] = {250,  500,  750,  1000, 1500,
+                                                2000, 3000, 5000, 8000};
+  MetricCounter m_metricTurnsOk{"dino_dialog_turns_total",
+                                "Dialog turns by outcome", "result=\"ok\""};
+  MetricCounter m_metricTurnsFailed{"dino_dialog_turns_total",
+                                    "Dialog turns by outcome",
+                                    "result=\"error\""};
+  MetricCounter m_metricDropQueue{"dino_dialog_dropped_total",
+                                  "Utterances / stream events dropped",
+                                  "reason=\"queue_full\""};
+  MetricCounter m_metricDropNoMem{"dino_dialog_dropped_total",
+                                  "Utterances / stream events dropped",
+                                  "reason=\"no_mem\""};
+  MetricCounter m_metricDropRing{"dino_dialog_dropped_total",
+                                 "Utterances / stream events dropped",
+                                 "reason=\"stream_ring_full\""};
+  MetricCounter m_metricUtterances{
+      "dino_dialog_utterances_total", "Utterances closed by the endpointer",
+      [this] { return m_statUtterances.load(std::memory_order_relaxed); }};
+  MetricCounter m_metricForcedEnds{
+      "dino_dialog_forced_ends_total", "Utterances cut at max length",
+      [this] { return m_statForcedEnds.load(std::memory_order_relaxed); }};
+  MetricCounter m_metricBargeIns{
+      "dino_dialog_barge_ins_total", "Replies interrupted by the user",
+      [this] { return m_statBargeIns.load(std::memory_order_relaxed); }};
+  MetricGauge m_metricNoiseFloor{
+      "dino_dialog_noise_floor", "Tracked noise floor (mean abs)",
+      [this] { return (double)m_statNoiseFloor.load(std::memory_order_relaxed); }};
+  // WebSocket：最后一个语音帧到首个下行音频包（端点静音 + STT + LLM + TTS 首包）
+  MetricHistogram m_metricReplyMs{
+      "dino_dialog_reply_latency_ms", "End of speech to first reply audio",
+      kReplyBoundsMs, sizeof(kReplyBoundsMs) / sizeof(kReplyBoundsMs[0]),
+      "mode=\"ws\""};
 };
@@ -5,16 +5,14 @@
  * 使用 ESP-SR V2.0 框架的 AFE (Audio Front-End)、WakeNet 和 MultiNet
  * 引擎实现语音唤醒检测和命令词识别。
  *
- * 支持的命令词：
- * - "开灯" (ID: 0)
- * - "关灯" (ID: 1)
- * - "前进" (ID: 2)
- * - "后退" (ID: 3)
- * - "神龙摆尾" (ID: 4)
+ * 命令词来自 CommandTable（默认：开灯/关灯/前进/后退/神龙摆尾，ID 0-4），
+ * 运行时修改后由检测任务在两帧之间热加载到 MultiNet。
  */
 
 #include "wake_word.h"
 
+#include "audio_dsp.h"
+#include "command_table.h"
 #include "driver/i2s_std.h"
 #include "esp_afe_sr_models.h"
 #include "esp_log.h"
@@ -22,8 +20,11 @@
 #include "esp_mn_speech_commands.h"
 
 #include "esp_wn_iface.h"
+#include "latency_trace.h"
 #include "mp3_player.h"
 #include "model_path.h"
+#include <algorithm>
+#include <cstdio>
 #include <string.h>
 
 static const char *TAG = "WakeWord";
@@ -31,17 +32,14 @@ static const char *TAG = "WakeWord";
 // 音频配置
 static constexpr int AUDIO_SAMPLE_RATE = 16000;
 
-// 命令词定义
-static const char *COMMANDS[] = {
-    "kai deng",         // 开灯
-    "guan deng",        // 关灯
-    "qian jin",         // 前进
-    "hou tui",          // 后退
-    "shen long bai wei" // 神龙摆尾
-};
-static const char *COMMAND_NAMES[] = {"开灯", "关灯", "前进", "后退",
-                                      "神龙摆尾"};
-static constexpr int NUM_COMMANDS = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+// 采集环长度：吸收 feed()/core 0 抖动，至少容纳 4 个 feed chunk
+static constexpr int CAPTURE_RING_MS = 256;
+static constexpr int CAPTURE_RING_MIN_CHUNKS = 4;
+// feed 任务超过该时长拿不到一个 chunk 记为一次欠载
+static constexpr int CAPTURE_STALL_MS = 200;
+
+// 命令词热加载：等待检测任务应用新表的最长时间
+static constexpr int COMMAND_RELOAD_TIMEOUT_MS = 3000;
 
 // ============= 单例实现 =============
 
@@ -78,60 +76,204 @@ void WakeWord::setDialogConfig(const DialogConfig &cfg) {
 
 // ============= 任务函数 =============
 
+void WakeWord::audioCaptureTask(void *arg) {
+  auto &self = WakeWord::instance();
+
+  const size_t chunk = (size_t)self.m_feedChunkSamples;
+
+  // 环满时仍要把 DMA 中的数据读走，读入丢弃缓冲并计为溢出
+  int16_t *discard = (int16_t *)malloc(chunk * sizeof(int16_t));
+  if (discard == nullptr) {
+    ESP_LOGE(TAG, "无法分配采集丢弃缓冲区");
+    vTaskDelete(nullptr);
+    return;
+  }
+
+  ESP_LOGI(TAG, "音频采集任务已启动, ring=%u samples",
+           (unsigned)self.m_captureRing.capacity());
+
+  while (self.m_running) {
+    size_t span = 0;
+    int16_t *dst = self.m_captureRing.writeSpan(&span);
+    bool dropping = (span == 0);
+    if (dropping) {
+      dst = discard;
+      span = chunk;
+    } else if (span > chunk) {
+      span = chunk;
+    }
+
+    size_t bytesRead = 0;
+    esp_err_t ret = i2s_channel_read(self.m_i2sRxHandle, dst,
+                                     span * sizeof(int16_t), &bytesRead,
+                                     portMAX_DELAY);
+    if (ret != ESP_OK || bytesRead == 0) {
+      ESP_LOGW(TAG, "I2S 读取失败: ret=%d, bytesRead=%u", ret,
+               (unsigned)bytesRead);
+      self.m_metricI2sErrors.inc();
+      continue;
+    }
+
+    LTRACE(TraceEvent::I2sReadDone, bytesRead / sizeof(int16_t));
+
+    if (dropping) {
+      self.m_captureRing.noteOverflow();
+      continue;
+    }
+
+    self.m_captureRing.commit(bytesRead / sizeof(int16_t));
+    if (self.m_captureRing.available() >= chunk && self.m_feedTaskHandle) {
+      xTaskNotifyGive(self.m_feedTaskHandle);
+    }
+  }
+
+  free(discard);
+  ESP_LOGI(TAG, "音频采集任务已退出");
+  vTaskDelete(nullptr);
+}
+
 void WakeWord::audioFeedTask(void *arg) {
   auto &self = WakeWord::instance();
 
-  int chunkSize = self.m_afeHandle->get_feed_chunksize(self.m_afeData);
-  int16_t *buffer = (int16_t *)malloc(chunkSize * sizeof(int16_t));
+  const size_t chunk = (size_t)self.m_feedChunkSamples;
+
+  const size_t channels = (size_t)self.m_feedChannels;
 
-  if (buffer == nullptr) {
+  // 仅在 chunk 跨越环尾时使用；其余情况直接把环内指针交给 AFE
+  int16_t *scratch = (int16_t *)malloc(chunk * sizeof(int16_t));
+  // "MR" 格式：参考信号 + 交织后的 feed 缓冲
+  int16_t *refBuf = nullptr;
+  int16_t *interleaved = nullptr;
+  if (channels > 1) {
+    refBuf = (int16_t *)malloc(chunk * sizeof(int16_t));
+    interleaved = (int16_t *)malloc(chunk * channels * sizeof(int16_t));
+  }
+  if (scratch == nullptr ||
+      (channels > 1 && (refBuf == nullptr || interleaved == nullptr))) {
     ESP_LOGE(TAG, "无法分配音频缓冲区");
+    free(scratch);
+    free(refBuf);
+    free(interleaved);
     vTaskDelete(nullptr);
     return;
   }
 
-  ESP_LOGI(TAG, "音频采集任务已启动, chunk size: %d", chunkSize);
+  ESP_LOGI(TAG, "AFE feed 任务已启动, chunk size: %u, channels: %u",
+           (unsigned)chunk, (unsigned)channels);
 
-  size_t bytesRead = 0;
-  uint32_t totalChunks = 0;
-  int16_t maxLevel = 0;
+  uint16_t maxLevel = 0;
   TickType_t lastLogTime = xTaskGetTickCount();
 
   while (self.m_running) {
-    esp_err_t ret = i2s_channel_read(self.m_i2sRxHandle, buffer,
-                                     chunkSize * sizeof(int16_t), &bytesRead,
-                                     portMAX_DELAY);
-    if (ret == ESP_OK && bytesRead > 0) {
-      // 计算音频电平（找最大值）
-      for (int i = 0; i < chunkSize; i++) {
-        int16_t absVal = buffer[i] > 0 ? buffer[i] : -buffer[i];
-        if (absVal > maxLevel) {
-          maxLevel = absVal;
-        }
+    if (self.m_captureRing.available() < chunk) {
+      if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CAPTURE_STALL_MS)) == 0 &&
+          self.m_running) {
+        self.m_captureRing.noteUnderrun();
       }
+      continue;
+    }
 
-      self.m_afeHandle->feed(self.m_afeData, buffer);
-      totalChunks++;
+    const int16_t *a = nullptr;
+    const int16_t *b = nullptr;
+    size_t na = 0;
+    size_t nb = 0;
+    self.m_captureRing.readSpans(&a, &na, &b, &nb);
+
+    const int16_t *frame = a;
+    if (na < chunk) {
+      memcpy(scratch, a, na * sizeof(int16_t));
+      memcpy(scratch + na, b, (chunk - na) * sizeof(int16_t));
+      frame = scratch;
+    }
 
-      // 每 5 秒打印一次调试信息
-      TickType_t currentTime = xTaskGetTickCount();
-      if ((currentTime - lastLogTime) * portTICK_PERIOD_MS >= 5000) {
-        ESP_LOGI(TAG, "📊 音频统计: chunks=%lu, 最大电平=%d, 读取字节=%u",
-                 totalChunks, maxLevel, (unsigned)bytesRead);
-        maxLevel = 0; // 重置
-        lastLogTime = currentTime;
+    // 计算音频电平（找最大值）
+    uint16_t level = audio_dsp::peakAbs16(frame, chunk);
+    if (level > maxLevel) {
+      maxLevel = level;
+    }
+
+    if (channels > 1) {
+      // 逐样本交织：麦克风在前，播放参考在后（与 "MR" 一致）
+      self.fillReference(refBuf, chunk);
+      for (size_t i = 0; i < chunk; i++) {
+        interleaved[i * channels] = frame[i];
+        interleaved[i * channels + 1] = refBuf[i];
+        for (size_t c = 2; c < channels; c++) {
+          interleaved[i * channels + c] = 0;
+        }
       }
+      self.m_afeHandle->feed(self.m_afeData, interleaved);
     } else {
-      ESP_LOGW(TAG, "I2S 读取失败: ret=%d, bytesRead=%u", ret,
-               (unsigned)bytesRead);
+      self.m_afeHandle->feed(self.m_afeData, frame);
+    }
+    self.m_captureRing.consume(chunk);
+    uint32_t totalChunks =
+        self.m_fedChunks.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // 每 5 秒打印一次调试信息
+    TickType_t currentTime = xTaskGetTickCount();
+    if ((currentTime - lastLogTime) * portTICK_PERIOD_MS >= 5000) {
+      ESP_LOGI(TAG,
+               "📊 音频统计: chunks=%lu, 最大电平=%d, overflow=%lu, "
+               "underrun=%lu, 最高水位=%lu/%u",
+               (unsigned long)totalChunks, maxLevel,
+               (unsigned long)self.m_captureRing.overflows(),
+               (unsigned long)self.m_captureRing.underruns(),
+               (unsigned long)self.m_captureRing.highWater(),
+               (unsigned)self.m_captureRing.capacity());
+      maxLevel = 0; // 重置
+      lastLogTime = currentTime;
     }
   }
 
-  free(buffer);
-  ESP_LOGI(TAG, "音频采集任务已退出");
+  free(scratch);
+  free(refBuf);
+  free(interleaved);
+  ESP_LOGI(TAG, "AFE feed 任务已退出");
   vTaskDelete(nullptr);
 }
 
+void WakeWord::fillReference(int16_t *dst, size_t n) {
+  AudioRing<int16_t> *ring =
+      m_aecEnabled ? Mp3Player::instance().referenceRing() : nullptr;
+  size_t avail = ring ? ring->available() : 0;
+  if (avail == 0) {
+    m_refActive = false;
+    memset(dst, 0, n * sizeof(int16_t));
+    return;
+  }
+
+  const size_t msToSamples = AUDIO_SAMPLE_RATE / 1000;
+  if (!m_refActive) {
+    // 新一段播放：参考信号先补静音，对齐功放/声学延迟
+    m_refActive = true;
+    m_refDelayRemaining = (size_t)std::max(0, m_aecCfg.ref_delay_ms) *
+                          msToSamples;
+  }
+
+  // 积压过多（例如 feed 任务曾暂停）：丢弃最旧的参考，限制其相对麦克风的滞后
+  size_t maxLag = (size_t)std::max(0, m_aecCfg.ref_delay_ms +
+                                          m_aecCfg.max_ref_lag_ms) *
+                      msToSamples +
+                  n;
+  if (avail > maxLag) {
+    ring->consume(avail - maxLag);
+    m_refTrimmed.fetch_add((uint32_t)(avail - maxLag),
+                           std::memory_order_relaxed);
+  }
+
+  size_t pos = 0;
+  if (m_refDelayRemaining > 0) {
+    pos = std::min(n, m_refDelayRemaining);
+    memset(dst, 0, pos * sizeof(int16_t));
+    m_refDelayRemaining -= pos;
+  }
+  pos += ring->read(dst + pos, n - pos);
+  if (pos < n) {
+    memset(dst + pos, 0, (n - pos) * sizeof(int16_t));
+  }
+}
+
 void WakeWord::detectTask(void *arg) {
   auto &self = WakeWord::instance();
 
@@ -159,6 +301,7 @@ void WakeWord::detectTask(void *arg) {
     self.m_state = WakeWordState::Running;
     self.m_prevVadSpeech = false;
     self.m_prevSpeakerPlaying = false;
+    self.m_dialogWakenetOn = false;
     self.m_exitDialogRequested.store(false, std::memory_order_relaxed);
 
     // 清理 MultiNet 状态
@@ -181,11 +324,27 @@ void WakeWord::detectTask(void *arg) {
     if (res == nullptr || res->ret_value == ESP_FAIL) {
       continue;
     }
+    LTRACE(TraceEvent::AfeFetch, res->vad_state);
+    self.m_metricAfeFrames.inc();
+
+    // 命令表热加载：在两次 detect 之间更新 MultiNet，不与识别并发
+    if (self.m_reloadRequested.exchange(false, std::memory_order_acquire)) {
+      self.m_reloadResult = self.registerCommands(&self.m_reloadError);
+      if (self.m_mnHandle && self.m_mnData) {
+        self.m_mnHandle->clean(self.m_mnData);
+      }
+      TaskHandle_t waiter =
+          self.m_reloadWaiter.load(std::memory_order_acquire);
+      if (waiter != nullptr) {
+        xTaskNotifyGive(waiter);
+      }
+    }
 
     // 检测到唤醒词（仅在等待唤醒阶段处理）
     if (self.m_state == WakeWordState::Running &&
         res->wakeup_state == WAKENET_DETECTED) {
       ESP_LOGI(TAG, "🎤 唤醒词检测到! 索引: %d", res->wake_word_index);
+      self.m_metricWakes.inc();
 
       self.m_state = WakeWordState::Detected;
 
@@ -209,6 +368,7 @@ void WakeWord::detectTask(void *arg) {
         self.m_state = WakeWordState::Dialog;
         self.m_prevVadSpeech = false;
         self.m_prevSpeakerPlaying = false;
+        self.m_dialogWakenetOn = false;
         self.m_dialogLastActivityTick.store((uint32_t)xTaskGetTickCount(),
                                             std::memory_order_relaxed);
         self.m_exitDialogRequested.store(false, std::memory_order_relaxed);
@@ -223,7 +383,9 @@ void WakeWord::detectTask(void *arg) {
 
     // 对话模式：持续输出音频帧 + 可选本地命令识别
     if (self.m_state == WakeWordState::Dialog) {
+      // 有 AEC 时播报期间的音频已去除回声：照常刷新活跃时间、做本地命令识别
       bool speakerPlaying =
+          !self.m_aecEnabled &&
           (Mp3Player::instance().getState() != Mp3PlayerState::Idle);
 
       // 用户有语音 -> 刷新会话活跃时间
@@ -232,9 +394,29 @@ void WakeWord::detectTask(void *arg) {
                                             std::memory_order_relaxed);
       }
 
+      // 播报打断：有 AEC 时播报期间打开 WakeNet，说唤醒词即可打断播报
+      if (self.m_bargeInCallback && self.m_aecEnabled) {
+        bool playing =
+            Mp3Player::instance().getState() != Mp3PlayerState::Idle;
+        if (playing != self.m_dialogWakenetOn) {
+          self.m_dialogWakenetOn = playing;
+          if (playing) {
+            self.m_afeHandle->enable_wakenet(self.m_afeData);
+          } else {
+            self.m_afeHandle->disable_wakenet(self.m_afeData);
+          }
+        }
+        if (playing && res->wakeup_state == WAKENET_DETECTED) {
+          ESP_LOGI(TAG, "🎤 播报中检测到唤醒词，打断播报");
+          self.m_metricBargeWakes.inc();
+          self.m_bargeInCallback();
+        }
+      }
+
       // 音频帧回调（对话录音/上传由外部完成；这里不做耗时操作）
       if (self.m_audioFrameCallback && res->data && res->data_size > 0) {
         int samples = res->data_size / (int)sizeof(int16_t);
+        LTRACE(TraceEvent::FrameCallback, samples);
         self.m_audioFrameCallback(res->data, samples, res->vad_state);
       }
 
@@ -286,16 +468,15 @@ void WakeWord::detectTask(void *arg) {
 
             if (mnResult != nullptr && mnResult->num > 0) {
               int commandId = mnResult->command_id[0];
-              if (commandId >= 0 && commandId < NUM_COMMANDS) {
-                const char *commandName = COMMAND_NAMES[commandId];
-
+              CommandEntry entry;
+              if (CommandTable::instance().lookup(commandId, entry)) {
                 ESP_LOGI(
                     TAG,
                     "✅ 命令词识别成功(对话中): %s (ID: %d, 置信度: %.2f)",
-                    commandName, commandId, mnResult->prob[0]);
+                    entry.name.c_str(), commandId, mnResult->prob[0]);
 
                 if (self.m_commandCallback) {
-                  self.m_commandCallback(commandId, commandName);
+                  self.m_commandCallback(commandId, entry.name.c_str());
                 }
               } else {
                 ESP_LOGW(TAG, "Invalid command id from MultiNet: %d",
@@ -343,14 +524,17 @@ void WakeWord::detectTask(void *arg) {
 
         if (mnResult != nullptr && mnResult->num > 0) {
           int commandId = mnResult->command_id[0];
-          const char *commandName = COMMAND_NAMES[commandId];
-
-          ESP_LOGI(TAG, "✅ 命令词识别成功: %s (ID: %d, 置信度: %.2f)",
-                   commandName, commandId, mnResult->prob[0]);
-
-          // 调用命令回调
-          if (self.m_commandCallback) {
-            self.m_commandCallback(commandId, commandName);
+          CommandEntry entry;
+          if (!CommandTable::instance().lookup(commandId, entry)) {
+            ESP_LOGW(TAG, "Invalid command id from MultiNet: %d", commandId);
+          } else {
+            ESP_LOGI(TAG, "✅ 命令词识别成功: %s (ID: %d, 置信度: %.2f)",
+                     entry.name.c_str(), commandId, mnResult->prob[0]);
+
+            // 调用命令回调
+            if (self.m_commandCallback) {
+              self.m_commandCallback(commandId, entry.name.c_str());
+            }
           }
         }
 
@@ -420,12 +604,15 @@ esp_err_t WakeWord::initAfe() {
   }
 
   // 使用 ESP-SR V2.0 的新 API
-  // "M" = 单麦克风通道
-  m_afeConfig = afe_config_init("M", m_models, AFE_TYPE_SR, AFE_MODE_LOW_COST);
+  // "M" = 单麦克风通道；"MR" = 麦克风 + 播放参考（开启 AEC）
+  const char *inputFormat = m_aecCfg.enabled ? "MR" : "M";
+  m_afeConfig =
+      afe_config_init(inputFormat, m_models, AFE_TYPE_SR, AFE_MODE_LOW_COST);
   if (m_afeConfig == nullptr) {
     ESP_LOGE(TAG, "AFE 配置初始化失败");
     return ESP_ERR_NO_MEM;
   }
+  m_afeConfig->aec_init = m_aecCfg.enabled;
 
   afe_config_print(m_afeConfig);
 
@@ -485,43 +672,114 @@ esp_err_t WakeWord::initMultiNet() {
   return ESP_OK;
 }
 
-esp_err_t WakeWord::registerCommands() {
+esp_err_t WakeWord::registerCommands(std::string *error) {
+  const std::vector<CommandEntry> entries = CommandTable::instance().entries();
+
   // 清除现有命令
   esp_mn_commands_clear();
 
   // 添加命令词
-  for (int i = 0; i < NUM_COMMANDS; i++) {
-    esp_err_t ret = esp_mn_commands_add(i, (char *)COMMANDS[i]);
+  for (const auto &e : entries) {
+    esp_err_t ret = esp_mn_commands_add(e.id, (char *)e.phrase.c_str());
     if (ret != ESP_OK) {
-      ESP_LOGE(TAG, "添加命令词失败: %s", COMMANDS[i]);
+      ESP_LOGE(TAG, "添加命令词失败: %s", e.phrase.c_str());
+      if (error) {
+        *error = "rejected phrase: " + e.phrase;
+      }
       return ret;
     }
-    ESP_LOGI(TAG, "注册命令词 [%d]: %s (%s)", i, COMMAND_NAMES[i], COMMANDS[i]);
+    ESP_LOGI(TAG, "注册命令词 [%d]: %s (%s)", e.id, e.name.c_str(),
+             e.phrase.c_str());
   }
 
   // 应用命令词更新
   esp_mn_error_t *errors = esp_mn_commands_update();
   if (errors != nullptr) {
+    std::string rejected;
+    for (int i = 0; i < errors->num; i++) {
+      if (errors->phrases[i] && errors->phrases[i]->string) {
+        ESP_LOGE(TAG, "命令词无法识别: %s", errors->phrases[i]->string);
+        rejected += rejected.empty() ? "" : ", ";
+        rejected += errors->phrases[i]->string;
+      }
+    }
     ESP_LOGE(TAG, "命令词更新失败");
+    if (error) {
+      *error = "rejected phrase: " + rejected;
+    }
     return ESP_FAIL;
   }
 
-  ESP_LOGI(TAG, "命令词注册完成，共 %d 个命令", NUM_COMMANDS);
+  ESP_LOGI(TAG, "命令词注册完成，共 %u 个命令", (unsigned)entries.size());
   esp_mn_commands_print();
 
   return ESP_OK;
 }
 
+esp_err_t WakeWord::reloadCommands(std::string *error) {
+  if (!m_initialized) {
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  std::lock_guard<std::mutex> lock(m_reloadMutex);
+
+  // 检测任务未运行时直接更新
+  if (!m_running) {
+    esp_err_t ret = registerCommands(error);
+    if (m_mnHandle && m_mnData) {
+      m_mnHandle->clean(m_mnData);
+    }
+    return ret;
+  }
+
+  // 交给检测任务在下一帧处理，等待结果
+  ulTaskNotifyTake(pdTRUE, 0);
+  m_reloadWaiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+  m_reloadRequested.store(true, std::memory_order_release);
+  if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(COMMAND_RELOAD_TIMEOUT_MS)) ==
+      0) {
+    // 撤回请求：检测任务之后不会再应用它（调用方会回滚 CommandTable）
+    if (m_reloadRequested.exchange(false, std::memory_order_acq_rel)) {
+      m_reloadWaiter.store(nullptr, std::memory_order_release);
+      ESP_LOGW(TAG, "命令词热加载超时");
+      if (error) {
+        *error = "reload timeout";
+      }
+      return ESP_ERR_TIMEOUT;
+    }
+    // 检测任务已经取走请求、正在注册：等它完成并通知，结果以它为准
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+  m_reloadWaiter.store(nullptr, std::memory_order_release);
+  if (error && m_reloadResult != ESP_OK) {
+    *error = m_reloadError;
+  }
+  return m_reloadResult;
+}
+
 // ============= 公共 API =============
 
+esp_err_t WakeWord::registerMetrics() {
+  esp_err_t ret = Metrics::instance().add(
+      {&m_metricWakes, &m_metricBargeWakes, &m_metricAfeFrames,
+       &m_metricI2sErrors, &m_metricCaptureOverflows,
+       &m_metricCaptureUnderruns});
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "指标注册失败: %s", esp_err_to_name(ret));
+  }
+  return ret;
+}
+
 esp_err_t WakeWord::init(const I2sConfig &i2sConfig,
-                         const CommandConfig &cmdConfig) {
+                         const CommandConfig &cmdConfig,
+                         const AecConfig &aecConfig) {
   if (m_initialized) {
     ESP_LOGW(TAG, "已经初始化");
     return ESP_OK;
   }
 
   m_cmdConfig = cmdConfig;
+  m_aecCfg = aecConfig;
 
   ESP_LOGI(TAG, "初始化唤醒词与命令识别模块...");
 
@@ -537,6 +795,33 @@ esp_err_t WakeWord::init(const I2sConfig &i2sConfig,
     return ret;
   }
 
+  m_feedChunkSamples = m_afeHandle->get_feed_chunksize(m_afeData);
+  m_feedChannels = m_afeHandle->get_feed_channel_num(m_afeData);
+  if (m_feedChannels < 1) {
+    m_feedChannels = 1;
+  }
+
+  // 回声参考来自 Mp3Player 最终写入 I2S 的音频
+  m_aecEnabled = false;
+  if (m_aecCfg.enabled && m_feedChannels > 1) {
+    ret = Mp3Player::instance().enableReference(AUDIO_SAMPLE_RATE);
+    if (ret == ESP_OK) {
+      m_aecEnabled = true;
+      ESP_LOGI(TAG, "AEC 已开启 (ref delay=%d ms)", m_aecCfg.ref_delay_ms);
+    } else {
+      ESP_LOGW(TAG, "AEC 参考信号不可用，播报期间仍丢弃麦克风音频");
+    }
+  }
+  size_t ringSamples = (size_t)AUDIO_SAMPLE_RATE * CAPTURE_RING_MS / 1000;
+  if (ringSamples < (size_t)m_feedChunkSamples * CAPTURE_RING_MIN_CHUNKS) {
+    ringSamples = (size_t)m_feedChunkSamples * CAPTURE_RING_MIN_CHUNKS;
+  }
+  ret = m_captureRing.init(ringSamples);
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "采集环分配失败");
+    return ret;
+  }
+
   ret = initMultiNet();
   if (ret != ESP_OK) {
     ESP_LOGE(TAG, "MultiNet 初始化失败");
@@ -550,6 +835,13 @@ esp_err_t WakeWord::init(const I2sConfig &i2sConfig,
   }
 
   m_initialized = true;
+  registerMetrics();
+
+  // 命令表修改后（网页 /api/commands）热加载，无需重启
+  CommandTable::instance().setReloadHook([this](std::string &error) {
+    return reloadCommands(&error);
+  });
+
   ESP_LOGI(TAG, "唤醒词与命令识别模块初始化完成");
   return ESP_OK;
 }
@@ -567,10 +859,24 @@ esp_err_t WakeWord::start() {
 
   m_running = true;
   m_state = WakeWordState::Running;
+  m_captureRing.reset();
+  m_fedChunks.store(0, std::memory_order_relaxed);
+  m_refActive = false;
+  m_refDelayRemaining = 0;
 
-  // 创建音频采集任务
-  BaseType_t ret = xTaskCreatePinnedToCore(audioFeedTask, "audio_feed", 4096,
+  // 创建 AFE feed 任务（先于采集任务，保证通知句柄可用）
+  BaseType_t ret = xTaskCreatePinnedToCore(audioFeedTask, "afe_feed", 4096,
                                            nullptr, 5, &m_feedTaskHandle, 0);
+  if (ret != pdPASS) {
+    ESP_LOGE(TAG, "AFE feed 任务创建失败");
+    m_running = false;
+    m_state = WakeWordState::Idle;
+    return ESP_FAIL;
+  }
+
+  // 创建音频采集任务：只做 I2S 读取，优先级高于 feed，避免 DMA 丢帧
+  ret = xTaskCreatePinnedToCore(audioCaptureTask, "audio_capture", 3072,
+                                nullptr, 7, &m_captureTaskHandle, 0);
   if (ret != pdPASS) {
     ESP_LOGE(TAG, "音频采集任务创建失败");
     m_running = false;
@@ -585,7 +891,6 @@ esp_err_t WakeWord::start() {
     ESP_LOGE(TAG, "唤醒词检测任务创建失败");
     m_running = false;
     m_state = WakeWordState::Idle;
-    vTaskDelete(m_feedTaskHandle);
     return ESP_FAIL;
   }
 
@@ -623,6 +928,36 @@ void WakeWord::enable() {
   }
 }
 
+CaptureStats WakeWord::getCaptureStats() const {
+  CaptureStats st;
+  st.chunks = m_fedChunks.load(std::memory_order_relaxed);
+  st.overflows = m_captureRing.overflows();
+  st.underruns = m_captureRing.underruns();
+  st.ring_samples = (uint32_t)m_captureRing.capacity();
+  st.fill_samples = (uint32_t)m_captureRing.available();
+  st.high_water = m_captureRing.highWater();
+  st.aec = m_aecEnabled;
+  AudioRing<int16_t> *ref =
+      m_aecEnabled ? Mp3Player::instance().referenceRing() : nullptr;
+  if (ref != nullptr) {
+    st.ref_fill_samples = (uint32_t)ref->available();
+    st.ref_overflows = ref->overflows();
+  }
+  st.ref_trimmed = m_refTrimmed.load(std::memory_order_relaxed);
+  return st;
+}
+
+std::string WakeWord::statusJson() const {
+  CaptureStats cap = getCaptureStats();
+  char buf[128];
+  snprintf(buf, sizeof(buf),
+           "{\"enabled\":%s,\"ref_fill\":%u,\"ref_overflows\":%u,"
+           "\"ref_trimmed\":%u}",
+           cap.aec ? "true" : "false", (unsigned)cap.ref_fill_samples,
+           (unsigned)cap.ref_overflows, (unsigned)cap.ref_trimmed);
+  return std::string(buf);
+}
+
 void WakeWord::touchDialog() {
   if (m_state == WakeWordState::Dialog) {
     m_dialogLastActivityTick.store((uint32_t)xTaskGetTickCount(),
@@ -660,6 +995,8 @@ void WakeWord::deinit() {
     m_i2sRxHandle = nullptr;
   }
 
+  m_captureRing.deinit();
+
   m_initialized = false;
   ESP_LOGI(TAG, "唤醒词模块已释放");
 }
@@ -1,13 +1,17 @@
 #pragma once
 
+#include "audio_ring.h"
 #include "driver/i2s_std.h"
 #include "esp_afe_sr_iface.h"
 #include "esp_err.h"
 #include "esp_mn_iface.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "metrics.h"
 #include <atomic>
 #include <functional>
+#include <mutex>
+#include <string>
 
 /**
  * @brief 唤醒词检测状态枚举
@@ -45,6 +49,11 @@ using AudioFrameCallback =
     std::function<void(const int16_t *samples, int numSamples,
                        vad_state_t vadState)>;
 
+/**
+ * @brief 对话模式下播报期间检测到唤醒词（打断播报）
+ */
+using BargeInCallback = std::function<void()>;
+
 /**
  * @brief I2S 麦克风配置
  */
@@ -62,6 +71,18 @@ struct CommandConfig {
   int timeout_ms = 6000; /*!< 命令词识别超时时间 (毫秒) */
 };
 
+/**
+ * @brief 回声消除配置
+ *
+ * 开启后 AFE 以 "MR"（麦克风 + 播放参考）格式工作，参考信号取自 Mp3Player
+ * 最终写入 I2S 的音频；播报期间麦克风音频不再被丢弃。
+ */
+struct AecConfig {
+  bool enabled = true;  /*!< 开启 AEC（需要 Mp3Player 提供参考信号） */
+  int ref_delay_ms = 0; /*!< 播放开始时参考信号额外延后（补偿功放/声学延迟） */
+  int max_ref_lag_ms = 200; /*!< 参考环积压超过该值（+延后）时丢弃最旧数据 */
+};
+
 /**
  * @brief 对话模式配置
  */
@@ -70,6 +91,22 @@ struct DialogConfig {
   int session_timeout_ms = 20000; /*!< 多少毫秒无语音则退出对话 */
 };
 
+/**
+ * @brief 麦克风采集环统计（采集任务与 AFE feed 任务之间）
+ */
+struct CaptureStats {
+  uint32_t chunks = 0;        /*!< 已送入 AFE 的 chunk 数 */
+  uint32_t overflows = 0;     /*!< 环满导致丢弃的 I2S 读取次数 */
+  uint32_t underruns = 0;     /*!< feed 任务等待采集数据超时次数 */
+  uint32_t ring_samples = 0;  /*!< 环容量（样本数） */
+  uint32_t fill_samples = 0;  /*!< 当前填充量（样本数） */
+  uint32_t high_water = 0;    /*!< 历史最高填充量（样本数） */
+  bool aec = false;           /*!< AFE 是否带回声参考（"MR"） */
+  uint32_t ref_fill_samples = 0; /*!< 参考环当前填充量（样本数） */
+  uint32_t ref_overflows = 0;    /*!< 参考环写满丢弃次数 */
+  uint32_t ref_trimmed = 0;      /*!< 积压过多被丢弃的参考样本数 */
+};
+
 /**
  * @brief 语音唤醒与命令识别管理类
  *
@@ -108,10 +145,12 @@ public:
    * @brief 初始化唤醒词模块（包含命令词识别）
    * @param i2sConfig I2S 麦克风配置
    * @param cmdConfig 命令词配置
+   * @param aecConfig 回声消除配置
    * @return ESP_OK 成功
    */
   esp_err_t init(const I2sConfig &i2sConfig = I2sConfig{},
-                 const CommandConfig &cmdConfig = CommandConfig{});
+                 const CommandConfig &cmdConfig = CommandConfig{},
+                 const AecConfig &aecConfig = AecConfig{});
 
   /**
    * @brief 设置唤醒词检测回调
@@ -134,6 +173,16 @@ public:
     m_audioFrameCallback = callback;
   }
 
+  /**
+   * @brief 设置播报打断回调（需开启 AEC）
+   *
+   * 设置后对话模式下播报期间保持 WakeNet 开启，检测到唤醒词即回调；
+   * 不播报时 WakeNet 仍然关闭，与原行为一致。
+   */
+  void setBargeInCallback(BargeInCallback callback) {
+    m_bargeInCallback = callback;
+  }
+
   /**
    * @brief 设置对话模式配置
    */
@@ -193,6 +242,29 @@ public:
     return m_state == WakeWordState::ListeningCommand;
   }
 
+  /**
+   * @brief AEC 是否生效：生效时播报期间的麦克风音频已去除回声，可以继续使用
+   */
+  bool aecEnabled() const { return m_aecEnabled; }
+
+  /**
+   * @brief 获取采集环统计（溢出 / 欠载 / 水位）
+   */
+  CaptureStats getCaptureStats() const;
+
+  /**
+   * @brief 回声参考环状态（JSON 对象字符串，供网页 /api/status）
+   */
+  std::string statusJson() const;
+
+  /**
+   * @brief 按 CommandTable 重新注册 MultiNet 命令词（热加载）
+   *
+   * 运行中时由检测任务在两帧之间执行，调用方阻塞等待结果（最多 3 秒）。
+   * @param error 失败时返回被 MultiNet 拒绝的命令词
+   */
+  esp_err_t reloadCommands(std::string *error = nullptr);
+
 private:
   // 私有构造函数（单例）
   WakeWord() = default;
@@ -200,11 +272,14 @@ private:
 
   // 内部初始化
   esp_err_t initI2s(const I2sConfig &config);
+  void fillReference(int16_t *dst, size_t n);
   esp_err_t initAfe();
+  esp_err_t registerMetrics();
   esp_err_t initMultiNet();
-  esp_err_t registerCommands();
+  esp_err_t registerCommands(std::string *error = nullptr);
 
   // 任务函数（静态，用于 FreeRTOS）
+  static void audioCaptureTask(void *arg);
   static void audioFeedTask(void *arg);
   static void detectTask(void *arg);
 
@@ -228,7 +303,21 @@ private:
   // I2S
   i2s_chan_handle_t m_i2sRxHandle = nullptr;
 
+  // 采集环：I2S 直接读入，AFE feed 任务原地消费
+  AudioRing<int16_t> m_captureRing;
+  int m_feedChunkSamples = 0;
+  int m_feedChannels = 1;
+  std::atomic<uint32_t> m_fedChunks{0};
+
+  // AEC 参考（由 AFE feed 任务从 Mp3Player 参考环读取）
+  AecConfig m_aecCfg;
+  bool m_aecEnabled = false;
+  bool m_refActive = false;          // 参考环上一次是否有数据
+  size_t m_refDelayRemaining = 0;    // 播放开始时还需补的静音样本数
+  std::atomic<uint32_t> m_refTrimmed{0};
+
   // FreeRTOS 任务
+  TaskHandle_t m_captureTaskHandle = nullptr;
   TaskHandle_t m_feedTaskHandle = nullptr;
   TaskHandle_t m_detectTaskHandle = nullptr;
   volatile bool m_running = false;
@@ -237,11 +326,36 @@ private:
   volatile bool m_listeningCommand = false;
   TickType_t m_commandStartTime = 0;
 
+  // 命令词热加载（reloadCommands -> 检测任务）
+  std::mutex m_reloadMutex;
+  std::atomic<bool> m_reloadRequested{false};
+  std::atomic<TaskHandle_t> m_reloadWaiter{nullptr};
+  esp_err_t m_reloadResult = ESP_OK;
+  std::string m_reloadError;
+
   // 对话模式
   DialogConfig m_dialogCfg;
   std::atomic<uint32_t> m_dialogLastActivityTick{0};
   std::atomic<bool> m_exitDialogRequested{false};
   bool m_prevVadSpeech = false;
   bool m_prevSpeakerPlaying = false;
+  bool m_dialogWakenetOn = false; // 对话中为打断而临时开启的 WakeNet
   AudioFrameCallback m_audioFrameCallback = nullptr;
+  BargeInCallback m_bargeInCallback = nullptr;
+
+  // /api/metrics（AFE 帧率 = rate(dino_afe_frames_total)）
+  MetricCounter m_metricWakes{"dino_wake_total", "Wake words detected",
+                              "phase=\"idle\""};
+  MetricCounter m_metricBargeWakes{"dino_wake_total", "Wake words detected",
+                                   "phase=\"playback\""};
+  MetricCounter m_metricAfeFrames{"dino_afe_frames_total",
+                                  "AFE frames fetched by the detect task"};
+  MetricCounter m_metricI2sErrors{"dino_i2s_read_errors_total",
+                                  "Failed or empty I2S mic reads"};
+  MetricCounter m_metricCaptureOverflows{
+      "dino_capture_ring_overflows_total", "Mic chunks dropped (ring full)",
+      [this] { return m_captureRing.overflows(); }};
+  MetricCounter m_metricCaptureUnderruns{
+      "dino_capture_ring_underruns_total", "AFE feed waits on an empty ring",
+      [this] { return m_captureRing.underruns(); }};
 };
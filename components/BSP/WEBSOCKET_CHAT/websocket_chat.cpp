@@ -1,9 +1,60 @@
 #include "websocket_chat.h"
 #include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
 #include "cJSON.h"
+#include "latency_trace.h"
+#include "sdkconfig.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string.h>
 
 static const char* TAG = "WebSocketChat";
 
+namespace {
+constexpr size_t kTxDescSlots = 64;          // 约 2 s 的 AFE 帧（32 ms/帧）
+constexpr TickType_t kTxSendTimeout = pdMS_TO_TICKS(2000);
+constexpr size_t kRxDescSlots = 2048;        // ADPCM 20 ms 一包：约 40 s
+// 留给 tts start / stop 的描述符：音频在用到这几个空位之前就停止入队，
+// 控制消息总能排进队列（ws_rx 卡住时也要积压十几轮才会用完）
+constexpr size_t kRxCtrlSlots = 16;
+#if CONFIG_CLOUD_WS_OPUS
+constexpr uint32_t kTxTaskStack = 8192;      // Opus 编码在 ws_tx 任务里执行
+#else
+constexpr uint32_t kTxTaskStack = 4096;
+#endif
+constexpr uint8_t kFrameVersion = 2;
+constexpr uint32_t kConnTaskStack = 4096;
+
+TickType_t usToTicks(int64_t us) {
+    return pdMS_TO_TICKS((uint32_t)std::max<int64_t>(1, us / 1000));
+}
+
+uint32_t nowMs() { return (uint32_t)(esp_timer_get_time() / 1000); }
+
+void putLe16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+void putLe32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+uint32_t le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+int jsonInt(const cJSON* obj, const char* key) {
+    const cJSON* item = cJSON_GetObjectItem(obj, key);
+    return cJSON_IsNumber(item) ? item->valueint : 0;
+}
+} // namespace
+
 WebSocketChat& WebSocketChat::instance() {
     static WebSocketChat instance;
     return instance;
@@ -17,6 +68,16 @@ WebSocketChat::~WebSocketChat() {
     }
 }
 
+void WebSocketChat::registerMetrics() {
+    esp_err_t err = Metrics::instance().add({&metric_tx_bytes_, &metric_rx_bytes_, &metric_attempts_,
+                                             &metric_sessions_, &metric_tx_dropped_, &metric_tx_errors_,
+                                             &metric_rx_dropped_, &metric_ready_, &metric_rtt_,
+                                             &metric_jitter_});
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Metrics register failed: %s", esp_err_to_name(err));
+    }
+}
+
 esp_err_t WebSocketChat::init(const WebSocketChatConfig& config) {
     if (initialized_) {
         ESP_LOGW(TAG, "Already initialized");
@@ -34,10 +95,17 @@ esp_err_t WebSocketChat::init(const WebSocketChatConfig& config) {
     esp_websocket_client_config_t ws_config = {};
     ws_config.uri = config_.url.c_str();
     ws_config.buffer_size = config_.buffer_size;
-    ws_config.reconnect_timeout_ms = config_.reconnect_timeout_ms;
-    ws_config.network_timeout_ms = 10000;
-    ws_config.ping_interval_sec = 30;
-    ws_config.pingpong_timeout_sec = 10;
+    ws_config.network_timeout_ms = config_.handshake_timeout_ms;
+    // 重连由 ws_conn 监督任务负责（指数退避），客户端自身不重连
+    ws_config.disable_auto_reconnect = true;
+    // 空闲时也保持连接：ping 让 NAT / 代理不回收连接，并及时发现断链；
+    // 一个周期内收不到 pong 即断开重连
+    ws_config.ping_interval_sec = CONFIG_CLOUD_WS_PING_INTERVAL_S;
+    ws_config.pingpong_timeout_sec = CONFIG_CLOUD_WS_PING_INTERVAL_S;
+    ws_config.keep_alive_enable = true;
+    ws_config.keep_alive_idle = CONFIG_CLOUD_WS_PING_INTERVAL_S;
+    ws_config.keep_alive_interval = 5;
+    ws_config.keep_alive_count = 3;
     
     client_ = esp_websocket_client_init(&ws_config);
     if (!client_) {
@@ -55,9 +123,23 @@ esp_err_t WebSocketChat::init(const WebSocketChatConfig& config) {
 
     // 注册事件处理
     esp_websocket_register_events(client_, WEBSOCKET_EVENT_ANY, eventHandler, this);
+
+    esp_err_t err = startTxTask();
+    if (err == ESP_OK) {
+        err = startRxTask();
+    }
+    if (err == ESP_OK) {
+        err = startConnTask();
+    }
+    if (err != ESP_OK) {
+        esp_websocket_client_destroy(client_);
+        client_ = nullptr;
+        return err;
+    }
     
     initialized_ = true;
     state_.store(WsDialogState::Idle);
+    registerMetrics();
     ESP_LOGI(TAG, "WebSocket client initialized, URL: %s", config_.url.c_str());
     return ESP_OK;
 }
@@ -67,44 +149,180 @@ esp_err_t WebSocketChat::connect() {
         ESP_LOGE(TAG, "Not initialized");
         return ESP_ERR_INVALID_STATE;
     }
-    
-    if (state_.load() != WsDialogState::Idle) {
-        ESP_LOGW(TAG, "Already connected or connecting");
-        return ESP_OK;
+
+    if (!wanted_.exchange(true)) {
+        ESP_LOGI(TAG, "Keeping connection to %s", config_.url.c_str());
     }
-    
-    state_.store(WsDialogState::Connecting);
-    ESP_LOGI(TAG, "Connecting to WebSocket server...");
-    
-    esp_err_t err = esp_websocket_client_start(client_);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start WebSocket client: %s", esp_err_to_name(err));
-        state_.store(WsDialogState::Idle);
+    if (state_.load() == WsDialogState::Idle) {
+        kick_.store(true);
     }
-    return err;
+    xTaskNotifyGive(conn_task_);
+    return ESP_OK;
 }
 
 void WebSocketChat::disconnect() {
     if (!initialized_ || !client_) {
         return;
     }
-    
-    if (esp_websocket_client_is_connected(client_)) {
+    wanted_.store(false);
+
+    std::lock_guard<std::mutex> lock(conn_mutex_);
+    if (client_started_) {
         ESP_LOGI(TAG, "Disconnecting...");
-        esp_websocket_client_stop(client_);
+        stopClientLocked();
     }
-    state_.store(WsDialogState::Idle);
     session_id_.clear();
 }
 
+void WebSocketChat::setNetworkUp(bool up) {
+    if (network_up_.exchange(up) == up) {
+        return;
+    }
+    ESP_LOGI(TAG, "Network %s", up ? "up" : "down");
+    if (up) {
+        // 新拿到 IP：之前的失败与网络无关，立即重连
+        reset_backoff_.store(true);
+        kick_.store(true);
+    }
+    if (conn_task_) {
+        xTaskNotifyGive(conn_task_);
+    }
+}
+
+// ========== 连接监督 ==========
+
+esp_err_t WebSocketChat::startConnTask() {
+    if (xTaskCreatePinnedToCore(connTaskEntry, "ws_conn", kConnTaskStack, this, 4,
+                                &conn_task_, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create ws_conn task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void WebSocketChat::connTaskEntry(void* arg) {
+    auto* self = static_cast<WebSocketChat*>(arg);
+    while (true) {
+        // 连接事件、connect()、网络变化都会唤醒；否则睡到下一个定时点
+        ulTaskNotifyTake(pdTRUE, self->connStep());
+    }
+}
+
+TickType_t WebSocketChat::connStep() {
+    const int64_t now = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(conn_mutex_);
+
+    if (!wanted_.load() || !network_up_.load()) {
+        if (client_started_) {
+            stopClientLocked();
+        }
+        return portMAX_DELAY;
+    }
+    if (reset_backoff_.exchange(false)) {
+        backoff_step_ = 0;
+    }
+
+    const WsDialogState st = state_.load();
+    if (st >= WsDialogState::Connected) {
+        return portMAX_DELAY; // 会话正常：断线事件会唤醒
+    }
+    if (st == WsDialogState::Connecting && client_started_) {
+        const int64_t left = attempt_start_us_ + (int64_t)config_.handshake_timeout_ms * 1000 - now;
+        if (left > 0) {
+            return usToTicks(left);
+        }
+        ESP_LOGW(TAG, "Handshake timed out after %d ms", config_.handshake_timeout_ms);
+    }
+
+    if (client_started_) {
+        // 连接失败 / 会话断开 / 握手超时：收拾客户端，排下一次重连
+        stopClientLocked();
+        scheduleRetryLocked(now);
+    }
+    if (kick_.exchange(false)) {
+        next_attempt_us_ = now;
+    }
+    if (now < next_attempt_us_) {
+        return usToTicks(next_attempt_us_ - now);
+    }
+    startAttemptLocked(now);
+    return client_started_ ? usToTicks((int64_t)config_.handshake_timeout_ms * 1000)
+                           : usToTicks(next_attempt_us_ - now);
+}
+
+void WebSocketChat::startAttemptLocked(int64_t nowUs) {
+    attempts_.fetch_add(1, std::memory_order_relaxed);
+    attempt_start_us_ = nowUs;
+    state_.store(WsDialogState::Connecting);
+    ESP_LOGI(TAG, "Connecting to WebSocket server...");
+
+    esp_err_t err = esp_websocket_client_start(client_);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start WebSocket client: %s", esp_err_to_name(err));
+        state_.store(WsDialogState::Idle);
+        scheduleRetryLocked(nowUs);
+        return;
+    }
+    client_started_ = true;
+}
+
+void WebSocketChat::stopClientLocked() {
+    // 不能在事件任务里调用：stop 要等客户端任务退出
+    esp_websocket_client_stop(client_);
+    client_started_ = false;
+    ready_since_ms_.store(0);
+    state_.store(WsDialogState::Idle);
+}
+
+void WebSocketChat::scheduleRetryLocked(int64_t nowUs) {
+    // 指数退避 + 抖动：等待取 [d/2, d]，避免大量设备在服务器重启后同时重连
+    const uint32_t minMs = CONFIG_CLOUD_WS_RECONNECT_MIN_MS;
+    const uint32_t maxMs = std::max<uint32_t>(minMs, CONFIG_CLOUD_WS_RECONNECT_MAX_MS);
+    uint32_t delay = minMs;
+    for (uint32_t i = 0; i < backoff_step_ && delay < maxMs; i++) {
+        delay *= 2;
+    }
+    delay = std::min(delay, maxMs);
+    delay = delay / 2 + esp_random() % (delay / 2 + 1);
+    backoff_step_++;
+    next_attempt_us_ = nowUs + (int64_t)delay * 1000;
+    backoff_ms_.store(delay, std::memory_order_relaxed);
+    ESP_LOGI(TAG, "Reconnecting in %lu ms", (unsigned long)delay);
+}
+
+void WebSocketChat::onSessionReady() {
+    const int64_t now = esp_timer_get_time();
+    reset_backoff_.store(true);
+    const uint32_t nowTick = (uint32_t)(now / 1000);
+    ready_since_ms_.store(nowTick != 0 ? nowTick : 1); // 0 留作“未就绪”
+    connect_ms_.store((uint32_t)((now - attempt_start_us_) / 1000), std::memory_order_relaxed);
+    sessions_.fetch_add(1, std::memory_order_relaxed);
+}
+
+WsConnStats WebSocketChat::connStats() const {
+    WsConnStats st;
+    const uint32_t since = ready_since_ms_.load();
+    st.ready = isReady();
+    // 无符号相减：tick 每 49.7 天回绕一次，差值仍然正确
+    st.uptime_ms = (st.ready && since != 0) ? nowMs() - since : 0;
+    st.connect_ms = connect_ms_.load(std::memory_order_relaxed);
+    st.sessions = sessions_.load(std::memory_order_relaxed);
+    st.attempts = attempts_.load(std::memory_order_relaxed);
+    st.backoff_ms = backoff_ms_.load(std::memory_order_relaxed);
+    return st;
+}
+
 esp_err_t WebSocketChat::sendText(const std::string& text) {
     if (state_.load() < WsDialogState::Connected) {
         ESP_LOGW(TAG, "Not connected");
         return ESP_ERR_INVALID_STATE;
     }
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    int sent = esp_websocket_client_send_text(client_, text.c_str(), text.length(), portMAX_DELAY);
+    return writeText(text);
+}
+
+esp_err_t WebSocketChat::writeText(const std::string& text) {
+    // 客户端内部对发送加锁，这里不再持 mutex_；超时与音频发送相同
+    int sent = esp_websocket_client_send_text(client_, text.c_str(), text.length(), kTxSendTimeout);
     if (sent < 0) {
         ESP_LOGE(TAG, "Failed to send text");
         return ESP_FAIL;
@@ -118,17 +336,318 @@ esp_err_t WebSocketChat::sendAudio(const uint8_t* data, size_t len) {
     if (state_.load() != WsDialogState::Listening) {
         return ESP_ERR_INVALID_STATE;
     }
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    int sent = esp_websocket_client_send_bin(client_, (const char*)data, len, portMAX_DELAY);
+    const size_t samples = len / sizeof(int16_t);
+    if (data == nullptr || samples == 0) {
+        return ESP_OK;
+    }
+
+    // 两个队列都放得下才入队（不能只写进一半），否则整段丢弃，绝不等待
+    if (tx_desc_.freeSpace() == 0 || tx_pcm_.freeSpace() < samples) {
+        tx_dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+        tx_pcm_.noteOverflow((uint32_t)samples);
+        return ESP_ERR_NO_MEM;
+    }
+    tx_pcm_.write(reinterpret_cast<const int16_t*>(data), samples);
+    const TxDesc desc{TxKind::Audio, turn_gen_.load(), (uint32_t)samples};
+    tx_desc_.write(&desc, 1);
+    LTRACE(TraceEvent::WsSendAudio, len);
+
+    // 攒够一条消息再唤醒 ws_tx，避免每个 AFE 帧都切一次任务
+    tx_unsignaled_ += samples;
+    if (tx_unsignaled_ >= tx_coalesce_samples_) {
+        tx_unsignaled_ = 0;
+        xTaskNotifyGive(tx_task_);
+    }
+    return ESP_OK;
+}
+
+esp_err_t WebSocketChat::enqueueControl(TxKind kind) {
+    if (tx_desc_.freeSpace() == 0) {
+        ESP_LOGE(TAG, "Uplink queue full");
+        return ESP_ERR_NO_MEM;
+    }
+    const TxDesc desc{kind, turn_gen_.load(), 0};
+    tx_desc_.write(&desc, 1);
+    tx_unsignaled_ = 0;
+    xTaskNotifyGive(tx_task_);
+    return ESP_OK;
+}
+
+WsTxStats WebSocketChat::txStats() const {
+    WsTxStats st;
+    const uint32_t perMs = std::max(1, config_.sample_rate / 1000);
+    st.queued_ms = (uint32_t)tx_pcm_.available() / perMs;
+    st.high_water_ms = tx_pcm_.highWater() / perMs;
+    st.dropped_frames = tx_dropped_frames_.load(std::memory_order_relaxed);
+    st.dropped_ms = tx_pcm_.overflows() / perMs;
+    st.messages = tx_messages_.load(std::memory_order_relaxed);
+    st.send_errors = tx_send_errors_.load(std::memory_order_relaxed);
+    return st;
+}
+
+esp_err_t WebSocketChat::startTxTask() {
+    // 合并长度：CONFIG_CLOUD_WS_TX_COALESCE_MS；队列容量：CONFIG_CLOUD_WS_TX_QUEUE_MS
+    const size_t perMs = (size_t)std::max(1, config_.sample_rate / 1000);
+    tx_coalesce_samples_ = perMs * CONFIG_CLOUD_WS_TX_COALESCE_MS;
+    esp_err_t err = tx_pcm_.init(perMs * CONFIG_CLOUD_WS_TX_QUEUE_MS);
+    if (err == ESP_OK) {
+        err = tx_desc_.init(kTxDescSlots, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to allocate uplink queue");
+        tx_pcm_.deinit();
+        return err;
+    }
+    tx_msg_.assign(kFrameHeaderBytes + tx_coalesce_samples_ * sizeof(int16_t), 0);
+
+    // 与 wake_detect（core 1）分开：发送阻塞只影响 ws_tx 自己
+    if (xTaskCreatePinnedToCore(txTaskEntry, "ws_tx", kTxTaskStack, this, 5,
+                                &tx_task_, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create ws_tx task");
+        tx_pcm_.deinit();
+        tx_desc_.deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void WebSocketChat::txTaskEntry(void* arg) {
+    auto* self = static_cast<WebSocketChat*>(arg);
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->txDrain();
+    }
+}
+
+void WebSocketChat::txDropStalePending() {
+    if (tx_pending_ > 0 && tx_pending_gen_ != turn_gen_.load()) {
+        // 打断 / 断线：上一轮没发完的音频作废
+        tx_pcm_.consume(tx_pending_);
+        tx_pending_ = 0;
+    }
+}
+
+void WebSocketChat::txDrain() {
+    txSendAbortIfPending();
+    TxDesc desc;
+    while (tx_desc_.read(&desc, 1) == 1) {
+        txSendAbortIfPending();
+        // 每个描述符都重新读 turn_gen_：发送可能阻塞（最长 kTxSendTimeout），
+        // 期间的打断 / 重连只作废更早的描述符，新一轮的 listen start 与音频照发。
+        // gen 入队时取自 turn_gen_ 且只增不减，不相等即更早
+        txDropStalePending();
+        if (desc.gen != turn_gen_.load()) {
+            if (desc.kind == TxKind::Audio) {
+                tx_pcm_.consume(desc.samples);
+            }
+            continue;
+        }
+        switch (desc.kind) {
+            case TxKind::Audio:
+                tx_pending_ += desc.samples;
+                tx_pending_gen_ = desc.gen;
+                while (tx_pending_ >= tx_coalesce_samples_ &&
+                       tx_pending_gen_ == turn_gen_.load()) {
+                    txSendPending(tx_coalesce_samples_);
+                }
+                break;
+
+            case TxKind::ListenStart: {
+                txSendPending(tx_pending_);
+                {
+                    // 每轮独立编码：服务器按轮次新建解码器
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (encoder_) {
+                        encoder_->reset();
+                    }
+                    enc_fill_ = 0;
+                }
+                (void)sendListenJson("start");
+                break;
+            }
+
+            case TxKind::ListenStop: {
+                txSendPending(tx_pending_);
+                // 不足一帧的尾巴补零发出，保证服务器在 listen stop 前收齐音频
+                flushUplink();
+                if (sendListenJson("stop") == ESP_OK) {
+                    LTRACE(TraceEvent::WsListenStop, 0);
+                }
+                break;
+            }
+        }
+    }
+    txDropStalePending();
+}
+
+void WebSocketChat::txSendAbortIfPending() {
+    if (!tx_abort_.exchange(false)) {
+        return;
+    }
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "session_id", session_id_.c_str());
+    cJSON_AddStringToObject(root, "type", "abort");
+    cJSON_AddStringToObject(root, "reason", "user_interrupt");
+    char* str = cJSON_PrintUnformatted(root);
+    if (sendText(str) == ESP_OK) {
+        ESP_LOGI(TAG, "Sent abort");
+    }
+    free(str);
+    cJSON_Delete(root);
+}
+
+void WebSocketChat::txSendPending(size_t samples) {
+    // PCM 直接读到帧头之后，发送时不用再拷贝
+    int16_t* msgPcm = reinterpret_cast<int16_t*>(tx_msg_.data() + kFrameHeaderBytes);
+    const size_t msgCap = (tx_msg_.size() - kFrameHeaderBytes) / sizeof(int16_t);
+    while (samples > 0) {
+        const size_t n = tx_pcm_.read(msgPcm, std::min(samples, msgCap));
+        if (n == 0) {
+            break;
+        }
+        samples -= n;
+        tx_pending_ -= std::min(tx_pending_, n);
+
+        bool encoded;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            encoded = encoder_ != nullptr;
+        }
+        if (!encoded) {
+            (void)sendAudioMessage(tx_msg_.data(), n * sizeof(int16_t), (uint32_t)n);
+            continue;
+        }
+
+        // 压缩格式：凑满一帧编码一次，每帧一条二进制消息。
+        // mutex_ 只包住编码，发送（可能阻塞 kTxSendTimeout）在锁外
+        const int16_t* pcm = msgPcm;
+        size_t left = n;
+        while (left > 0) {
+            int bytes = 0;
+            uint32_t frameSamples = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!encoder_) {
+                    break; // 重连后换了格式：这一段属于旧连接，丢弃
+                }
+                const size_t frame = enc_frame_.size();
+                const size_t take = std::min(frame - enc_fill_, left);
+                memcpy(enc_frame_.data() + enc_fill_, pcm, take * sizeof(int16_t));
+                enc_fill_ += take;
+                pcm += take;
+                left -= take;
+                if (enc_fill_ == frame) {
+                    bytes = encodeFrameLocked(&frameSamples);
+                }
+            }
+            if (bytes > 0) {
+                (void)sendAudioMessage(tx_pkt_.data(), (size_t)bytes, frameSamples);
+            }
+        }
+    }
+}
+
+int WebSocketChat::encodeFrameLocked(uint32_t* samples) {
+    // 编码结果放进 ws_tx 自己的 tx_pkt_，解锁后再发送
+    enc_fill_ = 0;
+    const size_t need = kFrameHeaderBytes + encoder_->maxPacketBytes();
+    if (tx_pkt_.size() < need) {
+        tx_pkt_.resize(need);
+    }
+    int bytes = encoder_->encode(enc_frame_.data(), tx_pkt_.data() + kFrameHeaderBytes);
+    if (bytes < 0) {
+        ESP_LOGE(TAG, "Uplink %s encode failed", encoder_->format());
+        return bytes;
+    }
+    *samples = (uint32_t)enc_frame_.size();
+    return bytes; // 0：编码器本帧无输出（DTX）
+}
+
+esp_err_t WebSocketChat::sendAudioMessage(uint8_t* msg, size_t payloadBytes, uint32_t samples) {
+    // msg 前 kFrameHeaderBytes 字节是预留的帧头位置，负载紧随其后
+    const uint8_t* out = msg + kFrameHeaderBytes;
+    size_t len = payloadBytes;
+    if (framed_.load()) {
+        // ts_ms 取发送时刻（不是采集时刻）：对端回显后 now - echo 才只含网络往返，
+        // 不含这一包的音频时长与 ws_tx 合并等待
+        const uint32_t now = nowMs();
+        uint32_t echo = 0;
+        if (have_peer_offset_.load(std::memory_order_acquire)) {
+            echo = now + peer_offset_.load(std::memory_order_relaxed);
+        }
+        msg[0] = kFrameVersion;
+        msg[1] = 0;
+        putLe16(msg + 2, (uint16_t)std::min<uint32_t>(samples, 0xFFFF));
+        putLe32(msg + 4, tx_seq_++);
+        putLe32(msg + 8, now);
+        putLe32(msg + 12, echo);
+        out = msg;
+        len += kFrameHeaderBytes;
+    }
+    int sent = esp_websocket_client_send_bin(client_, (const char*)out, (int)len, kTxSendTimeout);
     if (sent < 0) {
+        tx_send_errors_.fetch_add(1, std::memory_order_relaxed);
         ESP_LOGE(TAG, "Failed to send audio data");
         return ESP_FAIL;
     }
-    
+    tx_messages_.fetch_add(1, std::memory_order_relaxed);
+    tx_bytes_.fetch_add((uint32_t)len, std::memory_order_relaxed);
     return ESP_OK;
 }
 
+void WebSocketChat::flushUplink() {
+    int bytes = 0;
+    uint32_t frameSamples = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!encoder_ || enc_fill_ == 0) {
+            return;
+        }
+        std::fill(enc_frame_.begin() + enc_fill_, enc_frame_.end(), 0);
+        bytes = encodeFrameLocked(&frameSamples);
+    }
+    if (bytes > 0) {
+        (void)sendAudioMessage(tx_pkt_.data(), (size_t)bytes, frameSamples);
+    }
+}
+
+void WebSocketChat::selectUplinkFormat(const char* format) {
+    std::unique_ptr<UplinkEncoder> enc;
+    if (format && strcmp(format, "pcm") != 0) {
+        enc = UplinkEncoder::create(format, config_.sample_rate);
+        if (!enc) {
+            ESP_LOGE(TAG, "Server selected unsupported uplink format '%s', sending pcm", format);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    encoder_ = std::move(enc);
+    enc_fill_ = 0;
+    if (encoder_) {
+        enc_frame_.assign(encoder_->frameSamples(), 0);
+        uplink_format_.store(encoder_->format());
+    } else {
+        enc_frame_.clear();
+        uplink_format_.store("pcm");
+    }
+}
+
+void WebSocketChat::selectDownlinkFormat(const char* format) {
+    const char* selected = "pcm";
+    if (format && strcmp(format, "pcm") != 0) {
+        for (const char* const* f = DownlinkDecoder::supportedFormats(); *f; ++f) {
+            if (strcmp(format, *f) == 0) {
+                selected = *f;
+            }
+        }
+        if (strcmp(selected, "pcm") == 0) {
+            ESP_LOGE(TAG, "Server selected unsupported downlink format '%s'", format);
+        }
+    }
+    downlink_format_.store(selected);
+    rxAppend(nullptr, 0, false, true, true); // 丢弃拼到一半的包
+}
+
 void WebSocketChat::sendHello() {
     cJSON* root = cJSON_CreateObject();
     cJSON_AddStringToObject(root, "type", "hello");
@@ -141,35 +660,82 @@ void WebSocketChat::sendHello() {
     cJSON_AddStringToObject(audio_params, "format", "pcm");
     cJSON_AddNumberToObject(audio_params, "sample_rate", config_.sample_rate);
     cJSON_AddNumberToObject(audio_params, "channels", 1);
+
+    // 上行压缩格式协商：formats 按偏好排序，服务器在 hello 中以 uplink_format
+    // 回复选中的格式；旧服务器忽略该字段，仍按 format=pcm 处理
+    if (config_.uplink_format != "pcm") {
+        bool supported = false;
+        for (const char* const* f = UplinkEncoder::supportedFormats(); *f; ++f) {
+            supported = supported || config_.uplink_format == *f;
+        }
+        if (supported) {
+            cJSON* formats = cJSON_CreateArray();
+            cJSON_AddItemToArray(formats, cJSON_CreateString(config_.uplink_format.c_str()));
+            cJSON_AddItemToArray(formats, cJSON_CreateString("pcm"));
+            cJSON_AddItemToObject(audio_params, "formats", formats);
+            cJSON_AddNumberToObject(audio_params, "frame_duration", 20);
+        } else {
+            ESP_LOGW(TAG, "Uplink format '%s' not built in, offering pcm only",
+                     config_.uplink_format.c_str());
+        }
+    }
+    if (config_.downlink_format != "pcm") {
+        bool supported = false;
+        for (const char* const* f = DownlinkDecoder::supportedFormats(); *f; ++f) {
+            supported = supported || config_.downlink_format == *f;
+        }
+        if (supported) {
+            cJSON* formats = cJSON_CreateArray();
+            cJSON_AddItemToArray(formats, cJSON_CreateString(config_.downlink_format.c_str()));
+            cJSON_AddItemToArray(formats, cJSON_CreateString("pcm"));
+            cJSON_AddItemToObject(audio_params, "downlink_formats", formats);
+        } else {
+            ESP_LOGW(TAG, "Downlink format '%s' not built in, requesting pcm",
+                     config_.downlink_format.c_str());
+        }
+    }
+#if CONFIG_CLOUD_WS_FRAMING_V2
+    // 二进制消息带序号 / 时间戳帧头；服务器以 audio_params.framing = 2 确认
+    cJSON_AddNumberToObject(audio_params, "framing", 2);
+#endif
     cJSON_AddItemToObject(root, "audio_params", audio_params);
     
     char* str = cJSON_PrintUnformatted(root);
-    sendText(str);
+    esp_err_t err = writeText(str);
     
     free(str);
     cJSON_Delete(root);
     
-    ESP_LOGI(TAG, "Sent hello");
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Sent hello");
+    }
 }
 
-esp_err_t WebSocketChat::startListening() {
-    if (state_.load() != WsDialogState::Connected) {
-        ESP_LOGW(TAG, "Cannot start listening: not in Connected state");
-        return ESP_ERR_INVALID_STATE;
-    }
-    
+esp_err_t WebSocketChat::sendListenJson(const char* state) {
     cJSON* root = cJSON_CreateObject();
     cJSON_AddStringToObject(root, "session_id", session_id_.c_str());
     cJSON_AddStringToObject(root, "type", "listen");
-    cJSON_AddStringToObject(root, "state", "start");
-    cJSON_AddStringToObject(root, "mode", "auto");
+    cJSON_AddStringToObject(root, "state", state);
+    if (strcmp(state, "start") == 0) {
+        cJSON_AddStringToObject(root, "mode", "auto");
+    }
     
     char* str = cJSON_PrintUnformatted(root);
     esp_err_t err = sendText(str);
     
     free(str);
     cJSON_Delete(root);
+    return err;
+}
+
+esp_err_t WebSocketChat::startListening() {
+    if (state_.load() != WsDialogState::Connected) {
+        ESP_LOGW(TAG, "Cannot start listening: not in Connected state");
+        return ESP_ERR_INVALID_STATE;
+    }
     
+    // listen start 与之后的音频按顺序由 ws_tx 发出
+    esp_err_t err = enqueueControl(TxKind::ListenStart);
     if (err == ESP_OK) {
         state_.store(WsDialogState::Listening);
         ESP_LOGI(TAG, "Start listening");
@@ -181,19 +747,12 @@ esp_err_t WebSocketChat::stopListening() {
     if (state_.load() != WsDialogState::Listening) {
         return ESP_ERR_INVALID_STATE;
     }
-    
-    cJSON* root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "session_id", session_id_.c_str());
-    cJSON_AddStringToObject(root, "type", "listen");
-    cJSON_AddStringToObject(root, "state", "stop");
-    
-    char* str = cJSON_PrintUnformatted(root);
-    esp_err_t err = sendText(str);
-    
-    free(str);
-    cJSON_Delete(root);
-    
+
+    // 排在已入队的音频之后；不等它真正发出，检测任务继续运行
+    esp_err_t err = enqueueControl(TxKind::ListenStop);
     if (err == ESP_OK) {
+        // 新的对话轮次：从这里开始统计首包延迟
+        LTRACE_TURN();
         // Transition to WaitingForResponse - waiting for STT/TTS from server
         state_.store(WsDialogState::WaitingForResponse);
         ESP_LOGI(TAG, "Stop listening, waiting for response");
@@ -205,22 +764,302 @@ esp_err_t WebSocketChat::sendAbort() {
     if (state_.load() < WsDialogState::Connected) {
         return ESP_ERR_INVALID_STATE;
     }
-    
-    cJSON* root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "session_id", session_id_.c_str());
-    cJSON_AddStringToObject(root, "type", "abort");
-    cJSON_AddStringToObject(root, "reason", "user_interrupt");
-    
-    char* str = cJSON_PrintUnformatted(root);
-    esp_err_t err = sendText(str);
-    
-    free(str);
-    cJSON_Delete(root);
-    
+
+    // 调用方是唤醒检测 / 主循环，不能等 socket：abort 由 ws_tx 在所有排队
+    // 消息之前发出；递增 turn_gen_ 让尚未发出的本轮音频作废
+    turn_gen_.fetch_add(1);
+    tx_abort_.store(true);
+    xTaskNotifyGive(tx_task_);
+
+    // 打断后立即回到 Connected：丢弃本轮剩余的 TTS 音频，并允许马上 startListening
+    auto cur = WsDialogState::Speaking;
+    if (!state_.compare_exchange_strong(cur, WsDialogState::Connected)) {
+        cur = WsDialogState::WaitingForResponse;
+        state_.compare_exchange_strong(cur, WsDialogState::Connected);
+    }
+    return ESP_OK;
+}
+
+// ========== 下行接收通道 ==========
+
+esp_err_t WebSocketChat::startRxTask() {
+    esp_err_t err = rx_audio_.init((size_t)CONFIG_CLOUD_WS_RX_BUFFER_KB * 1024);
     if (err == ESP_OK) {
-        ESP_LOGI(TAG, "Sent abort");
+        err = rx_desc_.init(kRxDescSlots);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to allocate downlink queue");
+        rx_audio_.deinit();
+        return err;
+    }
+
+    if (xTaskCreatePinnedToCore(rxTaskEntry, "ws_rx", 4096, this, 5, &rx_task_, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create ws_rx task");
+        rx_audio_.deinit();
+        rx_desc_.deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+WsRxStats WebSocketChat::rxStats() const {
+    WsRxStats st;
+    st.queued_bytes = (uint32_t)rx_audio_.available();
+    st.high_water_bytes = rx_audio_.highWater();
+    st.dropped_bytes = rx_dropped_bytes_.load(std::memory_order_relaxed);
+    return st;
+}
+
+bool WebSocketChat::rxPush(RxKind kind, uint32_t bytes) {
+    if (rx_desc_.freeSpace() == 0) {
+        return false;
+    }
+    const RxDesc desc{kind, turn_gen_.load(), bytes};
+    rx_desc_.write(&desc, 1);
+    xTaskNotifyGive(rx_task_);
+    return true;
+}
+
+bool WebSocketChat::rxAudioSlotFree() const {
+    return rx_desc_.freeSpace() > kRxCtrlSlots;
+}
+
+void WebSocketChat::rxQueueTtsState(bool started) {
+    // 音频不会占用预留的 kRxCtrlSlots 个空位，这里只有 ws_rx 停住十几轮才会失败。
+    // 回调永远只在 ws_rx 上执行：与音频同序，也不让事件任务卡在播放器里
+    if (!rxPush(started ? RxKind::TtsStart : RxKind::TtsStop, 0)) {
+        ESP_LOGE(TAG, "Downlink control slots exhausted, tts %s dropped",
+                 started ? "start" : "stop");
+    }
+}
+
+void WebSocketChat::rxAppend(const uint8_t* data, size_t len, bool packet, bool start,
+                             bool done) {
+    if (start) {
+        if (rx_msg_bytes_ > 0) {
+            // 上一个包没收完（断线 / 格式切换）：已写入的字节作废。
+            // 开始写包时已确认过有一个描述符空位，这里必定成功
+            (void)rxPush(RxKind::Discard, (uint32_t)rx_msg_bytes_);
+            rx_msg_bytes_ = 0;
+        }
+        rx_msg_active_ = state_.load() == WsDialogState::Speaking && on_tts_audio_;
+        // 压缩包要给最后的 Packet / Discard 描述符预留一个（控制预留之外的）空位
+        rx_msg_dropped_ = rx_msg_active_ && packet && !rxAudioSlotFree();
+        if (rx_msg_dropped_) {
+            rx_dropped_bytes_.fetch_add((uint32_t)len, std::memory_order_relaxed);
+        }
+    }
+    if (data == nullptr || len == 0 || !rx_msg_active_) {
+        return;
+    }
+    if (rx_msg_dropped_) {
+        if (!start) {
+            rx_dropped_bytes_.fetch_add((uint32_t)len, std::memory_order_relaxed);
+        }
+        return;
+    }
+    LTRACE_FIRST(TraceEvent::TtsFirstBinary, len);
+
+    if (!packet) {
+        // PCM 可以按分片播放：每个分片一个描述符，放不下就丢掉这一片
+        if (rx_audio_.freeSpace() < len || !rxAudioSlotFree()) {
+            rx_dropped_bytes_.fetch_add((uint32_t)len, std::memory_order_relaxed);
+            return;
+        }
+        rx_audio_.write(data, len);
+        (void)rxPush(RxKind::Pcm, (uint32_t)len);
+        return;
+    }
+
+    if (rx_audio_.freeSpace() < len) {
+        // 包的一部分已经在环里：用 Discard 跳过，剩余分片也丢弃
+        rx_dropped_bytes_.fetch_add((uint32_t)(rx_msg_bytes_ + len), std::memory_order_relaxed);
+        if (rx_msg_bytes_ > 0) {
+            (void)rxPush(RxKind::Discard, (uint32_t)rx_msg_bytes_);
+            rx_msg_bytes_ = 0;
+        }
+        rx_msg_dropped_ = true;
+        return;
+    }
+    rx_audio_.write(data, len);
+    rx_msg_bytes_ += len;
+    if (done) {
+        (void)rxPush(RxKind::Packet, (uint32_t)rx_msg_bytes_);
+        rx_msg_bytes_ = 0;
+    }
+}
+
+void WebSocketChat::rxTaskEntry(void* arg) {
+    auto* self = static_cast<WebSocketChat*>(arg);
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->rxDrain();
     }
-    return err;
+}
+
+void WebSocketChat::rxDrain() {
+    RxDesc desc;
+    while (rx_desc_.read(&desc, 1) == 1) {
+        // 打断 / 断线之前收到的音频与 tts 状态作废
+        const bool stale = desc.gen != turn_gen_.load();
+        switch (desc.kind) {
+            case RxKind::Pcm:
+            case RxKind::Packet:
+                if (stale || !on_tts_audio_) {
+                    rx_audio_.consume(desc.bytes);
+                } else {
+                    rxDeliver(desc);
+                }
+                break;
+            case RxKind::Discard:
+                rx_audio_.consume(desc.bytes);
+                break;
+            case RxKind::TtsStart:
+            case RxKind::TtsStop:
+                if (!stale && on_tts_state_) {
+                    on_tts_state_(desc.kind == RxKind::TtsStart);
+                }
+                break;
+        }
+    }
+}
+
+void WebSocketChat::rxDeliver(const RxDesc& desc) {
+    const uint8_t* a = nullptr;
+    const uint8_t* b = nullptr;
+    size_t na = 0;
+    size_t nb = 0;
+    rx_audio_.readSpans(&a, &na, &b, &nb);
+    const size_t n = desc.bytes;
+
+    // 直接从环里交给回调（写进播放缓冲），不再经过中间缓冲
+    if (na >= n) {
+        on_tts_audio_(a, n);
+    } else if (desc.kind == RxKind::Pcm) {
+        on_tts_audio_(a, na);
+        on_tts_audio_(b, n - na);
+    } else {
+        // 压缩包跨越环尾：拼成连续的一块（很少发生）
+        rx_packet_.resize(n);
+        memcpy(rx_packet_.data(), a, na);
+        memcpy(rx_packet_.data() + na, b, n - na);
+        on_tts_audio_(rx_packet_.data(), n);
+    }
+    rx_audio_.consume(n);
+}
+
+// ========== v2 帧头统计 ==========
+
+void WebSocketChat::noteDownlinkFrame(uint32_t seq, uint32_t ts, uint32_t echo) {
+    const uint32_t now = nowMs();
+    peer_offset_.store(ts - now, std::memory_order_relaxed);
+    have_peer_offset_.store(true, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(net_mutex_);
+    WsNetStats& st = net_turn_;
+    st.dl_packets++;
+    if (rx_have_seq_) {
+        const int32_t gap = (int32_t)(seq - rx_next_seq_);
+        if (gap > 0) {
+            st.dl_lost += (uint32_t)gap;
+        } else if (gap < 0) {
+            st.dl_reordered++;
+        }
+        // RFC 3550 6.4.1：D = (Rj - Ri) - (Sj - Si)，J += (|D| - J) / 16
+        const int32_t d = (int32_t)(now - rx_last_arrival_) - (int32_t)(ts - rx_last_ts_);
+        rx_jitter_ += (std::fabs((float)d) - rx_jitter_) / 16.0f;
+    }
+    if (!rx_have_seq_ || (int32_t)(seq - rx_next_seq_) >= 0) {
+        rx_next_seq_ = seq + 1;
+    }
+    rx_have_seq_ = true;
+    rx_last_arrival_ = now;
+    rx_last_ts_ = ts;
+
+    // 单向传输时间含未知的时钟差，只看本轮内的波动（相对第一包）
+    if (st.dl_packets == 1) {
+        rx_transit_base_ = now - ts;
+        rx_transit_min_ = 0;
+        rx_transit_max_ = 0;
+    } else {
+        const int32_t rel = (int32_t)((now - ts) - rx_transit_base_);
+        rx_transit_min_ = std::min(rx_transit_min_, rel);
+        rx_transit_max_ = std::max(rx_transit_max_, rel);
+    }
+
+    if (echo != 0) {
+        const int32_t rtt = (int32_t)(now - echo);
+        if (rtt >= 0 && (st.rtt_ms == 0 || (uint32_t)rtt < st.rtt_ms)) {
+            st.rtt_ms = (uint32_t)rtt;
+        }
+    }
+}
+
+void WebSocketChat::publishNetStats() {
+    if (!framed_.load()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(net_mutex_);
+    net_turn_.framed = true;
+    net_turn_.dl_jitter_ms = (uint32_t)lroundf(rx_jitter_);
+    net_turn_.dl_delay_ms = (uint32_t)(rx_transit_max_ - rx_transit_min_);
+    net_last_ = net_turn_;
+    // 下一轮从零开始：一轮没有下行包时不能沿用这一轮的传输时间波动
+    net_turn_ = WsNetStats{};
+    rx_transit_min_ = 0;
+    rx_transit_max_ = 0;
+    ESP_LOGI(TAG, "net: rtt=%lu ms, dl %lu pkts lost=%lu reord=%lu jitter=%lu delay=%lu ms, "
+             "ul %lu pkts lost=%lu jitter=%lu ms",
+             (unsigned long)net_last_.rtt_ms, (unsigned long)net_last_.dl_packets,
+             (unsigned long)net_last_.dl_lost, (unsigned long)net_last_.dl_reordered,
+             (unsigned long)net_last_.dl_jitter_ms, (unsigned long)net_last_.dl_delay_ms,
+             (unsigned long)net_last_.ul_packets, (unsigned long)net_last_.ul_lost,
+             (unsigned long)net_last_.ul_jitter_ms);
+}
+
+WsNetStats WebSocketChat::netStats() const {
+    std::lock_guard<std::mutex> lock(net_mutex_);
+    WsNetStats st = net_last_;
+    st.framed = framed_.load();
+    return st;
+}
+
+std::string WebSocketChat::statusJson() const {
+    WsTxStats tx = txStats();
+    WsRxStats rx = rxStats();
+    WsConnStats conn = connStats();
+    WsNetStats net = netStats();
+    char buf[320];
+    snprintf(buf, sizeof(buf),
+             "{\"tx\":{\"queued_ms\":%u,\"high_water_ms\":%u,"
+             "\"dropped_frames\":%u,\"dropped_ms\":%u,\"messages\":%u,"
+             "\"send_errors\":%u},\"rx\":{\"queued_bytes\":%u,"
+             "\"high_water_bytes\":%u,\"dropped_bytes\":%u},",
+             (unsigned)tx.queued_ms, (unsigned)tx.high_water_ms,
+             (unsigned)tx.dropped_frames, (unsigned)tx.dropped_ms,
+             (unsigned)tx.messages, (unsigned)tx.send_errors,
+             (unsigned)rx.queued_bytes, (unsigned)rx.high_water_bytes,
+             (unsigned)rx.dropped_bytes);
+    std::string json(buf);
+    snprintf(buf, sizeof(buf),
+             "\"conn\":{\"ready\":%s,\"uptime_ms\":%u,\"connect_ms\":%u,"
+             "\"sessions\":%u,\"attempts\":%u,\"backoff_ms\":%u},",
+             conn.ready ? "true" : "false", (unsigned)conn.uptime_ms,
+             (unsigned)conn.connect_ms, (unsigned)conn.sessions,
+             (unsigned)conn.attempts, (unsigned)conn.backoff_ms);
+    json += buf;
+    snprintf(buf, sizeof(buf),
+             "\"net\":{\"framed\":%s,\"rtt_ms\":%u,\"dl_packets\":%u,"
+             "\"dl_lost\":%u,\"dl_reordered\":%u,\"dl_jitter_ms\":%u,"
+             "\"dl_delay_ms\":%u,\"ul_packets\":%u,\"ul_lost\":%u,"
+             "\"ul_jitter_ms\":%u}}",
+             net.framed ? "true" : "false", (unsigned)net.rtt_ms,
+             (unsigned)net.dl_packets, (unsigned)net.dl_lost,
+             (unsigned)net.dl_reordered, (unsigned)net.dl_jitter_ms,
+             (unsigned)net.dl_delay_ms, (unsigned)net.ul_packets,
+             (unsigned)net.ul_lost, (unsigned)net.ul_jitter_ms);
+    json += buf;
+    return json;
 }
 
 void WebSocketChat::eventHandler(void* arg, esp_event_base_t event_base,
@@ -234,26 +1073,41 @@ void WebSocketChat::handleEvent(esp_websocket_event_data_t* data, int32_t event_
     switch (event_id) {
         case WEBSOCKET_EVENT_CONNECTED:
             ESP_LOGI(TAG, "WebSocket connected");
-            // 先设置为 Connected 才能发送 hello
-            state_.store(WsDialogState::Connected);
-            sendHello();
-            // hello 发送后暂时回到 Connecting，等待服务器 hello 响应
+            turn_gen_.fetch_add(1); // 上一条连接排队的消息不发到新会话
+            tx_abort_.store(false); // 打断的是上一条连接的会话
+            // 帧头等服务器 hello 确认后才启用；序号按连接重新开始
+            framed_.store(false);
+            have_peer_offset_.store(false);
+            {
+                std::lock_guard<std::mutex> lock(net_mutex_);
+                rx_have_seq_ = false;
+                net_turn_ = WsNetStats{};
+                rx_transit_min_ = 0;
+                rx_transit_max_ = 0;
+            }
+            // 收到服务器 hello 之前一直是 Connecting：ws_conn 在这段时间里
+            // 仍按握手超时计时（hello 直接写出，不经过 sendText 的状态检查）
             state_.store(WsDialogState::Connecting);
+            sendHello();
             break;
             
         case WEBSOCKET_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "WebSocket disconnected");
             state_.store(WsDialogState::Idle);
+            turn_gen_.fetch_add(1);
             session_id_.clear();
             rx_continuation_opcode_ = 0;
             rx_text_buf_.clear();
+            rxAppend(nullptr, 0, false, true, true);
             if (on_connection_) {
                 on_connection_(false);
             }
+            xTaskNotifyGive(conn_task_); // ws_conn 负责重连
             break;
             
         case WEBSOCKET_EVENT_DATA:
             if (data->data_ptr && data->data_len > 0) {
+                rx_bytes_.fetch_add((uint32_t)data->data_len, std::memory_order_relaxed);
                 const uint8_t raw_op = data->op_code;
                 uint8_t op = raw_op;
 
@@ -289,10 +1143,26 @@ void WebSocketChat::handleEvent(esp_websocket_event_data_t* data, int32_t event_
                         rx_text_buf_.clear();
                     }
                 } else if (op == 0x02) {
-                    // Binary message (audio data)
-                    if (state_.load() == WsDialogState::Speaking && on_tts_audio_) {
-                        on_tts_audio_((const uint8_t*)data->data_ptr, (size_t)data->data_len);
+                    // Binary message (audio data)：拷进下行队列即返回，播放由 ws_rx 完成
+                    const bool start = raw_op == 0x02 && data->payload_offset == 0;
+                    const bool done = data->fin && frame_done;
+                    // 压缩包不能按分片解码：在环里拼完整条消息再交给上层
+                    const bool packet = strcmp(downlink_format_.load(), "pcm") != 0;
+                    const uint8_t* payload = (const uint8_t*)data->data_ptr;
+                    size_t payload_len = (size_t)data->data_len;
+                    if (start && framed_.load()) {
+                        // v2 帧头只在消息开头（服务器整条发出，首个分片必然含完整帧头）
+                        if (payload_len >= kFrameHeaderBytes && payload[0] == kFrameVersion) {
+                            noteDownlinkFrame(le32(payload + 4), le32(payload + 8),
+                                              le32(payload + 12));
+                            payload += kFrameHeaderBytes;
+                            payload_len -= kFrameHeaderBytes;
+                        } else {
+                            ESP_LOGW(TAG, "Binary message without frame header (%u bytes)",
+                                     (unsigned)payload_len);
+                        }
                     }
+                    rxAppend(payload, payload_len, packet, start, done);
                 }
 
                 // Clear opcode tracking when the message is finished.
@@ -307,23 +1177,29 @@ void WebSocketChat::handleEvent(esp_websocket_event_data_t* data, int32_t event_
             // ERROR may not always be followed by DISCONNECTED; reset state so
             // upper layers can recover.
             state_.store(WsDialogState::Idle);
+            turn_gen_.fetch_add(1);
             session_id_.clear();
             rx_continuation_opcode_ = 0;
             rx_text_buf_.clear();
+            rxAppend(nullptr, 0, false, true, true);
             if (on_connection_) {
                 on_connection_(false);
             }
+            xTaskNotifyGive(conn_task_); // ws_conn 负责重连
             break;
 
         case WEBSOCKET_EVENT_CLOSED:
             ESP_LOGI(TAG, "WebSocket closed");
             state_.store(WsDialogState::Idle);
+            turn_gen_.fetch_add(1);
             session_id_.clear();
             rx_continuation_opcode_ = 0;
             rx_text_buf_.clear();
+            rxAppend(nullptr, 0, false, true, true);
             if (on_connection_) {
                 on_connection_(false);
             }
+            xTaskNotifyGive(conn_task_); // ws_conn 负责重连
             break;
             
         default:
@@ -365,10 +1241,27 @@ void WebSocketChat::handleTextMessage(const char* data, size_t len) {
                 server_sample_rate_ = sample_rate->valueint;
             }
         }
+        cJSON* uplink = cJSON_IsObject(audio_params)
+                            ? cJSON_GetObjectItem(audio_params, "uplink_format")
+                            : nullptr;
+        selectUplinkFormat(cJSON_IsString(uplink) ? uplink->valuestring : "pcm");
+        cJSON* downlink = cJSON_IsObject(audio_params)
+                              ? cJSON_GetObjectItem(audio_params, "format")
+                              : nullptr;
+        selectDownlinkFormat(cJSON_IsString(downlink) ? downlink->valuestring : "pcm");
+#if CONFIG_CLOUD_WS_FRAMING_V2
+        const bool framed = cJSON_IsObject(audio_params) &&
+                            jsonInt(audio_params, "framing") == kFrameVersion;
+#else
+        const bool framed = false;
+#endif
+        framed_.store(framed);
         
+        onSessionReady();
         state_.store(WsDialogState::Connected);
-        ESP_LOGI(TAG, "Hello handshake complete, session_id=%s, server_sr=%d", 
-                 session_id_.c_str(), server_sample_rate_);
+        ESP_LOGI(TAG, "Hello handshake complete, session_id=%s, server_sr=%d, uplink=%s, downlink=%s, framing=%d", 
+                 session_id_.c_str(), server_sample_rate_, uplinkFormat(), downlinkFormat(),
+                 framed ? 2 : 1);
 
         if (on_connection_) {
             on_connection_(true);
@@ -393,23 +1286,40 @@ void WebSocketChat::handleTextMessage(const char* data, size_t len) {
                 auto cur_state = state_.load();
                 if (cur_state == WsDialogState::WaitingForResponse ||
                     cur_state == WsDialogState::Connected) {
+                    LTRACE_FIRST(TraceEvent::TtsStart, 0);
                     state_.store(WsDialogState::Speaking);
-                    if (on_tts_state_) {
-                        on_tts_state_(true);
-                    }
+                    rxQueueTtsState(true);
                     ESP_LOGI(TAG, "TTS start");
                 } else {
                     ESP_LOGW(TAG, "TTS start in unexpected state: %d", (int)cur_state);
                 }
                 
             } else if (strcmp(tts_state, "stop") == 0) {
-                state_.store(WsDialogState::Connected);
-                if (on_tts_state_) {
-                    on_tts_state_(false);
+                // 打断 (abort) 之后服务器仍可能补发上一轮的 stop；
+                // 此时已经开始新一轮 Listening，不能被它复位
+                auto cur_state = state_.load();
+                if (cur_state == WsDialogState::Speaking ||
+                    cur_state == WsDialogState::WaitingForResponse) {
+                    state_.store(WsDialogState::Connected);
+                    // 排在已收到的音频之后：播放器先收完整段再结束流
+                    rxQueueTtsState(false);
+                    ESP_LOGI(TAG, "TTS stop");
+                    publishNetStats();
+                } else {
+                    ESP_LOGD(TAG, "Ignore stale TTS stop in state: %d", (int)cur_state);
                 }
-                ESP_LOGI(TAG, "TTS stop");
             }
         }
+
+    } else if (strcmp(type, "net") == 0) {
+        // 服务器按 v2 帧头统计的上行网络质量（listen stop 之后发送）
+        cJSON* uplink = cJSON_GetObjectItem(root, "uplink");
+        if (cJSON_IsObject(uplink)) {
+            std::lock_guard<std::mutex> lock(net_mutex_);
+            net_turn_.ul_packets = (uint32_t)jsonInt(uplink, "packets");
+            net_turn_.ul_lost = (uint32_t)jsonInt(uplink, "lost");
+            net_turn_.ul_jitter_ms = (uint32_t)jsonInt(uplink, "jitter_ms");
+        }
     }
     
     cJSON_Delete(root);
@@ -1,11 +1,17 @@
 #pragma once
 
+#include "audio_codec.h"
+#include "audio_ring.h"
 #include "esp_err.h"
 #include "esp_websocket_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics.h"
 #include <functional>
 #include <string>
 #include <vector>
 #include <atomic>
+#include <memory>
 #include <mutex>
 
 /**
@@ -26,9 +32,64 @@ enum class WsDialogState {
 struct WebSocketChatConfig {
     std::string url;                     ///< WebSocket 服务器 URL (ws:// 或 wss://)
     std::string device_id;               ///< 设备 ID
-    int reconnect_timeout_ms = 10000;    ///< 重连超时
+    int handshake_timeout_ms = 10000;    ///< 建连（含 hello 响应）超时，超时按失败退避重连
     int buffer_size = 4096;              ///< 接收缓冲区大小
     int sample_rate = 16000;             ///< 音频采样率
+    std::string uplink_format = "pcm";   ///< 上行音频首选格式：pcm / adpcm / opus（以服务器 hello 确认为准）
+    std::string downlink_format = "pcm"; ///< 下行 TTS 首选格式：pcm / adpcm / opus（以服务器 hello 确认为准）
+};
+
+/**
+ * @brief 上行发送队列统计
+ */
+struct WsTxStats {
+    uint32_t queued_ms = 0;      ///< 当前排队待发的音频时长
+    uint32_t high_water_ms = 0;  ///< 排队时长的历史最高值
+    uint32_t dropped_frames = 0; ///< 队列满丢弃的 sendAudio 调用次数
+    uint32_t dropped_ms = 0;     ///< 丢弃的音频时长
+    uint32_t messages = 0;       ///< 已发送的音频消息数
+    uint32_t send_errors = 0;    ///< 发送失败次数
+};
+
+/**
+ * @brief 下行接收队列统计
+ */
+struct WsRxStats {
+    uint32_t queued_bytes = 0;     ///< 已收到、尚未交给播放器的音频字节
+    uint32_t high_water_bytes = 0; ///< 排队字节的历史最高值
+    uint32_t dropped_bytes = 0;    ///< 队列满丢弃的音频字节
+};
+
+/**
+ * @brief 常驻连接统计
+ */
+struct WsConnStats {
+    bool ready = false;        ///< 会话已就绪（hello 完成）
+    uint32_t uptime_ms = 0;    ///< 当前会话已保持的时长
+    uint32_t connect_ms = 0;   ///< 最近一次建连耗时（TCP + TLS + WebSocket 握手 + hello）
+    uint32_t sessions = 0;     ///< 成功建立的会话数
+    uint32_t attempts = 0;     ///< 发起的连接次数
+    uint32_t backoff_ms = 0;   ///< 最近一次重连前的等待
+};
+
+/**
+ * @brief 网络质量统计（v2 帧头，最近一轮对话）
+ *
+ * 抖动按 RFC 3550 的到达间隔抖动计算（发送时间戳与本地到达时间之差的
+ * 平均偏差），跨轮次持续平滑；其余字段每轮清零。上行部分由服务器在
+ * listen stop 之后用 "net" 消息回报。
+ */
+struct WsNetStats {
+    bool framed = false;       ///< 服务器确认了 v2 帧头
+    uint32_t rtt_ms = 0;       ///< 往返时延（时间戳回显，取本轮最小值）
+    uint32_t dl_packets = 0;   ///< 下行音频消息数
+    uint32_t dl_lost = 0;      ///< 下行序号缺口（服务器或本机队列丢弃）
+    uint32_t dl_reordered = 0; ///< 下行序号回退
+    uint32_t dl_jitter_ms = 0; ///< 下行到达抖动
+    uint32_t dl_delay_ms = 0;  ///< 下行单向时延的波动（最大 - 最小传输时间）
+    uint32_t ul_packets = 0;   ///< 服务器收到的上行音频消息数
+    uint32_t ul_lost = 0;      ///< 上行序号缺口
+    uint32_t ul_jitter_ms = 0; ///< 上行到达抖动
 };
 
 /**
@@ -61,14 +122,31 @@ public:
     esp_err_t init(const WebSocketChatConfig& config);
     
     /**
-     * @brief 连接服务器
+     * @brief 保持与服务器的连接（交给 ws_conn 监督任务）
+     *
+     * 之后连接常驻：网络可用时立即建连，断线后按带抖动的指数退避重连
+     * （CONFIG_CLOUD_WS_RECONNECT_MIN_MS .. CONFIG_CLOUD_WS_RECONNECT_MAX_MS），
+     * 握手超时也按失败处理。正在退避时再次调用会跳过剩余的等待（例如唤醒时）。
      */
     esp_err_t connect();
     
     /**
-     * @brief 断开连接
+     * @brief 断开连接并停止自动重连
      */
     void disconnect();
+
+    /**
+     * @brief 网络状态（STA 拿到 / 失去 IP）
+     *
+     * 拿到 IP 时重置退避并立即建连；断网时关闭连接，等下一次拿到 IP。
+     * 初始为不可用：必须由网络层（WifiManager）通知。
+     */
+    void setNetworkUp(bool up);
+
+    /**
+     * @brief 常驻连接统计
+     */
+    WsConnStats connStats() const;
     
     /**
      * @brief 是否已连接并完成握手
@@ -89,31 +167,81 @@ public:
      * @brief 获取服务器协商的音频采样率
      */
     int serverSampleRate() const { return server_sample_rate_; }
+
+    /**
+     * @brief 当前生效的上行音频格式（服务器未确认压缩格式时为 "pcm"）
+     */
+    const char* uplinkFormat() const { return uplink_format_; }
+
+    /**
+     * @brief 服务器确认的下行 TTS 音频格式（hello 的 audio_params.format）
+     *
+     * 非 "pcm" 时 TTS 音频回调每次给出一个完整的压缩包。
+     */
+    const char* downlinkFormat() const { return downlink_format_; }
     
     /**
-     * @brief 开始监听 (发送 listen start)
+     * @brief 开始监听 (listen start 排入上行队列，立即进入 Listening)
      */
     esp_err_t startListening();
     
     /**
-     * @brief 停止监听 (发送 listen stop)
+     * @brief 停止监听 (listen stop 排在已入队的音频之后发出，立即进入 WaitingForResponse)
      */
     esp_err_t stopListening();
     
     /**
-     * @brief 发送二进制音频数据
+     * @brief 发送二进制音频数据（只入队，不阻塞）
+     *
+     * PCM 先进入无锁上行队列，由 ws_tx 任务合并成约
+     * CONFIG_CLOUD_WS_TX_COALESCE_MS 的二进制消息发送，网络慢时不会拖住
+     * 调用方（唤醒检测任务）。协商为压缩格式时由 ws_tx 任务按编码器帧长
+     * （20ms）编码，每帧一条消息；不足一帧的尾巴在 listen stop 之前补零发出。
+     * 队列满时整段丢弃，计入 txStats()。
+     *
+     * startListening / sendAudio / stopListening 必须在同一个任务里调用
+     * （上行队列只有一个生产者）。
+     *
      * @param data PCM 16-bit mono 数据
      * @param len 数据长度 (字节)
      */
     esp_err_t sendAudio(const uint8_t* data, size_t len);
+
+    /**
+     * @brief 上行发送队列统计
+     */
+    WsTxStats txStats() const;
+
+    /**
+     * @brief 下行接收队列统计
+     */
+    WsRxStats rxStats() const;
+
+    /**
+     * @brief 最近一轮（tts stop 时结算）的网络质量统计
+     */
+    WsNetStats netStats() const;
+
+    /**
+     * @brief 上下行队列 / 连接 / 网络质量统计（JSON 对象字符串，供网页 /api/status）
+     */
+    std::string statusJson() const;
     
     /**
      * @brief 发送打断信号
+     *
+     * 不阻塞调用方：abort 交给 ws_tx 插到所有排队消息之前发出，尚未发出的
+     * 本轮上行作废。Speaking / WaitingForResponse 立即回到 Connected：
+     * 之后收到的本轮 TTS 音频与迟到的 "tts stop" 都会被忽略。
      */
     esp_err_t sendAbort();
     
     // ========== 回调设置 ==========
     
+    // 回调线程：TTS 音频与 TTS 状态在 ws_rx 任务中按到达顺序调用，可以阻塞
+    // （例如等待播放缓冲），背压不会拖住 WebSocket 事件任务；STT 与连接状态
+    // 在事件任务中立即调用，不能阻塞。
+
     /**
      * @brief STT 识别结果回调
      */
@@ -146,11 +274,19 @@ private:
     esp_websocket_client_handle_t client_ = nullptr;
     std::atomic<WsDialogState> state_{WsDialogState::Idle};
     bool initialized_ = false;
-    std::mutex mutex_;
+    std::mutex mutex_; // 只保护上行编码器状态，不跨 socket 发送持有
     
     std::string session_id_;
     int server_sample_rate_ = 16000;
 
+    // 上行编码（mutex_ 保护）；encoder_ 为空时直接发送 PCM
+    std::unique_ptr<UplinkEncoder> encoder_;
+    std::atomic<const char*> uplink_format_{"pcm"};
+    std::vector<int16_t> enc_frame_;
+    size_t enc_fill_ = 0;
+
+    std::atomic<const char*> downlink_format_{"pcm"};
+
     // RX framing helpers (handle continuation / oversized frames)
     uint8_t rx_continuation_opcode_ = 0;
     std::string rx_text_buf_;
@@ -161,8 +297,9 @@ private:
     TtsAudioCallback on_tts_audio_;
     ConnectionCallback on_connection_;
     
-    // 发送 JSON 文本
+    // 发送 JSON 文本（会话已就绪）；writeText 不检查状态，供握手阶段的 hello 使用
     esp_err_t sendText(const std::string& text);
+    esp_err_t writeText(const std::string& text);
     
     // 事件处理
     static void eventHandler(void* arg, esp_event_base_t event_base,
@@ -170,4 +307,154 @@ private:
     void handleEvent(esp_websocket_event_data_t* data, int32_t event_id);
     void handleTextMessage(const char* data, size_t len);
     void sendHello();
+    void selectUplinkFormat(const char* format);
+    void selectDownlinkFormat(const char* format);
+    int encodeFrameLocked(uint32_t* samples);
+    void flushUplink();
+
+    // ========== 连接监督任务 ==========
+    esp_err_t startConnTask();
+    static void connTaskEntry(void* arg);
+    TickType_t connStep();
+    void startAttemptLocked(int64_t nowUs);
+    void stopClientLocked();
+    void scheduleRetryLocked(int64_t nowUs);
+    void onSessionReady();
+
+    TaskHandle_t conn_task_ = nullptr;
+    std::mutex conn_mutex_;              // 客户端 start / stop（不能与发送用的 mutex_ 共用）
+    std::atomic<bool> wanted_{false};    // connect() 之后为 true，disconnect() 清除
+    std::atomic<bool> network_up_{false};
+    std::atomic<bool> kick_{false};      // 跳过当前退避等待
+    bool client_started_ = false;        // conn_mutex_
+    int64_t attempt_start_us_ = 0;       // conn_mutex_
+    int64_t next_attempt_us_ = 0;        // conn_mutex_
+    uint32_t backoff_step_ = 0;          // conn_mutex_：连续失败次数
+    std::atomic<bool> reset_backoff_{false}; // 会话建立成功：下次断线从最短退避开始
+    std::atomic<uint32_t> ready_since_ms_{0}; // nowMs() 刻度，0 = 未就绪；差值按回绕计算
+    std::atomic<uint32_t> connect_ms_{0};
+    std::atomic<uint32_t> sessions_{0};
+    std::atomic<uint32_t> attempts_{0};
+    std::atomic<uint32_t> backoff_ms_{0};
+
+    // ========== 上行发送任务 ==========
+    enum class TxKind : uint8_t { Audio, ListenStart, ListenStop };
+    struct TxDesc {
+        TxKind kind;
+        uint32_t gen;     // 入队时的 turn_gen_；不一致说明之后打断 / 断线过，丢弃
+        uint32_t samples; // Audio：tx_pcm_ 中属于这一段的采样数
+    };
+
+    esp_err_t startTxTask();
+    esp_err_t startRxTask();
+    esp_err_t enqueueControl(TxKind kind);
+    static void txTaskEntry(void* arg);
+    void txDrain();
+    void txDropStalePending();
+    void txSendAbortIfPending();
+    void txSendPending(size_t samples);
+    esp_err_t sendAudioMessage(uint8_t* msg, size_t payloadBytes, uint32_t samples);
+    esp_err_t sendListenJson(const char* state);
+
+    AudioRing<int16_t> tx_pcm_;   // 待发 PCM（PSRAM）
+    AudioRing<TxDesc> tx_desc_;   // 帧描述符，顺序与 tx_pcm_ 一致
+    TaskHandle_t tx_task_ = nullptr;
+    std::atomic<uint32_t> turn_gen_{0}; // 打断 / 连接变化时递增：上下行队列里更早的消息作废
+    size_t tx_coalesce_samples_ = 0;
+    size_t tx_unsignaled_ = 0;          // 生产者：上次唤醒 ws_tx 之后入队的采样数
+    size_t tx_pending_ = 0;             // ws_tx：已取出描述符、尚未发送的采样数
+    uint32_t tx_pending_gen_ = 0;
+    std::vector<uint8_t> tx_msg_;       // ws_tx：帧头 + 一条合并消息的 PCM
+    std::vector<uint8_t> tx_pkt_;       // ws_tx：帧头 + 一个编码包（在 mutex_ 外发送）
+    std::atomic<bool> tx_abort_{false}; // 待发的 abort（任意任务置位，ws_tx 优先发出）
+    uint32_t tx_seq_ = 0;               // ws_tx：上行帧序号
+    std::atomic<uint32_t> tx_dropped_frames_{0};
+    std::atomic<uint32_t> tx_messages_{0};
+    std::atomic<uint32_t> tx_send_errors_{0};
+    std::atomic<uint32_t> tx_bytes_{0};
+
+    // ========== 下行接收通道 ==========
+    // 事件任务把二进制分片拷进 rx_audio_ 就返回（不阻塞），压缩包在环里原地
+    // 拼接；ws_rx 任务按顺序把音频与 tts start/stop 交给回调
+    enum class RxKind : uint8_t { Pcm, Packet, Discard, TtsStart, TtsStop };
+    struct RxDesc {
+        RxKind kind;
+        uint32_t gen;   // 入队时的 turn_gen_
+        uint32_t bytes; // Pcm / Packet / Discard：rx_audio_ 中的字节数
+    };
+
+    static void rxTaskEntry(void* arg);
+    void rxDrain();
+    void rxDeliver(const RxDesc& desc);
+    bool rxPush(RxKind kind, uint32_t bytes);
+    bool rxAudioSlotFree() const;
+    void rxAppend(const uint8_t* data, size_t len, bool packet, bool start, bool done);
+    void rxQueueTtsState(bool started);
+
+    AudioRing<uint8_t> rx_audio_;  // 下行音频（PSRAM）
+    AudioRing<RxDesc> rx_desc_;
+    TaskHandle_t rx_task_ = nullptr;
+    // 事件任务：当前二进制消息的状态
+    bool rx_msg_active_ = false;   // 本条消息要交给播放器
+    bool rx_msg_dropped_ = false;  // 本条消息已因队列满而丢弃
+    size_t rx_msg_bytes_ = 0;      // 压缩包已写入 rx_audio_ 的字节
+    std::vector<uint8_t> rx_packet_; // ws_rx：跨越环尾的压缩包拼接缓冲
+    std::atomic<uint32_t> rx_dropped_bytes_{0};
+    std::atomic<uint32_t> rx_bytes_{0};
+
+    // ========== v2 帧头（序号 + 时间戳） ==========
+    // 每条二进制消息前 16 字节，小端：
+    //   u8 version(2) | u8 flags(0) | u16 samples | u32 seq | u32 ts_ms | u32 echo_ms
+    // ts_ms 为发送方时钟的发出时刻（两个方向相同）；echo_ms 为最近收到
+    // 的对端 ts_ms 加上它在本端停留的时间，对端用 now - echo_ms 得到往返时延，
+    // 两端时钟无需同步。hello 中 audio_params.framing = 2 协商，旧服务器不回复
+    // 该字段时双方都发裸音频。
+    static constexpr size_t kFrameHeaderBytes = 16;
+    void noteDownlinkFrame(uint32_t seq, uint32_t ts, uint32_t echo);
+    void publishNetStats();
+
+    std::atomic<bool> framed_{false};
+    // 最近的服务器 ts_ms 减本地到达时刻（模 2^32），echo = now + 偏移；
+    // 两个 32 位原子量：Xtensa 上 64 位 atomic 不是无锁的
+    std::atomic<uint32_t> peer_offset_{0};
+    std::atomic<bool> have_peer_offset_{false};
+    // 事件任务：本轮下行统计（net_mutex_ 保护，供 netStats 读取）
+    mutable std::mutex net_mutex_;
+    WsNetStats net_turn_;
+    WsNetStats net_last_;
+    bool rx_have_seq_ = false;
+    uint32_t rx_next_seq_ = 0;
+    uint32_t rx_last_arrival_ = 0;
+    uint32_t rx_last_ts_ = 0;
+    float rx_jitter_ = 0.0f;              // RFC 3550 J（ms）
+    uint32_t rx_transit_base_ = 0;        // 本轮第一包的 到达 - 发送
+    int32_t rx_transit_min_ = 0;
+    int32_t rx_transit_max_ = 0;
+
+    // ========== /api/metrics ==========
+    void registerMetrics();
+
+    MetricCounter metric_tx_bytes_{"dino_ws_bytes_total", "WebSocket payload bytes",
+                                   [this] { return tx_bytes_.load(std::memory_order_relaxed); },
+                                   "dir=\"tx\""};
+    MetricCounter metric_rx_bytes_{"dino_ws_bytes_total", "WebSocket payload bytes",
+                                   [this] { return rx_bytes_.load(std::memory_order_relaxed); },
+                                   "dir=\"rx\""};
+    MetricCounter metric_attempts_{"dino_ws_connect_attempts_total", "WebSocket connection attempts",
+                                   [this] { return attempts_.load(std::memory_order_relaxed); }};
+    // 重连次数 = sessions - 1
+    MetricCounter metric_sessions_{"dino_ws_sessions_total", "WebSocket sessions established (hello done)",
+                                   [this] { return sessions_.load(std::memory_order_relaxed); }};
+    MetricCounter metric_tx_dropped_{"dino_ws_tx_dropped_frames_total", "Uplink frames dropped (queue full)",
+                                     [this] { return tx_dropped_frames_.load(std::memory_order_relaxed); }};
+    MetricCounter metric_tx_errors_{"dino_ws_tx_send_errors_total", "Uplink sends that failed",
+                                    [this] { return tx_send_errors_.load(std::memory_order_relaxed); }};
+    MetricCounter metric_rx_dropped_{"dino_ws_rx_dropped_bytes_total", "Downlink audio bytes dropped (queue full)",
+                                     [this] { return rx_dropped_bytes_.load(std::memory_order_relaxed); }};
+    MetricGauge metric_ready_{"dino_ws_ready", "WebSocket session ready (1/0)",
+                              [this] { return isReady() ? 1.0 : 0.0; }};
+    MetricGauge metric_rtt_{"dino_ws_rtt_ms", "Round-trip time (v2 framing, last turn)",
+                            [this] { return (double)netStats().rtt_ms; }};
+    MetricGauge metric_jitter_{"dino_ws_downlink_jitter_ms", "Downlink arrival jitter (v2 framing)",
+                               [this] { return (double)netStats().dl_jitter_ms; }};
 };
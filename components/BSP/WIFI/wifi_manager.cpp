@@ -1,8 +1,11 @@
 #include "wifi_manager.h"
 
+#include "command_table.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "freertos/task.h"
+#include "latency_trace.h"
+#include "metrics.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 
@@ -387,6 +390,9 @@ void WifiManager::eventHandler(void *arg, esp_event_base_t eventBase,
 void WifiManager::onWifiEvent(int32_t eventId, void * /*eventData*/) {
   switch (eventId) {
   case WIFI_EVENT_STA_DISCONNECTED:
+    if (m_staCb) {
+      m_staCb(false);
+    }
     // If we are trying STA connect, retry a few times to avoid transient issues.
     if (!m_staSsid.empty() && m_staRetryCount < m_cfg.sta_max_retry) {
       m_staRetryCount++;
@@ -418,6 +424,9 @@ void WifiManager::onIpEvent(int32_t eventId, void *eventData) {
   if (m_eventGroup) {
     xEventGroupSetBits(m_eventGroup, STA_CONNECTED_BIT);
   }
+  if (m_staCb) {
+    m_staCb(true);
+  }
 
   if (!m_cfg.keep_ap_on_after_sta_connected && !m_deferStopAp) {
     stopAp();
@@ -450,13 +459,17 @@ static const char *kHtmlRoot = R"HTML(
   <h2>ESP32 Web Control</h2>
   <div class="card">
     <div><a href="/wifi">WiFi 配网</a></div>
+    <div id="cmds" class="row"></div>
+  </div>
+
+  <h3>命令词</h3>
+  <div class="card">
+    <textarea id="cmdTable" rows="10" style="width:100%;font-family:monospace"></textarea>
     <div class="row">
-      <button onclick="cmd(0)">开灯</button>
-      <button onclick="cmd(1)">关灯</button>
-      <button onclick="cmd(2)">前进</button>
-      <button onclick="cmd(3)">后退</button>
-      <button onclick="cmd(4)">神龙摆尾</button>
+      <button onclick="saveCmds()">保存并热加载</button>
+      <button onclick="resetCmds()">恢复默认</button>
     </div>
+    <pre id="cmdRet"></pre>
   </div>
 
   <h3>TTS</h3>
@@ -483,6 +496,53 @@ async function cmd(id) {
   }
 }
 
+async function loadCmds() {
+  try {
+    const r = await fetch('/api/commands');
+    const j = await r.json();
+    const row = document.getElementById('cmds');
+    row.innerHTML = '';
+    for (const c of j.commands) {
+      const b = document.createElement('button');
+      b.textContent = c.name;
+      b.onclick = () => cmd(c.id);
+      row.appendChild(b);
+    }
+    document.getElementById('cmdTable').value =
+        JSON.stringify({ commands: j.commands }, null, 1);
+    document.getElementById('cmdRet').textContent = 'actions: ' + j.actions.join(', ');
+  } catch (e) {
+    document.getElementById('cmdRet').textContent = 'commands error: ' + e;
+  }
+}
+
+async function saveCmds() {
+  try {
+    document.getElementById('cmdRet').textContent = 'reloading...';
+    const r = await fetch('/api/commands', {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json' },
+      body: document.getElementById('cmdTable').value
+    });
+    const t = await r.text();
+    if (r.ok) { await loadCmds(); }
+    document.getElementById('cmdRet').textContent = t;
+  } catch (e) {
+    document.getElementById('cmdRet').textContent = 'save error: ' + e;
+  }
+}
+
+async function resetCmds() {
+  try {
+    const r = await fetch('/api/commands', { method: 'DELETE' });
+    const t = await r.text();
+    if (r.ok) { await loadCmds(); }
+    document.getElementById('cmdRet').textContent = t;
+  } catch (e) {
+    document.getElementById('cmdRet').textContent = 'reset error: ' + e;
+  }
+}
+
 async function tts() {
   const text = document.getElementById('ttsText').value || '';
   if (!text.trim()) return;
@@ -509,6 +569,7 @@ async function refresh() {
   }
 }
 
+loadCmds();
 refresh();
 setInterval(refresh, 1200);
 </script>
@@ -593,6 +654,29 @@ esp_err_t WifiManager::startWebServer() {
                      .user_ctx = this};
   httpd_register_uri_handler(m_httpd, &tts);
 
+  httpd_uri_t trace = {.uri = "/api/trace",
+                       .method = HTTP_GET,
+                       .handler = &WifiManager::handleTrace,
+                       .user_ctx = this};
+  httpd_register_uri_handler(m_httpd, &trace);
+
+  httpd_uri_t metrics = {.uri = "/api/metrics",
+                         .method = HTTP_GET,
+                         .handler = &WifiManager::handleMetrics,
+                         .user_ctx = this};
+  httpd_register_uri_handler(m_httpd, &metrics);
+
+  // GET 读取 / POST 替换并热加载 / DELETE 恢复默认
+  static const httpd_method_t kCommandsMethods[] = {HTTP_GET, HTTP_POST,
+                                                    HTTP_DELETE};
+  for (httpd_method_t method : kCommandsMethods) {
+    httpd_uri_t commands = {.uri = "/api/commands",
+                            .method = method,
+                            .handler = &WifiManager::handleCommands,
+                            .user_ctx = this};
+    httpd_register_uri_handler(m_httpd, &commands);
+  }
+
   httpd_uri_t wifiSave = {.uri = "/api/wifi/save",
                           .method = HTTP_POST,
                           .handler = &WifiManager::handleWifiSave,
@@ -682,7 +766,13 @@ esp_err_t WifiManager::handleCmd(httpd_req_t *req) {
     }
   }
 
-  if (id >= 0 && id <= 4 && self->m_cmdCb) {
+  // 按当前命令表校验（表可经 /api/commands 在线修改）
+  if (id < 0 ||
+      CommandTable::instance().actionOf(id) == VoiceCommand::Unknown) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "unknown command id");
+    return ESP_FAIL;
+  }
+  if (self->m_cmdCb) {
     self->m_cmdCb(id);
   }
 
@@ -691,8 +781,92 @@ esp_err_t WifiManager::handleCmd(httpd_req_t *req) {
   return httpd_resp_send(req, ok, HTTPD_RESP_USE_STRLEN);
 }
 
+esp_err_t WifiManager::handleTrace(httpd_req_t *req) {
+  auto &trace = LatencyTrace::instance();
+  if (!trace.enabled()) {
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "trace disabled");
+    return ESP_FAIL;
+  }
+
+  // /api/trace?clear=1 ：导出后清空，便于逐轮对比
+  bool clearAfter = false;
+  char query[32];
+  char val[4];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+      httpd_query_key_value(query, "clear", val, sizeof(val)) == ESP_OK) {
+    clearAfter = (val[0] == '1');
+  }
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Content-Disposition",
+                     "attachment; filename=\"trace.json\"");
+  esp_err_t err = trace.exportChromeTrace([req](const char *data, size_t len) {
+    return httpd_resp_send_chunk(req, data, (ssize_t)len);
+  });
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "trace export failed: %s", esp_err_to_name(err));
+    return err;
+  }
+  if (clearAfter) {
+    trace.clear();
+  }
+  return httpd_resp_send_chunk(req, nullptr, 0);
+}
+
+esp_err_t WifiManager::handleMetrics(httpd_req_t *req) {
+  // Prometheus 文本格式，可直接作为 scrape target
+  httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+  esp_err_t err = Metrics::instance().exportPrometheus(
+      [req](const char *data, size_t len) {
+        return httpd_resp_send_chunk(req, data, (ssize_t)len);
+      });
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "metrics export failed: %s", esp_err_to_name(err));
+    return err;
+  }
+  return httpd_resp_send_chunk(req, nullptr, 0);
+}
+
 static std::string readReqBody(httpd_req_t *req);
 
+esp_err_t WifiManager::handleCommands(httpd_req_t *req) {
+  auto &table = CommandTable::instance();
+  std::string error;
+  esp_err_t ret = ESP_OK;
+
+  if (req->method == HTTP_POST) {
+    // 64 条命令的 JSON 远小于 8KB，超出直接拒绝
+    if (req->content_len == 0 || req->content_len > 8192) {
+      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad body size");
+      return ESP_FAIL;
+    }
+    std::string body = readReqBody(req);
+    ret = table.updateFromJson(body.data(), body.size(), error);
+  } else if (req->method == HTTP_DELETE) {
+    ret = table.resetToDefaults(error);
+  }
+
+  httpd_resp_set_type(req, "application/json");
+  if (ret != ESP_OK) {
+    std::string resp = "{\"ok\":false,\"error\":\"";
+    for (char c : error) {
+      if (c == '"' || c == '\\') {
+        resp += '\\';
+      }
+      resp += c;
+    }
+    resp += "\"}";
+    // 校验失败 / MultiNet 拒绝命令词 -> 400；NVS 等内部错误 -> 500
+    bool badInput = (ret == ESP_ERR_INVALID_ARG || ret == ESP_FAIL);
+    httpd_resp_set_status(req, badInput ? "400 Bad Request"
+                                        : "500 Internal Server Error");
+    return httpd_resp_send(req, resp.c_str(), resp.size());
+  }
+
+  std::string json = table.toJson();
+  return httpd_resp_send(req, json.c_str(), json.size());
+}
+
 namespace {
 struct TtsTaskCtx {
   WifiWebTtsCallback cb;
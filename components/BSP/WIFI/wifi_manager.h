@@ -30,7 +30,8 @@ struct WifiManagerConfig {
 
 /**
  * @brief Web 控制命令回调
- * @param command_id 与 WakeWord 命令 ID 一致 (0-4)
+ * @param command_id 与 WakeWord 命令 ID 一致（CommandTable 中的 id，
+ *                   handleCmd 已校验存在）
  */
 using WifiWebCommandCallback = std::function<void(int command_id)>;
 
@@ -44,6 +45,11 @@ using WifiWebStatusJsonCallback = std::function<std::string(void)>;
  */
 using WifiWebTtsCallback = std::function<void(const std::string &text)>;
 
+/**
+ * @brief STA 网络状态回调（true：拿到 IP；false：与路由器断开）
+ */
+using WifiStaStateCallback = std::function<void(bool connected)>;
+
 /**
  * @brief WiFi 管理器：支持网页配网 + 网页控制
  *
@@ -81,6 +87,11 @@ public:
    */
   void setTtsCallback(WifiWebTtsCallback cb) { m_ttsCb = cb; }
 
+  /**
+   * @brief 设置 STA 网络状态回调（在系统事件任务中调用，不能阻塞）
+   */
+  void setStaStateCallback(WifiStaStateCallback cb) { m_staCb = cb; }
+
   bool isStaConnected() const;
   std::string getStaIpAddress() const;
 
@@ -117,6 +128,9 @@ private:
   static esp_err_t handleStatus(httpd_req_t *req);
   static esp_err_t handleCmd(httpd_req_t *req);
   static esp_err_t handleTts(httpd_req_t *req);
+  static esp_err_t handleTrace(httpd_req_t *req);
+  static esp_err_t handleMetrics(httpd_req_t *req);
+  static esp_err_t handleCommands(httpd_req_t *req);
   static esp_err_t handleWifiSave(httpd_req_t *req);
 
   // helpers
@@ -146,6 +160,7 @@ private:
   WifiWebCommandCallback m_cmdCb = nullptr;
   WifiWebStatusJsonCallback m_statusCb = nullptr;
   WifiWebTtsCallback m_ttsCb = nullptr;
+  WifiStaStateCallback m_staCb = nullptr;
 
   // event bits
   static constexpr int STA_CONNECTED_BIT = BIT0;
@@ -2,11 +2,18 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "sdkconfig.h"
+#include "audio_dsp.h"
 #include "cloud_chat.h"
 #include "cloud_tts.h"
+#include "command_table.h"
+#include "http_conn_pool.h"
+#include "latency_trace.h"
+#include "metrics.h"
+#include "mp3_player.h"
 #include "voice_dialog.h"
 #include "voice_control.h"
 #include "wake_word.h"
+#include "websocket_chat.h"
 #include "wifi_manager.h"
 #include <stdio.h>
 #include <string.h>
@@ -22,6 +29,22 @@ extern "C" void app_main(void) {
   ESP_LOGI(TAG, "    语音控制示例程序");
   ESP_LOGI(TAG, "========================================");
 
+#if CONFIG_LATENCY_TRACE_ENABLE
+  // 端到端延迟打点（GET /api/trace 导出 Chrome trace JSON）
+  LatencyTrace::instance().init(CONFIG_LATENCY_TRACE_EVENTS);
+#endif
+
+#if CONFIG_AUDIO_DSP_SELF_TEST
+  // PCM 内核（PIE 向量路径）与参考模型逐位对比
+  if (audio_dsp::selfTest([](const char *msg) { ESP_LOGI(TAG, "%s", msg); }) !=
+      0) {
+    ESP_LOGE(TAG, "audio_dsp 自检失败：混音 / 增益结果与参考实现不一致");
+  }
+#endif
+
+  // 堆 / 运行时长 / 版本；各模块在 init 时注册自己的指标（GET /api/metrics）
+  registerSystemMetrics();
+
   // 初始化语音控制组件
   ESP_LOGI(TAG, "正在初始化语音控制组件...");
   esp_err_t ret = voiceCtrl.init({
@@ -42,12 +65,23 @@ extern "C" void app_main(void) {
     return;
   }
 
+  // 加载命令词表（NVS 中保存的表优先，网页 /api/commands 可在线修改）
+  CommandTable::instance().load();
+
   // 初始化唤醒词与命令识别模块
   ESP_LOGI(TAG, "正在初始化语音识别模块...");
   auto &wakeWord = WakeWord::instance();
+  AecConfig aecCfg;
+#if CONFIG_DIALOG_AEC_ENABLE
+  aecCfg.enabled = true;
+  aecCfg.ref_delay_ms = CONFIG_DIALOG_AEC_REF_DELAY_MS;
+#else
+  aecCfg.enabled = false;
+#endif
   ret = wakeWord.init(
       {.port = 0, .bck_io = 41, .ws_io = 42, .din_io = 2}, // I2S 配置
-      {.timeout_ms = 6000}                                 // 命令识别超时
+      {.timeout_ms = 6000},                                // 命令识别超时
+      aecCfg                                               // 回声消除
   );
   if (ret != ESP_OK) {
     ESP_LOGE(TAG, "语音识别模块初始化失败!");
@@ -71,15 +105,51 @@ extern "C" void app_main(void) {
       .chat_url = chatUrl,
       .ws_url = CONFIG_CLOUD_WEBSOCKET_URL,
       .use_websocket = useWebSocket,
+#if CONFIG_CLOUD_WS_UPLINK_OPUS
+      .ws_uplink_format = "opus",
+#elif CONFIG_CLOUD_WS_UPLINK_ADPCM
+      .ws_uplink_format = "adpcm",
+#else
+      .ws_uplink_format = "pcm",
+#endif
+#if CONFIG_CLOUD_WS_DOWNLINK_OPUS
+      .ws_downlink_format = "opus",
+#elif CONFIG_CLOUD_WS_DOWNLINK_ADPCM
+      .ws_downlink_format = "adpcm",
+#else
+      .ws_downlink_format = "pcm",
+#endif
       .sample_rate_hz = 16000,
       .use_pcm_stream = usePcmStream,
+#if CONFIG_CLOUD_CHAT_STREAM_UPLOAD
+      .stream_upload = true,
+#else
+      .stream_upload = false,
+#endif
       .min_speech_ms = 300,
       .end_silence_ms = CONFIG_DIALOG_END_SILENCE_MS,
       .max_utterance_ms = CONFIG_DIALOG_MAX_UTTERANCE_MS,
       .max_pcm_ms = CONFIG_DIALOG_MAX_UTTERANCE_MS + CONFIG_DIALOG_END_SILENCE_MS +
                     2000,
       .energy_gate_mean_abs = CONFIG_DIALOG_ENERGY_GATE_MEAN_ABS,
+#if CONFIG_DIALOG_ADAPTIVE_ENERGY_GATE
+      .adaptive_energy_gate = true,
+#else
+      .adaptive_energy_gate = false,
+#endif
+      .gate_snr_db = CONFIG_DIALOG_GATE_SNR_DB,
+      .gate_min_mean_abs = CONFIG_DIALOG_GATE_MIN_MEAN_ABS,
+      .gate_max_mean_abs = CONFIG_DIALOG_GATE_MAX_MEAN_ABS,
+      .noise_floor_attack_ms = CONFIG_DIALOG_NOISE_FLOOR_ATTACK_MS,
+      .noise_floor_release_ms = CONFIG_DIALOG_NOISE_FLOOR_RELEASE_MS,
       .local_command_ignore_ms = CONFIG_DIALOG_LOCAL_COMMAND_IGNORE_MS,
+      .preroll_ms = CONFIG_DIALOG_PREROLL_MS,
+#if CONFIG_DIALOG_BARGE_IN
+      .barge_in = true,
+      .barge_in_min_speech_ms = CONFIG_DIALOG_BARGE_IN_MIN_SPEECH_MS,
+#else
+      .barge_in = false,
+#endif
       .worker_stack = 8192,
       .worker_prio = 4,
       .worker_core = 0,
@@ -94,6 +164,10 @@ extern "C" void app_main(void) {
     voiceCtrl.executeCommandById(commandId);
     voiceDialog.onLocalCommandDetected();
   });
+#if CONFIG_DIALOG_BARGE_IN
+  // 播报中说唤醒词也能打断（WakeNet 仅在播报期间开启）
+  wakeWord.setBargeInCallback([]() { voiceDialog.onWakeDuringReply(); });
+#endif
   wakeWord.setAudioFrameCallback([](const int16_t *samples, int numSamples,
                                     vad_state_t vad) {
     voiceDialog.onAudioFrame(samples, numSamples, vad);
@@ -137,21 +211,33 @@ extern "C" void app_main(void) {
     CloudTts::instance().init({
         .url = CONFIG_CLOUD_TTS_PROXY_URL,
         .timeout_ms = 15000,
-        .max_response_bytes = 1024 * 1024,
     });
 
     wifiMgr.setCommandCallback([](int commandId) {
-      // 与语音命令 ID 对齐：0-4
+      // 与语音命令 ID 对齐（CommandTable，/api/commands 可修改）
       voiceCtrl.executeCommandById(commandId);
     });
     wifiMgr.setStatusCallback([]() -> std::string {
-      char buf[128];
-      snprintf(buf, sizeof(buf),
-               "{\"led_on\":%s,\"servo_angle\":%.1f}",
+      // 各模块给出自己的 JSON 对象，这里只负责拼接
+      char buf[64];
+      snprintf(buf, sizeof(buf), "{\"led_on\":%s,\"servo_angle\":%.1f",
                voiceCtrl.isLightOn() ? "true" : "false",
                (double)voiceCtrl.getCurrentServoAngle());
-      return std::string(buf);
+      std::string json(buf);
+      json += ",\"aec\":" + WakeWord::instance().statusJson();
+      json += ",\"dialog\":" + voiceDialog.statusJson();
+      json += ",\"playback\":" + Mp3Player::instance().statusJson();
+      json += ",\"http\":" + HttpConnPool::instance().statusJson();
+      json += ",\"ws\":" + WebSocketChat::instance().statusJson();
+      json += "}";
+      return json;
     });
+    if (useWebSocket) {
+      // 对话 WebSocket 常驻：拿到 IP 就建连，不等唤醒
+      wifiMgr.setStaStateCallback([](bool connected) {
+        WebSocketChat::instance().setNetworkUp(connected);
+      });
+    }
     wifiMgr.setTtsCallback([](const std::string &text) {
       auto &tts = CloudTts::instance();
       if (tts.getUrl().empty()) {
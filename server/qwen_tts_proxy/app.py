@@ -4,7 +4,9 @@ import io
 import json
 import os
 import queue
+import struct
 import threading
+import time
 import wave
 from typing import Optional
 
@@ -59,6 +61,23 @@ def _pcm_to_wav(pcm_bytes: bytes, sample_rate: int) -> bytes:
     return bio.getvalue()
 
 
+def _fix_streaming_wav(wav_bytes: bytes) -> bytes:
+    """
+    The device streams its upload (chunked transfer encoding) and cannot know
+    the length when it sends the header, so RIFF / data sizes are 0xFFFFFFFF.
+    Patch them to the actual body length before handing the WAV to ASR.
+    """
+    if len(wav_bytes) < 44 or wav_bytes[0:4] != b"RIFF" or wav_bytes[36:40] != b"data":
+        return wav_bytes
+    data_len = len(wav_bytes) - 44
+    if struct.unpack_from("<I", wav_bytes, 40)[0] == data_len:
+        return wav_bytes
+    fixed = bytearray(wav_bytes)
+    struct.pack_into("<I", fixed, 4, 36 + data_len)
+    struct.pack_into("<I", fixed, 40, data_len)
+    return bytes(fixed)
+
+
 def _normalize_wav(wav_bytes: bytes, target_sr: int, target_channels: int = 1) -> bytes:
     """
     Normalize WAV for embedded playback:
@@ -574,6 +593,7 @@ async def chat(req: Request) -> Response:
     wav_bytes = await req.body()
     if not wav_bytes:
         raise HTTPException(status_code=400, detail="empty wav")
+    wav_bytes = _fix_streaming_wav(wav_bytes)
 
     # 1) ASR
     asr_model = os.getenv("QWEN_ASR_MODEL", "qwen3-asr-flash")
@@ -630,6 +650,7 @@ async def chat_pcm(req: Request) -> StreamingResponse:
     wav_bytes = await req.body()
     if not wav_bytes:
         raise HTTPException(status_code=400, detail="empty wav")
+    wav_bytes = _fix_streaming_wav(wav_bytes)
 
     # 1) ASR
     asr_model = os.getenv("QWEN_ASR_MODEL", "qwen3-asr-flash")
@@ -699,6 +720,148 @@ async def chat_pcm(req: Request) -> StreamingResponse:
 # WebSocket Streaming Endpoint (xiaozhi-compatible protocol)
 # ==============================================================================
 
+try:
+    # Optional: only needed when devices use Opus uplink/downlink audio
+    import opuslib  # type: ignore
+except Exception:
+    opuslib = None
+
+# Uplink formats this proxy can decode, in order of preference
+_WS_UPLINK_FORMATS = ("opus", "adpcm", "pcm") if opuslib else ("adpcm", "pcm")
+
+
+def _ws_pick_uplink_format(audio_params: dict) -> str:
+    """Pick the first uplink format offered by the client that we can decode."""
+    offered = audio_params.get("formats") or [audio_params.get("format", "pcm")]
+    for fmt in offered:
+        if fmt in _WS_UPLINK_FORMATS:
+            return fmt
+    return "pcm"
+
+
+# Downlink (TTS) formats this proxy can encode, in order of preference
+_WS_DOWNLINK_FORMATS = ("opus", "adpcm", "pcm") if opuslib else ("adpcm", "pcm")
+_OPUS_SAMPLE_RATES = (8000, 12000, 16000, 24000, 48000)
+
+
+def _ws_pick_downlink_format(audio_params: dict, tts_sample_rate: int) -> str:
+    """Pick the first downlink format requested by the client that we can encode."""
+    for fmt in audio_params.get("downlink_formats") or ["pcm"]:
+        if fmt == "opus" and tts_sample_rate not in _OPUS_SAMPLE_RATES:
+            continue
+        if fmt in _WS_DOWNLINK_FORMATS:
+            return fmt
+    return "pcm"
+
+
+class _WsDownlinkEncoder:
+    """Packetize TTS PCM into one compressed packet per 20 ms frame."""
+    FRAME_MS = 20
+
+    def __init__(self, fmt: str, sample_rate: int):
+        self.fmt = fmt
+        self.frame_bytes = sample_rate * self.FRAME_MS // 1000 * 2
+        self.pending = b""
+        self.adpcm_state = None
+        self.opus = None
+        if fmt == "opus":
+            self.opus = opuslib.Encoder(sample_rate, 1, opuslib.APPLICATION_VOIP)
+
+    def _packet(self, frame: bytes) -> bytes:
+        if self.fmt == "adpcm":
+            # Same layout as the uplink: int16 predictor, uint8 index, uint8 0
+            pred, index = self.adpcm_state or (0, 0)
+            body, self.adpcm_state = audioop.lin2adpcm(frame, 2, self.adpcm_state)
+            return struct.pack("<hBB", pred, index, 0) + body
+        return self.opus.encode(frame, len(frame) // 2)
+
+    def encode(self, pcm: bytes) -> list[bytes]:
+        if self.fmt == "pcm":
+            return [pcm]
+        data = self.pending + pcm
+        n = len(data) // self.frame_bytes * self.frame_bytes
+        self.pending = data[n:]
+        return [self._packet(data[i:i + self.frame_bytes]) for i in range(0, n, self.frame_bytes)]
+
+    def flush(self) -> list[bytes]:
+        """Emit the last partial frame, zero-padded to a whole frame."""
+        if self.fmt == "pcm" or not self.pending:
+            return []
+        frame = self.pending.ljust(self.frame_bytes, b"\0")
+        self.pending = b""
+        return [self._packet(frame)]
+
+    def packet_samples(self, packet: bytes) -> int:
+        """PCM samples one packet decodes to."""
+        if self.fmt == "pcm":
+            return len(packet) // 2
+        return self.frame_bytes // 2
+
+
+# Binary framing v2 (negotiated with hello audio_params.framing = 2): every
+# binary message starts with a 16-byte little-endian header
+#   u8 version (2) | u8 flags (0) | u16 samples | u32 seq | u32 ts_ms | u32 echo_ms
+# ts_ms is the sender's clock at send time (both directions);
+# echo_ms is the last peer ts_ms plus how long it has been held here, so the
+# peer gets the round-trip time as now - echo_ms without synchronized clocks.
+WS_FRAME_HEADER = struct.Struct("<BBHIII")
+WS_FRAMING_VERSION = 2
+
+
+def _ws_now_ms() -> int:
+    return int(time.monotonic() * 1000) & 0xFFFFFFFF
+
+
+def _s32(v: int) -> int:
+    """Wrap a u32 difference to a signed 32-bit value."""
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+class _WsNetStats:
+    """Loss, RFC 3550 interarrival jitter and RTT of one direction of v2-framed audio."""
+    def __init__(self):
+        self.jitter = 0.0  # smoothed across turns, like RTP receivers do
+        self.next_seq = None
+        self.last = None  # (arrival_ms, ts_ms) of the previous message
+        self.reset_turn()
+
+    def reset_turn(self):
+        self.packets = 0
+        self.lost = 0
+        self.reordered = 0
+        self.rtt_ms = None
+
+    def note(self, seq: int, ts: int, now: int, echo: int):
+        self.packets += 1
+        if self.next_seq is not None:
+            gap = _s32(seq - self.next_seq)
+            if gap > 0:
+                self.lost += gap
+            elif gap < 0:
+                self.reordered += 1
+        if self.next_seq is None or _s32(seq - self.next_seq) >= 0:
+            self.next_seq = (seq + 1) & 0xFFFFFFFF
+        if self.last is not None:
+            # D = (Rj - Ri) - (Sj - Si), J += (|D| - J) / 16
+            d = _s32(now - self.last[0]) - _s32(ts - self.last[1])
+            self.jitter += (abs(d) - self.jitter) / 16
+        self.last = (now, ts)
+        if echo:
+            rtt = _s32(now - echo)
+            if rtt >= 0 and (self.rtt_ms is None or rtt < self.rtt_ms):
+                self.rtt_ms = rtt
+
+    def summary(self) -> dict:
+        return {
+            "packets": self.packets,
+            "lost": self.lost,
+            "reordered": self.reordered,
+            "jitter_ms": round(self.jitter),
+            "rtt_ms": self.rtt_ms or 0,
+        }
+
+
 class WsSession:
     """Per-connection WebSocket session state."""
     def __init__(self, session_id: str):
@@ -706,8 +869,61 @@ class WsSession:
         self.device_id: str = "default"
         self.audio_buffer = io.BytesIO()
         self.sample_rate: int = 16000
+        self.uplink_format: str = "pcm"
+        self.opus_decoder = None
+        self.downlink_format: str = "pcm"
         self.state: str = "idle"  # idle, listening, speaking
         self.stop_speaking = False
+        self.framing: int = 1  # 2: binary messages carry WS_FRAME_HEADER
+        self.tx_seq = 0
+        self.peer_ts = None  # last device ts_ms and when it arrived (for echo_ms)
+        self.peer_arrival = 0
+        self.uplink_net = _WsNetStats()
+
+    def reset_decoder(self):
+        """New utterance: the device restarts its encoder on every listen start."""
+        self.opus_decoder = None
+        if self.uplink_format == "opus":
+            self.opus_decoder = opuslib.Decoder(self.sample_rate, 1)
+
+    def decode_uplink(self, packet: bytes) -> bytes:
+        """Decode one binary uplink message (one 20 ms frame) to PCM16 mono."""
+        if self.uplink_format == "adpcm":
+            # 4-byte header: int16 predictor, uint8 step index, uint8 reserved
+            if len(packet) < 4:
+                return b""
+            pred, index = struct.unpack_from("<hB", packet, 0)
+            pcm, _ = audioop.adpcm2lin(packet[4:], 2, (pred, index))
+            return pcm
+        if self.uplink_format == "opus":
+            # Max Opus frame is 120 ms
+            return self.opus_decoder.decode(packet, self.sample_rate * 120 // 1000)
+        return packet
+
+    def unframe_uplink(self, message: bytes) -> bytes:
+        """Strip the v2 header of one uplink message, recording its seq / timestamps."""
+        if self.framing < WS_FRAMING_VERSION:
+            return message
+        if len(message) < WS_FRAME_HEADER.size or message[0] != WS_FRAMING_VERSION:
+            raise ValueError("missing v2 frame header")
+        _, _, _, seq, ts, echo = WS_FRAME_HEADER.unpack_from(message, 0)
+        now = _ws_now_ms()
+        self.peer_ts, self.peer_arrival = ts, now
+        self.uplink_net.note(seq, ts, now, echo)
+        return message[WS_FRAME_HEADER.size:]
+
+    def frame_downlink(self, packet: bytes, samples: int) -> bytes:
+        """Prepend the v2 header to one downlink message."""
+        if self.framing < WS_FRAMING_VERSION:
+            return packet
+        now = _ws_now_ms()
+        echo = 0
+        if self.peer_ts is not None:
+            echo = (self.peer_ts + _s32(now - self.peer_arrival)) & 0xFFFFFFFF
+        header = WS_FRAME_HEADER.pack(WS_FRAMING_VERSION, 0, min(samples, 0xFFFF),
+                                      self.tx_seq, now, echo)
+        self.tx_seq = (self.tx_seq + 1) & 0xFFFFFFFF
+        return header + packet
 
 _ws_sessions: dict[str, WsSession] = {}
 
@@ -721,10 +937,12 @@ async def _ws_send_json(ws: WebSocket, msg: dict) -> bool:
         return False
 
 
-async def _ws_send_audio(ws: WebSocket, pcm_bytes: bytes) -> bool:
-    """Send binary PCM audio to WebSocket client."""
+async def _ws_send_audio(ws: WebSocket, session: WsSession, encoder: _WsDownlinkEncoder,
+                         packets: list[bytes]) -> bool:
+    """Send binary audio (PCM chunks or compressed packets) to WebSocket client."""
     try:
-        await ws.send_bytes(pcm_bytes)
+        for packet in packets:
+            await ws.send_bytes(session.frame_downlink(packet, encoder.packet_samples(packet)))
         return True
     except Exception:
         return False
@@ -733,6 +951,8 @@ async def _ws_send_audio(ws: WebSocket, pcm_bytes: bytes) -> bool:
 async def _ws_handle_listen_start(ws: WebSocket, session: WsSession, mode: str):
     """Handle listen start: prepare to receive audio."""
     session.audio_buffer = io.BytesIO()
+    session.reset_decoder()
+    session.uplink_net.reset_turn()
     session.state = "listening"
     print(f"[WS] Session {session.session_id}: start listening (mode={mode})")
 
@@ -745,6 +965,18 @@ async def _ws_handle_listen_stop(ws: WebSocket, session: WsSession):
     session.state = "speaking"
     session.stop_speaking = False
 
+    if session.framing >= WS_FRAMING_VERSION:
+        # Uplink network quality of this utterance, measured from the v2 headers
+        net = session.uplink_net.summary()
+        await _ws_send_json(ws, {
+            "session_id": session.session_id,
+            "type": "net",
+            "uplink": net,
+        })
+        print(f"[WS] Session {session.session_id}: uplink {net['packets']} msgs, "
+              f"lost={net['lost']}, reordered={net['reordered']}, "
+              f"jitter={net['jitter_ms']} ms, rtt={net['rtt_ms']} ms")
+
     api_key = _env("DASHSCOPE_API_KEY")
     asr_model = os.getenv("QWEN_ASR_MODEL", "qwen3-asr-flash")
     llm_model = os.getenv("QWEN_LLM_MODEL", "qwen-plus")
@@ -807,6 +1039,7 @@ async def _ws_handle_listen_stop(ws: WebSocket, session: WsSession):
             target_sample_rate=target_sr,
         )
 
+        encoder = _WsDownlinkEncoder(session.downlink_format, target_sr)
         state = None
         while not session.stop_speaking:
             try:
@@ -834,12 +1067,14 @@ async def _ws_handle_listen_stop(ws: WebSocket, session: WsSession):
                     continue
 
             # Send audio chunk
-            if not await _ws_send_audio(ws, chunk):
+            if not await _ws_send_audio(ws, session, encoder, encoder.encode(chunk)):
                 break
 
             # Yield to event loop
             await asyncio.sleep(0)
 
+        if not session.stop_speaking:
+            await _ws_send_audio(ws, session, encoder, encoder.flush())
         stop_evt.set()
 
     except Exception as e:
@@ -872,12 +1107,23 @@ async def websocket_endpoint(ws: WebSocket):
     2. Client sends: {"type": "hello", "version": 1, "audio_params": {...}}
     3. Server replies: {"type": "hello", "session_id": "xxx", "audio_params": {...}}
     4. Client sends: {"type": "listen", "state": "start", "mode": "auto"}
-    5. Client sends binary PCM audio frames
+    5. Client sends binary audio frames (PCM, or one ADPCM/Opus packet per
+       20 ms frame if negotiated: the client lists its preferences in
+       hello audio_params.formats, the server answers with
+       audio_params.uplink_format)
     6. Client sends: {"type": "listen", "state": "stop"}
     7. Server sends: {"type": "stt", "text": "..."}
     8. Server sends: {"type": "tts", "state": "start"}
-    9. Server sends binary PCM audio frames
+    9. Server sends binary audio frames (PCM, or one ADPCM/Opus packet per
+       20 ms frame if the client listed it in hello audio_params.downlink_formats;
+       the server hello's audio_params.format names the chosen format)
     10. Server sends: {"type": "tts", "state": "stop"}
+
+    If the client offers hello audio_params.framing = 2 and the server answers
+    with the same, every binary message in both directions starts with a
+    16-byte header (sequence number, sender timestamp, echoed peer timestamp;
+    see WS_FRAME_HEADER). After step 6 the server then also sends
+    {"type": "net", "uplink": {"packets", "lost", "reordered", "jitter_ms", "rtt_ms"}}.
     """
     await ws.accept()
     
@@ -910,19 +1156,28 @@ async def websocket_endpoint(ws: WebSocket):
                     # Client hello: extract audio params
                     audio_params = data.get("audio_params", {})
                     session.sample_rate = audio_params.get("sample_rate", 16000)
+                    session.uplink_format = _ws_pick_uplink_format(audio_params)
+                    tts_sr = int(os.getenv("QWEN_TTS_SAMPLE_RATE", "16000"))
+                    session.downlink_format = _ws_pick_downlink_format(audio_params, tts_sr)
+                    if audio_params.get("framing") == WS_FRAMING_VERSION:
+                        session.framing = WS_FRAMING_VERSION
                     
-                    # Reply with server hello
+                    # Reply with server hello ("format" is the TTS downlink format)
                     await _ws_send_json(ws, {
                         "type": "hello",
                         "transport": "websocket",
                         "session_id": session_id,
                         "audio_params": {
-                            "format": "pcm",
-                            "sample_rate": int(os.getenv("QWEN_TTS_SAMPLE_RATE", "16000")),
-                            "channels": 1
+                            "format": session.downlink_format,
+                            "sample_rate": tts_sr,
+                            "channels": 1,
+                            "uplink_format": session.uplink_format,
+                            "framing": session.framing,
                         }
                     })
-                    print(f"[WS] Session {session_id}: hello handshake complete")
+                    print(f"[WS] Session {session_id}: hello handshake complete "
+                          f"(uplink={session.uplink_format}, downlink={session.downlink_format}, "
+                          f"framing={session.framing})")
                 
                 elif msg_type == "listen":
                     state = data.get("state", "")
@@ -938,7 +1193,12 @@ async def websocket_endpoint(ws: WebSocket):
             elif "bytes" in message:
                 # Binary audio data
                 if session.state == "listening":
-                    session.audio_buffer.write(message["bytes"])
+                    try:
+                        pcm = session.decode_uplink(session.unframe_uplink(message["bytes"]))
+                    except Exception as e:
+                        print(f"[WS] Session {session_id}: drop bad {session.uplink_format} frame: {e}")
+                        continue
+                    session.audio_buffer.write(pcm)
     
     except WebSocketDisconnect:
         print(f"[WS] Session {session_id}: client disconnected")
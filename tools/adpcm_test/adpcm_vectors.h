@@ -0,0 +1,581 @@
+// Generated by tools/adpcm_test/gen_vectors.py from Python 3.11 audioop.
+// Do not edit by hand.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vectors {
+
+constexpr int kSampleRate = 16000;
+constexpr size_t kFrame = 320;
+constexpr size_t kPackets = 6;
+constexpr size_t kPacketBytes = 164; // 4-byte header + kFrame / 2
+
+const int16_t kInput[1920] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1375, 2709, 3963,
+    5099, 6083, 6885, 7483, 7858, 7999, 7901, 7568, 7010, 6243, 5290, 4179,
+    2944, 1622, 251, -1127, -2472, -3743, -4903, -5917, -6754, -7391, -7807, -7991,
+    -7936, -7646, -7128, -6397, -5476, -4392, -3177, -1867, -502, 877, 2231, 3519,
+    4702, 5745, 6616, 7291, 7748, 7975, 7964, 7716, 7238, 6545, 5656, 4600,
+    3406, 2110, 752, -627, -1989, -3292, -4496, -5567, -6472, -7184, -7682, -7951,
+    -7984, -7778, -7342, -6686, -5831, -4803, -3631, -2352, -1002, 376, 1745, 3061,
+    4286, 5384, 6321, 7070, 7608, 7920, 7996, 7833, 7438, 6821, 6000, 5001,
+    3854, 2591, 1251, -125, -1499, -2827, -4072, -5195, -6164, -6949, -7527, -7880,
+    -8000, -7880, -7527, -6949, -6164, -5195, -4072, -2827, -1499, -125, 1251, 2591,
+    3854, 5001, 6000, 6821, 7438, 7833, 7996, 7920, 7608, 7070, 6321, 5384,
+    4286, 3061, 1745, 376, -1002, -2352, -3631, -4803, -5831, -6686, -7342, -7778,
+    -7984, -7951, -7682, -7184, -6472, -5567, -4496, -3292, -1989, -627, 752, 2110,
+    3406, 4600, 5656, 6545, 7238, 7716, 7964, 7975, 7748, 7291, 6616, 5745,
+    4702, 3519, 2231, 877, -502, -1867, -3177, -4392, -5476, -6397, -7128, -7646,
+    -7936, -7991, -7807, -7391, -6754, -5917, -4903, -3743, -2472, -1127, 251, 1622,
+    2944, 4179, 5290, 6243, 7010, 7568, 7901, 7999, 7858, 7483, 6885, 6083,
+    5099, 3963, 2709, 1375, 0, -1375, -2709, -3963, -5099, -6083, -6885, -7483,
+    -7858, -7999, -7901, -7568, -7010, -6243, -5290, -4179, -2944, -1622, -251, 1127,
+    2472, 3743, 4903, 5917, 6754, 7391, 7807, 7991, 7936, 7646, 7128, 6397,
+    5476, 4392, 3177, 1867, 502, -877, -2231, -3519, -4702, -5745, -6616, -7291,
+    -7748, -7975, -7964, -7716, -7238, -6545, -5656, -4600, -3406, -2110, -752, 627,
+    1989, 3292, 4496, 5567, 6472, 7184, 7682, 7951, 7984, 7778, 7342, 6686,
+    5831, 4803, 3631, 2352, 1002, -376, -1745, -3061, -4286, -5384, -6321, -7070,
+    -7608, -7920, -7996, -7833, -7438, -6821, -6000, -5001, -3854, -2591, -1251, 125,
+    1499, 2827, 4072, 5195, 6164, 6949, 7527, 7880, 8000, 7880, 7527, 6949,
+    6164, 5195, 4072, 2827, 1499, 125, -1251, -2591, -3854, -5001, -6000, -6821,
+    -7438, -7833, -7996, -7920, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768, 32767, 32767, -32768, -32768,
+    -31431, -31684, 2828, 8841, 26871, -25398, -270, 3168, 6298, 18576, -30157, 15977,
+    30527, -27941, 13081, -2603, -6785, 30115, -6153, 29672, 32353, 10728, -5054, -5,
+    -13941, -5027, 11489, -22591, -26951, 23113, -12350, -32305, -2447, -13653, 4783, 30295,
+    -31755, 18334, -12960, -11723, 29818, 3068, 10961, 10286, 8088, -22201, 28119, 17525,
+    -2814, 14790, -11025, 13936, 4984, 17132, -3753, -19270, -2822, 11263, 1376, 24425,
+    -7104, 27894, 15876, -23406, 12135, -9820, -9292, 19211, 19438, -21228, -24971, -6288,
+    24546, 14645, 2348, -16534, -7082, 24248, 20534, -8403, 21783, 12599, 1853, 25920,
+    8606, 27543, -7609, 18562, 21318, -26447, 7696, 7275, -25408, 5165, 25499, -26736,
+    -14652, 18351, 15109, -8086, -20981, -14282, 24986, -7079, 18043, 14274, -26837, 15588,
+    22433, 3894, -18784, 26436, -6554, -19330, 11722, 21025, 32763, -32526, 10363, -31331,
+    -9706, -25606, 729, 27023, 31841, -12812, -10512, 28178, 26415, -20652, 14728, 6719,
+    -5262, -10229, 31287, 17719, 10220, -3285, -1353, -667, -8286, -9527, 29051, -7677,
+    -25193, 8227, 11133, -3365, 22967, -23549, -24229, 6736, 4882, 9060, -3165, -2658,
+    4939, -9131, 8811, -24737, -12463, -20709, 5158, -32688, -26290, 24475, -16460, 27218,
+    -26659, -9480, 3512, -32332, -18815, -23175, 17712, -18255, -31917, -11090, 5952, -7883,
+    11771, 14804, -25009, -26394, 7138, -24458, -7083, -27808, -14937, 17750, -15244, 1728,
+    -11823, -5748, 15303, 15973, -24380, 9710, 32120, -26636, -16905, -7503, 24086, 28314,
+    -5532, 5966, -5594, -18281, -19391, 13991, 15353, 23288, -12306, -5269, -6978, 30629,
+    -22993, 2232, 31961, 14748, -13412, -11519, 12147, -7299, 21847, 1328, 21843, 9287,
+    16126, 13836, 29421, -2462, 21985, -32290, 11705, -29473, 23925, -25520, 3271, 4860,
+    24841, -20841, 6289, 16876, 26296, -23086, -20975, 4309, -2144, -10830, 6421, 795,
+    12627, 4957, -13873, -10019, 21643, -21363, 14769, -23106, 1315, -8450, -11399, -28185,
+    -20669, -19449, 29321, -14006, -14885, 25735, 19833, 23849, -12717, -22268, 24560, 7127,
+    28034, -26096, -22608, -23873, -5666, 1261, -14094, 11940, -10510, 22641, -4622, -4567,
+    -8682, -29139, -2613, -9583, -10149, -19510, 18053, 23240, -21051, -1868, -10643, 13475,
+    -21058, 25596, 16550, -28571, 21704, -27016, -1794, 4740, -19597, 15661, -3325, 20395,
+    -5489, 6127, 20567, 7936, 28836, -18361, -5566, -29016, 0, 647, 1413, 2295,
+    3292, 4401, 5621, 6946, 8369, 9884, 11480, 13145, 14863, 16618, 18387, 20146,
+    21869, 23522, 25074, 26485, 27716, 28725, 29468, 29902, 29985, 29675, 28936, 27738,
+    26058, 23884, 21213, 18059, 14452, 10438, 6083, 1472, -3292, -8086, -12773, -17201,
+    -21213, -24645, -27342, -29157, -29966, -29675, -28226, -25609, -21869, -17105, -11480, -5215,
+    1413, 8086, 14452, 20146, 24812, 28125, 29818, 29708, 27716, 23884, 18387, 11534,
+    3759, -4401, -12345, -19438, -25074, -28725, -30000, -28691, -24812, -18619, -10604, -1472,
+    7916, 16618, 23704, 28363, 30000, 28324, 23412, 15725, 6083, -4401, -14452, -22773,
+    -28226, -29993, -27716, -21584, -12345, -1236, 10162, 20146, 27144, 29974, 28063, 21584,
+    11480, -647, -12773, -22773, -28808, -29675, -25074, -15725, -3292, 9884, 21213, 28363,
+    29763, 24976, 14863, 1472, -12345, -23522, -29468, -28691, -21213, -8652, 6083, 19438,
+    28063, 29675, 23704, 11534, -3759, -18153, -27716, -29708, -23412, -10438, 5621, 20146,
+    28808, 28889, 20190, 5215, -11480, -24645, -29985, -25609, -12773, 4401, 20190, 29157,
+    28063, 17105, 0, -17201, -28226, -28889, -18757, -1472, 16470, 28125, 28808, 18059,
+    0, -18153, -28936, -27738, -14863, 4401, 21869, 29902, 24812, 8652, -11480, -26485,
+    -29376, -18619, 942, 20146, 29763, 24976, 7916, -13145, -27716, -28324, -14452, 6946,
+    24812, 29675, 18757, -2295, -22188, -29993, -21213, -530, 20536, 29974, 22188, 1472,
+    -20190, -29974, -21869, -530, 21213, 29993, 20190, -2295, -23412, -29675, -16862, 6946,
+    26289, 28324, 11480, -13145, -28936, -24976, -3759, 20146, 29985, 18619, -6083, -26485,
+    -27716, -8652, 16862, 29902, 20536, -4401, -26058, -27738, -7916, 18153, 30000, 18059,
+    -8369, -28125, -25074, -1472, 23412, 28889, 10162, -17201, -30000, -17105, 10604, 29157,
+    22188, -4401, -27144, -25609, -942, 24645, 27716, 5215, -22188, -28889, -8369, 20146,
+    29468, 10438, -18757, -29708, -11480, 18153, 29763, 11534, -18387, -29675, -10604, 19438,
+    29376, 8652, -21213, -28691, -5621, 23522, 27342, 1472, -26058, -24976, 3759, 28363,
+    21213, -9884, -29818, -15725, 16470, 29675, 8369, -22773, -27144, 647, 27716, 21584,
+    -10604, -29974, -12773, 20146, 28226, 1236, -27342, -21584, 11480, 29993, 10162, -22773,
+    -26289, 4401, 29376, 15725, -18757, -28324, 0, 28363, 18387, -16618, -28936, -1472,
+    28063, 18619, -16862, -28691, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+// lin2adpcm with the state carried across packets, each packet prefixed
+// with struct.pack('<hBB', predictor, index, 0) of its start state
+const uint8_t kPacketStream[984] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 7, 119, 119, 119, 115, 136, 137, 170,
+    171, 188, 187, 187, 186, 168, 1, 53, 68, 67, 67, 52, 35, 34, 17, 137,
+    172, 204, 189, 187, 203, 187, 170, 169, 0, 51, 100, 53, 51, 67, 51, 50,
+    32, 8, 172, 204, 203, 204, 171, 187, 187, 169, 128, 35, 99, 83, 68, 50,
+    66, 34, 17, 8, 154, 190, 188, 203, 188, 187, 171, 169, 136, 19, 69, 53,
+    52, 51, 66, 50, 33, 16, 154, 204, 203, 219, 188, 187, 186, 170, 152, 18,
+    68, 68, 52, 67, 35, 51, 49, 32, 154, 189, 219, 204, 188, 171, 186, 185,
+    152, 130, 52, 84, 52, 66, 51, 66, 33, 16, 9, 172, 203, 219, 203, 188,
+    171, 170, 153, 1, 35, 99, 83, 67, 52, 50, 34, 32, 9, 156, 204, 189,
+    187, 203, 187, 171, 153, 128, 36, 68, 67, 68, 50, 52, 33, 32, 8, 154,
+    204, 203, 204, 171, 188, 170, 153, 128, 33, 225, 50, 0, 119, 255, 114, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248,
+    112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 112, 248, 226, 133, 87, 0,
+    128, 80, 47, 32, 2, 244, 31, 90, 133, 196, 10, 160, 161, 63, 134, 202,
+    73, 35, 244, 192, 91, 24, 140, 121, 162, 195, 145, 186, 50, 167, 196, 157,
+    74, 132, 13, 130, 73, 154, 21, 140, 56, 147, 163, 242, 14, 72, 195, 63,
+    4, 138, 161, 124, 56, 229, 10, 183, 185, 64, 31, 61, 41, 52, 14, 4,
+    14, 73, 152, 105, 153, 8, 144, 123, 164, 9, 63, 132, 128, 144, 10, 78,
+    24, 62, 7, 213, 226, 29, 24, 108, 146, 42, 48, 248, 76, 42, 21, 194,
+    144, 48, 243, 63, 0, 80, 193, 169, 134, 0, 209, 133, 227, 58, 192, 59,
+    90, 41, 8, 63, 63, 93, 109, 56, 63, 49, 31, 131, 152, 40, 42, 192,
+    125, 76, 57, 138, 0, 123, 134, 128, 217, 106, 63, 128, 32, 165, 181, 184,
+    138, 73, 9, 96, 210, 147, 213, 142, 110, 48, 181, 163, 177, 42, 79, 27,
+    223, 141, 86, 0, 72, 0, 128, 0, 128, 0, 16, 0, 16, 1, 1, 0,
+    136, 137, 187, 205, 189, 188, 187, 203, 171, 170, 128, 20, 69, 67, 67, 66,
+    34, 24, 155, 220, 203, 202, 185, 128, 37, 53, 51, 50, 8, 189, 219, 187,
+    169, 19, 100, 51, 33, 154, 235, 202, 160, 19, 99, 34, 9, 204, 202, 144,
+    36, 52, 32, 156, 203, 168, 20, 67, 32, 188, 218, 128, 52, 65, 138, 203,
+    168, 37, 65, 10, 203, 160, 53, 49, 140, 202, 130, 67, 41, 204, 168, 52,
+    49, 173, 185, 20, 65, 155, 217, 20, 33, 156, 184, 36, 48, 190, 144, 51,
+    42, 234, 131, 65, 155, 200, 53, 25, 202, 3, 64, 173, 145, 66, 155, 184,
+    83, 12, 184, 52, 27, 201, 37, 26, 201, 36, 27, 185, 54, 11, 192, 51,
+    141, 161, 65, 172, 131, 72, 202, 36, 11, 176, 97, 172, 132, 41, 216, 52,
+    156, 147, 73, 201, 99, 144, 87, 0, 48, 128, 128, 128, 128, 128, 8, 8,
+    128, 128, 8, 128, 8, 8, 128, 128, 8, 8, 128, 8, 128, 128, 8, 8,
+    128, 8, 128, 8, 128, 8, 128, 8, 128, 8, 8, 8, 8, 8, 128, 128,
+    128, 128, 128, 128, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+};
+constexpr int16_t kFinalPredictor = 0;
+constexpr uint8_t kFinalIndex = 0;
+
+// adpcm2lin of every packet body from its header state
+const int16_t kRoundTrip[1920] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 11, 41, 104,
+    240, 533, 1164, 2521, 5431, 8340, 7962, 7619, 7307, 6455, 5164, 3991,
+    2925, 1567, 334, -1108, -2466, -3699, -4820, -5839, -6766, -7367, -7914, -8013,
+    -7923, -7677, -7155, -6407, -5512, -4429, -3118, -1885, -443, 915, 2148, 3590,
+    4560, 5793, 6594, 7322, 7719, 8079, 7970, 7672, 7220, 6480, 5585, 4502,
+    3483, 2026, 668, -565, -2007, -3365, -4598, -5719, -6447, -7109, -7710, -8038,
+    -7939, -7849, -7274, -6752, -5868, -4785, -3766, -2309, -951, 282, 1724, 3082,
+    4315, 5436, 6455, 7117, 7718, 7827, 7926, 7836, 7425, 6753, 5939, 4954,
+    3762, 2641, 1330, -257, -1323, -2681, -3914, -5035, -6054, -6981, -7582, -7910,
+    -8009, -7919, -7508, -6986, -6102, -5261, -4057, -2936, -1625, -38, 1454, 2424,
+    4011, 5077, 6047, 6928, 7408, 7844, 7976, 7856, 7528, 7031, 6398, 5329,
+    4310, 3118, 1676, 318, -915, -2357, -3715, -4948, -5749, -6768, -7430, -7790,
+    -7899, -7998, -7727, -7152, -6480, -5485, -4558, -3235, -2002, -560, 798, 2031,
+    3473, 4443, 5676, 6477, 7205, 7602, 7962, 8071, 7773, 7321, 6581, 5686,
+    4603, 3584, 2127, 769, -464, -1906, -3264, -4497, -5618, -6346, -7008, -7609,
+    -7937, -8036, -7765, -7354, -6682, -5868, -4883, -3691, -2570, -1259, 328, 1820,
+    2790, 4023, 5144, 6163, 7090, 7450, 7997, 8096, 7825, 7414, 6892, 6144,
+    5050, 4031, 2839, 1397, 39, -1548, -2614, -3972, -5205, -6006, -7025, -7422,
+    -7782, -7891, -7990, -7538, -6963, -6291, -5296, -4104, -2983, -1672, -85, 981,
+    2339, 3572, 5014, 5984, 6865, 7345, 7781, 7913, 8033, 7705, 7208, 6394,
+    5409, 4482, 3159, 1926, 484, -874, -2107, -3549, -4519, -5752, -6553, -7281,
+    -7678, -8038, -7929, -7631, -7179, -6604, -5633, -4706, -3383, -2150, -708, 650,
+    1883, 3325, 4683, 5564, 6365, 7093, 7755, 7875, 7984, 7686, 7415, 6675,
+    5780, 4697, 3678, 2221, 863, -370, -1812, -3170, -4403, -5524, -6252, -7179,
+    -7539, -7867, -7966, -7876, -7465, -6793, -5979, -4994, -3802, -2681, -1370, 217,
+    1709, 2679, 3912, 5354, 6324, 6852, 7653, 7798, 7930, 7810, 7482, 6985,
+    6171, 5186, 3994, 2873, 1562, -25, -1091, -2449, -3682, -5124, -6094, -6975,
+    -7455, -7891, -8023, -7903, -6261, -2741, -10289, -26469, 8218, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262, 24601, 28696, -27167, -31262,
+    -32768, -29383, 4472, 8567, 27188, -23597, -3119, 605, 3990, 19378, -22593, 14269,
+    26555, -29308, 15745, -4733, -8457, 28785, -8077, 28785, 32767, 14146, -2782, 295,
+    -13695, -6065, 10122, -21411, -25506, 22909, -13953, -32768, 750, -11536, 7085, 30784,
+    -15382, 21480, -15382, -11287, 29679, 1010, 12182, 8797, 5720, -19463, 31322, 19036,
+    415, 17343, -10357, 15712, 5556, 14788, -4798, -17516, -1329, 9182, -373, 25686,
+    -7832, 29030, 16744, -24222, 12640, -7838, -11562, 18909, 23004, -17962, -22057, -3436,
+    27035, 14749, 3577, -13351, -4119, 26660, 22565, -10953, 17716, 13992, 3836, 25379,
+    11389, 29194, -5493, 14985, 18709, -25305, 11557, 7462, -26056, 2613, 28682, -22103,
+    -18008, 15510, 11415, -7206, -24134, -14902, 27069, -9793, 18876, 15152, -28862, 16191,
+    20286, 1665, -22034, 24132, -4537, -15709, 14762, 18857, 30029, -20756, 7913, -32768,
+    -12290, -23462, 237, 27937, 31661, -12353, -8258, 25260, 29355, -19060, 17802, 5516,
+    -5656, -9041, 30970, 18684, 7512, -2644, 433, -2365, -9995, -7683, 23850, -4819,
+    -23440, 7031, 11126, -46, 23653, -22513, -26608, 6910, 2815, 6539, -3617, -540,
+    2258, -10460, 10352, -26023, -13737, -17461, 6238, -32768, -28673, 27190, -17863, 27190,
+    -26055, -5577, 5595, -31647, -19361, -23085, 20929, -15933, -28219, -9598, 7330, -8058,
+    11528, 14071, -20616, -24711, 8807, -28055, -7577, -26198, -16042, 17813, -19049, 1429,
+    -9743, -6358, 15185, 17983, -20172, 8497, 32767, -18018, -13923, -10199, 27043, 31138,
+    -2380, 9906, -8715, -18871, -21948, 14427, 18522, 22246, -14996, -2710, -6434, 30808,
+    -22437, 6232, 32301, 15373, -12327, -8603, 15096, -6447, 24332, 3854, 22475, 12319,
+    15396, 12598, 30403, -4284, 24385, -31478, 13575, -31478, 21767, -23286, 5383, 1659,
+    25358, -20808, 7861, 19033, 29189, -16977, -21072, 4997, -5159, -8236, 5754, 3211,
+    14773, 4262, -12938, -10626, 20907, -24146, 12716, -24146, 4523, -6649, -10034, -25422,
+    -22624, -20081, 14606, -14063, -17787, 26227, 22132, 25856, -11386, -23672, 24743, 4265,
+    30334, -20451, -24546, -20822, -3894, -817, -14807, 13173, -12896, 24346, -4323, -8047,
+    -11432, -26820, -1637, -11793, -8716, -17110, 15958, 20053, -20913, -435, -11607, 12092,
+    -21763, 23290, 19195, -29220, 24025, -29220, -551, 3173, -20526, 13329, -7149, 18920,
+    -4779, 4453, 18443, 5725, 26537, -15434, -3148, -29217, 1254, -2841, 883, 4268,
+    1191, 3989, 6532, 8844, 6742, 8653, 10390, 11969, 16275, 17580, 18766, 19844,
+    22785, 23676, 24486, 26695, 27364, 29189, 29742, 30245, 29788, 29373, 28995, 27965,
+    25780, 23792, 21468, 18033, 14831, 10258, 5998, 1017, -3670, -7930, -12911, -17598,
+    -20641, -24515, -27031, -29318, -29733, -29355, -28325, -25514, -22112, -17080, -11053, -5380,
+    1250, 7490, 14784, 19686, 24143, 28195, 30404, 29735, 27910, 24036, 18501, 11871,
+    3848, -3702, -12527, -18459, -26009, -28950, -29841, -29031, -25348, -17982, -11119, -1313,
+    7823, 16128, 23678, 28580, 29471, 28661, 23505, 16139, 5353, -4696, -13832, -22137,
+    -27530, -30471, -27797, -22124, -12547, -800, 10254, 20303, 26829, 30388, 27153, 22251,
+    10662, -392, -13314, -22000, -29896, -28461, -24546, -16241, -2218, 11159, 19845, 27741,
+    29176, 25261, 14582, 1660, -13976, -24487, -30220, -28483, -20587, -7665, 4495, 18709,
+    28264, 30001, 25264, 12342, -3294, -18009, -27564, -29301, -24564, -11642, 3994, 18709,
+    28264, 30001, 18947, 6025, -13085, -25803, -28115, -26013, -12636, 3000, 21920, 29550,
+    27238, 16727, -473, -16660, -27171, -29082, -20396, -3024, 17788, 26182, 28725, 17163,
+    -1757, -19562, -31124, -29022, -15645, 3465, 21270, 28207, 26105, 8905, -11907, -25897,
+    -28440, -16878, 2042, 19847, 31409, 25103, 7903, -12909, -26899, -29442, -13255, 5665,
+    23470, 30407, 19896, -1126, -20712, -28342, -21405, -2485, 20408, 29640, 21246, 3441,
+    -21996, -32152, -22920, 2263, 19191, 28423, 20029, -2864, -24407, -27205, -14487, 6325,
+    25911, 28454, 12267, -15062, -26234, -22849, -1306, 18280, 30998, 19436, -7893, -26514,
+    -29899, -8356, 16827, 26983, 17751, -1835, -24728, -27805, -8219, 19761, 30933, 20777,
+    -6923, -25544, -22159, -616, 24567, 27952, 12564, -18215, -30501, -19329, 11142, 31620,
+    20448, -3251, -24794, -27592, 388, 26457, 29842, 2142, -23927, -27312, -5769, 19414,
+    29570, 8027, -17156, -27312, -11924, 18855, 31141, 12520, -17951, -30237, -11616, 18855,
+    31141, 5072, -18627, -27859, -8273, 24795, 28890, 2821, -27650, -23555, 2514, 26213,
+    23136, -7643, -28121, -16949, 13522, 25808, 7187, -23284, -27379, -1310, 29161, 25066,
+    -8452, -28930, -10309, 20162, 24257, -1812, -25511, -22434, 13941, 26227, 7606, -22865,
+    -26960, 6558, 27036, 15864, -21378, -25473, 596, 31067, 18781, -14737, -27023, -954,
+    29517, 17231, -16287, -28573, -2504, 881, -2196, 602, -1941, 371, -1731, 180,
+    -1557, 22, -1413, -108, 1078, 0, 980, 89, -721, 15, -654, -46,
+    507, 4, -453, -38, 340, -3, 309, 25, -233, 1, -212, -18,
+    158, -2, 143, 11, -109, 0, 99, 9, -73, 1, -67, -6,
+    50, -1, 45, 3, -35, -1, 30, 2, -24, -1, 20, 1,
+    -16, 0, 14, 1, -11, 0, 10, 1, -7, 0, 6, 0,
+    5, 0, 4, 0, 3, 0, 3, 1, -1, 1, -1, 1,
+    0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+const uint8_t kCodes[160] = {
+    137, 193, 214, 109, 58, 151, 66, 125, 199, 56, 87, 214, 162, 114, 106, 171,
+    181, 31, 98, 172, 127, 220, 43, 247, 58, 141, 169, 161, 181, 201, 233, 141,
+    221, 139, 192, 153, 42, 222, 17, 104, 96, 83, 100, 69, 86, 120, 142, 236,
+    188, 164, 146, 62, 23, 200, 255, 19, 91, 32, 107, 196, 225, 244, 206, 39,
+    175, 187, 237, 252, 55, 88, 8, 21, 21, 65, 122, 197, 113, 202, 14, 67,
+    3, 224, 42, 31, 224, 242, 21, 253, 146, 206, 249, 30, 45, 181, 113, 120,
+    72, 243, 181, 110, 30, 172, 183, 87, 65, 179, 204, 105, 153, 172, 170, 201,
+    158, 182, 220, 186, 3, 97, 247, 59, 72, 202, 33, 147, 231, 243, 202, 141,
+    5, 216, 162, 111, 244, 194, 36, 227, 215, 223, 66, 105, 69, 42, 18, 0,
+    177, 11, 141, 32, 253, 97, 166, 52, 120, 204, 100, 43, 48, 92, 196, 215,
+};
+
+struct DecodeCase {
+  int16_t predictor;
+  uint8_t index;
+  int16_t final_predictor;
+  uint8_t final_index;
+  int16_t samples[320];
+};
+
+// adpcm2lin(kCodes, 2, (predictor, index)) from several start states
+const DecodeCase kDecodeCases[5] = {
+    {0, 0, 28668, 88, {
+        0, -1, -8, -5, -16, 3, 36, -14, 32, 1, -15, 61,
+        160, 226, 407, 120, -225, 469, 1165, 1075, 1979, 3783, 943, 5857,
+        2509, 5552, 13854, 19786, 32767, 23212, 14526, 3472, -6577, 7780, 13513, -12546,
+        32767, 32767, 14146, -16325, 32767, -28669, -32768, -32768, -12290, -32768, -32768, 28668,
+        32767, 14146, 10761, -23094, -32768, -32768, -32768, -23536, -32768, -4788, -32768, -32768,
+        -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -28673, -32768, -32768,
+        -17380, -31370, -32768, -32768, -20482, -9310, 32767, 28672, 32767, 32767, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 32767, 32767, 28672, 24948, -19066, -32768, -32768,
+        -32768, -32768, -32768, 750, -11536, 7085, 30784, -9227, 3059, 32767, -4095, -8190,
+        -32768, -32768, -20482, 5587, 32767, 4098, 22719, 26104, 32767, 4098, -29420, 7442,
+        -32768, -20482, -32768, 4094, -32768, -32768, -12290, 32767, 12289, -32768, -32768, -32768,
+        -32768, -32768, -32768, -32768, -4099, 32767, 32767, 28672, 32396, 29011, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 12289, -21229, 23824, 32767, 32767, -751, -21229,
+        -17505, -32768, 4094, 32763, 32767, 32767, -7244, -3149, 15472, -1456, 7776, -32768,
+        -32768, -28673, -32768, -12290, -1118, 32767, -28669, -32768, -32768, -14147, -32768, -32768,
+        -32768, -32768, -21596, -32768, -12290, -32768, -32768, 8198, 32767, 32767, 32767, 28672,
+        32767, 28672, -27191, 1478, -24591, 12651, 32767, -20478, -8192, -32768, -32768, -32768,
+        -32768, 23095, 32767, 32767, 32767, 32767, 6698, 30397, 2697, -30821, 22424, 10138,
+        -1034, -11190, -26578, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, 15647,
+        -29406, -32768, -32768, -32768, -29383, -7840, 28535, 32767, -23096, 32767, 32767, 6698,
+        32767, 28672, -4846, -25324, -6703, 3453, -5779, 13807, -19261, 32767, -28669, 0,
+        -32768, -32768, -32768, -32768, -28673, 12293, -32760, -32768, -32768, -15840, 24171, -32768,
+        -32768, 4094, -32768, -12290, 6331, 32767, -20478, 8191, -32768, 28668, -16385, -32768,
+        4094, 24572, 32767, 20481, 32767, 32767, 32767, 14146, 24302, 32767, 32767, 32767,
+        16580, 22886, 24797, 12637, 11058, -4735, 5776, 7687, -18372, -32768, 20477, 32763,
+        14142, 32767, 32767, 32767, 32767, 28672, -4846, -32768, 20477, 32767, 32767, 6698,
+        30397, 32767, 32767, -4095, -32768, 4094, -32768, 28668,
+    }},
+    {32767, 88, 28668, 88, {
+        28672, 17500, -12971, -685, -32768, 20477, 32767, -12286, 16383, -2238, -12394, 32767,
+        32767, 32767, 32767, -12286, -32768, 28668, 32767, 29043, 32767, 32767, -12286, 32767,
+        12289, 30910, 32767, 32767, 32767, 12289, -6332, -30031, -32768, -1989, 10297, -32768,
+        20477, 32767, 14146, -16325, 32767, -28669, -32768, -32768, -12290, -32768, -32768, 28668,
+        32767, 14146, 10761, -23094, -32768, -32768, -32768, -23536, -32768, -4788, -32768, -32768,
+        -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -28673, -32768, -32768,
+        -17380, -31370, -32768, -32768, -20482, -9310, 32767, 28672, 32767, 32767, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 32767, 32767, 28672, 24948, -19066, -32768, -32768,
+        -32768, -32768, -32768, 750, -11536, 7085, 30784, -9227, 3059, 32767, -4095, -8190,
+        -32768, -32768, -20482, 5587, 32767, 4098, 22719, 26104, 32767, 4098, -29420, 7442,
+        -32768, -20482, -32768, 4094, -32768, -32768, -12290, 32767, 12289, -32768, -32768, -32768,
+        -32768, -32768, -32768, -32768, -4099, 32767, 32767, 28672, 32396, 29011, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 12289, -21229, 23824, 32767, 32767, -751, -21229,
+        -17505, -32768, 4094, 32763, 32767, 32767, -7244, -3149, 15472, -1456, 7776, -32768,
+        -32768, -28673, -32768, -12290, -1118, 32767, -28669, -32768, -32768, -14147, -32768, -32768,
+        -32768, -32768, -21596, -32768, -12290, -32768, -32768, 8198, 32767, 32767, 32767, 28672,
+        32767, 28672, -27191, 1478, -24591, 12651, 32767, -20478, -8192, -32768, -32768, -32768,
+        -32768, 23095, 32767, 32767, 32767, 32767, 6698, 30397, 2697, -30821, 22424, 10138,
+        -1034, -11190, -26578, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, 15647,
+        -29406, -32768, -32768, -32768, -29383, -7840, 28535, 32767, -23096, 32767, 32767, 6698,
+        32767, 28672, -4846, -25324, -6703, 3453, -5779, 13807, -19261, 32767, -28669, 0,
+        -32768, -32768, -32768, -32768, -28673, 12293, -32760, -32768, -32768, -15840, 24171, -32768,
+        -32768, 4094, -32768, -12290, 6331, 32767, -20478, 8191, -32768, 28668, -16385, -32768,
+        4094, 24572, 32767, 20481, 32767, 32767, 32767, 14146, 24302, 32767, 32767, 32767,
+        16580, 22886, 24797, 12637, 11058, -4735, 5776, 7687, -18372, -32768, 20477, 32763,
+        14142, 32767, 32767, 32767, 32767, 28672, -4846, -32768, 20477, 32767, 32767, 6698,
+        30397, 32767, 32767, -4095, -32768, 4094, -32768, 28668,
+    }},
+    {-32768, 88, 28668, 88, {
+        -32768, -32768, -32768, -20482, -32768, 20477, 32767, -12286, 16383, -2238, -12394, 32767,
+        32767, 32767, 32767, -12286, -32768, 28668, 32767, 29043, 32767, 32767, -12286, 32767,
+        12289, 30910, 32767, 32767, 32767, 12289, -6332, -30031, -32768, -1989, 10297, -32768,
+        20477, 32767, 14146, -16325, 32767, -28669, -32768, -32768, -12290, -32768, -32768, 28668,
+        32767, 14146, 10761, -23094, -32768, -32768, -32768, -23536, -32768, -4788, -32768, -32768,
+        -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -28673, -32768, -32768,
+        -17380, -31370, -32768, -32768, -20482, -9310, 32767, 28672, 32767, 32767, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 32767, 32767, 28672, 24948, -19066, -32768, -32768,
+        -32768, -32768, -32768, 750, -11536, 7085, 30784, -9227, 3059, 32767, -4095, -8190,
+        -32768, -32768, -20482, 5587, 32767, 4098, 22719, 26104, 32767, 4098, -29420, 7442,
+        -32768, -20482, -32768, 4094, -32768, -32768, -12290, 32767, 12289, -32768, -32768, -32768,
+        -32768, -32768, -32768, -32768, -4099, 32767, 32767, 28672, 32396, 29011, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 12289, -21229, 23824, 32767, 32767, -751, -21229,
+        -17505, -32768, 4094, 32763, 32767, 32767, -7244, -3149, 15472, -1456, 7776, -32768,
+        -32768, -28673, -32768, -12290, -1118, 32767, -28669, -32768, -32768, -14147, -32768, -32768,
+        -32768, -32768, -21596, -32768, -12290, -32768, -32768, 8198, 32767, 32767, 32767, 28672,
+        32767, 28672, -27191, 1478, -24591, 12651, 32767, -20478, -8192, -32768, -32768, -32768,
+        -32768, 23095, 32767, 32767, 32767, 32767, 6698, 30397, 2697, -30821, 22424, 10138,
+        -1034, -11190, -26578, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, 15647,
+        -29406, -32768, -32768, -32768, -29383, -7840, 28535, 32767, -23096, 32767, 32767, 6698,
+        32767, 28672, -4846, -25324, -6703, 3453, -5779, 13807, -19261, 32767, -28669, 0,
+        -32768, -32768, -32768, -32768, -28673, 12293, -32760, -32768, -32768, -15840, 24171, -32768,
+        -32768, 4094, -32768, -12290, 6331, 32767, -20478, 8191, -32768, 28668, -16385, -32768,
+        4094, 24572, 32767, 20481, 32767, 32767, 32767, 14146, 24302, 32767, 32767, 32767,
+        16580, 22886, 24797, 12637, 11058, -4735, 5776, 7687, -18372, -32768, 20477, 32763,
+        14142, 32767, 32767, 32767, 32767, 28672, -4846, -32768, 20477, 32767, 32767, 6698,
+        30397, 32767, 32767, -4095, -32768, 4094, -32768, 28668,
+    }},
+    {-1000, 40, 28668, 88, {
+        -1042, -1156, -1469, -1343, -1764, -1035, 258, -1681, 126, -1047, -1686, 1224,
+        4966, 7482, 14344, 3558, -9364, 16695, 32767, 29382, 32767, 32767, -12286, 32767,
+        12289, 30910, 32767, 32767, 32767, 12289, -6332, -30031, -32768, -1989, 10297, -32768,
+        20477, 32767, 14146, -16325, 32767, -28669, -32768, -32768, -12290, -32768, -32768, 28668,
+        32767, 14146, 10761, -23094, -32768, -32768, -32768, -23536, -32768, -4788, -32768, -32768,
+        -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -28673, -32768, -32768,
+        -17380, -31370, -32768, -32768, -20482, -9310, 32767, 28672, 32767, 32767, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 32767, 32767, 28672, 24948, -19066, -32768, -32768,
+        -32768, -32768, -32768, 750, -11536, 7085, 30784, -9227, 3059, 32767, -4095, -8190,
+        -32768, -32768, -20482, 5587, 32767, 4098, 22719, 26104, 32767, 4098, -29420, 7442,
+        -32768, -20482, -32768, 4094, -32768, -32768, -12290, 32767, 12289, -32768, -32768, -32768,
+        -32768, -32768, -32768, -32768, -4099, 32767, 32767, 28672, 32396, 29011, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 12289, -21229, 23824, 32767, 32767, -751, -21229,
+        -17505, -32768, 4094, 32763, 32767, 32767, -7244, -3149, 15472, -1456, 7776, -32768,
+        -32768, -28673, -32768, -12290, -1118, 32767, -28669, -32768, -32768, -14147, -32768, -32768,
+        -32768, -32768, -21596, -32768, -12290, -32768, -32768, 8198, 32767, 32767, 32767, 28672,
+        32767, 28672, -27191, 1478, -24591, 12651, 32767, -20478, -8192, -32768, -32768, -32768,
+        -32768, 23095, 32767, 32767, 32767, 32767, 6698, 30397, 2697, -30821, 22424, 10138,
+        -1034, -11190, -26578, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, 15647,
+        -29406, -32768, -32768, -32768, -29383, -7840, 28535, 32767, -23096, 32767, 32767, 6698,
+        32767, 28672, -4846, -25324, -6703, 3453, -5779, 13807, -19261, 32767, -28669, 0,
+        -32768, -32768, -32768, -32768, -28673, 12293, -32760, -32768, -32768, -15840, 24171, -32768,
+        -32768, 4094, -32768, -12290, 6331, 32767, -20478, 8191, -32768, 28668, -16385, -32768,
+        4094, 24572, 32767, 20481, 32767, 32767, 32767, 14146, 24302, 32767, 32767, 32767,
+        16580, 22886, 24797, 12637, 11058, -4735, 5776, 7687, -18372, -32768, 20477, 32763,
+        14142, 32767, 32767, 32767, 32767, 28672, -4846, -32768, 20477, 32767, 32767, 6698,
+        30397, 32767, 32767, -4095, -32768, 4094, -32768, 28668,
+    }},
+    {5, 1, 28668, 88, {
+        4, 3, -4, -1, -12, 7, 40, -10, 36, 5, -11, 65,
+        164, 230, 411, 124, -221, 473, 1169, 1079, 1983, 3787, 947, 5861,
+        2513, 5556, 13858, 19790, 32767, 23212, 14526, 3472, -6577, 7780, 13513, -12546,
+        32767, 32767, 14146, -16325, 32767, -28669, -32768, -32768, -12290, -32768, -32768, 28668,
+        32767, 14146, 10761, -23094, -32768, -32768, -32768, -23536, -32768, -4788, -32768, -32768,
+        -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -28673, -32768, -32768,
+        -17380, -31370, -32768, -32768, -20482, -9310, 32767, 28672, 32767, 32767, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 32767, 32767, 28672, 24948, -19066, -32768, -32768,
+        -32768, -32768, -32768, 750, -11536, 7085, 30784, -9227, 3059, 32767, -4095, -8190,
+        -32768, -32768, -20482, 5587, 32767, 4098, 22719, 26104, 32767, 4098, -29420, 7442,
+        -32768, -20482, -32768, 4094, -32768, -32768, -12290, 32767, 12289, -32768, -32768, -32768,
+        -32768, -32768, -32768, -32768, -4099, 32767, 32767, 28672, 32396, 29011, 32767, 32767,
+        32767, 32767, 32767, 32767, 32767, 12289, -21229, 23824, 32767, 32767, -751, -21229,
+        -17505, -32768, 4094, 32763, 32767, 32767, -7244, -3149, 15472, -1456, 7776, -32768,
+        -32768, -28673, -32768, -12290, -1118, 32767, -28669, -32768, -32768, -14147, -32768, -32768,
+        -32768, -32768, -21596, -32768, -12290, -32768, -32768, 8198, 32767, 32767, 32767, 28672,
+        32767, 28672, -27191, 1478, -24591, 12651, 32767, -20478, -8192, -32768, -32768, -32768,
+        -32768, 23095, 32767, 32767, 32767, 32767, 6698, 30397, 2697, -30821, 22424, 10138,
+        -1034, -11190, -26578, -32768, -32768, -32768, -32768, -32768, -32768, -32768, -32768, 15647,
+        -29406, -32768, -32768, -32768, -29383, -7840, 28535, 32767, -23096, 32767, 32767, 6698,
+        32767, 28672, -4846, -25324, -6703, 3453, -5779, 13807, -19261, 32767, -28669, 0,
+        -32768, -32768, -32768, -32768, -28673, 12293, -32760, -32768, -32768, -15840, 24171, -32768,
+        -32768, 4094, -32768, -12290, 6331, 32767, -20478, 8191, -32768, 28668, -16385, -32768,
+        4094, 24572, 32767, 20481, 32767, 32767, 32767, 14146, 24302, 32767, 32767, 32767,
+        16580, 22886, 24797, 12637, 11058, -4735, 5776, 7687, -18372, -32768, 20477, 32763,
+        14142, 32767, 32767, 32767, 32767, 28672, -4846, -32768, 20477, 32767, 32767, 6698,
+        30397, 32767, 32767, -4095, -32768, 4094, -32768, 28668,
+    }},
+};
+
+} // namespace vectors
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Regenerate adpcm_vectors.h from Python's audioop (the server's codec).
+
+The proxy (server/qwen_tts_proxy/app.py) encodes downlink and decodes uplink
+ADPCM with audioop.lin2adpcm / adpcm2lin and a 4-byte packet header
+(<hBB: predictor, step index, 0). The vectors freeze that behaviour so the
+firmware codec can be checked without Python. audioop was removed in
+Python 3.13: run this with 3.12 or older (or the audioop-lts package).
+
+    python3 tools/adpcm_test/gen_vectors.py > tools/adpcm_test/adpcm_vectors.h
+"""
+
+import audioop
+import math
+import struct
+import sys
+
+SAMPLE_RATE = 16000
+FRAME = SAMPLE_RATE * 20 // 1000  # samples per uplink packet (20 ms)
+
+
+def lcg(seed):
+    s = seed
+    while True:
+        s = (s * 1664525 + 1013904223) & 0xFFFFFFFF
+        yield s
+
+
+def make_input():
+    """Six frames that walk the step index over its whole range."""
+    rnd = lcg(12345)
+    pcm = []
+    pcm += [0] * FRAME  # silence: index decays to 0
+    pcm += [int(8000 * math.sin(2 * math.pi * 440 * i / SAMPLE_RATE)) for i in range(FRAME)]
+    # full-scale square: index runs into 88, predictor clamps at both rails
+    pcm += [32767 if (i // 2) % 2 == 0 else -32768 for i in range(FRAME)]
+    pcm += [(next(rnd) >> 16) - 32768 for _ in range(FRAME)]  # white noise
+    pcm += [int(30000 * math.sin(2 * math.pi * (200 + 20 * i) * i / SAMPLE_RATE / 4))
+            for i in range(FRAME)]  # chirp
+    pcm += [0] * FRAME  # back to silence after the rails
+    return pcm
+
+
+def encode_packets(pcm):
+    """Exactly what the server sends (and what the firmware must send)."""
+    state = None
+    packets = []
+    for f in range(0, len(pcm), FRAME):
+        frame = struct.pack("<%dh" % FRAME, *pcm[f:f + FRAME])
+        pred, index = state or (0, 0)
+        body, state = audioop.lin2adpcm(frame, 2, state)
+        packets.append(struct.pack("<hBB", pred, index, 0) + body)
+    return packets, state
+
+
+def decode_body(body, pred, index):
+    pcm, state = audioop.adpcm2lin(body, 2, (pred, index))
+    return list(struct.unpack("<%dh" % (len(pcm) // 2), pcm)), state
+
+
+def c_array(ctype, name, values, per_line=12):
+    out = ["const %s %s[%d] = {" % (ctype, name, len(values))]
+    for i in range(0, len(values), per_line):
+        out.append("    " + ", ".join(str(v) for v in values[i:i + per_line]) + ",")
+    out.append("};")
+    return "\n".join(out)
+
+
+def main():
+    pcm = make_input()
+    packets, final_state = encode_packets(pcm)
+    stream = b"".join(packets)
+
+    # Decode cases: (predictor, index) start states at both rails, random codes
+    rnd = lcg(777)
+    codes = bytes((next(rnd) >> 24) & 0xFF for _ in range(FRAME // 2))
+    starts = [(0, 0), (32767, 88), (-32768, 88), (-1000, 40), (5, 1)]
+    decoded = []
+    for pred, index in starts:
+        samples, state = decode_body(codes, pred, index)
+        decoded.append((pred, index, samples, state))
+
+    # Server packets decoded by the server (round trip reference)
+    roundtrip = []
+    for p in packets:
+        pred, index = struct.unpack_from("<hB", p, 0)
+        samples, _ = decode_body(p[4:], pred, index)
+        roundtrip += samples
+
+    w = sys.stdout.write
+    w("// Generated by tools/adpcm_test/gen_vectors.py from Python %d.%d audioop.\n"
+      % sys.version_info[:2])
+    w("// Do not edit by hand.\n#pragma once\n\n#include <cstddef>\n#include <cstdint>\n\n")
+    w("namespace vectors {\n\n")
+    w("constexpr int kSampleRate = %d;\n" % SAMPLE_RATE)
+    w("constexpr size_t kFrame = %d;\n" % FRAME)
+    w("constexpr size_t kPackets = %d;\n" % len(packets))
+    w("constexpr size_t kPacketBytes = %d; // 4-byte header + kFrame / 2\n\n" % len(packets[0]))
+    w(c_array("int16_t", "kInput", pcm) + "\n\n")
+    w("// lin2adpcm with the state carried across packets, each packet prefixed\n"
+      "// with struct.pack('<hBB', predictor, index, 0) of its start state\n")
+    w(c_array("uint8_t", "kPacketStream", list(stream), 16) + "\n")
+    w("constexpr int16_t kFinalPredictor = %d;\n" % final_state[0])
+    w("constexpr uint8_t kFinalIndex = %d;\n\n" % final_state[1])
+    w("// adpcm2lin of every packet body from its header state\n")
+    w(c_array("int16_t", "kRoundTrip", roundtrip) + "\n\n")
+    w(c_array("uint8_t", "kCodes", list(codes), 16) + "\n\n")
+    w("struct DecodeCase {\n  int16_t predictor;\n  uint8_t index;\n"
+      "  int16_t final_predictor;\n  uint8_t final_index;\n  int16_t samples[%d];\n};\n\n"
+      % (len(codes) * 2))
+    w("// adpcm2lin(kCodes, 2, (predictor, index)) from several start states\n")
+    w("const DecodeCase kDecodeCases[%d] = {\n" % len(decoded))
+    for pred, index, samples, state in decoded:
+        w("    {%d, %d, %d, %d, {\n" % (pred, index, state[0], state[1]))
+        for i in range(0, len(samples), 12):
+            w("        " + ", ".join(str(v) for v in samples[i:i + 12]) + ",\n")
+        w("    }},\n")
+    w("};\n\n} // namespace vectors\n")
+
+
+if __name__ == "__main__":
+    main()
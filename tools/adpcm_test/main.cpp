@@ -0,0 +1,162 @@
+// adpcm_test - checks the firmware's IMA ADPCM codec (components/BSP/
+// AUDIO_CODEC, compiled unmodified) against vectors produced by the server's
+// codec, Python audioop lin2adpcm / adpcm2lin (see gen_vectors.py).
+//
+// Usage: adpcm_test
+// Exit status is non-zero on any mismatch. See README.md.
+
+#include "adpcm_vectors.h"
+#include "audio_codec.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+void fail(const char *what, size_t at, int got, int want) {
+  // 只打印前几个不一致，后面的多半是同一个错误的连锁反应
+  if (g_failures < 10) {
+    printf("FAIL %s: [%zu] got %d want %d\n", what, at, got, want);
+  }
+  g_failures++;
+}
+
+template <typename T>
+void expectEqual(const char *what, const T *got, const T *want, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (got[i] != want[i]) {
+      fail(what, i, got[i], want[i]);
+      return;
+    }
+  }
+}
+
+void expectState(const char *what, const audio_codec::AdpcmState &st,
+                 int16_t predictor, uint8_t index) {
+  if (st.predictor != predictor) {
+    fail(what, 0, st.predictor, predictor);
+  }
+  if (st.index != index) {
+    fail(what, 1, st.index, index);
+  }
+}
+
+// 逐包编码：状态跨包延续，包头是每包起始状态
+void checkRawEncode() {
+  using namespace vectors;
+  audio_codec::AdpcmState st;
+  uint8_t body[kFrame / 2];
+  for (size_t p = 0; p < kPackets; p++) {
+    const uint8_t *want = kPacketStream + p * kPacketBytes;
+    const int16_t pred = (int16_t)(want[0] | (want[1] << 8));
+    expectState("adpcmEncode start state", st, pred, want[2]);
+    const size_t n = audio_codec::adpcmEncode(kInput + p * kFrame, kFrame,
+                                              body, st);
+    if (n != kFrame / 2) {
+      fail("adpcmEncode bytes", p, (int)n, (int)(kFrame / 2));
+      continue;
+    }
+    expectEqual("adpcmEncode body", body, want + audio_codec::kAdpcmHeaderBytes,
+                n);
+  }
+  expectState("adpcmEncode final state", st, kFinalPredictor, kFinalIndex);
+}
+
+// 上行编码器输出的整包（含 4 字节头）必须与服务器 struct.pack('<hBB') 一致
+void checkUplinkEncoder() {
+  using namespace vectors;
+  auto enc = UplinkEncoder::create("adpcm", kSampleRate);
+  if (!enc || enc->frameSamples() != kFrame) {
+    fail("UplinkEncoder::create", 0, enc ? (int)enc->frameSamples() : -1,
+         (int)kFrame);
+    return;
+  }
+  std::vector<uint8_t> out(enc->maxPacketBytes());
+  for (size_t p = 0; p < kPackets; p++) {
+    const int n = enc->encode(kInput + p * kFrame, out.data());
+    if (n != (int)kPacketBytes) {
+      fail("UplinkEncoder packet bytes", p, n, (int)kPacketBytes);
+      return;
+    }
+    expectEqual("UplinkEncoder packet", out.data(),
+                kPacketStream + p * kPacketBytes, kPacketBytes);
+  }
+}
+
+void checkRawDecode() {
+  using namespace vectors;
+  int16_t out[kFrame];
+  for (const DecodeCase &c : kDecodeCases) {
+    audio_codec::AdpcmState st;
+    st.predictor = c.predictor;
+    st.index = c.index;
+    audio_codec::adpcmDecode(kCodes, sizeof(kCodes), out, st);
+    expectEqual("adpcmDecode samples", out, c.samples, sizeof(kCodes) * 2);
+    expectState("adpcmDecode final state", st, c.final_predictor,
+                c.final_index);
+  }
+}
+
+// 下行解码器：按包头起始状态解码，包头 index 越界时钳到 88
+void checkDownlinkDecoder() {
+  using namespace vectors;
+  auto dec = DownlinkDecoder::create("adpcm", kSampleRate);
+  if (!dec) {
+    fail("DownlinkDecoder::create", 0, 0, 1);
+    return;
+  }
+  std::vector<int16_t> out(dec->maxFrameSamples());
+  for (size_t p = 0; p < kPackets; p++) {
+    const int n = dec->decode(kPacketStream + p * kPacketBytes, kPacketBytes,
+                              out.data());
+    if (n != (int)kFrame) {
+      fail("DownlinkDecoder samples", p, n, (int)kFrame);
+      return;
+    }
+    expectEqual("DownlinkDecoder packet", out.data(), kRoundTrip + p * kFrame,
+                kFrame);
+  }
+
+  // 包头 index 200 / 89 / 255 应与 88 解码结果一致（audioop 会直接拒绝）
+  uint8_t pkt[audio_codec::kAdpcmHeaderBytes + sizeof(kCodes)];
+  pkt[0] = 0xFF; // predictor 32767
+  pkt[1] = 0x7F;
+  pkt[3] = 0;
+  memcpy(pkt + audio_codec::kAdpcmHeaderBytes, kCodes, sizeof(kCodes));
+  const DecodeCase &at88 = kDecodeCases[1];
+  for (uint8_t index : {(uint8_t)88, (uint8_t)89, (uint8_t)200, (uint8_t)255}) {
+    pkt[2] = index;
+    const int n = dec->decode(pkt, sizeof(pkt), out.data());
+    if (n != (int)(sizeof(kCodes) * 2)) {
+      fail("DownlinkDecoder clamped index samples", index, n,
+           (int)(sizeof(kCodes) * 2));
+      continue;
+    }
+    expectEqual("DownlinkDecoder clamped index", out.data(), at88.samples,
+                sizeof(kCodes) * 2);
+  }
+
+  // 只有包头、或者比最大包长还长的包都要拒绝
+  if (dec->decode(pkt, audio_codec::kAdpcmHeaderBytes - 1, out.data()) > 0) {
+    fail("DownlinkDecoder short packet", 0, 1, 0);
+  }
+  std::vector<uint8_t> big(dec->maxPacketBytes() + 1, 0);
+  if (dec->decode(big.data(), big.size(), out.data()) > 0) {
+    fail("DownlinkDecoder oversized packet", 0, 1, 0);
+  }
+}
+
+} // namespace
+
+int main() {
+  checkRawEncode();
+  checkUplinkEncoder();
+  checkRawDecode();
+  checkDownlinkDecoder();
+  printf("adpcm vs audioop: %d failures\n", g_failures);
+  return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+// Host fakes for the modules VoiceDialog depends on. They use the real BSP
+// headers so that voice_dialog.cpp compiles unmodified; only the member
+// functions VoiceDialog actually calls are defined here.
+
+#include "cloud_chat.h"
+#include "mp3_player.h"
+#include "replay_host.h"
+#include "wake_word.h"
+#include "websocket_chat.h"
+
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+std::mutex g_uploadMutex;
+std::vector<replay::Upload> g_uploads;
+
+// WS turn being recorded between startListening() and stopListening()
+bool g_wsRecording = false;
+replay::Upload g_wsCurrent;
+bool g_wsReplyPending = false;
+
+// HTTP turn being recorded between streamBegin() and streamFinish()
+replay::Upload g_httpCurrent;
+
+constexpr size_t kWavHeaderBytes = CloudChat::kWavHeaderBytes;
+
+} // namespace
+
+namespace replay {
+
+std::vector<Upload> takeUploads() {
+  std::lock_guard<std::mutex> lock(g_uploadMutex);
+  std::vector<Upload> out;
+  out.swap(g_uploads);
+  return out;
+}
+
+void setDialogActive(bool active) {
+  auto &ww = WakeWord::instance();
+  if (active) {
+    (void)ww.start();
+  } else {
+    (void)ww.stop();
+  }
+}
+
+void pumpServer() {
+  // The fake server replies instantly: "tts start" followed by "tts stop"
+  // with no audio, so the next turn can begin on the following frame.
+  if (!g_wsReplyPending) {
+    return;
+  }
+  g_wsReplyPending = false;
+  (void)WebSocketChat::instance().connect();
+}
+
+} // namespace replay
+
+// ============= WakeWord =============
+
+WakeWord &WakeWord::instance() {
+  static WakeWord instance;
+  return instance;
+}
+
+esp_err_t WakeWord::start() {
+  m_state = WakeWordState::Dialog;
+  return ESP_OK;
+}
+
+esp_err_t WakeWord::stop() {
+  m_state = WakeWordState::Running;
+  return ESP_OK;
+}
+
+void WakeWord::touchDialog() {}
+
+void WakeWord::requestExitDialog() { m_state = WakeWordState::Running; }
+
+// ============= AudioMixer (owned by Mp3Player, never started here) =============
+
+void AudioMixer::deinit() {}
+
+// ============= Mp3Player =============
+
+Mp3Player &Mp3Player::instance() {
+  static Mp3Player instance;
+  return instance;
+}
+
+esp_err_t Mp3Player::pcmStreamBegin(uint32_t, uint32_t, const char *) {
+  return ESP_OK;
+}
+
+esp_err_t Mp3Player::pcmStreamWrite(const uint8_t *, size_t, uint32_t) {
+  return ESP_OK;
+}
+
+esp_err_t Mp3Player::pcmStreamEnd() { return ESP_OK; }
+
+esp_err_t Mp3Player::pcmStreamFlush() { return ESP_OK; }
+
+void Mp3Player::noteNetworkJitter(uint32_t) {}
+
+JitterStats Mp3Player::getJitterStats() const { return JitterStats{}; }
+
+esp_err_t Mp3Player::stop() { return ESP_OK; }
+
+Mp3PlayerState Mp3Player::getState() const { return m_playerState; }
+
+// ============= CloudChat (HTTP mode) =============
+
+CloudChat &CloudChat::instance() {
+  static CloudChat instance;
+  return instance;
+}
+
+esp_err_t CloudChat::init(const CloudChatConfig &cfg) {
+  m_cfg = cfg;
+  m_inited = true;
+  return ESP_OK;
+}
+
+void CloudChat::fillWavHeader(uint8_t *header, int, uint32_t) {
+  // The fake server only looks past the header.
+  memset(header, 0, kWavHeaderBytes);
+}
+
+static esp_err_t recordWav(const UploadSpan *spans, size_t count) {
+  std::vector<uint8_t> body;
+  for (size_t i = 0; i < count; i++) {
+    const auto *p = static_cast<const uint8_t *>(spans[i].data);
+    body.insert(body.end(), p, p + spans[i].len);
+  }
+  if (body.size() < kWavHeaderBytes) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  replay::Upload up;
+  up.websocket = false;
+  up.start_ms = replay::tick();
+  up.finalize_ms = up.start_ms;
+  up.bytes = body.size();
+  size_t samples = (body.size() - kWavHeaderBytes) / sizeof(int16_t);
+  up.pcm.resize(samples);
+  memcpy(up.pcm.data(), body.data() + kWavHeaderBytes,
+         samples * sizeof(int16_t));
+
+  std::lock_guard<std::mutex> lock(g_uploadMutex);
+  g_uploads.push_back(std::move(up));
+  return ESP_OK;
+}
+
+esp_err_t CloudChat::chatWav(const UploadSpan *spans, size_t count,
+                             const std::string &) {
+  return recordWav(spans, count);
+}
+
+esp_err_t CloudChat::chatWavPcmStream(const UploadSpan *spans, size_t count,
+                                      const std::string &) {
+  return recordWav(spans, count);
+}
+
+esp_err_t CloudChat::streamBegin(const std::string &, int, bool pcmResponse) {
+  m_cancel.store(false);
+  m_stream = reinterpret_cast<esp_http_client_handle_t>(this);
+  m_streamPcm = pcmResponse;
+  m_streamBytes = kWavHeaderBytes;
+  g_httpCurrent = replay::Upload{};
+  g_httpCurrent.websocket = false;
+  g_httpCurrent.start_ms = replay::tick();
+  return ESP_OK;
+}
+
+esp_err_t CloudChat::streamWrite(const int16_t *pcm, size_t samples) {
+  if (m_stream == nullptr) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  g_httpCurrent.pcm.insert(g_httpCurrent.pcm.end(), pcm, pcm + samples);
+  m_streamBytes += samples * sizeof(int16_t);
+  return ESP_OK;
+}
+
+esp_err_t CloudChat::streamFinish() {
+  if (m_stream == nullptr) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  m_stream = nullptr;
+  g_httpCurrent.finalize_ms = replay::tick();
+  g_httpCurrent.bytes = m_streamBytes;
+  std::lock_guard<std::mutex> lock(g_uploadMutex);
+  g_uploads.push_back(std::move(g_httpCurrent));
+  return ESP_OK;
+}
+
+void CloudChat::streamAbort() { m_stream = nullptr; }
+
+// ============= WebSocketChat (WS mode) =============
+
+WebSocketChat &WebSocketChat::instance() {
+  static WebSocketChat instance;
+  return instance;
+}
+
+WebSocketChat::~WebSocketChat() = default;
+
+esp_err_t WebSocketChat::init(const WebSocketChatConfig &config) {
+  config_ = config;
+  initialized_ = true;
+  server_sample_rate_ = config.sample_rate;
+  state_.store(WsDialogState::Connected);
+  return ESP_OK;
+}
+
+esp_err_t WebSocketChat::connect() {
+  // Used as the fake server's event pump (see replay::pumpServer()).
+  if (state_.load() == WsDialogState::WaitingForResponse) {
+    state_.store(WsDialogState::Speaking);
+    if (on_tts_state_) {
+      on_tts_state_(true);
+    }
+    state_.store(WsDialogState::Connected);
+    if (on_tts_state_) {
+      on_tts_state_(false);
+    }
+  }
+  if (state_.load() < WsDialogState::Connected) {
+    state_.store(WsDialogState::Connected);
+  }
+  return ESP_OK;
+}
+
+void WebSocketChat::disconnect() {}
+
+esp_err_t WebSocketChat::startListening() {
+  state_.store(WsDialogState::Listening);
+  g_wsRecording = true;
+  g_wsCurrent = replay::Upload{};
+  g_wsCurrent.websocket = true;
+  g_wsCurrent.start_ms = replay::tick();
+  return ESP_OK;
+}
+
+esp_err_t WebSocketChat::stopListening() {
+  if (g_wsRecording) {
+    g_wsRecording = false;
+    g_wsCurrent.finalize_ms = replay::tick();
+    std::lock_guard<std::mutex> lock(g_uploadMutex);
+    g_uploads.push_back(std::move(g_wsCurrent));
+  }
+  state_.store(WsDialogState::WaitingForResponse);
+  g_wsReplyPending = true;
+  return ESP_OK;
+}
+
+esp_err_t WebSocketChat::sendAudio(const uint8_t *data, size_t len) {
+  if (!g_wsRecording || data == nullptr || len == 0) {
+    return ESP_OK;
+  }
+  g_wsCurrent.bytes += len;
+  size_t old = g_wsCurrent.pcm.size();
+  g_wsCurrent.pcm.resize(old + len / sizeof(int16_t));
+  memcpy(g_wsCurrent.pcm.data() + old, data,
+         (len / sizeof(int16_t)) * sizeof(int16_t));
+  return ESP_OK;
+}
+
+esp_err_t WebSocketChat::sendAbort() {
+  g_wsRecording = false;
+  state_.store(WsDialogState::Connected);
+  return ESP_OK;
+}
+
+WsNetStats WebSocketChat::netStats() const { return WsNetStats{}; }
@@ -0,0 +1,129 @@
+// Minimal host-side stand-ins for the ESP-IDF / FreeRTOS APIs used by
+// VoiceDialog and the headers it pulls in. Only what dialog_replay needs.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ---- esp_err ----
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+#define ESP_ERR_INVALID_RESPONSE 0x108
+const char *esp_err_to_name(esp_err_t code);
+
+// ---- esp_log ----
+void replay_log(char level, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+#define ESP_LOGE(tag, fmt, ...) replay_log('E', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) replay_log('W', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) replay_log('I', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) replay_log('D', tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) replay_log('V', tag, fmt, ##__VA_ARGS__)
+
+// ---- esp_mac ----
+typedef enum { ESP_MAC_WIFI_STA, ESP_MAC_WIFI_SOFTAP } esp_mac_type_t;
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+// ---- heap_caps ----
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+static inline void *heap_caps_malloc(size_t size, uint32_t caps) {
+  (void)caps;
+  return malloc(size);
+}
+static inline void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+  (void)caps;
+  return calloc(n, size);
+}
+static inline void *heap_caps_aligned_alloc(size_t align, size_t size,
+                                            uint32_t caps) {
+  (void)caps;
+  return aligned_alloc(align, (size + align - 1) / align * align);
+}
+static inline void heap_caps_free(void *p) { free(p); }
+
+// ---- esp_vad / AFE / MultiNet (opaque) ----
+typedef enum { VAD_SILENCE = 0, VAD_SPEECH = 1 } vad_state_t;
+typedef struct esp_afe_sr_iface_t esp_afe_sr_iface_t;
+typedef struct esp_afe_sr_data_t esp_afe_sr_data_t;
+typedef struct afe_config_t afe_config_t;
+typedef struct srmodel_list_t srmodel_list_t;
+typedef struct esp_mn_iface_t esp_mn_iface_t;
+typedef struct model_iface_data_t model_iface_data_t;
+
+// ---- driver ----
+typedef int gpio_num_t;
+#define GPIO_NUM_NC (-1)
+typedef struct i2s_channel_obj_t *i2s_chan_handle_t;
+typedef enum { I2S_SLOT_MODE_MONO = 1, I2S_SLOT_MODE_STEREO = 2 } i2s_slot_mode_t;
+
+// ---- http client (opaque) ----
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+// ---- websocket client (opaque) ----
+typedef const char *esp_event_base_t;
+typedef struct esp_websocket_client *esp_websocket_client_handle_t;
+typedef struct {
+  const char *data_ptr;
+  int data_len;
+  bool fin;
+  uint8_t op_code;
+  int payload_len;
+  int payload_offset;
+} esp_websocket_event_data_t;
+
+// ---- FreeRTOS (simulated clock: 1 tick == 1 ms) ----
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void *TaskHandle_t;
+typedef struct HostQueue *QueueHandle_t;
+typedef void *StreamBufferHandle_t;
+typedef struct {
+  uint8_t reserved[64];
+} StaticStreamBuffer_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *handle,
+                                   BaseType_t core);
+void vTaskDelete(TaskHandle_t handle);
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+void vQueueDelete(QueueHandle_t q);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,2 @@
+#pragma once
+// Host build: no Kconfig options set (latency tracing compiles out).
@@ -0,0 +1,195 @@
+// Simulated FreeRTOS for dialog_replay: tasks are std::threads, queues are
+// mutex/condvar FIFOs, and the tick count is driven by the harness so that
+// timing only depends on how much audio has been fed.
+
+#include "host_idf.h"
+#include "replay_host.h"
+
+#include <pthread.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<uint32_t> g_tick{0};
+std::atomic<bool> g_verbose{false};
+
+// Idle tracking: a consumer is "busy" from a successful receive until its
+// next receive call.
+std::mutex g_idleMutex;
+std::condition_variable g_idleCv;
+int g_pendingItems = 0;
+int g_busyConsumers = 0;
+thread_local bool t_holdingItem = false;
+
+void releaseHeldItem() {
+  if (!t_holdingItem) {
+    return;
+  }
+  t_holdingItem = false;
+  std::lock_guard<std::mutex> lock(g_idleMutex);
+  g_busyConsumers--;
+  g_idleCv.notify_all();
+}
+
+} // namespace
+
+struct HostQueue {
+  size_t len = 0;
+  size_t itemSize = 0;
+  std::deque<std::vector<uint8_t>> items;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+namespace replay {
+
+void setTick(uint32_t ms) { g_tick.store(ms); }
+uint32_t tick() { return g_tick.load(); }
+void setVerbose(bool verbose) { g_verbose.store(verbose); }
+
+void waitIdle() {
+  std::unique_lock<std::mutex> lock(g_idleMutex);
+  g_idleCv.wait(lock,
+                [] { return g_pendingItems == 0 && g_busyConsumers == 0; });
+}
+
+} // namespace replay
+
+extern "C" {
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_ARG:
+    return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  default:
+    return "ESP_ERR_UNKNOWN";
+  }
+}
+
+void replay_log(char level, const char *tag, const char *fmt, ...) {
+  if (!g_verbose.load() && level != 'E') {
+    return;
+  }
+  fprintf(stderr, "%c (%6u) %s: ", level, (unsigned)g_tick.load(), tag);
+  va_list ap;
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  fputc('\n', stderr);
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type) {
+  (void)type;
+  static const uint8_t kMac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+  memcpy(mac, kMac, sizeof(kMac));
+  return ESP_OK;
+}
+
+TickType_t xTaskGetTickCount(void) { return g_tick.load(); }
+
+void vTaskDelay(TickType_t ticks) {
+  // Simulated time does not advance on its own; just yield the host CPU.
+  (void)ticks;
+  std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name,
+                                   uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  (void)name;
+  (void)stack;
+  (void)prio;
+  (void)core;
+  std::thread t(fn, arg);
+  if (handle) {
+    *handle = reinterpret_cast<TaskHandle_t>(t.native_handle());
+  }
+  t.detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+  if (handle == nullptr) {
+    releaseHeldItem();
+    pthread_exit(nullptr);
+  }
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize) {
+  auto *q = new HostQueue();
+  q->len = len;
+  q->itemSize = itemSize;
+  return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) {
+  (void)wait;
+  {
+    std::lock_guard<std::mutex> lock(q->mutex);
+    if (q->items.size() >= q->len) {
+      return pdFALSE;
+    }
+    {
+      std::lock_guard<std::mutex> idle(g_idleMutex);
+      g_pendingItems++;
+    }
+    const auto *p = static_cast<const uint8_t *>(item);
+    q->items.emplace_back(p, p + q->itemSize);
+  }
+  q->cv.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait) {
+  releaseHeldItem();
+
+  std::unique_lock<std::mutex> lock(q->mutex);
+  if (q->items.empty()) {
+    if (wait == 0) {
+      return pdFALSE;
+    }
+    q->cv.wait(lock, [q] { return !q->items.empty(); });
+  }
+  memcpy(item, q->items.front().data(), q->itemSize);
+  q->items.pop_front();
+  lock.unlock();
+
+  // Non-blocking drains (wait == 0) come from the harness-side code path and
+  // are not tracked as a consumer task.
+  std::lock_guard<std::mutex> idle(g_idleMutex);
+  g_pendingItems--;
+  if (wait != 0) {
+    g_busyConsumers++;
+    t_holdingItem = true;
+  }
+  g_idleCv.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> lock(q->mutex);
+  return (UBaseType_t)q->items.size();
+}
+
+void vQueueDelete(QueueHandle_t q) { delete q; }
+
+} // extern "C"
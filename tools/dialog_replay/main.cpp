@@ -0,0 +1,717 @@
+// dialog_replay - feed WAV files through VoiceDialog on the host and report
+// endpointing quality (endpoint latency, clipped onsets, upload size).
+//
+// Usage: dialog_replay [options] <dir-or-wav>...
+// See README.md for the label file format and options.
+
+#include "replay_host.h"
+#include "voice_dialog.h"
+
+#ifdef HAVE_FVAD
+#include <fvad.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Segment {
+  double start_ms = 0;
+  double end_ms = 0;
+};
+
+struct Clip {
+  std::string name;
+  std::vector<int16_t> pcm;
+  std::vector<Segment> truth;   // ground-truth speech
+  std::vector<Segment> vadFile; // optional VAD override (<stem>.vad)
+};
+
+enum class VadSource { Labels, Energy, WebRtc };
+
+struct Options {
+  std::string mode = "ws";
+  int sample_rate = 16000;
+  int frame_ms = 32;
+  int tail_ms = 1500;
+  int min_speech_ms = 300;
+  int preroll_ms = 200;
+  int max_utterance_ms = 8000;
+  std::vector<int> end_silence_ms{450};
+  std::vector<int> energy_gate{120};
+  bool adaptive_gate = false;
+  std::vector<int> snr_db{8};
+  VadSource vad = VadSource::Labels;
+  int vad_delay_ms = 0;
+  int vad_hangover_ms = 0;
+  int webrtc_mode = 2;
+  int onset_tol_ms = 0;
+  bool per_utterance = true;
+  bool verbose = false;
+  std::vector<std::string> inputs;
+};
+
+// ---------------------------------------------------------------------------
+// Input
+// ---------------------------------------------------------------------------
+
+uint32_t rd32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+uint16_t rd16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+bool loadWav(const fs::path &path, int expectRate, std::vector<int16_t> &out,
+             std::string &err) {
+  std::ifstream f(path, std::ios::binary);
+  std::vector<uint8_t> buf((std::istreambuf_iterator<char>(f)),
+                           std::istreambuf_iterator<char>());
+  if (buf.size() < 12 || memcmp(buf.data(), "RIFF", 4) != 0 ||
+      memcmp(buf.data() + 8, "WAVE", 4) != 0) {
+    err = "not a RIFF/WAVE file";
+    return false;
+  }
+
+  uint16_t format = 0, channels = 0, bits = 0;
+  uint32_t rate = 0;
+  const uint8_t *data = nullptr;
+  size_t dataLen = 0;
+  size_t pos = 12;
+  while (pos + 8 <= buf.size()) {
+    const uint8_t *ck = buf.data() + pos;
+    size_t len = rd32(ck + 4);
+    size_t body = pos + 8;
+    if (body + len > buf.size()) {
+      len = buf.size() - body;
+    }
+    if (memcmp(ck, "fmt ", 4) == 0 && len >= 16) {
+      format = rd16(ck + 8);
+      channels = rd16(ck + 10);
+      rate = rd32(ck + 12);
+      bits = rd16(ck + 22);
+    } else if (memcmp(ck, "data", 4) == 0) {
+      data = buf.data() + body;
+      dataLen = len;
+    }
+    pos = body + len + (len & 1);
+  }
+
+  if (format != 1 || bits != 16 || channels == 0 || data == nullptr) {
+    err = "only 16-bit PCM WAV is supported";
+    return false;
+  }
+  if ((int)rate != expectRate) {
+    err = "sample rate " + std::to_string(rate) + " != " +
+          std::to_string(expectRate) + " (resample first)";
+    return false;
+  }
+
+  size_t frames = dataLen / (2u * channels);
+  out.resize(frames);
+  for (size_t i = 0; i < frames; i++) {
+    out[i] = (int16_t)rd16(data + i * 2u * channels); // first channel
+  }
+  return true;
+}
+
+// Audacity label track export: "<start_s>\t<end_s>[\t<text>]" per line.
+std::vector<Segment> loadLabels(const fs::path &path) {
+  std::vector<Segment> segs;
+  std::ifstream f(path);
+  std::string line;
+  while (std::getline(f, line)) {
+    if (line.empty() || line[0] == '#' || line[0] == '\\') {
+      continue;
+    }
+    std::istringstream ss(line);
+    double a = 0, b = 0;
+    if (ss >> a >> b && b > a) {
+      segs.push_back({a * 1000.0, b * 1000.0});
+    }
+  }
+  std::sort(segs.begin(), segs.end(),
+            [](const Segment &x, const Segment &y) {
+              return x.start_ms < y.start_ms;
+            });
+  return segs;
+}
+
+fs::path sibling(const fs::path &wav, const char *ext) {
+  fs::path p = wav;
+  p.replace_extension(ext);
+  return p;
+}
+
+// ---------------------------------------------------------------------------
+// VAD sources (stand-ins for the AFE VAD)
+// ---------------------------------------------------------------------------
+
+class FrameVad {
+public:
+  FrameVad(const Options &opt, const Clip &clip) : m_opt(opt), m_clip(clip) {
+#ifdef HAVE_FVAD
+    if (opt.vad == VadSource::WebRtc) {
+      m_fvad = fvad_new();
+      fvad_set_mode(m_fvad, opt.webrtc_mode);
+      fvad_set_sample_rate(m_fvad, opt.sample_rate);
+    }
+#endif
+  }
+  ~FrameVad() {
+#ifdef HAVE_FVAD
+    if (m_fvad) {
+      fvad_free(m_fvad);
+    }
+#endif
+  }
+
+  bool speech(const int16_t *x, int n, double frameStartMs) {
+    double mid = frameStartMs + m_opt.frame_ms / 2.0;
+    switch (m_opt.vad) {
+    case VadSource::Labels: {
+      const auto &segs = m_clip.vadFile.empty() ? m_clip.truth : m_clip.vadFile;
+      for (const auto &s : segs) {
+        if (mid >= s.start_ms + m_opt.vad_delay_ms &&
+            mid <= s.end_ms + m_opt.vad_hangover_ms) {
+          return true;
+        }
+      }
+      return false;
+    }
+    case VadSource::Energy:
+      return energy(x, n);
+    case VadSource::WebRtc:
+      return webrtc(x, n);
+    }
+    return false;
+  }
+
+private:
+  // Adaptive noise floor + fixed ratio; a rough substitute for the AFE VAD
+  // when no labels or libfvad are available.
+  bool energy(const int16_t *x, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+      sum += std::abs((int)x[i]);
+    }
+    double m = n > 0 ? sum / n : 0;
+    if (m_floor < 0) {
+      m_floor = std::max(m, 30.0);
+    }
+    bool active = m > std::max(m_floor * 3.0, 150.0);
+    if (!active) {
+      m_floor = 0.9 * m_floor + 0.1 * std::max(m, 10.0);
+    }
+    if (active) {
+      m_hang = 4;
+      return true;
+    }
+    if (m_hang > 0) {
+      m_hang--;
+      return true;
+    }
+    return false;
+  }
+
+  bool webrtc(const int16_t *x, int n) {
+#ifdef HAVE_FVAD
+    const int sub = m_opt.sample_rate / 100; // 10 ms
+    for (int off = 0; off + sub <= n; off += sub) {
+      if (fvad_process(m_fvad, x + off, (size_t)sub) == 1) {
+        return true;
+      }
+    }
+    return false;
+#else
+    (void)x;
+    (void)n;
+    return false;
+#endif
+  }
+
+  const Options &m_opt;
+  const Clip &m_clip;
+  double m_floor = -1;
+  int m_hang = 0;
+#ifdef HAVE_FVAD
+  Fvad *m_fvad = nullptr;
+#endif
+};
+
+// ---------------------------------------------------------------------------
+// Evaluation
+// ---------------------------------------------------------------------------
+
+struct Located {
+  replay::Upload up;
+  double start_ms = -1; // position of the uploaded audio in the source clip
+  double end_ms = -1;
+  double finalize_ms = 0; // relative to clip start
+};
+
+long findInSource(const std::vector<int16_t> &src,
+                  const std::vector<int16_t> &pcm, size_t from) {
+  if (pcm.empty() || pcm.size() > src.size()) {
+    return -1;
+  }
+  size_t probe = std::min<size_t>(pcm.size(), 256);
+  for (size_t p = from; p + pcm.size() <= src.size(); p++) {
+    if (memcmp(src.data() + p, pcm.data(), probe * sizeof(int16_t)) == 0 &&
+        memcmp(src.data() + p, pcm.data(), pcm.size() * sizeof(int16_t)) ==
+            0) {
+      return (long)p;
+    }
+  }
+  return -1;
+}
+
+struct Totals {
+  int utterances = 0;
+  int detected = 0;
+  int clipped = 0;
+  int split = 0;
+  int falseTriggers = 0;
+  int uploads = 0;
+  int forcedCut = 0;
+  size_t bytes = 0;
+  double speechMs = 0;
+  std::vector<double> latency;
+};
+
+double mean(const std::vector<double> &v) {
+  if (v.empty()) {
+    return 0;
+  }
+  double sum = 0;
+  for (double x : v) {
+    sum += x;
+  }
+  return sum / (double)v.size();
+}
+
+double percentile(std::vector<double> v, double q) {
+  if (v.empty()) {
+    return 0;
+  }
+  std::sort(v.begin(), v.end());
+  size_t idx = (size_t)std::lround(q * (double)(v.size() - 1));
+  return v[idx];
+}
+
+void evaluate(const Options &opt, const Clip &clip,
+              const std::vector<Located> &ups, Totals &t) {
+  const auto &truth = clip.truth;
+  t.uploads += (int)ups.size();
+  for (const auto &u : ups) {
+    t.bytes += u.up.bytes;
+  }
+  for (const auto &s : truth) {
+    t.speechMs += s.end_ms - s.start_ms;
+  }
+
+  auto overlaps = [](const Located &u, const Segment &s) {
+    return u.start_ms >= 0 && u.start_ms < s.end_ms && u.end_ms > s.start_ms;
+  };
+
+  // per ground-truth utterance
+  for (size_t i = 0; i < truth.size(); i++) {
+    const auto &s = truth[i];
+    t.utterances++;
+    const Located *first = nullptr;
+    int count = 0;
+    for (const auto &u : ups) {
+      if (overlaps(u, s)) {
+        if (!first) {
+          first = &u;
+        }
+        count++;
+      }
+    }
+    if (!first) {
+      if (opt.per_utterance) {
+        printf("%-24s utt=%zu speech=[%.0f,%.0f] MISSED\n", clip.name.c_str(),
+               i, s.start_ms, s.end_ms);
+      }
+      continue;
+    }
+    t.detected++;
+    double clipMs = first->start_ms - s.start_ms;
+    bool clipped = clipMs > opt.onset_tol_ms;
+    if (clipped) {
+      t.clipped++;
+    }
+    if (count > 1) {
+      t.split++;
+    }
+    if (opt.per_utterance) {
+      printf("%-24s utt=%zu speech=[%.0f,%.0f] upload=[%.0f,%.0f] "
+             "onset=%+.0fms%s%s\n",
+             clip.name.c_str(), i, s.start_ms, s.end_ms, first->start_ms,
+             first->end_ms, clipMs, clipped ? " CLIPPED" : "",
+             count > 1 ? " SPLIT" : "");
+    }
+  }
+
+  // per upload: endpoint latency against the last utterance it covers
+  for (const auto &u : ups) {
+    const Segment *last = nullptr;
+    for (const auto &s : truth) {
+      if (overlaps(u, s)) {
+        last = &s;
+      }
+    }
+    if (!last) {
+      t.falseTriggers++;
+      if (opt.per_utterance) {
+        printf("%-24s upload=[%.0f,%.0f] bytes=%zu FALSE-TRIGGER\n",
+               clip.name.c_str(), u.start_ms, u.end_ms, u.up.bytes);
+      }
+      continue;
+    }
+    double lat = u.finalize_ms - last->end_ms;
+    bool cut = u.end_ms < last->end_ms;
+    if (cut) {
+      t.forcedCut++;
+    }
+    t.latency.push_back(lat);
+    if (opt.per_utterance) {
+      printf("%-24s upload=[%.0f,%.0f] finalize=%.0f endpoint_latency=%.0fms "
+             "bytes=%zu%s\n",
+             clip.name.c_str(), u.start_ms, u.end_ms, u.finalize_ms, lat,
+             u.up.bytes, cut ? " TAIL-CUT" : "");
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Driver
+// ---------------------------------------------------------------------------
+
+uint32_t g_clock = 0;
+
+std::vector<Located> runClip(const Options &opt, VoiceDialog &dialog,
+                             const Clip &clip) {
+  const int frame = opt.sample_rate * opt.frame_ms / 1000;
+  const uint32_t clipStart = g_clock;
+  uint32_t lastTick = clipStart;
+
+  replay::setDialogActive(true);
+  dialog.onWakeDetected();
+
+  std::vector<int16_t> buf(frame);
+  FrameVad vad(opt, clip);
+  size_t total = clip.pcm.size() +
+                 (size_t)opt.tail_ms * (size_t)opt.sample_rate / 1000;
+
+  for (size_t pos = 0; pos + frame <= total; pos += frame) {
+    for (int i = 0; i < frame; i++) {
+      size_t k = pos + (size_t)i;
+      buf[i] = k < clip.pcm.size() ? clip.pcm[k] : 0;
+    }
+    double startMs = (double)pos * 1000.0 / opt.sample_rate;
+    bool speech = vad.speech(buf.data(), frame, startMs);
+
+    // AFE hands out a frame once it has been fully captured
+    g_clock = clipStart +
+              (uint32_t)((pos + frame) * 1000ull / (size_t)opt.sample_rate);
+    replay::setTick(g_clock);
+
+    dialog.onAudioFrame(buf.data(), frame, speech ? VAD_SPEECH : VAD_SILENCE);
+    replay::waitIdle();
+    replay::pumpServer();
+
+    if (g_clock - lastTick >= 1000) {
+      dialog.tick();
+      lastTick = g_clock;
+    }
+  }
+
+  replay::setDialogActive(false);
+  dialog.tick();
+  replay::waitIdle();
+  g_clock += 1000;
+  replay::setTick(g_clock);
+
+  // Uploads may run into the appended tail silence
+  std::vector<int16_t> fed(clip.pcm);
+  fed.resize(total, 0);
+
+  std::vector<Located> out;
+  size_t searchFrom = 0;
+  for (auto &up : replay::takeUploads()) {
+    Located l;
+    l.finalize_ms = (double)(up.finalize_ms - clipStart);
+    long at = findInSource(fed, up.pcm, searchFrom);
+    if (at >= 0) {
+      l.start_ms = at * 1000.0 / opt.sample_rate;
+      l.end_ms = (at + (double)up.pcm.size()) * 1000.0 / opt.sample_rate;
+      searchFrom = (size_t)at;
+    }
+    l.up = std::move(up);
+    out.push_back(std::move(l));
+  }
+  return out;
+}
+
+std::vector<int> parseList(const char *s) {
+  std::vector<int> v;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      v.push_back(atoi(item.c_str()));
+    }
+  }
+  return v;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: dialog_replay [options] <dir-or-wav>...\n"
+          "  --mode ws|http|http-stream  dialog path to drive (default ws)\n"
+          "  --rate HZ                 expected WAV sample rate (16000)\n"
+          "  --frame-ms N              AFE fetch frame length (32)\n"
+          "  --end-silence-ms A[,B..]  end_silence_ms values to sweep (450)\n"
+          "  --energy-gate A[,B..]     energy_gate_mean_abs values (120)\n"
+          "  --adaptive-gate           track the noise floor instead of a\n"
+          "                            fixed gate\n"
+          "  --snr-db A[,B..]          adaptive gate SNR values to sweep (8)\n"
+          "  --min-speech-ms N         min_speech_ms (300)\n"
+          "  --preroll-ms N            WS pre-roll before speech start (200)\n"
+          "  --max-utterance-ms N      max_utterance_ms (8000)\n"
+          "  --vad labels|energy|webrtc  VAD source (labels)\n"
+          "  --vad-delay-ms N          label VAD onset delay (0)\n"
+          "  --vad-hangover-ms N       label VAD hangover (0)\n"
+          "  --webrtc-mode 0..3        libfvad aggressiveness (2)\n"
+          "  --onset-tol-ms N          onset clip tolerance (0)\n"
+          "  --tail-ms N               silence appended to each clip (1500)\n"
+          "  --summary-only            no per-utterance lines\n"
+          "  --verbose                 print device logs\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&](const char *name) -> const char * {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "%s needs a value\n", name);
+        exit(2);
+      }
+      return argv[++i];
+    };
+    if (a == "--mode") {
+      opt.mode = next("--mode");
+    } else if (a == "--rate") {
+      opt.sample_rate = atoi(next("--rate"));
+    } else if (a == "--frame-ms") {
+      opt.frame_ms = atoi(next("--frame-ms"));
+    } else if (a == "--end-silence-ms") {
+      opt.end_silence_ms = parseList(next("--end-silence-ms"));
+    } else if (a == "--energy-gate") {
+      opt.energy_gate = parseList(next("--energy-gate"));
+    } else if (a == "--adaptive-gate") {
+      opt.adaptive_gate = true;
+    } else if (a == "--snr-db") {
+      opt.snr_db = parseList(next("--snr-db"));
+    } else if (a == "--min-speech-ms") {
+      opt.min_speech_ms = atoi(next("--min-speech-ms"));
+    } else if (a == "--preroll-ms") {
+      opt.preroll_ms = atoi(next("--preroll-ms"));
+    } else if (a == "--max-utterance-ms") {
+      opt.max_utterance_ms = atoi(next("--max-utterance-ms"));
+    } else if (a == "--vad") {
+      std::string v = next("--vad");
+      if (v == "labels") {
+        opt.vad = VadSource::Labels;
+      } else if (v == "energy") {
+        opt.vad = VadSource::Energy;
+      } else if (v == "webrtc") {
+#ifndef HAVE_FVAD
+        fprintf(stderr, "built without libfvad; --vad webrtc unavailable\n");
+        return false;
+#endif
+        opt.vad = VadSource::WebRtc;
+      } else {
+        return false;
+      }
+    } else if (a == "--vad-delay-ms") {
+      opt.vad_delay_ms = atoi(next("--vad-delay-ms"));
+    } else if (a == "--vad-hangover-ms") {
+      opt.vad_hangover_ms = atoi(next("--vad-hangover-ms"));
+    } else if (a == "--webrtc-mode") {
+      opt.webrtc_mode = atoi(next("--webrtc-mode"));
+    } else if (a == "--onset-tol-ms") {
+      opt.onset_tol_ms = atoi(next("--onset-tol-ms"));
+    } else if (a == "--tail-ms") {
+      opt.tail_ms = atoi(next("--tail-ms"));
+    } else if (a == "--summary-only") {
+      opt.per_utterance = false;
+    } else if (a == "--verbose") {
+      opt.verbose = true;
+    } else if (a == "-h" || a == "--help") {
+      return false;
+    } else if (!a.empty() && a[0] == '-') {
+      fprintf(stderr, "unknown option %s\n", a.c_str());
+      return false;
+    } else {
+      opt.inputs.push_back(a);
+    }
+  }
+  if (opt.mode != "ws" && opt.mode != "http" && opt.mode != "http-stream") {
+    fprintf(stderr, "--mode must be ws, http or http-stream\n");
+    return false;
+  }
+  return !opt.inputs.empty() && opt.frame_ms > 0 && opt.sample_rate > 0 &&
+         !opt.end_silence_ms.empty() && !opt.energy_gate.empty() &&
+         !opt.snr_db.empty();
+}
+
+std::vector<Clip> loadClips(const Options &opt) {
+  std::vector<fs::path> wavs;
+  for (const auto &in : opt.inputs) {
+    fs::path p(in);
+    if (fs::is_directory(p)) {
+      for (const auto &e : fs::directory_iterator(p)) {
+        if (e.path().extension() == ".wav") {
+          wavs.push_back(e.path());
+        }
+      }
+    } else {
+      wavs.push_back(p);
+    }
+  }
+  std::sort(wavs.begin(), wavs.end());
+
+  std::vector<Clip> clips;
+  for (const auto &w : wavs) {
+    Clip c;
+    c.name = w.filename().string();
+    std::string err;
+    if (!loadWav(w, opt.sample_rate, c.pcm, err)) {
+      fprintf(stderr, "skip %s: %s\n", w.string().c_str(), err.c_str());
+      continue;
+    }
+    for (const char *ext : {".txt", ".lab"}) {
+      fs::path lp = sibling(w, ext);
+      if (fs::exists(lp)) {
+        c.truth = loadLabels(lp);
+        break;
+      }
+    }
+    fs::path vp = sibling(w, ".vad");
+    if (fs::exists(vp)) {
+      c.vadFile = loadLabels(vp);
+    }
+    if (c.truth.empty() && opt.vad == VadSource::Labels &&
+        c.vadFile.empty()) {
+      fprintf(stderr, "skip %s: no labels (use --vad energy|webrtc)\n",
+              w.string().c_str());
+      continue;
+    }
+    clips.push_back(std::move(c));
+  }
+  return clips;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  replay::setVerbose(opt.verbose);
+
+  std::vector<Clip> clips = loadClips(opt);
+  if (clips.empty()) {
+    fprintf(stderr, "no usable WAV files\n");
+    return 1;
+  }
+
+  printf("# mode=%s frame=%dms vad=%s clips=%zu\n", opt.mode.c_str(),
+         opt.frame_ms,
+         opt.vad == VadSource::Labels
+             ? "labels"
+             : (opt.vad == VadSource::Energy ? "energy" : "webrtc"),
+         clips.size());
+
+  // Fixed gate: sweep energy_gate_mean_abs. Adaptive gate: sweep the SNR.
+  const std::vector<int> &gateValues =
+      opt.adaptive_gate ? opt.snr_db : opt.energy_gate;
+  const char *gateName = opt.adaptive_gate ? "snr_db" : "gate";
+
+  for (int endSilence : opt.end_silence_ms) {
+    for (int gate : gateValues) {
+      VoiceDialogConfig cfg;
+      cfg.chat_url = "http://replay/chat";
+      cfg.ws_url = "ws://replay/ws";
+      cfg.use_websocket = (opt.mode == "ws");
+      cfg.stream_upload = (opt.mode == "http-stream");
+      cfg.sample_rate_hz = opt.sample_rate;
+      cfg.min_speech_ms = opt.min_speech_ms;
+      cfg.preroll_ms = opt.preroll_ms;
+      cfg.end_silence_ms = endSilence;
+      cfg.max_utterance_ms = opt.max_utterance_ms;
+      cfg.max_pcm_ms = opt.max_utterance_ms + endSilence + 1000;
+      cfg.energy_gate_mean_abs = gate;
+      cfg.adaptive_energy_gate = opt.adaptive_gate;
+      if (opt.adaptive_gate) {
+        cfg.gate_snr_db = gate;
+      }
+      cfg.local_command_ignore_ms = 0;
+
+      // One instance per configuration; the worker task of a previous
+      // instance stays parked on its own (empty) queue.
+      auto *dialog = new VoiceDialog();
+      if (dialog->init(cfg) != ESP_OK) {
+        fprintf(stderr, "VoiceDialog init failed\n");
+        return 1;
+      }
+
+      printf("# end_silence_ms=%d %s=%d\n", endSilence, gateName, gate);
+      Totals t;
+      for (const auto &clip : clips) {
+        std::vector<Located> ups = runClip(opt, *dialog, clip);
+        evaluate(opt, clip, ups, t);
+      }
+
+      double bytesPerSpeechSec =
+          t.speechMs > 0 ? (double)t.bytes / (t.speechMs / 1000.0) : 0;
+      printf("SUMMARY end_silence_ms=%d %s=%d utterances=%d detected=%d "
+             "missed=%d split=%d false_triggers=%d tail_cut=%d\n",
+             endSilence, gateName, gate, t.utterances, t.detected,
+             t.utterances - t.detected, t.split, t.falseTriggers,
+             t.forcedCut);
+      printf("  endpoint_latency_ms mean=%.0f p50=%.0f p90=%.0f max=%.0f "
+             "(n=%zu)\n",
+             mean(t.latency),
+             percentile(t.latency, 0.5), percentile(t.latency, 0.9),
+             t.latency.empty()
+                 ? 0.0
+                 : *std::max_element(t.latency.begin(), t.latency.end()),
+             t.latency.size());
+      printf("  clipped_onset=%d/%d (%.1f%%)\n", t.clipped, t.detected,
+             t.detected ? 100.0 * t.clipped / t.detected : 0.0);
+      printf("  upload_bytes total=%zu per_upload=%.0f per_speech_sec=%.0f\n",
+             t.bytes, t.uploads ? (double)t.bytes / t.uploads : 0.0,
+             bytesPerSpeechSec);
+    }
+  }
+
+  fflush(stdout);
+  // Worker threads are parked forever on their queues; skip static
+  // destructors instead of joining them.
+  std::_Exit(0);
+}
@@ -0,0 +1,48 @@
+// Harness-side controls for the simulated FreeRTOS environment and the fake
+// modules that VoiceDialog talks to (WakeWord / Mp3Player / WebSocketChat /
+// CloudChat).
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace replay {
+
+// ---- simulated RTOS ----
+
+/** Set the simulated tick (ms). Only the harness thread advances time. */
+void setTick(uint32_t ms);
+uint32_t tick();
+
+/** Block until every queue is empty and every consumer task is back waiting. */
+void waitIdle();
+
+void setVerbose(bool verbose);
+
+// ---- fake cloud side ----
+
+/**
+ * @brief One uploaded utterance as seen by the fake server.
+ */
+struct Upload {
+  bool websocket = false;
+  uint32_t start_ms = 0;    /*!< startListening (WS) / request (HTTP) time */
+  uint32_t finalize_ms = 0; /*!< stopListening (WS) / request (HTTP) time */
+  size_t bytes = 0;         /*!< bytes on the wire (WAV incl. header / WS binary) */
+  std::vector<int16_t> pcm; /*!< uploaded audio */
+};
+
+/** Uploads recorded since the last call; clears the list. */
+std::vector<Upload> takeUploads();
+
+/**
+ * @brief Deliver the fake server's reply ("tts start" + "tts stop") for a
+ * finished WS turn. Called by the harness after each frame.
+ */
+void pumpServer();
+
+/** Enter / leave dialog mode on the fake WakeWord. */
+void setDialogActive(bool active);
+
+} // namespace replay
@@ -0,0 +1,284 @@
+// resampler_bench - accuracy and throughput of the firmware's
+// PolyphaseResampler (components/BSP/MP3_PLAYER/resampler.cpp, compiled
+// unmodified) for every source rate the player may see.
+//
+// Usage: resampler_bench [options]
+// See README.md for what the columns mean.
+
+#include "resampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+  int out_rate = 48000;
+  std::vector<int> rates{8000,  11025, 12000, 16000, 22050,
+                         24000, 32000, 44100, 48000};
+  double seconds = 20.0; // 吞吐量测试的音频时长
+  bool accuracy = true;
+  bool throughput = true;
+};
+
+constexpr double kAmp = 16384.0; // -6 dBFS
+
+std::vector<int> parseList(const char *s) {
+  std::vector<int> v;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      v.push_back(atoi(item.c_str()));
+    }
+  }
+  return v;
+}
+
+// Feed the whole input in irregular blocks (like the players do) and collect
+// the output, including the filter tail.
+std::vector<int16_t> run(PolyphaseResampler &rs, const std::vector<int16_t> &in,
+                         int channels) {
+  std::vector<int16_t> out;
+  std::vector<int16_t> buf(512 * channels);
+  const size_t frames = in.size() / channels;
+  std::vector<int16_t> tail(rs.delayFrames() * channels, 0);
+
+  auto feed = [&](const int16_t *p, size_t n) {
+    while (n > 0) {
+      size_t used = 0;
+      size_t got = rs.process(p, n, &used, buf.data(), 512);
+      out.insert(out.end(), buf.begin(), buf.begin() + got * channels);
+      p += used * channels;
+      n -= used;
+    }
+  };
+  size_t pos = 0;
+  for (size_t i = 0; pos < frames; i++) {
+    const size_t block = std::min(frames - pos, 1 + (i * 37) % 509);
+    feed(in.data() + pos * channels, block);
+    pos += block;
+  }
+  feed(tail.data(), rs.delayFrames());
+  // 输出缓冲只在输入耗尽时才停止，最后一段可能还没取完
+  size_t got;
+  do {
+    got = rs.process(nullptr, 0, nullptr, buf.data(), 512);
+    out.insert(out.end(), buf.begin(), buf.begin() + got * channels);
+  } while (got > 0);
+  return out;
+}
+
+std::vector<int16_t> sine(double hz, int rate, size_t n) {
+  std::vector<int16_t> v(n);
+  for (size_t i = 0; i < n; i++) {
+    v[i] = (int16_t)std::lround(kAmp * std::sin(2.0 * M_PI * hz * i / rate));
+  }
+  return v;
+}
+
+struct Fit {
+  double snr_db = 0;
+  double gain_db = 0;
+};
+
+// Least-squares fit of a*sin + b*cos + c at a known frequency over the
+// steady-state part of y; everything else counts as error.
+Fit fitSine(const std::vector<int16_t> &y, double hz, int rate, size_t skip) {
+  const size_t n = y.size() > 2 * skip ? y.size() - 2 * skip : 0;
+  double ss = 0, cc = 0, sc = 0, s1 = 0, c1 = 0, ys = 0, yc = 0, y1 = 0;
+  for (size_t i = 0; i < n; i++) {
+    const double t = 2.0 * M_PI * hz * (double)(i + skip) / rate;
+    const double s = std::sin(t), c = std::cos(t), v = y[i + skip];
+    ss += s * s;
+    cc += c * c;
+    sc += s * c;
+    s1 += s;
+    c1 += c;
+    ys += v * s;
+    yc += v * c;
+    y1 += v;
+  }
+  // 3x3 normal equations (Cramer's rule)
+  const double m[3][3] = {{ss, sc, s1}, {sc, cc, c1}, {s1, c1, (double)n}};
+  const double r[3] = {ys, yc, y1};
+  auto det3 = [](const double a[3][3]) {
+    return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+           a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+           a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+  };
+  const double d = det3(m);
+  double coef[3];
+  for (int k = 0; k < 3; k++) {
+    double mk[3][3];
+    memcpy(mk, m, sizeof(mk));
+    for (int row = 0; row < 3; row++) {
+      mk[row][k] = r[row];
+    }
+    coef[k] = det3(mk) / d;
+  }
+  double sig = 0, err = 0;
+  for (size_t i = 0; i < n; i++) {
+    const double t = 2.0 * M_PI * hz * (double)(i + skip) / rate;
+    const double f = coef[0] * std::sin(t) + coef[1] * std::cos(t) + coef[2];
+    sig += f * f;
+    err += (y[i + skip] - f) * (y[i + skip] - f);
+  }
+  Fit fit;
+  fit.snr_db = 10.0 * std::log10(sig / std::max(err, 1e-9));
+  fit.gain_db =
+      20.0 * std::log10(std::hypot(coef[0], coef[1]) / kAmp + 1e-12);
+  return fit;
+}
+
+double rmsDbfs(const std::vector<int16_t> &y, size_t skip) {
+  double acc = 0;
+  size_t n = 0;
+  for (size_t i = skip; i + skip < y.size(); i++, n++) {
+    acc += (double)y[i] * y[i];
+  }
+  const double rms = n ? std::sqrt(acc / n) : 0.0;
+  return 20.0 * std::log10(rms / 32768.0 + 1e-12);
+}
+
+void accuracy(const Options &opt) {
+  printf("ACCURACY out=%d Hz, tones at -6 dBFS, 1 s each\n", opt.out_rate);
+  printf("%7s %5s %5s  %8s %8s  %8s %8s %8s  %9s\n", "in_hz", "taps", "phase",
+         "1k_snr", "1k_gain", "hf_hz", "hf_snr", "hf_gain", "alias_db");
+  for (int in : opt.rates) {
+    PolyphaseResampler rs;
+    if (!rs.configure(in, opt.out_rate, 1)) {
+      printf("%7d  unsupported\n", in);
+      continue;
+    }
+    const size_t n = (size_t)in;
+    const size_t skip = (size_t)opt.out_rate / 50; // 20 ms 过渡
+
+    rs.reset();
+    Fit lo = fitSine(run(rs, sine(1000.0, in, n), 1), 1000.0, opt.out_rate,
+                     skip);
+
+    // 高频音：两侧 Nyquist 较小者的 80%，检验通带边缘与镜像
+    // （频率错开整数比，避免正好落在采样点上）
+    const double hf = 0.4 * std::min(in, opt.out_rate) - 13.0;
+    rs.reset();
+    Fit hi = fitSine(run(rs, sine(hf, in, n), 1), hf, opt.out_rate, skip);
+
+    // 降采样：输出 Nyquist 与输入 Nyquist 之间的音应被滤掉
+    char alias[16] = "-";
+    if (in > opt.out_rate) {
+      const double f = 0.25 * (in + opt.out_rate) + 37.0;
+      rs.reset();
+      snprintf(alias, sizeof(alias), "%.1f",
+               rmsDbfs(run(rs, sine(f, in, n), 1), skip) -
+                   20.0 * std::log10(kAmp / 32768.0 / std::sqrt(2.0)));
+    }
+
+    const uint32_t g = std::gcd((uint32_t)in, (uint32_t)opt.out_rate);
+    const uint32_t phases =
+        std::min((uint32_t)opt.out_rate / g, PolyphaseResampler::kMaxPhases);
+    printf("%7d %5d %5u  %8.1f %8.2f  %8.0f %8.1f %8.2f  %9s\n", in,
+           rs.passthrough() ? 0 : (int)rs.delayFrames() * 2,
+           rs.passthrough() ? 0 : phases, lo.snr_db, lo.gain_db, hf, hi.snr_db,
+           hi.gain_db, alias);
+  }
+}
+
+void throughput(const Options &opt) {
+  printf("\nTHROUGHPUT out=%d Hz, %.0f s of noise per run, 512-frame blocks\n",
+         opt.out_rate, opt.seconds);
+  printf("%7s %3s  %10s %12s\n", "in_hz", "ch", "x_realtime", "Mframes/s");
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> dist(-16384, 16384);
+  for (int in : opt.rates) {
+    for (int ch = 1; ch <= PolyphaseResampler::kMaxChannels; ch++) {
+      PolyphaseResampler rs;
+      if (!rs.configure(in, opt.out_rate, ch)) {
+        continue;
+      }
+      const size_t frames = (size_t)(in * opt.seconds);
+      std::vector<int16_t> src(frames * ch);
+      for (auto &s : src) {
+        s = (int16_t)dist(rng);
+      }
+      std::vector<int16_t> out(512 * ch);
+      size_t produced = 0;
+      const auto t0 = std::chrono::steady_clock::now();
+      size_t pos = 0;
+      while (pos < frames) {
+        size_t used = 0;
+        const size_t n = std::min<size_t>(512, frames - pos);
+        produced += rs.process(src.data() + pos * ch, n, &used, out.data(), 512);
+        pos += used;
+      }
+      const double sec = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - t0)
+                             .count();
+      printf("%7d %3d  %10.0f %12.2f\n", in, ch, opt.seconds / sec,
+             produced / sec / 1e6);
+    }
+  }
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: resampler_bench [options]\n"
+          "  --out HZ             fixed output rate (48000)\n"
+          "  --rates A[,B..]      source rates (8000..48000 standard set)\n"
+          "  --seconds N          audio per throughput run (20)\n"
+          "  --accuracy-only      skip the throughput runs\n"
+          "  --throughput-only    skip the accuracy runs\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&](const char *name) -> const char * {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "%s needs a value\n", name);
+        exit(2);
+      }
+      return argv[++i];
+    };
+    if (a == "--out") {
+      opt.out_rate = atoi(next("--out"));
+    } else if (a == "--rates") {
+      opt.rates = parseList(next("--rates"));
+    } else if (a == "--seconds") {
+      opt.seconds = atof(next("--seconds"));
+    } else if (a == "--accuracy-only") {
+      opt.throughput = false;
+    } else if (a == "--throughput-only") {
+      opt.accuracy = false;
+    } else {
+      return false;
+    }
+  }
+  return opt.out_rate > 0 && !opt.rates.empty() && opt.seconds > 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  if (opt.accuracy) {
+    accuracy(opt);
+  }
+  if (opt.throughput) {
+    throughput(opt);
+  }
+  return 0;
+}
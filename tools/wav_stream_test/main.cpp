@@ -0,0 +1,318 @@
+// wav_stream_test - host check of the incremental WAV parser and the stereo
+// downmix carry in components/BSP/MP3_PLAYER/wav_stream.cpp (compiled
+// unmodified). Every case is fed split at every byte offset, the way TCP
+// hands the HTTP body to WavStreamPlayer::write().
+//
+// Usage: wav_stream_test
+// Exit status is non-zero on any mismatch. See README.md.
+
+#include "mp3_player.h"
+#include "wav_stream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// ============= Host fakes for wav_stream.cpp =============
+
+namespace {
+
+// Mp3Player::pcmStreamWrite 收到的 PCM（双声道已下混）
+std::vector<uint8_t> g_played;
+uint32_t g_beginRate = 0;
+int g_begins = 0;
+int g_ends = 0;
+
+} // namespace
+
+const char *esp_err_to_name(esp_err_t code) {
+  return code == ESP_OK ? "ESP_OK" : "ESP_ERR";
+}
+
+void replay_log(char, const char *, const char *, ...) {}
+
+void AudioMixer::deinit() {}
+
+Mp3Player &Mp3Player::instance() {
+  static Mp3Player instance;
+  return instance;
+}
+
+esp_err_t Mp3Player::pcmStreamBegin(uint32_t sample_rate_hz, uint32_t,
+                                    const char *) {
+  g_beginRate = sample_rate_hz;
+  g_begins++;
+  return ESP_OK;
+}
+
+esp_err_t Mp3Player::pcmStreamWrite(const uint8_t *data, size_t len,
+                                    uint32_t) {
+  g_played.insert(g_played.end(), data, data + len);
+  return ESP_OK;
+}
+
+esp_err_t Mp3Player::pcmStreamEnd() {
+  g_ends++;
+  return ESP_OK;
+}
+
+esp_err_t Mp3Player::pcmStreamFlush() { return ESP_OK; }
+
+JitterStats Mp3Player::getJitterStats() const { return JitterStats{}; }
+
+// ============= Test streams =============
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+int g_failures = 0;
+
+void fail(const std::string &name, size_t split, const char *what) {
+  // 同一个错误会在每个切分点重复出现，只打印前几条
+  if (g_failures < 10) {
+    printf("FAIL %s (split %zu): %s\n", name.c_str(), split, what);
+  }
+  g_failures++;
+}
+
+void put16(Bytes &b, uint16_t v) {
+  b.push_back((uint8_t)v);
+  b.push_back((uint8_t)(v >> 8));
+}
+
+void put32(Bytes &b, uint32_t v) {
+  put16(b, (uint16_t)v);
+  put16(b, (uint16_t)(v >> 16));
+}
+
+void putChunk(Bytes &b, const char *id, const Bytes &body, bool pad = true) {
+  b.insert(b.end(), id, id + 4);
+  put32(b, (uint32_t)body.size());
+  b.insert(b.end(), body.begin(), body.end());
+  if (pad && (body.size() & 1)) {
+    b.push_back(0xAA); // 填充字节，不能被当成下一个块头
+  }
+}
+
+// makeCase 的 dataSize：按实际 PCM 长度填写 data 块头
+constexpr uint32_t kExactSize = 1;
+
+struct Case {
+  std::string name;
+  Bytes stream;
+  uint16_t channels = 1;
+  uint32_t rate = 16000;
+  Bytes pcm; // data 块里的 PCM（下混前）
+};
+
+Bytes fmtBody(uint16_t tag, uint16_t channels, uint32_t rate, size_t size) {
+  Bytes f;
+  put16(f, tag);
+  put16(f, channels);
+  put32(f, rate);
+  put32(f, rate * channels * 2);
+  put16(f, (uint16_t)(channels * 2));
+  put16(f, 16);
+  f.resize(size, 0);
+  return f;
+}
+
+Bytes extensibleFmt(uint16_t channels, uint32_t rate) {
+  // KSDATAFORMAT_SUBTYPE_PCM
+  static const uint8_t kPcmGuid[16] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                       0x10, 0x00, 0x80, 0x00, 0x00, 0xAA,
+                                       0x00, 0x38, 0x9B, 0x71};
+  Bytes f = fmtBody(0xFFFE, channels, rate, 16);
+  put16(f, 22); // cbSize
+  put16(f, 16); // wValidBitsPerSample
+  put32(f, channels == 2 ? 0x3 : 0x4);
+  f.insert(f.end(), kPcmGuid, kPcmGuid + sizeof(kPcmGuid));
+  return f;
+}
+
+Bytes makePcm(size_t frames, uint16_t channels) {
+  Bytes b;
+  uint32_t s = 1;
+  for (size_t i = 0; i < frames * channels; i++) {
+    s = s * 1664525u + 1013904223u;
+    put16(b, (uint16_t)(s >> 16));
+  }
+  return b;
+}
+
+Case makeCase(const std::string &name, const Bytes &fmt, uint16_t channels,
+              uint32_t dataSize, bool listFirst, bool trailer) {
+  Case c;
+  c.name = name;
+  c.channels = channels;
+  c.pcm = makePcm(37, channels); // 奇数帧数，末尾不对齐任何块大小
+  Bytes body;
+  body.insert(body.end(), {'W', 'A', 'V', 'E'});
+  if (listFirst) {
+    const char info[] = "INFOISFT\x05\0\0\0Lavf\0"; // 奇数长度 + 填充
+    putChunk(body, "LIST", Bytes(info, info + sizeof(info) - 1));
+  }
+  putChunk(body, "fmt ", fmt);
+  putChunk(body, "fact", Bytes{1, 2, 3, 4});
+  body.insert(body.end(), {'d', 'a', 't', 'a'});
+  put32(body, dataSize == kExactSize ? (uint32_t)c.pcm.size() : dataSize);
+  body.insert(body.end(), c.pcm.begin(), c.pcm.end());
+  if (trailer) {
+    putChunk(body, "LIST", Bytes{'I', 'N', 'F', 'O', 'x'});
+  }
+  c.stream.insert(c.stream.end(), {'R', 'I', 'F', 'F'});
+  put32(c.stream, (uint32_t)body.size());
+  c.stream.insert(c.stream.end(), body.begin(), body.end());
+  return c;
+}
+
+// 每个切分点都把流分成两次 feed，另外再逐字节喂一遍
+void checkParser(const Case &c) {
+  for (size_t split = 0; split <= c.stream.size() + 1; split++) {
+    WavStreamParser p;
+    Bytes got;
+    auto feedAll = [&](const uint8_t *in, size_t len, size_t step) {
+      while (len > 0) {
+        const size_t n = std::min(len, step);
+        size_t off = 0;
+        while (off < n) {
+          const uint8_t *pcm = nullptr;
+          size_t pcmLen = 0;
+          off += p.feed(in + off, n - off, &pcm, &pcmLen);
+          got.insert(got.end(), pcm, pcm + pcmLen);
+        }
+        in += n;
+        len -= n;
+      }
+    };
+    if (split <= c.stream.size()) {
+      feedAll(c.stream.data(), split, split ? split : 1);
+      feedAll(c.stream.data() + split, c.stream.size() - split,
+              c.stream.size());
+    } else {
+      feedAll(c.stream.data(), c.stream.size(), 1);
+    }
+    if (p.failed() || !p.ready()) {
+      fail(c.name, split, p.failed() ? p.error() : "never reached data");
+      continue;
+    }
+    const WavFormat &f = p.format();
+    if (f.format_tag != 1 || f.channels != c.channels ||
+        f.sample_rate != c.rate || f.bits_per_sample != 16 ||
+        f.block_align != c.channels * 2) {
+      fail(c.name, split, "wrong format");
+    }
+    // 有界 data 块之后的尾部块不能混进 PCM
+    if (got != c.pcm) {
+      fail(c.name, split, "wrong pcm");
+    }
+  }
+}
+
+// 双声道的一帧 4 字节可能被切在任意位置（m_carry）
+void checkPlayer(const Case &c) {
+  Bytes want;
+  for (size_t i = 0; i + c.channels * 2 <= c.pcm.size(); i += c.channels * 2) {
+    const int32_t l = (int16_t)(c.pcm[i] | (c.pcm[i + 1] << 8));
+    int32_t v = l;
+    if (c.channels == 2) {
+      const int32_t r = (int16_t)(c.pcm[i + 2] | (c.pcm[i + 3] << 8));
+      v = (l + r) >> 1;
+    }
+    put16(want, (uint16_t)(int16_t)v);
+  }
+  for (size_t a = 0; a <= c.stream.size(); a++) {
+    // 三段：[0,a) [a,a+3) [a+3,end)，让半帧跨两次 write
+    const size_t b = std::min(a + 3, c.stream.size());
+    g_played.clear();
+    g_begins = g_ends = 0;
+    {
+      WavStreamPlayer player;
+      if (player.write(c.stream.data(), a) != ESP_OK ||
+          player.write(c.stream.data() + a, b - a) != ESP_OK ||
+          player.write(c.stream.data() + b, c.stream.size() - b) != ESP_OK ||
+          player.finish() != ESP_OK) {
+        fail(c.name, a, "player write failed");
+        continue;
+      }
+      if (player.pcmBytes() < c.pcm.size()) {
+        fail(c.name, a, "pcmBytes short");
+      }
+    }
+    if (g_begins != 1 || g_ends != 1 || g_beginRate != c.rate) {
+      fail(c.name, a, "pcmStreamBegin/End not called once");
+    }
+    if (g_played.size() < want.size() ||
+        !std::equal(want.begin(), want.end(), g_played.begin())) {
+      fail(c.name, a, "wrong downmix");
+    }
+  }
+}
+
+void checkRejects() {
+  struct Bad {
+    const char *name;
+    Bytes stream;
+  };
+  std::vector<Bad> bad;
+  {
+    Case c = makeCase("x", fmtBody(1, 1, 16000, 16), 1, kExactSize, false,
+                      false);
+    c.stream[8] = 'A'; // WAVE -> AAVE
+    bad.push_back({"not WAVE", c.stream});
+  }
+  {
+    Bytes s = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E'};
+    putChunk(s, "data", Bytes{0, 0});
+    bad.push_back({"data before fmt", s});
+  }
+  {
+    Bytes s = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E'};
+    putChunk(s, "fmt ", Bytes(14, 0));
+    bad.push_back({"short fmt", s});
+  }
+  for (const Bad &b : bad) {
+    WavStreamParser p;
+    const uint8_t *pcm = nullptr;
+    size_t pcmLen = 0;
+    size_t off = 0;
+    while (off < b.stream.size() && !p.failed()) {
+      off += p.feed(b.stream.data() + off, b.stream.size() - off, &pcm,
+                    &pcmLen);
+    }
+    if (!p.failed()) {
+      fail(b.name, 0, "accepted");
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+  const std::vector<Case> cases = {
+      makeCase("mono pcm", fmtBody(1, 1, 16000, 16), 1, kExactSize, false,
+               true),
+      makeCase("LIST before fmt", fmtBody(1, 1, 16000, 18), 1, kExactSize,
+               true, true),
+      makeCase("odd fmt + pad", fmtBody(1, 1, 16000, 17), 1, kExactSize, true,
+               false),
+      makeCase("extensible stereo", extensibleFmt(2, 16000), 2, kExactSize,
+               false, true),
+      // 流式 data 块延续到响应结束，所以这两个没有尾部块
+      makeCase("streaming size 0", fmtBody(1, 2, 16000, 16), 2, 0, true,
+               false),
+      makeCase("streaming size ~0", extensibleFmt(1, 16000), 1, 0xFFFFFFFFu,
+               false, false),
+      makeCase("stereo pcm", fmtBody(1, 2, 16000, 16), 2, kExactSize, true,
+               true),
+  };
+  for (const Case &c : cases) {
+    checkParser(c);
+    checkPlayer(c);
+  }
+  checkRejects();
+  printf("wav_stream: %zu streams, %d failures\n", cases.size(), g_failures);
+  return g_failures == 0 ? 0 : 1;
+}